@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Accuracy report of the single precision (float) path against the
+    double path on the reference spectra: SNIP, smoothing and peak finding.
+    Also times the batch SNIP for both precisions.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace peakingduck;
+
+using Data = core::NumericalData<double>;
+using DataF = core::NumericalData<float>;
+
+// errors below this (relative to the largest value) are within float rounding
+constexpr double TOLERANCE = 1e-4;
+
+/*!
+   @brief The maximum absolute difference, relative to the largest
+   (absolute) value of the double result
+*/
+double maxRelativeError(const Data& expected, const DataF& candidate)
+{
+    double scale = 1.0;
+    double error = 0.0;
+    for(int i=0; i<expected.size(); ++i){
+        scale = std::max(scale, std::abs(expected[i]));
+        error = std::max(error, std::abs(expected[i] - static_cast<double>(candidate[i])));
+    }
+    return error/scale;
+}
+
+void reportAccuracy(const std::string& name, double error)
+{
+    std::cout << std::left << std::setw(45) << name
+              << std::right << std::scientific << std::setprecision(3)
+              << std::setw(15) << error
+              << std::setw(8) << (error < TOLERANCE ? "ok" : "FAIL") << std::endl;
+}
+
+// the number of peaks found with both precisions, a peak can move by a
+// channel when two neighbouring values are the same to within float rounding
+size_t matchingPeaks(const core::PeakList<double>& expected, const core::PeakList<float>& candidate)
+{
+    constexpr int CHANNELTOLERANCE = 1;
+    size_t nmatching = 0;
+    for(const auto& peak: candidate){
+        nmatching += std::any_of(expected.begin(), expected.end(),
+            [&](const core::PeakInfo<double>& other){ 
+                return std::abs(static_cast<int>(other.index) - static_cast<int>(peak.index)) <= CHANNELTOLERANCE; 
+            });
+    }
+    return nmatching;
+}
+
+int main()
+{
+    const std::vector<Data> spectra = benchmarks::referenceSpectra<double>();
+    const std::vector<DataF> spectraf = benchmarks::referenceSpectra<float>();
+
+    std::cout << std::left << std::setw(45) << "float vs double"
+              << std::right << std::setw(15) << "max rel. error" << std::endl;
+
+    bool allok = true;
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const DataF& dataf = spectraf[i];
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+
+        // background
+        const Data background = data.snip(20);
+        const DataF backgroundf = dataf.snip(20);
+        const double snipError = maxRelativeError(background, backgroundf);
+        reportAccuracy(label + "snip", snipError);
+
+        // smoothing
+        const double masError = maxRelativeError(core::MovingAverageSmoother<double>(5).go(data),
+                                                 core::MovingAverageSmoother<float>(5).go(dataf));
+        reportAccuracy(label + "moving average", masError);
+
+        const double wmasError = maxRelativeError(core::WeightedMovingAverageSmoother<double>(5).go(data),
+                                                  core::WeightedMovingAverageSmoother<float>(5).go(dataf));
+        reportAccuracy(label + "weighted moving average", wmasError);
+
+        // peaks - background removed then smoothed
+        const Data signal = core::MovingAverageSmoother<double>(2).go(data - background);
+        const DataF signalf = core::MovingAverageSmoother<float>(2).go(dataf - backgroundf);
+        const core::PeakList<double> peaks = core::SimplePeakFinder<double>(0.05).find(signal);
+        const core::PeakList<float> peaksf = core::SimplePeakFinder<float>(0.05f).find(signalf);
+        const size_t nmatching = matchingPeaks(peaks, peaksf);
+        std::cout << std::left << std::setw(45) << label + "peaks (double/float/both)"
+                  << std::right << std::setw(15) << (std::to_string(peaks.size()) + "/" + std::to_string(peaksf.size()) + "/" + std::to_string(nmatching))
+                  << std::setw(8) << (nmatching == peaks.size() && nmatching == peaksf.size() ? "ok" : "FAIL") << std::endl;
+
+        allok &= snipError < TOLERANCE && masError < TOLERANCE && wmasError < TOLERANCE;
+        allok &= nmatching == peaks.size() && nmatching == peaksf.size();
+    }
+
+    // all the reference spectra (repeated) in one batch
+    std::vector<Data> repeated;
+    for(int r=0; r<16; ++r){
+        repeated.insert(repeated.end(), spectra.begin(), spectra.end());
+    }
+    const core::NumericalBatch<double> batch(repeated);
+    const core::NumericalBatch<float> batchf = batch.cast<float>();
+    core::NumericalBatch<double> work = batch;
+    core::NumericalBatch<float> workf = batchf;
+
+    std::cout << std::endl;
+    benchmarks::header("double", "float");
+    benchmarks::report("batch snip (" + std::to_string(batch.nspectra()) + " spectra)",
+        benchmarks::timeit([&](){ work = batch; work.snipInPlace(20); benchmarks::consume(work(0, 0)); }, 5),
+        benchmarks::timeit([&](){ workf = batchf; workf.snipInPlace(20); benchmarks::consume(workf(0, 0)); }, 5));
+
+    if(!allok){
+        std::cerr << "Single precision results differ from the double precision results!" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Compares processing spectra one at a time with processing them
+    as a NumericalBatch, using copies of the reference spectra.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace peakingduck;
+
+using Data = core::NumericalData<double>;
+using Batch = core::NumericalBatch<double>;
+
+int main()
+{
+    const std::vector<Data> reference = benchmarks::referenceSpectra();
+    if(reference.empty()){
+        return 1;
+    }
+
+    // make a larger batch from copies
+    const int nspectra = 64;
+    std::vector<Data> spectra;
+    for(int i=0; i<nspectra; ++i){
+        spectra.push_back(reference[i % reference.size()]);
+    }
+    const Batch batch(spectra);
+    const std::string label = std::to_string(nspectra) + " spectra ";
+
+    const core::MovingAverageSmoother<double> smoother(5);
+    const core::GlobalThresholdPeakFilter<double> filter(0.1);
+
+    benchmarks::header("per spectrum", "batch");
+    benchmarks::report(label + "LLS", 
+        benchmarks::timeit([&](){ for(const auto& s: spectra){ benchmarks::consume(s.LLS()[0]); } }, 5),
+        benchmarks::timeit([&](){ benchmarks::consume(batch.LLS()(0, 0)); }, 5));
+    benchmarks::report(label + "midpoint", 
+        benchmarks::timeit([&](){ for(const auto& s: spectra){ benchmarks::consume(s.midpoint(3)[0]); } }, 5),
+        benchmarks::timeit([&](){ benchmarks::consume(batch.midpoint(3)(0, 0)); }, 5));
+    benchmarks::report(label + "gradient(2)", 
+        benchmarks::timeit([&](){ for(const auto& s: spectra){ benchmarks::consume(s.gradient(2)[0]); } }, 5),
+        benchmarks::timeit([&](){ benchmarks::consume(batch.gradient(2)(0, 0)); }, 5));
+    benchmarks::report(label + "snip(20)", 
+        benchmarks::timeit([&](){ for(const auto& s: spectra){ benchmarks::consume(s.snip(20)[0]); } }, 5),
+        benchmarks::timeit([&](){ benchmarks::consume(batch.snip(20)(0, 0)); }, 5));
+    benchmarks::report(label + "moving average smoother", 
+        benchmarks::timeit([&](){ for(const auto& s: spectra){ benchmarks::consume(smoother.go(s)[0]); } }, 5),
+        benchmarks::timeit([&](){ benchmarks::consume(smoother.go(batch)(0, 0)); }, 5));
+    benchmarks::report(label + "global threshold filter", 
+        benchmarks::timeit([&](){ for(const auto& s: spectra){ benchmarks::consume(filter.go(s)[0]); } }, 5),
+        benchmarks::timeit([&](){ benchmarks::consume(filter.go(batch)(0, 0)); }, 5));
+    return 0;
+}
@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Simple timing helpers shared by the benchmarks.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef BENCHMARKS_BENCHMARK_HPP
+#define BENCHMARKS_BENCHMARK_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+#include "peakingduck.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(benchmarks)
+
+    constexpr int NREFERENCESPECTRA = 4;
+
+    /*!
+       @brief Read the counts of the reference spectra (reference/spectrum*.csv)
+    */
+    template<typename T=core::DefaultType>
+    std::vector<core::NumericalData<T>> referenceSpectra()
+    {
+        std::vector<core::NumericalData<T>> spectra;
+        for(int i=0; i<NREFERENCESPECTRA; ++i){
+            const std::string filename = std::string(PEAKINGDUCK_REFERENCE_DIR) + "/spectrum" + std::to_string(i) + ".csv";
+            std::ifstream stream(filename);
+            if(!stream.good()){
+                std::cerr << "Cannot open reference spectrum: " << filename << std::endl;
+                continue;
+            }
+
+            core::Histogram<T, T> hist;
+            io::Deserialize<T, T, ','>(stream, hist);
+            spectra.push_back(hist.Y());
+        }
+        return spectra;
+    }
+
+    /*!
+       @brief Time a function, returning the best (minimum) of the repeats in microseconds.
+       The function is called once before timing to warm up.
+    */
+    template<class Function>
+    double timeit(Function&& function, int repeats=20)
+    {
+        function();
+        double best = std::numeric_limits<double>::max();
+        for(int i=0; i<repeats; ++i){
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::micro>(end - start).count());
+        }
+        return best;
+    }
+
+    /*!
+       @brief Print a comparison of the reference and candidate timings
+    */
+    inline void report(const std::string& name, double reference, double candidate)
+    {
+        std::cout << std::left << std::setw(40) << name 
+                  << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << reference << " us"
+                  << std::setw(12) << candidate << " us"
+                  << std::setw(10) << reference/candidate << "x" << std::endl;
+    }
+
+    inline void header(const std::string& reference, const std::string& candidate)
+    {
+        std::cout << std::left << std::setw(40) << "benchmark" 
+                  << std::right << std::setw(15) << reference
+                  << std::setw(15) << candidate
+                  << std::setw(11) << "speedup" << std::endl;
+    }
+
+    /*!
+       @brief Keep the result alive so the compiler cannot remove the work
+    */
+    template<typename T>
+    void consume(const T& value)
+    {
+        static volatile double sink = 0;
+        sink = sink + static_cast<double>(value);
+    }
+
+PEAKINGDUCK_NAMESPACE_END // benchmarks
+PEAKINGDUCK_NAMESPACE_END // peakingduck
+
+#endif // BENCHMARKS_BENCHMARK_HPP
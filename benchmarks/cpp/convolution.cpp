@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Compares the direct and FFT (overlap-save) convolution over kernel
+    sizes on the reference spectra (used to set ConvolutionEngine::FFTCost),
+    and the weighted moving average (a box cascade) with a wide window 
+    against the same kernel through the ConvolutionSmoother.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace peakingduck;
+
+using Data = core::NumericalData<double>;
+
+double maxRelativeDifference(const Data& expected, const Data& candidate)
+{
+    double maxdiff = 0.0;
+    for(int j=0; j<expected.size(); ++j){
+        maxdiff = std::max(maxdiff, std::abs(expected[j] - candidate[j])/std::max(1.0, std::abs(expected[j])));
+    }
+    return maxdiff;
+}
+
+std::string methodName(core::ConvolutionMethod method)
+{
+    switch(method){
+        case core::ConvolutionMethod::FFT: return "fft";
+        case core::ConvolutionMethod::Separable: return "separable";
+        default: return "direct";
+    }
+}
+
+int main()
+{
+    const std::vector<Data> spectra = benchmarks::referenceSpectra();
+
+    benchmarks::header("direct", "fft");
+    double maxdiff = 0.0;
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+
+        for(int half: {4, 16, 32, 64, 128, 512}){
+            const Data kernel = core::gaussianKernel<double>(half/4.0);
+            core::ConvolutionEngine<double> direct(kernel, core::ConvolutionMethod::Direct);
+            core::ConvolutionEngine<double> fft(kernel, core::ConvolutionMethod::FFT);
+            const core::ConvolutionEngine<double> automatic(kernel);
+            Data result(data.size());
+
+            maxdiff = std::max(maxdiff, maxRelativeDifference(direct.convolve(data), fft.convolve(data)));
+            benchmarks::report(label + "K=" + std::to_string(kernel.size()) + " (" + methodName(automatic.method(data.size())) + ")",
+                benchmarks::timeit([&](){ direct.convolve(data, result); benchmarks::consume(result[0]); }),
+                benchmarks::timeit([&](){ fft.convolve(data, result); benchmarks::consume(result[0]); }));
+        }
+    }
+
+    std::cout << std::endl;
+    benchmarks::header("box cascade", "convolution");
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+
+        for(int windowsize: {16, 64, 256}){
+            const core::WeightedMovingAverageSmoother<double> weighted(windowsize);
+            // the weighted moving average is a correlation, so the reversed kernel
+            const Data weights = core::weightedMovingAverageWeights<double>(windowsize);
+            const core::ConvolutionSmoother<double> convolution(Data(weights.reverse()));
+            maxdiff = std::max(maxdiff, maxRelativeDifference(weighted.go(data), convolution.go(data)));
+            benchmarks::report(label + "WMAS w=" + std::to_string(windowsize),
+                benchmarks::timeit([&](){ benchmarks::consume(weighted.go(data)[0]); }),
+                benchmarks::timeit([&](){ benchmarks::consume(convolution.go(data)[0]); }));
+        }
+    }
+
+    std::cout << "max relative difference: " << maxdiff << std::endl;
+    return 0;
+}
@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Compares arithmetic chains evaluated one step at a time (a new array
+    per operation, as before) with the lazy expressions which evaluate
+    the whole chain in a single loop on assignment.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace peakingduck;
+
+using Data = core::NumericalData<double>;
+
+// the previous implementations, every step is materialised
+Data sqrtLogSteps(const Data& data)
+{
+    const Data shifted = data + 1.0;
+    const Data rooted = shifted.sqrt();
+    return rooted.log();
+}
+
+Data LLSSteps(const Data& data)
+{
+    const Data one = data + 1.0;
+    const Data two = one.sqrt();
+    const Data three = two + 1.0;
+    const Data four = three.log();
+    const Data five = four + 1.0;
+    return five.log();
+}
+
+Data signalSteps(const Data& data, const Data& background, double gain, double offset)
+{
+    const Data signal = data - background;
+    const Data scaled = signal*gain;
+    return scaled + offset;
+}
+
+bool same(const Data& lhs, const Data& rhs)
+{
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+int main()
+{
+    const std::vector<Data> spectra = benchmarks::referenceSpectra();
+
+    benchmarks::header("per step", "lazy");
+    bool allsame = true;
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const Data background = data.snip(20);
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+
+        Data result = data;
+        allsame &= same(sqrtLogSteps(data), (result = (data + 1.0).sqrt().log()));
+        benchmarks::report(label + "(x+1).sqrt().log()",
+            benchmarks::timeit([&](){ result = sqrtLogSteps(data); benchmarks::consume(result[0]); }),
+            benchmarks::timeit([&](){ result = (data + 1.0).sqrt().log(); benchmarks::consume(result[0]); }));
+
+        allsame &= same(LLSSteps(data), (result = data.LLS()));
+        benchmarks::report(label + "LLS",
+            benchmarks::timeit([&](){ result = LLSSteps(data); benchmarks::consume(result[0]); }),
+            benchmarks::timeit([&](){ result = data.LLS(); benchmarks::consume(result[0]); }));
+
+        allsame &= same(signalSteps(data, background, 2.0, 1.0), (result = (data - background)*2.0 + 1.0));
+        benchmarks::report(label + "(x-background)*gain+offset",
+            benchmarks::timeit([&](){ result = signalSteps(data, background, 2.0, 1.0); benchmarks::consume(result[0]); }),
+            benchmarks::timeit([&](){ result = (data - background)*2.0 + 1.0; benchmarks::consume(result[0]); }));
+    }
+
+    if(!allsame){
+        std::cerr << "Lazy results differ from the per step results!" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Times the Gaussian peak fitting of the prominent peaks of the
+    reference spectra (and 1M channels), and the deconvolution of
+    the groups of the simple peak finder into multiplets, on the 
+    calling thread only against the thread pool, with the fits per
+    second.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace peakingduck;
+
+using Data = core::NumericalData<double>;
+
+int main()
+{
+    const std::vector<Data> spectra = benchmarks::referenceSpectra();
+
+    // the reference spectra repeated to 1M channels
+    Data large(1 << 20);
+    for(int i=0; i<large.size(); ++i){
+        large[i] = spectra[(i/spectra[0].size()) % spectra.size()][i % spectra[0].size()];
+    }
+
+    benchmarks::header("no workers", "thread pool");
+    std::cout << "threads: " << util::ThreadPool::shared().nthreads() << std::endl;
+    util::ThreadPool serial(0);
+    const core::LocalMaximaPeakFinder<double> finder({}, {}, 5.0, 50.0);
+    int mismatches = 0;
+    for(const Data* data: std::vector<const Data*>{&spectra[0], &spectra[1], &large}){
+        const std::vector<core::FitRegion> regions = core::fitRegions(finder.find(*data), 8, data->size());
+        const int repeats = data->size() > 100000 ? 3 : 20;
+
+        for(bool tails: {false, true}){
+            const std::string label = "(" + std::to_string(data->size()) + ") " + std::to_string(regions.size())
+                + " regions" + (tails ? " with tails" : "");
+            const core::GaussianPeakFitter<double> fitter(core::FitBackground::Linear, tails);
+            const core::GaussianPeakFitter<double> serialfitter(core::FitBackground::Linear, tails, 100, 1e-8, serial);
+            const core::PeakFits<double> fits = fitter.fit(*data, regions);
+            mismatches += fits.centroids != serialfitter.fit(*data, regions).centroids;
+
+            const double time = benchmarks::timeit([&](){ benchmarks::consume(fitter.fit(*data, regions).size()); }, repeats);
+            benchmarks::report(label,
+                benchmarks::timeit([&](){ benchmarks::consume(serialfitter.fit(*data, regions).size()); }, repeats),
+                time);
+            std::cout << "    " << static_cast<int>(fits.size()/(time*1e-6)) << " peaks/s" << std::endl;
+        }
+    }
+
+    // the groups of the simple finder deconvolved into multiplets
+    std::cout << std::endl;
+    benchmarks::header("no workers", "thread pool");
+    for(const Data* data: std::vector<const Data*>{&spectra[0], &spectra[1], &large}){
+        const std::vector<core::FitRegion> regions = core::multipletRegions<double>(*data, 0.01, 6);
+        const int repeats = data->size() > 100000 ? 3 : 20;
+        const std::string label = "(" + std::to_string(data->size()) + ") " + std::to_string(regions.size()) + " multiplets";
+        const core::MultipletFitter<double> fitter(4);
+        const core::MultipletFitter<double> serialfitter(4, core::FitBackground::Linear, 100, 1e-8, serial);
+        const core::PeakFits<double> fits = fitter.fit(*data, regions);
+        mismatches += fits.centroids != serialfitter.fit(*data, regions).centroids;
+
+        const double time = benchmarks::timeit([&](){ benchmarks::consume(fitter.fit(*data, regions).size()); }, repeats);
+        benchmarks::report(label,
+            benchmarks::timeit([&](){ benchmarks::consume(serialfitter.fit(*data, regions).size()); }, repeats),
+            time);
+        std::cout << "    " << fits.size() << " peaks, " << static_cast<int>(regions.size()/(time*1e-6)) << " multiplets/s" << std::endl;
+    }
+
+    std::cout << "mismatched fits: " << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Compares the recursive gradient with the single pass
+    GradientEngine on the reference spectra.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace peakingduck;
+
+using Data = core::NumericalData<double>;
+
+int main()
+{
+    const std::vector<Data> spectra = benchmarks::referenceSpectra();
+
+    benchmarks::header("recursive", "engine");
+    double maxdiff = 0.0;
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+
+        for(int order=1; order<=3; ++order){
+            const core::GradientEngine<double> engine(order);
+            Data output(data.size());
+
+            const Data expected = data.gradient(order);
+            engine.apply(data, output);
+            for(int j=0; j<data.size(); ++j){
+                maxdiff = std::max(maxdiff, std::abs(expected[j] - output[j])/std::max(1.0, std::abs(expected[j])));
+            }
+
+            benchmarks::report(label + "gradient(" + std::to_string(order) + ")", 
+                benchmarks::timeit([&](){ benchmarks::consume(data.gradient(order)[0]); }),
+                benchmarks::timeit([&](){ engine.apply(data, output); benchmarks::consume(output[0]); }));
+        }
+    }
+
+    std::cout << "max relative difference: " << maxdiff << std::endl;
+    return maxdiff < 1e-12 ? 0 : 1;
+}
@@ -0,0 +1,260 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Compares the peak finders with the previous versions on the
+    reference spectra, the window peak finder with a window copy,
+    mean and stddev per point (as the original Python version)
+    against the prefix sums, the simple peak finder building
+    the groups then the maxima against a single pass, the 
+    chunked peak filter copying each chunk against the views on
+    the thread pool (on 1M channels), and the local maxima 
+    prominences searched from each peak (as scipy) against the 
+    monotonic stack, a new peak list sorted and filtered per
+    spectrum against a reused peak table, and the gradient peak
+    finder derivatives from a smoother call each against the 
+    fused pass.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace peakingduck;
+
+using Data = core::NumericalData<double>;
+
+// the previous window peak finder, a window per point
+std::vector<int> windowPeaks(const Data& data, double threshold, int ninner, int nouter)
+{
+    std::vector<int> indices;
+    for(int i=3; i<=data.size()-4; ++i){
+        const Data values = core::window(data, i, nouter, ninner, false);
+        const double localthreshold = values.mean() + values.stddev(1)*threshold;
+        if((localthreshold < data[i]) && (localthreshold <= data[i+1]) && (localthreshold <= data[i-1])){
+            indices.push_back(i);
+        }
+    }
+    return indices;
+}
+
+// the previous simple peak finder, the groups then the maximum of each
+core::PeakList<double> groupPeaks(const Data& data, double percentThreshold)
+{
+    const double threshold = data.maxCoeff()*percentThreshold;
+    std::vector<std::vector<size_t>> groups;
+    std::vector<size_t> group;
+    int last = -1;
+    for(int i=0; i<data.size(); ++i){
+        if(data[i] > threshold){
+            if((last + 1 < i) && (last >= 0)){
+                groups.emplace_back(group);
+                group.resize(0);
+            }
+            group.emplace_back(i);
+            last = i;
+        }
+    }
+    if(group.size() > 0){
+        groups.emplace_back(group);
+    }
+
+    core::PeakList<double> peaks;
+    for(auto& g: groups){
+        double maxvalue = -1.0;
+        size_t maxindex = -1;
+        for(auto i: g){
+            if(data[i] > maxvalue){
+                maxvalue = data[i];
+                maxindex = i;
+            }
+        }
+        peaks.emplace_back(maxindex, data[maxindex]);
+    }
+    return peaks;
+}
+
+// the previous chunked threshold filter, a copy per chunk
+Data chunkedThreshold(const Data& data, double percentThreshold, int chunksize)
+{
+    Data processed = Data::Zero(data.size());
+    const core::GlobalThresholdPeakFilter<double> gpf(percentThreshold);
+    for(int start=0; start<data.size(); start+=chunksize){
+        const Data newdata = gpf.go(data(start, std::min<int>(data.size(), start + chunksize)));
+        for(int i=0; i<newdata.size(); ++i){
+            processed[start+i] = newdata[i];
+        }
+    }
+    return processed;
+}
+
+// the zero crossings of the Savitzky-Golay derivatives, a smoother call per derivative
+std::vector<int> smoothedCrossings(const Data& data, int windowsize)
+{
+    const Data first = core::SavitzkyGolaySmoother<double>(windowsize, 2, 1).go(data);
+    const Data second = core::SavitzkyGolaySmoother<double>(windowsize, 2, 2).go(data);
+    std::vector<int> indices;
+    for(int i=windowsize/2; i<data.size()-windowsize/2-1; ++i){
+        if(first[i] > 0.0 && first[i+1] <= 0.0){
+            const double fraction = first[i]/(first[i] - first[i+1]);
+            if(second[i] + fraction*(second[i+1] - second[i]) < 0.0){
+                indices.push_back(fraction < 0.5 ? i : i + 1);
+            }
+        }
+    }
+    return indices;
+}
+
+int main()
+{
+    const std::vector<Data> spectra = benchmarks::referenceSpectra();
+
+    benchmarks::header("window copies", "prefix sums");
+    int mismatches = 0;
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+
+        for(int nouter: {10, 40, 160}){
+            const core::WindowPeakFinder<double> finder(2.0, 3, nouter);
+            const std::vector<int> expected = windowPeaks(data, 2.0, 3, nouter);
+            const core::PeakList<double> peaks = finder.find(data);
+            mismatches += peaks.size() != expected.size();
+            for(size_t p=0; p<std::min(peaks.size(), expected.size()); ++p){
+                mismatches += peaks[p].index != static_cast<size_t>(expected[p]);
+            }
+            benchmarks::report(label + "window finder(" + std::to_string(nouter) + ")",
+                benchmarks::timeit([&](){ benchmarks::consume(windowPeaks(data, 2.0, 3, nouter).size()); }),
+                benchmarks::timeit([&](){ benchmarks::consume(finder.find(data).size()); }));
+        }
+    }
+
+    std::cout << std::endl;
+    benchmarks::header("groups", "single pass");
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+
+        for(double threshold: {0.001, 0.01, 0.1}){
+            const core::SimplePeakFinder<double> finder(threshold);
+            const core::PeakList<double> expected = groupPeaks(data, threshold);
+            core::PeakList<double> peaks;
+            finder.find(data, peaks);
+            mismatches += peaks.size() != expected.size();
+            for(size_t p=0; p<std::min(peaks.size(), expected.size()); ++p){
+                mismatches += peaks[p].index != expected[p].index;
+            }
+            benchmarks::report(label + "simple finder(" + std::to_string(threshold).substr(0, 5) + ")",
+                benchmarks::timeit([&](){ benchmarks::consume(groupPeaks(data, threshold).size()); }),
+                benchmarks::timeit([&](){ finder.find(data, peaks); benchmarks::consume(peaks.size()); }));
+        }
+    }
+
+    // the reference spectra repeated to 1M channels
+    Data large(1 << 20);
+    for(int i=0; i<large.size(); ++i){
+        large[i] = spectra[(i/spectra[0].size()) % spectra.size()][i % spectra[0].size()];
+    }
+
+    std::cout << std::endl;
+    benchmarks::header("chunk copies", "thread pool");
+    std::cout << "threads: " << util::ThreadPool::shared().nthreads() << std::endl;
+    util::ThreadPool serial(0);
+    for(int chunksize: {10, 1000, 100000}){
+        const core::ChunkedThresholdPeakFilter<double> filter(0.05, chunksize);
+        const Data expected = chunkedThreshold(large, 0.05, chunksize);
+        mismatches += (filter.go(large) - expected).abs().maxCoeff() > 0;
+        benchmarks::report("(1048576) chunked filter(" + std::to_string(chunksize) + ")",
+            benchmarks::timeit([&](){ benchmarks::consume(chunkedThreshold(large, 0.05, chunksize)[0]); }, 5),
+            benchmarks::timeit([&](){ benchmarks::consume(filter.go(large)[0]); }, 5));
+    }
+
+    // the same finder without and with the workers
+    std::cout << std::endl;
+    benchmarks::header("no workers", "thread pool");
+    for(int nchunks: {10, 100}){
+        const core::ChunkedSimplePeakFinder<double> finder(0.05, nchunks);
+        const core::ChunkedSimplePeakFinder<double> serialfinder(0.05, nchunks, serial);
+        mismatches += finder.find(large).size() != serialfinder.find(large).size();
+        benchmarks::report("(1048576) chunked finder(" + std::to_string(nchunks) + ")",
+            benchmarks::timeit([&](){ benchmarks::consume(serialfinder.find(large).size()); }, 5),
+            benchmarks::timeit([&](){ benchmarks::consume(finder.find(large).size()); }, 5));
+    }
+
+    // a window wider than the data searches from each peak, as scipy
+    std::cout << std::endl;
+    benchmarks::header("searched", "stack");
+    for(const Data* data: std::vector<const Data*>{&spectra[0], &spectra[1], &large}){
+        const std::string label = "(" + std::to_string(data->size()) + ") ";
+        const int repeats = data->size() > 100000 ? 3 : 20;
+        const core::LocalMaximaPeakFinder<double> searched({}, {}, 1.0, 0.0, {}, 2.0*data->size() + 1);
+        const core::LocalMaximaPeakFinder<double> stack({}, {}, 1.0, 0.0);
+        mismatches += searched.findWithProperties(*data).prominences != stack.findWithProperties(*data).prominences;
+        benchmarks::report(label + "prominences",
+            benchmarks::timeit([&](){ benchmarks::consume(searched.findWithProperties(*data).size()); }, repeats),
+            benchmarks::timeit([&](){ benchmarks::consume(stack.findWithProperties(*data).size()); }, repeats));
+    }
+
+    // all local maxima, the largest first and those above the mean
+    std::cout << std::endl;
+    benchmarks::header("peak list", "peak table");
+    for(const Data* data: std::vector<const Data*>{&spectra[0], &spectra[1], &large}){
+        const std::string label = "(" + std::to_string(data->size()) + ") ";
+        const int repeats = data->size() > 100000 ? 5 : 50;
+        const core::LocalMaximaPeakFinder<double> finder;
+        const double lower = data->mean();
+        const auto listed = [&](){
+            core::PeakList<double> peaks = finder.find(*data);
+            std::stable_sort(peaks.begin(), peaks.end(), [](const core::PeakInfo<double>& a, const core::PeakInfo<double>& b){
+                return b.value < a.value;
+            });
+            peaks.erase(std::remove_if(peaks.begin(), peaks.end(), [&](const core::PeakInfo<double>& peak){
+                return peak.value < lower;
+            }), peaks.end());
+            return peaks;
+        };
+        core::PeakTable<double> table;
+        const auto tabled = [&](){
+            finder.find(*data, table);
+            table.sortBy(core::PeakColumn::Value, true);
+            table.filter(core::PeakColumn::Value, lower, std::numeric_limits<double>::max());
+        };
+        tabled();
+        const core::PeakList<double> peaks = listed();
+        mismatches += static_cast<int>(peaks.size()) != table.size();
+        for(int p=0; p<std::min(static_cast<int>(peaks.size()), table.size()); ++p){
+            mismatches += peaks[p].index != table.indices()[p];
+        }
+        benchmarks::report(label + "find, sort and filter",
+            benchmarks::timeit([&](){ benchmarks::consume(listed().size()); }, repeats),
+            benchmarks::timeit([&](){ tabled(); benchmarks::consume(table.size()); }, repeats));
+    }
+
+    // the derivatives from the smoothers then the scan, against one pass
+    std::cout << std::endl;
+    benchmarks::header("derivative calls", "fused pass");
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+        for(int windowsize: {3, 9}){
+            const core::GradientPeakFinder<double> finder(windowsize);
+            const std::vector<int> expected = smoothedCrossings(data, windowsize);
+            const core::PeakPositions<double> peaks = finder.findWithPositions(data);
+            mismatches += peaks.indices != expected;
+            benchmarks::report(label + "gradient finder(" + std::to_string(windowsize) + ")",
+                benchmarks::timeit([&](){ benchmarks::consume(smoothedCrossings(data, windowsize).size()); }, 50),
+                benchmarks::timeit([&](){ benchmarks::consume(finder.find(data).size()); }, 50));
+        }
+    }
+
+    std::cout << "mismatched peaks: " << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
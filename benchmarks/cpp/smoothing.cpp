@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Compares the dynamic window size smoothers and SNIP iterations with
+    the compile time (fixed) window size and schedule versions on the
+    reference spectra, the previous window mean per point moving 
+    average with the running sum for wide windows and the previous 
+    weighted product per point weighted moving average with the box
+    cascade (on the reference spectra and 1M channels), and the
+    resolution smoother with the kernel bank rebuilt per spectrum
+    against reused, and the rolling median by sorting each window
+    against the order statistics.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace peakingduck;
+
+using Data = core::NumericalData<double>;
+
+double maxRelativeDifference(const Data& expected, const Data& candidate)
+{
+    double maxdiff = 0.0;
+    for(int j=0; j<expected.size(); ++j){
+        maxdiff = std::max(maxdiff, std::abs(expected[j] - candidate[j])/std::max(1.0, std::abs(expected[j])));
+    }
+    return maxdiff;
+}
+
+// the previous moving average, the mean of each window
+Data movingAverageWindowMean(const Data& data, int windowsize)
+{
+    Data smoothed = data;
+    for(int i=windowsize; i<data.size()-windowsize; ++i){
+        smoothed[i] = data(i-windowsize, i+windowsize+1).mean();
+    }
+    return smoothed;
+}
+
+// the median of each window, by sorting a copy
+Data windowMedian(const Data& data, int windowsize)
+{
+    Data filtered = data;
+    std::vector<double> window(2*windowsize + 1);
+    for(int i=windowsize; i<data.size()-windowsize; ++i){
+        std::copy(data.begin() + i - windowsize, data.begin() + i + windowsize + 1, window.begin());
+        std::sort(window.begin(), window.end());
+        filtered[i] = window[windowsize];
+    }
+    return filtered;
+}
+
+// the previous weighted moving average, a weighted product per window
+Data weightedMovingAverageWindowSum(const Data& data, int windowsize, const Data& weights)
+{
+    Data smoothed = data;
+    for(int i=windowsize; i<data.size()-windowsize; ++i){
+        smoothed[i] = (data(i-windowsize, i+windowsize+1)*weights).sum();
+    }
+    return smoothed;
+}
+
+int main()
+{
+    const std::vector<Data> spectra = benchmarks::referenceSpectra();
+
+    benchmarks::header("dynamic", "fixed");
+    double maxdiff = 0.0;
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+
+        for(int windowsize: {2, 5, 8}){
+            const core::MovingAverageSmoother<double> dynamic(windowsize);
+            const auto fixed = core::makeMovingAverageSmoother<double>(windowsize);
+            maxdiff = std::max(maxdiff, maxRelativeDifference(dynamic.go(data), fixed->go(data)));
+            benchmarks::report(label + "moving average(" + std::to_string(windowsize) + ")", 
+                benchmarks::timeit([&](){ benchmarks::consume(dynamic.go(data)[0]); }),
+                benchmarks::timeit([&](){ benchmarks::consume(fixed->go(data)[0]); }));
+
+            const core::WeightedMovingAverageSmoother<double> weighted(windowsize);
+            const auto fixedWeighted = core::makeWeightedMovingAverageSmoother<double>(windowsize);
+            maxdiff = std::max(maxdiff, maxRelativeDifference(weighted.go(data), fixedWeighted->go(data)));
+            benchmarks::report(label + "weighted moving average(" + std::to_string(windowsize) + ")", 
+                benchmarks::timeit([&](){ benchmarks::consume(weighted.go(data)[0]); }),
+                benchmarks::timeit([&](){ benchmarks::consume(fixedWeighted->go(data)[0]); }));
+        }
+
+        core::SNIPEngine<double> engine;
+        Data background(data.size());
+        for(int niterations: {20, 40}){
+            std::vector<int> iterations(niterations);
+            std::generate(iterations.begin(), iterations.end(), [n = 1] () mutable { return n++; });
+            engine.estimate(data, niterations, background);
+            maxdiff = std::max(maxdiff, maxRelativeDifference(data.snip(niterations), background));
+            benchmarks::report(label + "snip engine(" + std::to_string(niterations) + ")", 
+                benchmarks::timeit([&](){ engine.estimate(data, iterations.begin(), iterations.end(), background); benchmarks::consume(background[0]); }),
+                benchmarks::timeit([&](){ engine.estimate(data, niterations, background); benchmarks::consume(background[0]); }));
+        }
+    }
+
+    std::cout << std::endl;
+    benchmarks::header("window mean", "running sum");
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+
+        for(int windowsize: {8, 32, 128}){
+            const core::MovingAverageSmoother<double> smoother(windowsize);
+            maxdiff = std::max(maxdiff, maxRelativeDifference(movingAverageWindowMean(data, windowsize), smoother.go(data)));
+            benchmarks::report(label + "moving average(" + std::to_string(windowsize) + ")", 
+                benchmarks::timeit([&](){ benchmarks::consume(movingAverageWindowMean(data, windowsize)[0]); }),
+                benchmarks::timeit([&](){ benchmarks::consume(smoother.go(data)[0]); }));
+        }
+    }
+
+    // the reference spectra repeated to 1M channels
+    Data large(1 << 20);
+    for(int i=0; i<large.size(); ++i){
+        large[i] = spectra[(i/spectra[0].size()) % spectra.size()][i % spectra[0].size()];
+    }
+
+    std::cout << std::endl;
+    benchmarks::header("window sum", "box cascade");
+    for(const Data* data: std::vector<const Data*>{&spectra[0], &large}){
+        const std::string label = "(" + std::to_string(data->size()) + ") ";
+        const int repeats = data->size() > 100000 ? 3 : 20;
+
+        for(int windowsize: {8, 32, 128}){
+            const Data weights = core::weightedMovingAverageWeights<double>(windowsize);
+            const core::WeightedMovingAverageSmoother<double> smoother(windowsize);
+            maxdiff = std::max(maxdiff, maxRelativeDifference(weightedMovingAverageWindowSum(*data, windowsize, weights), smoother.go(*data)));
+            benchmarks::report(label + "weighted moving average(" + std::to_string(windowsize) + ")", 
+                benchmarks::timeit([&](){ benchmarks::consume(weightedMovingAverageWindowSum(*data, windowsize, weights)[0]); }, repeats),
+                benchmarks::timeit([&](){ benchmarks::consume(smoother.go(*data)[0]); }, repeats));
+        }
+    }
+
+    // the resolution of a typical HPGe detector, FWHM(E) in channels
+    std::cout << std::endl;
+    benchmarks::header("rebuilt kernels", "kernel bank");
+    const core::FWHMCalibration calibration(4.0, 2e-3, 1e-7);
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+        Data edges(data.size() + 1);
+        for(int j=0; j<edges.size(); ++j){
+            edges[j] = j;
+        }
+
+        const core::ResolutionSmoother<double> smoother(edges, calibration);
+        maxdiff = std::max(maxdiff, maxRelativeDifference(core::ResolutionSmoother<double>(edges, calibration).go(data), smoother.go(data)));
+        benchmarks::report(label + "resolution smoother",
+            benchmarks::timeit([&](){ benchmarks::consume(core::ResolutionSmoother<double>(edges, calibration).go(data)[0]); }),
+            benchmarks::timeit([&](){ benchmarks::consume(smoother.go(data)[0]); }));
+    }
+
+    std::cout << std::endl;
+    benchmarks::header("sorted copies", "rolling");
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+
+        for(int windowsize: {2, 8, 32, 128}){
+            const core::RollingMedianFilter<double> filter(windowsize);
+            maxdiff = std::max(maxdiff, maxRelativeDifference(windowMedian(data, windowsize), filter.go(data)));
+            benchmarks::report(label + "rolling median(" + std::to_string(windowsize) + ")",
+                benchmarks::timeit([&](){ benchmarks::consume(windowMedian(data, windowsize)[0]); }),
+                benchmarks::timeit([&](){ benchmarks::consume(filter.go(data)[0]); }));
+        }
+    }
+
+    std::cout << "max relative difference: " << maxdiff << std::endl;
+    return maxdiff < 1e-12 ? 0 : 1;
+}
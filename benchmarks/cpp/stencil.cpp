@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Compares the std::function and compile time stencil versions
+    of symmetricNeighbourOp on the reference spectra.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace peakingduck;
+
+using Data = core::NumericalData<double>;
+using Operation = std::function<void(int, int, const Data&, Data&)>;
+
+// the previous (std::function) implementations
+const Operation midpointOp = [](int i, int order, const Data& values, Data& newValues){
+    newValues[i] = (values[i-order] + values[i+order])/2.0;
+};
+
+const Operation gradOp = [](int i, int, const Data& values, Data& newValues){
+    newValues[i] = (values[i+1] - values[i-1])/2.0;
+};
+
+const Operation midpointMinOp = [](int i, int order, const Data& values, Data& newValues){
+    newValues[i] = (values[i-order] + values[i+order])/2.0;
+    newValues[i] = std::min(newValues[i], values[i]);
+};
+
+Data snipWithFunction(const Data& data, int niterations)
+{
+    Data snipped = data.LLS();
+    for(int order=1; order<=niterations; ++order){
+        snipped = snipped.symmetricNeighbourOp(midpointMinOp, order);
+    }
+    return snipped.inverseLLS();
+}
+
+bool same(const Data& lhs, const Data& rhs)
+{
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+int main()
+{
+    const std::vector<Data> spectra = benchmarks::referenceSpectra();
+    const int snipiterations = 20;
+
+    benchmarks::header("std::function", "stencil");
+    bool allsame = true;
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data& data = spectra[i];
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+
+        allsame &= same(data.symmetricNeighbourOp(midpointOp, 4), data.midpoint(4));
+        benchmarks::report(label + "midpoint", 
+            benchmarks::timeit([&](){ benchmarks::consume(data.symmetricNeighbourOp(midpointOp, 4)[0]); }),
+            benchmarks::timeit([&](){ benchmarks::consume(data.midpoint(4)[0]); }));
+
+        allsame &= same(data.symmetricNeighbourOp(gradOp, 1), data.symmetricNeighbourOp<core::GradientStencil>(1));
+        benchmarks::report(label + "gradient", 
+            benchmarks::timeit([&](){ benchmarks::consume(data.symmetricNeighbourOp(gradOp, 1)[0]); }),
+            benchmarks::timeit([&](){ benchmarks::consume(data.symmetricNeighbourOp<core::GradientStencil>(1)[0]); }));
+
+        allsame &= same(data.symmetricNeighbourOp(midpointMinOp, 4), data.symmetricNeighbourOp<core::MidpointMinStencil>(4));
+        benchmarks::report(label + "snip clip", 
+            benchmarks::timeit([&](){ benchmarks::consume(data.symmetricNeighbourOp(midpointMinOp, 4)[0]); }),
+            benchmarks::timeit([&](){ benchmarks::consume(data.symmetricNeighbourOp<core::MidpointMinStencil>(4)[0]); }));
+
+        allsame &= same(snipWithFunction(data, snipiterations), data.snip(snipiterations));
+        benchmarks::report(label + "snip(" + std::to_string(snipiterations) + ")", 
+            benchmarks::timeit([&](){ benchmarks::consume(snipWithFunction(data, snipiterations)[0]); }),
+            benchmarks::timeit([&](){ benchmarks::consume(data.snip(snipiterations)[0]); }));
+    }
+
+    if(!allsame){
+        std::cerr << "Stencil results differ from the std::function results!" << std::endl;
+        return 1;
+    }
+    return 0;
+}
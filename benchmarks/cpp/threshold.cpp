@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Compares the previous std::function/scalar loop thresholding with
+    the masking and thresholding kernels on the reference spectra.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace peakingduck;
+
+using Data = core::NumericalData<double>;
+
+// the previous implementations
+Data rampWithFunction(const Data& data, double threshold)
+{
+    std::function<double(double)> imp = [&](const double& x){
+        return (x >= threshold) ? x : 0;
+    };
+    return data.unaryExpr(imp);
+}
+
+void clampWithLoop(Data& data)
+{
+    for(int i=0;i<data.size();++i)
+        data[i] = data[i] > 0 ? data[i] : 0.0;
+}
+
+bool same(const Data& lhs, const Data& rhs)
+{
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+int main()
+{
+    const std::vector<Data> spectra = benchmarks::referenceSpectra();
+
+    benchmarks::header("previous", "kernel");
+    bool allsame = true;
+    for(size_t i=0; i<spectra.size(); ++i){
+        const Data data = spectra[i] - spectra[i].mean();
+        const double threshold = 0.5*data.maxCoeff();
+        const std::string label = "spectrum" + std::to_string(i) + " (" + std::to_string(data.size()) + ") ";
+
+        allsame &= same(rampWithFunction(data, threshold), data.ramp(threshold));
+        benchmarks::report(label + "ramp", 
+            benchmarks::timeit([&](){ benchmarks::consume(rampWithFunction(data, threshold)[0]); }),
+            benchmarks::timeit([&](){ benchmarks::consume(data.ramp(threshold)[0]); }));
+
+        Data work = data;
+        Data expected = data;
+        clampWithLoop(expected);
+        allsame &= same(expected, data.zeroBelow(0));
+        benchmarks::report(label + "zero below in place", 
+            benchmarks::timeit([&](){ work = data; clampWithLoop(work); benchmarks::consume(work[0]); }),
+            benchmarks::timeit([&](){ work = data; work.zeroBelowInPlace(0); benchmarks::consume(work[0]); }));
+    }
+
+    if(!allsame){
+        std::cerr << "Kernel results differ from the previous results!" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Times the wavelet transform peak finder on the reference spectra
+    (and 1M channels), the transform by direct convolution on the 
+    calling thread (as scipy.signal.find_peaks_cwt) against the 
+    engines (overlap-save for the wider wavelets) on the thread pool.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace peakingduck;
+
+using Data = core::NumericalData<double>;
+
+// the transform by direct convolution, one width after another
+std::vector<Data> directTransform(const Data& data, const std::vector<double>& widths)
+{
+    std::vector<Data> rows;
+    for(double width: widths){
+        const Data wavelet = core::rickerWavelet<double>(std::min(10.0*width, static_cast<double>(data.size())), width);
+        rows.push_back(core::correlate<double>(data, wavelet, core::ConvolutionMethod::Direct));
+    }
+    return rows;
+}
+
+int main()
+{
+    const std::vector<Data> spectra = benchmarks::referenceSpectra();
+
+    // the reference spectra repeated to 1M channels
+    Data large(1 << 20);
+    for(int i=0; i<large.size(); ++i){
+        large[i] = spectra[(i/spectra[0].size()) % spectra.size()][i % spectra[0].size()];
+    }
+
+    std::vector<double> widths;
+    for(double width=1.0; width<=64.0; width*=1.25){
+        widths.push_back(width);
+    }
+
+    benchmarks::header("direct", "engines");
+    std::cout << "threads: " << util::ThreadPool::shared().nthreads() << ", widths: " << widths.size() << std::endl;
+    int mismatches = 0;
+    for(const Data* data: std::vector<const Data*>{&spectra[0], &spectra[1], &large}){
+        const std::string label = "(" + std::to_string(data->size()) + ") ";
+        const int repeats = data->size() > 100000 ? 1 : 5;
+        const core::CWTPeakFinder<double> finder(widths);
+
+        const std::vector<Data> expected = directTransform(*data, widths);
+        const std::vector<Data> rows = finder.transform(*data);
+        for(size_t r=0; r<rows.size(); ++r){
+            mismatches += (rows[r] - expected[r]).abs().maxCoeff() > 1e-6*expected[r].abs().maxCoeff();
+        }
+
+        benchmarks::report(label + "transform",
+            benchmarks::timeit([&](){ benchmarks::consume(directTransform(*data, widths).size()); }, repeats),
+            benchmarks::timeit([&](){ benchmarks::consume(finder.transform(*data).size()); }, repeats));
+        std::cout << "    find: " << benchmarks::timeit([&](){ benchmarks::consume(finder.find(*data).size()); }, repeats)
+                  << " us, " << finder.find(*data).size() << " peaks" << std::endl;
+    }
+
+    std::cout << "mismatched rows: " << mismatches << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
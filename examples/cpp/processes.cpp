@@ -1,9 +1,5 @@
 #include "peakingduck.hpp"
 
-#include <pybind11/embed.h>
-#include <pybind11/numpy.h>
-#include <pybind11/stl.h>
-
 #include <memory>
 #include <iomanip>
 
@@ -22,23 +18,6 @@ private:
   int size;
 };
 
-class SavitzkyGolaySmoother : public IProcess<double> {
-public:
-  SavitzkyGolaySmoother(int windowwidth, int polynomialorder = 2) :
-    windowsize(windowwidth), order(polynomialorder) {}
-  NumericalData<double> go(const NumericalData<double>& data) const override {
-    namespace py = pybind11;
-    py::scoped_interpreter guard{};
-
-    py::object savgol_filter = py::module::import("scipy.signal").attr("savgol_filter");
-    py::array_t<double> pyData = py::cast(data.to_vector());
-    py::object result = savgol_filter(pyData, windowsize, order);
-    return NumericalData<double>(result.cast<std::vector<double> >());
-  }
-private:
-  int windowsize, order;
-};
-
 class ThresholdCut : public IProcess<double> {
 public:
   ThresholdCut(double thresholdLevel) : threshold(thresholdLevel) {}
@@ -53,7 +32,7 @@ int main() {
   SimpleProcessManager<double> pm;
   pm.append(std::dynamic_pointer_cast<IProcess<double> >(std::make_shared<MovingAverageSmoother<double> >(1)));
   pm.append(std::dynamic_pointer_cast<IProcess<double> >(std::make_shared<SnipRemoval>(40)));
-  pm.append(std::dynamic_pointer_cast<IProcess<double> >(std::make_shared<SavitzkyGolaySmoother>(3)));
+  pm.append(std::dynamic_pointer_cast<IProcess<double> >(std::make_shared<SavitzkyGolaySmoother<double> >(3)));
   pm.append(std::dynamic_pointer_cast<IProcess<double> >(std::make_shared<ThresholdCut>(1e3)));
   pm.append(std::dynamic_pointer_cast<IProcess<double> >(std::make_shared<MovingAverageSmoother<double> >(3)));
 
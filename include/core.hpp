@@ -14,10 +14,21 @@
 #define CORE_HPP
 
 #include "core/crtp.hpp"
+#include "core/stencil.hpp"
+#include "core/statistics.hpp"
+#include "core/expression.hpp"
 #include "core/numerical.hpp"
+#include "core/batch.hpp"
 #include "core/process.hpp"
+#include "core/background.hpp"
+#include "core/gradient.hpp"
 #include "core/smoothing.hpp"
+#include "core/convolution.hpp"
+#include "core/resolution.hpp"
+#include "core/quantile.hpp"
 #include "core/spectral.hpp"
 #include "core/peaking.hpp"
+#include "core/wavelet.hpp"
+#include "core/fitting.hpp"
 
 #endif //CORE_HPP
\ No newline at end of file
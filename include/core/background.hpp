@@ -0,0 +1,257 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Defines background estimation engines to be applied to numerical array
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef CORE_BACKGROUND_HPP
+#define CORE_BACKGROUND_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <initializer_list>
+#include <utility>
+
+#include "common.hpp"
+#include "core/numerical.hpp"
+#include "core/stencil.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(core)
+
+    /*!
+       @brief A SNIP iteration schedule (the window orders) known at compile time.
+
+        Passed to SNIPEngine::estimate in place of an iterator range, the
+        iterations are unrolled with each order a constant.
+    */
+    template<int... Orders>
+    struct SNIPSchedule
+    {
+        static constexpr int size = sizeof...(Orders);
+    };
+
+    template<int... Orders>
+    constexpr int SNIPSchedule<Orders...>::size;
+
+    template<class Sequence>
+    struct IncreasingSNIPScheduleImp;
+
+    template<int... Indices>
+    struct IncreasingSNIPScheduleImp<std::integer_sequence<int, Indices...>>
+    {
+        using type = SNIPSchedule<(Indices+1)...>;
+    };
+
+    /*!
+       @brief The increasing window schedule 1, 2, ..., NIterations 
+       (as NumericalFunctions::snip(niterations)) at compile time.
+    */
+    template<int NIterations>
+    using IncreasingSNIPSchedule = typename IncreasingSNIPScheduleImp<std::make_integer_sequence<int, NIterations>>::type;
+
+    /*!
+       @brief Sensitive Nonlinear Iterative Peak (SNIP) background engine.
+
+        Gives the same (bit for bit) result as NumericalFunctions::snip, but
+        does not allocate per iteration. Instead two scratch buffers are kept
+        and swapped (ping-pong) between iterations, so repeated calls on
+        spectra of the same size do not allocate at all.
+
+        The LLS transform is done as the data is read into the first buffer
+        and the inverse as the result is written out, rather than as
+        separate passes. The clipping step uses the MidpointMinStencil over
+        the interior of the array so is vectorized.
+
+        Holds state (the buffers) so use one engine per thread.
+    */
+    template<typename T=DefaultType>
+    class SNIPEngine
+    {
+        public:
+            using value_type = T;
+
+            SNIPEngine() = default;
+
+            /*!
+                @brief Estimate the background, writing into the given output.
+                The output is resized only if it is not the same size as the data.
+            */
+            template<class Iterator>
+            void estimate(const ConstNumericalView<T>& data, Iterator first, Iterator last,
+                          NumericalData<T>& background)
+            {
+                iterate(data, first, last);
+                write(background);
+            }
+
+            /*!
+                @brief Estimate the background, writing through the given view
+                (i.e. into a spectrum of a NumericalBatch). The view must be the 
+                same size as the data.
+            */
+            template<class Iterator>
+            void estimate(const ConstNumericalView<T>& data, Iterator first, Iterator last,
+                          NumericalView<T>& background)
+            {
+                iterate(data, first, last);
+                write(background);
+            }
+
+            /*!
+                @brief Estimate the background, returning a new array.
+            */
+            template<class Iterator>
+            NumericalData<T> estimate(const ConstNumericalView<T>& data, Iterator first, Iterator last)
+            {
+                NumericalData<T> background(data.size());
+                estimate(data, first, last, background);
+                return background;
+            }
+
+            /*!
+                @brief Estimate the background with a compile time schedule,
+                i.e. IncreasingSNIPSchedule<20>(), writing into the given output
+                (array or view).
+            */
+            template<int... Orders, class Output>
+            void estimate(const ConstNumericalView<T>& data, SNIPSchedule<Orders...>,
+                          Output& background)
+            {
+                read(data);
+                (void)std::initializer_list<int>{ (clip(Orders), 0)... };
+                write(background);
+            }
+
+            /*!
+                @brief Estimate the background with a compile time schedule,
+                returning a new array.
+            */
+            template<int... Orders>
+            NumericalData<T> estimate(const ConstNumericalView<T>& data, SNIPSchedule<Orders...> schedule)
+            {
+                NumericalData<T> background(data.size());
+                estimate(data, schedule, background);
+                return background;
+            }
+
+            /*!
+                @brief Estimate the background with the increasing window
+                schedule 1, 2, ..., niterations (as NumericalFunctions::snip(niterations)),
+                writing into the given output (array or view).
+
+                Uses the compile time schedule for the common numbers of
+                iterations and a runtime loop otherwise.
+            */
+            template<class Output>
+            void estimate(const ConstNumericalView<T>& data, int niterations, 
+                          Output& background)
+            {
+                switch(niterations){
+                    case 10: estimate(data, IncreasingSNIPSchedule<10>(), background); return;
+                    case 20: estimate(data, IncreasingSNIPSchedule<20>(), background); return;
+                    case 30: estimate(data, IncreasingSNIPSchedule<30>(), background); return;
+                    case 40: estimate(data, IncreasingSNIPSchedule<40>(), background); return;
+                    default: break;
+                }
+
+                read(data);
+                for(int order=1; order<=niterations; ++order){
+                    clip(order);
+                }
+                write(background);
+            }
+
+        private:
+            using Buffer = Array1D<T>;
+            using ContiguousMap = Eigen::Map<const Buffer>;
+
+            // LLS and all the clipping iterations, leaves the result in _current
+            template<class Iterator>
+            void iterate(const ConstNumericalView<T>& data, Iterator first, Iterator last)
+            {
+                read(data);
+                for(auto it=first; it!=last; ++it){
+                    clip(*it);
+                }
+            }
+
+            // first pass - scale by LLS as the data is read into _current
+            void read(const ConstNumericalView<T>& data)
+            {
+                const int size = data.size();
+                const T one = 1;
+                resize(size);
+
+                // first pass - scale by LLS as the data is read
+                if(data.stride() == 1){
+                    const ContiguousMap values(data.data(), size);
+                    _current = (((values + one).sqrt() + one).log() + one).log();
+                }
+                else{
+                    // strided data cannot be vectorized, copy it first to
+                    // keep the same result as the contiguous case
+                    std::copy(data.begin(), data.end(), _current.data());
+                    _current = (((_current + one).sqrt() + one).log() + one).log();
+                }
+            }
+
+            // a single clipping iteration, from _current into _next then swapped
+            void clip(int order)
+            {
+                const int ninterior = _current.size() - 2*order;
+                if(ninterior <= 0){
+                    return;
+                }
+
+                // end points remain unchanged
+                _next.head(order) = _current.head(order);
+                _next.tail(order) = _current.tail(order);
+
+                // clip to the midpoint of the neighbours
+                _next.segment(order, ninterior) = MidpointMinStencil::apply(_current.segment(0, ninterior),
+                                                                            _current.segment(order, ninterior),
+                                                                            _current.segment(2*order, ninterior));
+                std::swap(_current, _next);
+            }
+
+            // last pass - scale back as it is written to the output
+            void write(NumericalData<T>& background)
+            {
+                const T one = 1;
+                background = ((((_current.exp() - one).exp()) - one).square()) - one;
+            }
+
+            void write(NumericalView<T>& background)
+            {
+                assert(background.size() == _current.size());
+                // evaluate into our own (aligned) buffer first, so the result does
+                // not depend on the alignment or stride of the view
+                const T one = 1;
+                _next = ((((_current.exp() - one).exp()) - one).square()) - one;
+                std::copy(_next.data(), _next.data() + _next.size(), background.begin());
+            }
+
+            // only reallocates if the size changes
+            void resize(int size)
+            {
+                if(_current.size() != size){
+                    _current.resize(size);
+                    _next.resize(size);
+                }
+            }
+
+            Buffer _current;
+            Buffer _next;
+    };
+
+PEAKINGDUCK_NAMESPACE_END
+PEAKINGDUCK_NAMESPACE_END
+
+#endif // CORE_BACKGROUND_HPP
@@ -0,0 +1,459 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Defines a batch of spectra (2D numerical data) so that the numerical
+    functions can be applied to many spectra in one call.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef CORE_BATCH_HPP
+#define CORE_BATCH_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "core/numerical.hpp"
+#include "core/background.hpp"
+#include "core/stencil.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(core)
+
+    /*!
+       @brief A batch of spectra all with the same number of channels.
+
+        Stored as a single contiguous (column major) channels x spectra array,
+        so each spectrum is a contiguous column and can be viewed without a copy
+        (see spectrum()).
+
+        The numerical functions mirror those of NumericalData but act on all
+        spectra at once, as single Eigen expressions over the whole batch
+        where possible (LLS, midpoint, thresholds), or spectrum by spectrum
+        reusing the same buffers where each spectrum needs several passes
+        (gradient, snip, smoothing), so that each spectrum stays in cache.
+
+        Like NumericalData, Eigen is an implementation detail and is not exposed.
+    */
+    template<typename T=DefaultType>
+    class NumericalBatch
+    {
+        public:
+            using value_type = T;
+
+            NumericalBatch() : _values(0, 0)
+            {
+            }
+
+            // all values are zero
+            NumericalBatch(int nchannels, int nspectra) : _values(BaseEigenArray::Zero(nchannels, nspectra))
+            {
+            }
+
+            // copies the spectra, which must all be the same size
+            explicit NumericalBatch(const std::vector<NumericalData<T>>& spectra)
+            {
+                const int nchannels = spectra.empty() ? 0 : spectra.front().size();
+                _values.resize(nchannels, spectra.size());
+                for(size_t i=0; i<spectra.size(); ++i){
+                    assert(spectra[i].size() == nchannels && "All spectra in a batch must be the same size.");
+                    std::copy(spectra[i].begin(), spectra[i].end(), _values.col(i).data());
+                }
+            }
+
+            // construct from an Eigen expression of channels x spectra
+            template<typename OtherDerived>
+            explicit NumericalBatch(const Eigen::ArrayBase<OtherDerived>& other)
+                : _values(other)
+            { }
+
+            inline int nchannels() const
+            {
+                return _values.rows();
+            }
+
+            inline int nspectra() const
+            {
+                return _values.cols();
+            }
+
+            inline T* data()
+            {
+                return _values.data();
+            }
+
+            inline const T* data() const
+            {
+                return _values.data();
+            }
+
+            inline T& operator()(int channel, int spectrum)
+            {
+                return _values(channel, spectrum);
+            }
+
+            inline const T& operator()(int channel, int spectrum) const
+            {
+                return _values(channel, spectrum);
+            }
+
+            // a writable view onto a single spectrum (no copy)
+            NumericalView<T> spectrum(int index)
+            {
+                return NumericalView<T>(_values.col(index).data(), nchannels());
+            }
+
+            // a read only view onto a single spectrum (no copy)
+            ConstNumericalView<T> spectrum(int index) const
+            {
+                return ConstNumericalView<T>(_values.col(index).data(), nchannels());
+            }
+
+            std::vector<NumericalData<T>> to_vector() const
+            {
+                std::vector<NumericalData<T>> spectra;
+                spectra.reserve(nspectra());
+                for(int i=0; i<nspectra(); ++i){
+                    spectra.emplace_back(spectrum(i));
+                }
+                return spectra;
+            }
+
+            /*!
+                @brief A copy of the batch with a different value type,
+                i.e. to move between single and double precision
+            */
+            template<typename NewType>
+            NumericalBatch<NewType> cast() const
+            {
+                return NumericalBatch<NewType>(_values.template cast<NewType>());
+            }
+
+            /*!
+                @brief The maximum value of each spectrum
+            */
+            NumericalData<T> maxCoeffs() const
+            {
+                return NumericalData<T>(_values.colwise().maxCoeff().transpose());
+            }
+
+            NumericalBatch& operator+=(const NumericalBatch& other)
+            {
+                assert(other.nchannels() == nchannels() && other.nspectra() == nspectra());
+                _values += other._values;
+                return *this;
+            }
+
+            NumericalBatch& operator-=(const NumericalBatch& other)
+            {
+                assert(other.nchannels() == nchannels() && other.nspectra() == nspectra());
+                _values -= other._values;
+                return *this;
+            }
+
+            /*!
+                @brief log(log(sqrt(value + 1) + 1) + 1) for all spectra
+                Returns a new batch
+            */
+            NumericalBatch LLS() const
+            {
+                const T one = 1;
+                return NumericalBatch((((_values + one).sqrt() + one).log() + one).log());
+            }
+
+            /*!
+                @brief log(log(sqrt(value + 1) + 1) + 1) for all spectra
+                Changes the underlying batch
+            */
+            NumericalBatch& LLSInPlace()
+            {
+                const T one = 1;
+                _values = (((_values + one).sqrt() + one).log() + one).log();
+                return *this;
+            }
+
+            /*!
+                @brief exp(exp(sqrt(value + 1) + 1) + 1) for all spectra
+                Returns a new batch
+            */
+            NumericalBatch inverseLLS() const
+            {
+                const T one = 1;
+                return NumericalBatch(((((_values.exp() - one).exp()) - one).square()) - one);
+            }
+
+            /*!
+                @brief exp(exp(sqrt(value + 1) + 1) + 1) for all spectra
+                Changes the underlying batch
+            */
+            NumericalBatch& inverseLLSInPlace()
+            {
+                const T one = 1;
+                _values = ((((_values.exp() - one).exp()) - one).square()) - one;
+                return *this;
+            }
+
+            /*!
+                @brief Apply a compile time stencil (see core/stencil.hpp) to the
+                channels of every spectrum.
+
+                See: NumericalFunctions::symmetricNeighbourOp
+
+                Returns a new batch
+            */
+            template<class Stencil>
+            NumericalBatch symmetricNeighbourOp(int order=1) const
+            {
+                NumericalBatch result;
+                applyStencil<Stencil>(order, result);
+                return result;
+            }
+
+            /*!
+                @brief The midpoint of the neighbours for all spectra.
+
+                See: NumericalFunctions::midpoint
+
+                Returns a new batch
+            */
+            NumericalBatch midpoint(int order=1) const
+            {
+                return symmetricNeighbourOp<MidpointStencil>(order);
+            }
+
+            NumericalBatch& midpointInPlace(int order=1)
+            {
+                *this = midpoint(order);
+                return *this;
+            }
+
+            /*!
+                @brief The numerical gradient of all spectra.
+
+                See: NumericalFunctions::gradient
+
+                Returns a new batch
+            */
+            NumericalBatch gradient(int order=1) const
+            {
+                assert(nchannels() >= 2 && "Cannot compute gradient with less than 2 points.");
+                if(order == 0){
+                    return *this;
+                }
+
+                // all orders are done on one spectrum at a time whilst it is in
+                // cache, ping-ponging between two buffers reused for all spectra
+                NumericalBatch result;
+                result._values.resize(nchannels(), nspectra());
+                const int last = nchannels() - 1;
+                const int ninterior = nchannels() - 2;
+                Array1D<T> current(nchannels());
+                Array1D<T> next(nchannels());
+                for(int s=0; s<nspectra(); ++s){
+                    current = _values.col(s);
+                    for(int i=0; i<order; ++i){
+                        next.segment(1, ninterior) = GradientStencil::apply(current.segment(0, ninterior),
+                                                                            current.segment(1, ninterior),
+                                                                            current.segment(2, ninterior));
+                        next[0] = current[1] - current[0];
+                        next[last] = current[last] - current[last-1];
+                        std::swap(current, next);
+                    }
+                    result._values.col(s) = current;
+                }
+                return result;
+            }
+
+            NumericalBatch& gradientInPlace(int order=1)
+            {
+                *this = gradient(order);
+                return *this;
+            }
+
+            /*!
+                @brief Sensitive Nonlinear Iterative Peak (SNIP) background of
+                all spectra. Each spectrum is done in turn with the same SNIPEngine
+                so the buffers are only allocated once for the whole batch.
+
+                See: NumericalFunctions::snip
+
+                Returns a new batch
+            */
+            template<class Iterator>
+            NumericalBatch snip(Iterator first, Iterator last) const
+            {
+                NumericalBatch result(nchannels(), nspectra());
+                SNIPEngine<T> engine;
+                for(int i=0; i<nspectra(); ++i){
+                    NumericalView<T> output = result.spectrum(i);
+                    engine.estimate(spectrum(i), first, last, output);
+                }
+                return result;
+            }
+
+            NumericalBatch snip(int niterations) const
+            {
+                NumericalBatch result(nchannels(), nspectra());
+                SNIPEngine<T> engine;
+                for(int i=0; i<nspectra(); ++i){
+                    NumericalView<T> output = result.spectrum(i);
+                    engine.estimate(spectrum(i), niterations, output);
+                }
+                return result;
+            }
+
+            NumericalBatch& snipInPlace(int niterations)
+            {
+                *this = snip(niterations);
+                return *this;
+            }
+
+            /*!
+                @brief The (weighted) mean of a window of 2N+1 channels around each
+                channel, where N is given by the number of weights (2N+1).
+                The first and last N channels are unchanged.
+
+                This is the moving average (all weights 1) and weighted moving
+                average smoothers applied to every spectrum.
+
+                Returns a new batch
+            */
+            NumericalBatch weightedWindowMean(const ConstNumericalView<T>& weights) const
+            {
+                assert(weights.size() % 2 == 1 && "Weights must have an odd size.");
+                const int windowsize = (weights.size() - 1)/2;
+                const int ninterior = nchannels() - 2*windowsize;
+                if(ninterior <= 0){
+                    return *this;
+                }
+
+                NumericalBatch result;
+                result._values.resize(nchannels(), nspectra());
+                const T norm = static_cast<T>(weights.size());
+                for(int i=0; i<nspectra(); ++i){
+                    const auto values = _values.col(i);
+                    result._values.col(i).head(windowsize) = values.head(windowsize);
+                    result._values.col(i).tail(windowsize) = values.tail(windowsize);
+
+                    auto smoothed = result._values.col(i).segment(windowsize, ninterior);
+                    smoothed = weights[0]*values.segment(0, ninterior);
+                    for(int j=1; j<weights.size(); ++j){
+                        smoothed += weights[j]*values.segment(j, ninterior);
+                    }
+                    smoothed /= norm;
+                }
+                return result;
+            }
+
+            /*!
+                @brief Set values below the threshold (<) to zero for all spectra.
+
+                See: NumericalData::ramp
+            */
+            NumericalBatch ramp(const value_type& threshold) const
+            {
+                return NumericalBatch((_values >= threshold).select(_values, value_type(0)));
+            }
+
+            NumericalBatch& rampInPlace(const value_type& threshold)
+            {
+                _values = (_values >= threshold).select(_values, value_type(0));
+                return *this;
+            }
+
+            /*!
+                @brief Set values below a threshold (<) to zero, with a
+                different threshold for each spectrum.
+            */
+            NumericalBatch ramp(const ConstNumericalView<T>& thresholds) const
+            {
+                assert(thresholds.size() == nspectra() && "Need one threshold per spectrum.");
+                NumericalBatch result;
+                result._values.resize(nchannels(), nspectra());
+                for(int i=0; i<nspectra(); ++i){
+                    const auto values = _values.col(i);
+                    result._values.col(i) = (values >= thresholds[i]).select(values, value_type(0));
+                }
+                return result;
+            }
+
+            NumericalBatch& rampInPlace(const ConstNumericalView<T>& thresholds)
+            {
+                assert(thresholds.size() == nspectra() && "Need one threshold per spectrum.");
+                for(int i=0; i<nspectra(); ++i){
+                    auto values = _values.col(i);
+                    values = (values >= thresholds[i]).select(values, value_type(0));
+                }
+                return *this;
+            }
+
+            /*!
+                @brief Limit the values of all spectra to the range [lower, upper].
+
+                See: NumericalData::clip
+            */
+            NumericalBatch clip(const value_type& lower, const value_type& upper) const
+            {
+                assert(lower <= upper && "Lower clip value must not be above the upper.");
+                return NumericalBatch(_values.max(lower).min(upper));
+            }
+
+            NumericalBatch& clipInPlace(const value_type& lower, const value_type& upper)
+            {
+                assert(lower <= upper && "Lower clip value must not be above the upper.");
+                _values = _values.max(lower).min(upper);
+                return *this;
+            }
+
+            /*!
+                @brief Set values at or below the threshold (<=) to zero for all spectra.
+
+                See: NumericalData::zeroBelow
+            */
+            NumericalBatch zeroBelow(const value_type& threshold) const
+            {
+                return NumericalBatch((_values > threshold).select(_values, value_type(0)));
+            }
+
+            NumericalBatch& zeroBelowInPlace(const value_type& threshold)
+            {
+                _values = (_values > threshold).select(_values, value_type(0));
+                return *this;
+            }
+
+        private:
+            using BaseEigenArray = Array2D<T>;
+
+            // writes every value of the result once, the end channels are 
+            // copied and the stencil is applied to the rest
+            template<class Stencil>
+            void applyStencil(int order, NumericalBatch& result) const
+            {
+                const int ninterior = nchannels() - 2*order;
+                if(ninterior <= 0){
+                    result._values = _values;
+                    return;
+                }
+
+                result._values.resize(nchannels(), nspectra());
+                result._values.topRows(order) = _values.topRows(order);
+                result._values.bottomRows(order) = _values.bottomRows(order);
+                result._values.middleRows(order, ninterior) = Stencil::apply(_values.middleRows(0, ninterior),
+                                                                             _values.middleRows(order, ninterior),
+                                                                             _values.middleRows(2*order, ninterior));
+            }
+
+            BaseEigenArray _values;
+    };
+
+PEAKINGDUCK_NAMESPACE_END
+PEAKINGDUCK_NAMESPACE_END
+
+#endif // CORE_BATCH_HPP
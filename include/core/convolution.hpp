@@ -0,0 +1,647 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Defines 1D convolution (and correlation) of numerical arrays with
+    a kernel, done directly, by FFT (overlap-save) or as a cascade of
+    box filters, and the smoothers built on it.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef CORE_CONVOLUTION_HPP
+#define CORE_CONVOLUTION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+#include <Eigen/Core>
+#include <unsupported/Eigen/FFT>
+
+#include "common.hpp"
+#include "exceptions.hpp"
+#include "core/numerical.hpp"
+#include "core/process.hpp"
+#include "core/smoothing.hpp"
+#include "core/statistics.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(core)
+
+    /*!
+       @brief How a ConvolutionEngine computes the convolution.
+
+        Automatic - pick from the kernel and data size (see ConvolutionEngine::method)
+        Direct - the weighted sum of the shifted data, O(N*K)
+        FFT - overlap-save with a fixed block size, O(N*log(K))
+        Separable - a cascade of running sums, O(N) per box, only for
+                    kernels made from boxes (ConvolutionEngine::boxes)
+    */
+    enum class ConvolutionMethod
+    {
+        Automatic,
+        Direct,
+        FFT,
+        Separable
+    };
+
+    /*!
+       @brief Convolves data with a kernel, giving the same result as
+       numpy.convolve(data, kernel, mode='same'), i.e. the data is zero
+       outside of its range and the output is centred on kernel[(K-1)/2].
+
+        The FFT plan (twiddles) and the spectrum of the kernel for the
+        block size are computed once, at construction, and reused for
+        every call. The padded data and block buffers are kept between
+        calls so repeated calls on spectra of the same size do not allocate.
+
+        Holds state (the buffers and the FFT scratch) so use one engine
+        per thread (see ConvolutionEnginePool). Copies share the kernel
+        and its spectrum, and start with empty buffers.
+    */
+    template<typename T=DefaultType>
+    class ConvolutionEngine
+    {
+        public:
+            using value_type = T;
+            using Complex = std::complex<T>;
+
+            /*!
+                @brief The smallest and the relative size of the FFT blocks,
+                the block is the next power of two of max(MinBlockSize, BlockFactor*K)
+            */
+            static constexpr int MinBlockSize = 256;
+            static constexpr int BlockFactor = 4;
+
+            /*!
+                @brief The cost of an FFT per point per log2(block size) relative
+                to a multiply-add of the direct convolution (measured, see
+                benchmarks/cpp/convolution.cpp)
+            */
+            static constexpr double FFTCost = 5.0;
+
+            explicit ConvolutionEngine(const NumericalData<T>& kernel,
+                                       ConvolutionMethod method=ConvolutionMethod::Automatic)
+            {
+                if(kernel.size() == 0){
+                    throw PeakingDuckException("Convolution kernel must not be empty.");
+                }
+                if(method == ConvolutionMethod::Separable){
+                    throw PeakingDuckException("Only kernels made from boxes (ConvolutionEngine::boxes) are separable.");
+                }
+                Plan plan;
+                plan.kernel = kernel;
+                plan.method = method;
+                makePlan(plan);
+            }
+
+            // the buffers are not copied, the FFT is to keep its twiddles
+            ConvolutionEngine(const ConvolutionEngine& other)
+            : _plan(other._plan), _fft(other._fft)
+            {}
+
+            ConvolutionEngine& operator=(const ConvolutionEngine& other)
+            {
+                if(this != &other){
+                    _plan = other._plan;
+                    _fft = other._fft;
+                }
+                return *this;
+            }
+
+            ConvolutionEngine(ConvolutionEngine&&) = default;
+            ConvolutionEngine& operator=(ConvolutionEngine&&) = default;
+
+            /*!
+                @brief The kernel scale*box(widths[0])*box(widths[1])*..., where box(w)
+                is w ones, done as a cascade of running sums by default.
+
+                i.e. boxes({w+1, w+1}, 1/(w+1)^2) is the triangle of width 2w+1
+            */
+            static ConvolutionEngine boxes(const std::vector<int>& widths, T scale=1,
+                                           ConvolutionMethod method=ConvolutionMethod::Automatic)
+            {
+                if(widths.empty() || *std::min_element(widths.begin(), widths.end()) < 1){
+                    throw PeakingDuckException("Convolution box widths must be positive.");
+                }
+
+                // the equivalent kernel, for the other methods
+                NumericalData<T> kernel = NumericalData<T>::Ones(1);
+                kernel[0] = scale;
+                for(int width: widths){
+                    NumericalData<T> next = NumericalData<T>::Zero(kernel.size() + width - 1);
+                    for(int i=0; i<kernel.size(); ++i){
+                        for(int j=i; j<i+width; ++j){
+                            next[j] += kernel[i];
+                        }
+                    }
+                    kernel = next;
+                }
+
+                // no FFT plan unless asked for
+                Plan plan;
+                plan.kernel = kernel;
+                plan.boxes = widths;
+                plan.scale = scale;
+                plan.method = (method == ConvolutionMethod::Automatic) ? ConvolutionMethod::Separable : method;
+                ConvolutionEngine engine;
+                engine.makePlan(plan);
+                return engine;
+            }
+
+            inline const NumericalData<T>& kernel() const
+            {
+                return _plan->kernel;
+            }
+
+            // the index of the kernel aligned with each point of the output
+            inline int centre() const
+            {
+                return (static_cast<int>(_plan->kernel.size()) - 1)/2;
+            }
+
+            /*!
+                @brief The method used for data of the given size, never
+                Automatic. Automatic picks the cheapest of the direct
+                (N*K) and FFT (blocks*L*log2(L)*FFTCost) convolutions,
+                or the running sums for boxes.
+            */
+            ConvolutionMethod method(int datasize) const
+            {
+                if(_plan->method != ConvolutionMethod::Automatic){
+                    return _plan->method;
+                }
+
+                const int kernelsize = _plan->kernel.size();
+                const int blocksize = _plan->blocksize;
+                const int step = blocksize - kernelsize + 1;
+                const double nblocks = std::ceil(static_cast<double>(datasize)/step);
+                const double directcost = static_cast<double>(datasize)*kernelsize;
+                const double fftcost = nblocks*blocksize*std::log2(static_cast<double>(blocksize))*FFTCost;
+                return fftcost < directcost ? ConvolutionMethod::FFT : ConvolutionMethod::Direct;
+            }
+
+            /*!
+                @brief Convolve, writing into the given output (array or view)
+                which must be the same size as the data.
+            */
+            template<class Output>
+            void convolve(const ConstNumericalView<T>& data, Output& output)
+            {
+                const int size = data.size();
+                if(size == 0){
+                    return;
+                }
+
+                switch(method(size)){
+                    case ConvolutionMethod::Separable: separable(data); break;
+                    case ConvolutionMethod::FFT: overlapSave(data); break;
+                    default: direct(data); break;
+                }
+                std::copy(_result.data(), _result.data() + size, output.begin());
+            }
+
+            /*!
+                @brief Convolve, returning a new array.
+            */
+            NumericalData<T> convolve(const ConstNumericalView<T>& data)
+            {
+                NumericalData<T> output(data.size());
+                convolve(data, output);
+                return output;
+            }
+
+        private:
+            using Buffer = Array1D<T>;
+
+            // what does not change after construction, shared by copies
+            struct Plan
+            {
+                NumericalData<T> kernel;
+                ConvolutionMethod method = ConvolutionMethod::Automatic;
+                std::vector<int> boxes;
+                T scale = 1;
+                int blocksize = MinBlockSize;
+                std::vector<Complex> spectrum;
+            };
+
+            ConvolutionEngine() = default;
+
+            // the block size and the spectrum of the kernel for it
+            void makePlan(Plan& plan)
+            {
+                const int kernelsize = plan.kernel.size();
+                plan.blocksize = MinBlockSize;
+                while(plan.blocksize < BlockFactor*kernelsize){
+                    plan.blocksize *= 2;
+                }
+                if(plan.method == ConvolutionMethod::Direct || plan.method == ConvolutionMethod::Separable){
+                    _plan = std::make_shared<const Plan>(std::move(plan));
+                    return;
+                }
+
+                // the inverse is unscaled, so scale the kernel instead
+                const int blocksize = plan.blocksize;
+                _fft.SetFlag(Eigen::FFT<T>::HalfSpectrum);
+                _fft.SetFlag(Eigen::FFT<T>::Unscaled);
+                Buffer padded = Buffer::Zero(blocksize);
+                for(int i=0; i<kernelsize; ++i){
+                    padded[i] = plan.kernel[i]/static_cast<T>(blocksize);
+                }
+                plan.spectrum.resize(blocksize/2 + 1);
+                _fft.fwd(plan.spectrum.data(), padded.data(), blocksize);
+
+                // make the inverse plan now too
+                _block.resize(blocksize);
+                _fft.inv(_block.data(), plan.spectrum.data(), blocksize);
+                _plan = std::make_shared<const Plan>(std::move(plan));
+            }
+
+            // the data with before zeros before and enough zeros after
+            void pad(const ConstNumericalView<T>& data, int before, int length)
+            {
+                _padded.resize(length);
+                _padded.head(before).setZero();
+                std::copy(data.begin(), data.end(), _padded.data() + before);
+                _padded.tail(length - before - data.size()).setZero();
+            }
+
+            // out[i] = sum_j k[j]*x[i+c-j], in chunks that stay in cache
+            void direct(const ConstNumericalView<T>& data)
+            {
+                constexpr int ChunkSize = 512;
+                const NumericalData<T>& kernel = _plan->kernel;
+                const int size = data.size();
+                const int kernelsize = kernel.size();
+                const int offset = centre() + kernelsize - 1;
+                pad(data, kernelsize - 1, size + 2*(kernelsize - 1));
+
+                _result.resize(size);
+                for(int start=0; start<size; start+=ChunkSize){
+                    const int n = std::min(ChunkSize, size - start);
+                    auto chunk = _result.segment(start, n);
+                    chunk = kernel[0]*_padded.segment(start + offset, n);
+                    for(int j=1; j<kernelsize; ++j){
+                        chunk += kernel[j]*_padded.segment(start + offset - j, n);
+                    }
+                }
+            }
+
+            // each block of step outputs is the circular convolution of
+            // the block of inputs, without the first kernelsize-1 (wrapped) values
+            void overlapSave(const ConstNumericalView<T>& data)
+            {
+                const int size = data.size();
+                const int kernelsize = _plan->kernel.size();
+                const int blocksize = _plan->blocksize;
+                const std::vector<Complex>& spectrum = _plan->spectrum;
+                const int step = blocksize - kernelsize + 1;
+                const int nblocks = (size + step - 1)/step;
+                const int shift = kernelsize - 1 - centre();
+                pad(data, shift, std::max(size + shift, (nblocks - 1)*step + blocksize));
+
+                _result.resize(size);
+                _block.resize(blocksize);
+                _blockspectrum.resize(blocksize/2 + 1);
+                for(int b=0; b<nblocks; ++b){
+                    const int start = b*step;
+                    _fft.fwd(_blockspectrum.data(), _padded.data() + start, blocksize);
+                    for(size_t k=0; k<_blockspectrum.size(); ++k){
+                        _blockspectrum[k] *= spectrum[k];
+                    }
+                    _fft.inv(_block.data(), _blockspectrum.data(), blocksize);
+
+                    const int n = std::min(step, size - start);
+                    std::copy(_block.data() + kernelsize - 1, _block.data() + kernelsize - 1 + n,
+                              _result.data() + start);
+                }
+            }
+
+            // the full convolution with each box in turn (by running sums),
+            // the output is the middle of the last
+            void separable(const ConstNumericalView<T>& data)
+            {
+                const int size = data.size();
+                _padded.resize(size);
+                std::copy(data.begin(), data.end(), _padded.data());
+
+                int length = size;
+                for(int width: _plan->boxes){
+                    // next[m] = sum of values[m-width+1 .. m]
+                    _result.resize(length + width - 1);
+                    CompensatedSum<T> sum;
+                    for(int m=0; m<length + width - 1; ++m){
+                        if(m < length){
+                            if(m >= width){
+                                sum.slide(_padded[m], _padded[m-width]);
+                            }
+                            else{
+                                sum.add(_padded[m]);
+                            }
+                        }
+                        else if(m >= width){
+                            sum.subtract(_padded[m-width]);
+                        }
+                        _result[m] = sum.value();
+                    }
+                    _padded.swap(_result);
+                    length += width - 1;
+                }
+
+                _result = _plan->scale*_padded.segment(centre(), size);
+            }
+
+            std::shared_ptr<const Plan> _plan;
+            Eigen::FFT<T> _fft;
+
+            Buffer _padded;
+            Buffer _result;
+            std::vector<T> _block;
+            std::vector<Complex> _blockspectrum;
+    };
+
+    template<typename T>
+    constexpr int ConvolutionEngine<T>::MinBlockSize;
+
+    template<typename T>
+    constexpr int ConvolutionEngine<T>::BlockFactor;
+
+    template<typename T>
+    constexpr double ConvolutionEngine<T>::FFTCost;
+
+    /*!
+       @brief Engines for one kernel that can be used from any number of
+       threads at once. Each call takes an idle engine and gives it back
+       after, so the engines (and their buffers) are reused between calls
+       and a new one (a copy, sharing the plan) is only made when more
+       calls run at once than before. Copies of the pool share the engines.
+    */
+    template<typename T=DefaultType>
+    class ConvolutionEnginePool
+    {
+        public:
+            using value_type = T;
+
+            explicit ConvolutionEnginePool(const ConvolutionEngine<T>& engine)
+            : _engines(std::make_shared<Engines>(engine))
+            {}
+
+            inline const NumericalData<T>& kernel() const
+            {
+                return _engines->prototype.kernel();
+            }
+
+            inline int centre() const
+            {
+                return _engines->prototype.centre();
+            }
+
+            inline ConvolutionMethod method(int datasize) const
+            {
+                return _engines->prototype.method(datasize);
+            }
+
+            /*!
+                @brief Convolve, writing into the given output (array or view)
+                which must be the same size as the data.
+            */
+            template<class Output>
+            void convolve(const ConstNumericalView<T>& data, Output& output) const
+            {
+                Lease lease(*_engines);
+                lease.engine->convolve(data, output);
+            }
+
+            NumericalData<T> convolve(const ConstNumericalView<T>& data) const
+            {
+                NumericalData<T> output(data.size());
+                convolve(data, output);
+                return output;
+            }
+
+        private:
+            struct Engines
+            {
+                explicit Engines(const ConvolutionEngine<T>& engine) : prototype(engine)
+                {}
+
+                // only ever copied, never used to convolve
+                const ConvolutionEngine<T> prototype;
+                std::mutex mutex;
+                std::vector<std::unique_ptr<ConvolutionEngine<T>>> idle;
+            };
+
+            // an engine taken from the idle ones for the scope
+            struct Lease
+            {
+                explicit Lease(Engines& engines) : _engines(engines)
+                {
+                    std::lock_guard<std::mutex> lock(_engines.mutex);
+                    if(_engines.idle.empty()){
+                        engine.reset(new ConvolutionEngine<T>(_engines.prototype));
+                    }
+                    else{
+                        engine = std::move(_engines.idle.back());
+                        _engines.idle.pop_back();
+                    }
+                }
+
+                ~Lease()
+                {
+                    std::lock_guard<std::mutex> lock(_engines.mutex);
+                    _engines.idle.push_back(std::move(engine));
+                }
+
+                Lease(const Lease&) = delete;
+                Lease& operator=(const Lease&) = delete;
+
+                std::unique_ptr<ConvolutionEngine<T>> engine;
+
+              private:
+                Engines& _engines;
+            };
+
+            std::shared_ptr<Engines> _engines;
+    };
+
+    /*!
+       @brief Convolve the data with the kernel, as numpy.convolve(data, kernel, mode='same').
+       Use a ConvolutionEngine to convolve many spectra with the same kernel.
+    */
+    template<typename T=DefaultType>
+    NumericalData<T> convolve(const ConstNumericalView<T>& data, const NumericalData<T>& kernel,
+                              ConvolutionMethod method=ConvolutionMethod::Automatic)
+    {
+        return ConvolutionEngine<T>(kernel, method).convolve(data);
+    }
+
+    /*!
+       @brief Correlate the data with the kernel, as numpy.correlate(data, kernel, mode='same'),
+       i.e. the convolution with the reversed kernel.
+    */
+    template<typename T=DefaultType>
+    NumericalData<T> correlate(const ConstNumericalView<T>& data, const NumericalData<T>& kernel,
+                               ConvolutionMethod method=ConvolutionMethod::Automatic)
+    {
+        return ConvolutionEngine<T>(NumericalData<T>(kernel.reverse()), method).convolve(data);
+    }
+
+    /*!
+       @brief The normalised Gaussian kernel, exp(-x^2/(2 sigma^2)) scaled by
+       its sum, out to truncate standard deviations either side (as
+       scipy.ndimage.gaussian_filter1d).
+    */
+    template<typename T=DefaultType>
+    NumericalData<T> gaussianKernel(double sigma, double truncate=4.0)
+    {
+        if(sigma <= 0.0){
+            throw PeakingDuckException("Gaussian kernel sigma must be positive.");
+        }
+        const int half = static_cast<int>(truncate*sigma + 0.5);
+        NumericalData<T> kernel(2*half + 1);
+        for(int i=-half; i<=half; ++i){
+            kernel[i+half] = static_cast<T>(std::exp(-0.5*i*i/(sigma*sigma)));
+        }
+        kernel *= static_cast<T>(1.0/kernel.sum());
+        return kernel;
+    }
+
+    /*!
+       @brief Smooths (or filters) the data by convolution with a kernel,
+       using a ConvolutionEngine (so direct, FFT or running sums as fits).
+
+        The kernel should be odd sized to be symmetric about each point,
+        and sum to one for smoothing. The points within centre() of the
+        start and size-1-centre() of the end, where the kernel does
+        not fit, are left as they are (EdgeMode::Keep) or are the
+        weighted sum over the part of the kernel in the data scaled by
+        the sum of those weights (EdgeMode::Truncate).
+
+        See makeGaussianSmoother and makeTriangularSmoother.
+    */
+    template<typename T=DefaultType, int Size=ArrayTypeDynamic>
+    struct ConvolutionSmoother : public IProcess<T, Size>
+    {
+        explicit ConvolutionSmoother(const NumericalData<T>& kernel, EdgeMode edgemode=EdgeMode::Keep,
+                                     ConvolutionMethod method=ConvolutionMethod::Automatic)
+        : ConvolutionSmoother(ConvolutionEngine<T>(kernel, method), edgemode)
+        {}
+
+        explicit ConvolutionSmoother(const ConvolutionEngine<T>& engine, EdgeMode edgemode=EdgeMode::Keep)
+        : _engines(engine), _edgemode(edgemode)
+        {
+            // the sums of the kernel weights, for the truncated edges
+            const NumericalData<T>& kernel = _engines.kernel();
+            _cumulative = NumericalData<T>::Zero(kernel.size() + 1);
+            std::partial_sum(kernel.begin(), kernel.end(), _cumulative.begin() + 1);
+        }
+
+        inline const NumericalData<T>& kernel() const
+        {
+            return _engines.kernel();
+        }
+
+        NumericalData<T, Size>
+        go(const NumericalData<T, Size>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalData<T, Size>
+        go(const ConstNumericalView<T>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalBatch<T>
+        go(const NumericalBatch<T>& batch) const override final
+        {
+            // smoothing straight into the new batch
+            NumericalBatch<T> smoothed(batch.nchannels(), batch.nspectra());
+            for(int i=0; i<batch.nspectra(); ++i){
+                NumericalView<T> output = smoothed.spectrum(i);
+                smooth(batch.spectrum(i), output);
+            }
+            return smoothed;
+        };
+
+      private:
+        template<typename DataType>
+        NumericalData<T, Size> apply(const DataType& data) const
+        {
+            NumericalData<T, Size> smoothed = data;
+            smooth(data, smoothed);
+            return smoothed;
+        }
+
+        // the output must not be the data
+        template<typename OutputType>
+        void smooth(const ConstNumericalView<T>& data, OutputType& smoothed) const
+        {
+            const int size = data.size();
+            const int kernelsize = _engines.kernel().size();
+            const int centre = _engines.centre();
+            const int first = std::min(centre, size);
+            const int last = std::max(first, size - (kernelsize - 1 - centre));
+
+            _engines.convolve(data, smoothed);
+            if(_edgemode != EdgeMode::Truncate){
+                std::copy(data.begin(), data.begin() + first, smoothed.begin());
+                std::copy(data.begin() + last, data.end(), smoothed.begin() + last);
+                return;
+            }
+
+            // the kernel indices in the data at i are [i+c-(size-1), i+c]
+            auto edge = [&](int i){
+                const int lower = std::max(0, i + centre - (size - 1));
+                const int upper = std::min(kernelsize - 1, i + centre);
+                smoothed[i] /= (_cumulative[upper + 1] - _cumulative[lower]);
+            };
+            for(int i=0; i<first; ++i){
+                edge(i);
+            }
+            for(int i=last; i<size; ++i){
+                edge(i);
+            }
+        }
+
+        ConvolutionEnginePool<T> _engines;
+        EdgeMode _edgemode;
+        NumericalData<T> _cumulative;
+    };
+
+    /*!
+       @brief Gaussian smoother, convolution with gaussianKernel(sigma, truncate)
+    */
+    template<typename T=DefaultType, int Size=ArrayTypeDynamic>
+    std::shared_ptr<IProcess<T, Size>> makeGaussianSmoother(double sigma, double truncate=4.0,
+                                                            EdgeMode edgemode=EdgeMode::Keep)
+    {
+        return std::make_shared<ConvolutionSmoother<T, Size>>(gaussianKernel<T>(sigma, truncate), edgemode);
+    }
+
+    /*!
+       @brief Triangular smoother, the weights w+1-|i| for |i| <= w (windowsize),
+       scaled by their sum (w+1)^2. Done as two box running sums so O(N)
+       for any window size.
+    */
+    template<typename T=DefaultType, int Size=ArrayTypeDynamic>
+    std::shared_ptr<IProcess<T, Size>> makeTriangularSmoother(int windowsize, EdgeMode edgemode=EdgeMode::Keep)
+    {
+        const T scale = static_cast<T>(1.0/((windowsize + 1.0)*(windowsize + 1.0)));
+        return std::make_shared<ConvolutionSmoother<T, Size>>(
+            ConvolutionEngine<T>::boxes({windowsize + 1, windowsize + 1}, scale), edgemode);
+    }
+
+PEAKINGDUCK_NAMESPACE_END
+PEAKINGDUCK_NAMESPACE_END
+
+#endif // CORE_CONVOLUTION_HPP
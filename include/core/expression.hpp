@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Defines the lazy numerical expression returned from arithmetic on
+    NumericalData and NumericalView.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef CORE_EXPRESSION_HPP
+#define CORE_EXPRESSION_HPP
+
+#include <type_traits>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "common.hpp"
+#include "core/numericalfunctions.hpp"
+#include "core/numericalmacros.h"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(core)
+
+    template<typename T, int Size>
+    struct NumericalData;
+
+    template<typename T>
+    struct NumericalView;
+
+    /*!
+       @brief Is the type one of the numerical types (array, view or
+       expression), i.e. can it be used as an operand of the arithmetic operators
+    */
+    template<class T>
+    struct IsNumerical : std::false_type {};
+
+    template<typename T, int Size>
+    struct IsNumerical<NumericalData<T, Size>> : std::true_type {};
+
+    template<typename T>
+    struct IsNumerical<NumericalView<T>> : std::true_type {};
+
+    template<class Expr>
+    struct IsNumerical<NumericalExpression<Expr>> : std::true_type {};
+
+    template<class Expr>
+    struct NumericalFunctionsTraits<NumericalExpression<Expr>>
+    {
+        using PlainType = NumericalData<typename Expr::Scalar, Expr::SizeAtCompileTime>;
+    };
+
+    /*!
+       @brief A lazy (unevaluated) numerical expression, i.e. the result of
+        (x + 1.0).sqrt().log() or data - data.snip(20).
+
+        Arithmetic operators and the coefficient-wise functions (exp, log,
+        sqrt, square, abs, pow, LLS, inverseLLS) on NumericalData, NumericalView
+        and NumericalExpression all return a NumericalExpression, so a whole chain
+        is evaluated in a single (vectorized) loop only when it is assigned to a
+        NumericalData (or view), with no temporary array per step.
+
+        Like the Eigen expressions it wraps, it refers to the arrays it was
+        built from, so do not keep one (i.e. with auto) beyond the lifetime
+        of those arrays - assign it to a NumericalData instead.
+
+        The other numerical functions (snip, gradient, midpoint, etc..)
+        evaluate the expression and return a new array.
+    */
+    template<class Expr>
+    struct NumericalExpression : public NumericalFunctions<NumericalExpression<Expr>>
+    {
+            using value_type = typename Expr::Scalar;
+            using PlainType = typename NumericalFunctionsTraits<NumericalExpression>::PlainType;
+
+            explicit NumericalExpression(const Expr& expr) : _expr(expr)
+            { }
+
+            inline int size() const
+            {
+                return static_cast<int>(_expr.size());
+            }
+
+            // evaluates a single coefficient only
+            inline value_type operator[](int index) const
+            {
+                return _expr.coeff(index);
+            }
+
+            inline decltype(auto) segment(int start, int n) const
+            {
+                return _expr.segment(start, n);
+            }
+
+            // evaluate into a new array
+            inline PlainType eval() const
+            {
+                return PlainType(*this);
+            }
+
+            inline std::vector<value_type> to_vector() const
+            {
+                return eval().to_vector();
+            }
+
+            // evaluate into a plain Eigen array, as the Eigen expressions did
+            template<int Size>
+            operator Eigen::Array<value_type, Size, 1>() const
+            {
+                return _expr;
+            }
+
+            // reduce
+            inline value_type sum() const
+            {
+                return _expr.sum();
+            }
+
+            inline value_type mean() const
+            {
+                return _expr.mean();
+            }
+
+            inline value_type maxCoeff() const
+            {
+                return _expr.maxCoeff();
+            }
+
+            inline value_type minCoeff() const
+            {
+                return _expr.minCoeff();
+            }
+
+            inline auto operator-() const
+            {
+                return makeNumericalExpression(-_expr);
+            }
+
+            PEAKINGDUCK_NUMERICAL_EXPRESSION_OPERATOR_IMP_MACRO(NumericalExpression,+)
+            PEAKINGDUCK_NUMERICAL_EXPRESSION_OPERATOR_IMP_MACRO(NumericalExpression,-)
+            PEAKINGDUCK_NUMERICAL_EXPRESSION_OPERATOR_IMP_MACRO(NumericalExpression,*)
+            PEAKINGDUCK_NUMERICAL_EXPRESSION_OPERATOR_IMP_MACRO(NumericalExpression,/)
+
+            friend inline const Expr& toEigen(const NumericalExpression& expression)
+            {
+                return expression._expr;
+            }
+
+        private:
+            Expr _expr;
+    };
+
+    template<class Expr>
+    inline NumericalExpression<Expr> makeNumericalExpression(const Expr& expr)
+    {
+        return NumericalExpression<Expr>(expr);
+    }
+
+PEAKINGDUCK_NAMESPACE_END
+PEAKINGDUCK_NAMESPACE_END
+
+#endif // CORE_EXPRESSION_HPP
@@ -0,0 +1,1048 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Defines the peak fitting, Gaussian peaks (with optional tails) on
+    a polynomial background fitted to regions around the found peaks
+    by Levenberg-Marquardt, and the deconvolution of multiplets.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef CORE_FITTING_HPP
+#define CORE_FITTING_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "common.hpp"
+#include "exceptions.hpp"
+#include "core/numerical.hpp"
+#include "core/peaking.hpp"
+#include "util/threadpool.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(core)
+
+    /*!
+       @brief The background under the peaks of a fit region
+    */
+    enum class FitBackground
+    {
+        Linear,
+        Quadratic
+    };
+
+    /*!
+       @brief A region of the data, [first, last), with a peak at each of
+       the centroids (in channels, the first guesses).
+    */
+    struct FitRegion
+    {
+        int first;
+        int last;
+        std::vector<double> centroids;
+    };
+
+    /*!
+       @brief The regions halfwidth channels either side of each peak (within
+       the data of size points), regions that overlap are joined into one
+       with all of their peaks.
+    */
+    template<typename T>
+    std::vector<FitRegion> fitRegions(const PeakList<T>& peaks, int halfwidth, int size)
+    {
+        if(halfwidth < 1){
+            throw PeakingDuckException("Fit region half width must be positive.");
+        }
+
+        std::vector<int> indices;
+        for(const auto& peak: peaks){
+            indices.push_back(static_cast<int>(peak.index));
+        }
+        std::sort(indices.begin(), indices.end());
+
+        std::vector<FitRegion> regions;
+        for(int index: indices){
+            const int first = std::max(0, index - halfwidth);
+            const int last = std::min(size, index + halfwidth + 1);
+            if(!regions.empty() && first < regions.back().last){
+                regions.back().last = std::max(regions.back().last, last);
+                regions.back().centroids.push_back(index);
+            }
+            else{
+                regions.push_back(FitRegion{first, last, {static_cast<double>(index)}});
+            }
+        }
+        return regions;
+    }
+
+    /*!
+       @brief The fitted peaks, one row per peak in order of region and
+       then of the centroids of the region, with their uncertainties (one
+       standard deviation) from the covariance of the fit.
+
+        The area is the net area of the peak including its tail, the FWHM
+        is that of its Gaussian part. The tail fraction and slope (zero
+        without tails), reduced chi squared, iterations and convergence
+        are those of the region of the peak. A fit is stalled (and not
+        converged) when no step from its first guess lowers the chi squared,
+        so the parameters are still the guess.
+    */
+    template<typename T=DefaultType>
+    struct PeakFits
+    {
+        inline int size() const
+        {
+            return static_cast<int>(centroids.size());
+        }
+
+        std::vector<int> regions;
+        std::vector<T> centroids;
+        std::vector<T> centroidErrors;
+        std::vector<T> heights;
+        std::vector<T> heightErrors;
+        std::vector<T> fwhms;
+        std::vector<T> fwhmErrors;
+        std::vector<T> areas;
+        std::vector<T> areaErrors;
+        std::vector<T> tailFractions;
+        std::vector<T> tailSlopes;
+        std::vector<T> reducedChi2s;
+        std::vector<int> iterations;
+        std::vector<bool> converged;
+        std::vector<bool> stalled;
+    };
+
+    /*!
+       @brief Fits Gaussian peaks, with an optional low energy tail, on a
+       linear or quadratic background to regions of the data by
+       Levenberg-Marquardt.
+
+        Peak k of a region is
+            H_k*((1 - eta)*G(u) + eta*T(u)), u = x - c_k
+            G(u) = exp(-u^2/(2*s_k^2))
+            T(u) = exp(u/beta)*erfc(u/(sqrt(2)*s_k) + s_k/(sqrt(2)*beta))
+        on the background b0 + b1*v + b2*v^2, v = x - (middle of the region),
+        where the tail fraction eta and slope beta are shared by the peaks
+        of the region. The residuals are weighted by the Poisson variance,
+        max(y, 1), so the uncertainties are from the inverse of J^T W J at
+        the solution, not scaled by the chi squared.
+
+        The regions are independent and fitted concurrently on the thread
+        pool, each writing only its own result, so the results do not
+        depend on the number of threads.
+
+        Usage as:
+
+            const GaussianPeakFitter<double> fitter(FitBackground::Linear, true);
+            const PeakFits<double> fits = fitter.fit(data, finder.find(data), 10);
+    */
+    template<typename T=DefaultType>
+    class GaussianPeakFitter
+    {
+        public:
+            explicit GaussianPeakFitter(FitBackground background=FitBackground::Linear, bool tails=false,
+                                        int maxIterations=100, double tolerance=1e-8,
+                                        util::ThreadPool& pool=util::ThreadPool::shared()) :
+                _background(background), _tails(tails), _maxIterations(maxIterations),
+                _tolerance(tolerance), _pool(&pool)
+            {
+                if(maxIterations < 1){
+                    throw PeakingDuckException("Fit needs at least one iteration.");
+                }
+                if(!(tolerance > 0.0)){
+                    throw PeakingDuckException("Fit tolerance must be positive.");
+                }
+            }
+
+            /*!
+                @brief Fit the peaks of each region.
+            */
+            PeakFits<T> fit(const ConstNumericalView<T>& data, const std::vector<FitRegion>& regions) const
+            {
+                for(const auto& region: regions){
+                    check(data, region);
+                }
+
+                std::vector<RegionFit> results(regions.size());
+                _pool->parallelFor(static_cast<int>(regions.size()), [&](int r){
+                    results[r] = fitRegion(data, regions[r]);
+                });
+
+                PeakFits<T> fits;
+                for(size_t r=0; r<regions.size(); ++r){
+                    append(regions[r], results[r], static_cast<int>(r), fits);
+                }
+                return fits;
+            }
+
+            /*!
+                @brief Fit the peaks in regions of halfwidth channels either
+                side of each, see fitRegions.
+            */
+            PeakFits<T> fit(const ConstNumericalView<T>& data, const PeakList<T>& peaks, int halfwidth) const
+            {
+                return fit(data, fitRegions(peaks, halfwidth, data.size()));
+            }
+
+            // sqrt(8 ln 2)
+            static constexpr double FWHMPerSigma = 2.3548200450309493;
+
+        private:
+            static constexpr double SqrtTwo = 1.4142135623730951;
+            static constexpr double SqrtPi = 1.7724538509055160;
+            static constexpr double SqrtTwoPi = 2.5066282746310002;
+            static constexpr double TwoOverSqrtPi = 1.1283791670955126;
+
+            using Vector = Eigen::VectorXd;
+            using Matrix = Eigen::MatrixXd;
+
+            struct RegionFit
+            {
+                Vector parameters;
+                Matrix covariance;
+                double chi2;
+                int iterations;
+                bool converged;
+                bool stalled;
+            };
+
+            inline int nbackground() const
+            {
+                return _background == FitBackground::Quadratic ? 3 : 2;
+            }
+
+            inline int nparameters(const FitRegion& region) const
+            {
+                return nbackground() + 3*static_cast<int>(region.centroids.size()) + (_tails ? 2 : 0);
+            }
+
+            void check(const ConstNumericalView<T>& data, const FitRegion& region) const
+            {
+                if(region.first < 0 || region.last > data.size() || region.first >= region.last){
+                    throw PeakingDuckException("Fit region must be within the data.");
+                }
+                if(region.centroids.empty()){
+                    throw PeakingDuckException("Fit region must have a peak.");
+                }
+                if(region.last - region.first <= nparameters(region)){
+                    throw PeakingDuckException("Fit region must have more points than parameters.");
+                }
+            }
+
+            // the first guesses, a line through the ends and each peak from
+            // its height above it and the points above half of that
+            Vector guess(const Vector& y, const FitRegion& region) const
+            {
+                const int n = static_cast<int>(y.size());
+                const int nb = nbackground();
+                const double middle = 0.5*(region.first + region.last - 1);
+                const double left = 0.5*(y[0] + y[1]);
+                const double right = 0.5*(y[n-2] + y[n-1]);
+                const double slope = (right - left)/(n - 2);
+
+                Vector p = Vector::Zero(nparameters(region));
+                p[0] = left + slope*(middle - region.first - 0.5);
+                p[1] = slope;
+                const auto background = [&](int i){ return p[0] + p[1]*(region.first + i - middle); };
+
+                for(size_t k=0; k<region.centroids.size(); ++k){
+                    const int centre = std::min(n - 1, std::max(0, static_cast<int>(std::round(region.centroids[k])) - region.first));
+                    const double height = std::max(1.0, y[centre] - background(centre));
+                    int lower = centre;
+                    while(lower > 0 && y[lower] - background(lower) > 0.5*height){
+                        --lower;
+                    }
+                    int upper = centre;
+                    while(upper < n - 1 && y[upper] - background(upper) > 0.5*height){
+                        ++upper;
+                    }
+                    p[nb + 3*k] = height;
+                    p[nb + 3*k + 1] = region.centroids[k];
+                    p[nb + 3*k + 2] = std::max(1.0, upper - lower - 1.0)/FWHMPerSigma;
+                }
+                if(_tails){
+                    p[nb + 3*region.centroids.size()] = 0.1;
+                    p[nb + 3*region.centroids.size() + 1] = p[nb + 2];
+                }
+                return p;
+            }
+
+            bool valid(const Vector& p, const FitRegion& region) const
+            {
+                const int nb = nbackground();
+                for(size_t k=0; k<region.centroids.size(); ++k){
+                    const double height = p[nb + 3*k];
+                    const double centroid = p[nb + 3*k + 1];
+                    const double sigma = p[nb + 3*k + 2];
+                    if(!(height >= 0.0 && centroid >= region.first && centroid <= region.last - 1 && sigma > 0.0)){
+                        return false;
+                    }
+                }
+                if(_tails){
+                    const double fraction = p[nb + 3*region.centroids.size()];
+                    const double slope = p[nb + 3*region.centroids.size() + 1];
+                    return fraction >= 0.0 && fraction <= 1.0 && slope > 0.0;
+                }
+                return true;
+            }
+
+            // exp(z^2)*erfc(z) for z >= 0, asymptotic where exp(z^2) overflows
+            static inline double erfcx(double z)
+            {
+                if(z < 25.0){
+                    return std::exp(z*z)*std::erfc(z);
+                }
+                const double z2 = 1.0/(z*z);
+                return (1.0 - 0.5*z2 + 0.75*z2*z2)/(z*SqrtPi);
+            }
+
+            // the model at each point of the region and its Jacobian
+            void model(const Vector& p, const FitRegion& region, Vector& f, Matrix& jacobian) const
+            {
+                const int n = region.last - region.first;
+                const int nb = nbackground();
+                const int npeaks = static_cast<int>(region.centroids.size());
+                const double middle = 0.5*(region.first + region.last - 1);
+                const double fraction = _tails ? p[nb + 3*npeaks] : 0.0;
+                const double slope = _tails ? p[nb + 3*npeaks + 1] : 1.0;
+
+                f.resize(n);
+                jacobian.setZero(n, p.size());
+                for(int i=0; i<n; ++i){
+                    const double x = region.first + i;
+                    const double v = x - middle;
+                    f[i] = p[0] + p[1]*v;
+                    jacobian(i, 0) = 1.0;
+                    jacobian(i, 1) = v;
+                    if(nb == 3){
+                        f[i] += p[2]*v*v;
+                        jacobian(i, 2) = v*v;
+                    }
+
+                    for(int k=0; k<npeaks; ++k){
+                        const int j = nb + 3*k;
+                        const double height = p[j];
+                        const double u = x - p[j+1];
+                        const double sigma = p[j+2];
+                        const double gauss = std::exp(-0.5*u*u/(sigma*sigma));
+                        const double dgaussdc = gauss*u/(sigma*sigma);
+                        const double dgaussds = dgaussdc*u/sigma;
+                        if(!_tails){
+                            f[i] += height*gauss;
+                            jacobian(i, j) = gauss;
+                            jacobian(i, j+1) = height*dgaussdc;
+                            jacobian(i, j+2) = height*dgaussds;
+                            continue;
+                        }
+
+                        // T = exp(u/beta)*erfc(z), as gauss*e*erfcx(z) for z >= 0 so
+                        // neither factor overflows, and d = 2/sqrt(pi)*exp(u/beta - z^2)
+                        const double e = std::exp(-0.5*sigma*sigma/(slope*slope));
+                        const double z = u/(SqrtTwo*sigma) + sigma/(SqrtTwo*slope);
+                        const double tail = z < 0.0 ? std::exp(u/slope)*std::erfc(z) : gauss*e*erfcx(z);
+                        const double d = TwoOverSqrtPi*gauss*e;
+                        const double peak = (1.0 - fraction)*gauss + fraction*tail;
+                        f[i] += height*peak;
+                        jacobian(i, j) = peak;
+                        jacobian(i, j+1) = height*((1.0 - fraction)*dgaussdc + fraction*(d/(SqrtTwo*sigma) - tail/slope));
+                        jacobian(i, j+2) = height*((1.0 - fraction)*dgaussds + fraction*d*(u/(SqrtTwo*sigma*sigma) - 1.0/(SqrtTwo*slope)));
+                        jacobian(i, nb + 3*npeaks) += height*(tail - gauss);
+                        jacobian(i, nb + 3*npeaks + 1) += height*fraction*(d*sigma/(SqrtTwo*slope*slope) - tail*u/(slope*slope));
+                    }
+                }
+            }
+
+            RegionFit fitRegion(const ConstNumericalView<T>& data, const FitRegion& region) const
+            {
+                const int n = region.last - region.first;
+                Vector y(n);
+                Vector weights(n);
+                for(int i=0; i<n; ++i){
+                    y[i] = static_cast<double>(data[region.first + i]);
+                    weights[i] = 1.0/std::max(1.0, y[i]);
+                }
+
+                RegionFit result;
+                result.parameters = guess(y, region);
+                result.iterations = 0;
+                result.converged = false;
+                result.stalled = false;
+
+                Vector f;
+                Matrix jacobian;
+                Vector trialf;
+                Matrix trialjacobian;
+                model(result.parameters, region, f, jacobian);
+                result.chi2 = (weights.array()*(y - f).array().square()).sum();
+
+                double lambda = 1e-3;
+                while(result.iterations < _maxIterations && !result.converged && !result.stalled){
+                    ++result.iterations;
+                    const Matrix alpha = jacobian.transpose()*weights.asDiagonal()*jacobian;
+                    const Vector beta = jacobian.transpose()*(weights.array()*(y - f).array()).matrix();
+
+                    // damp along the diagonal until the chi squared drops
+                    while(true){
+                        Matrix damped = alpha;
+                        damped.diagonal() += lambda*alpha.diagonal().cwiseMax(1e-12*alpha.diagonal().maxCoeff());
+                        const Vector step = damped.ldlt().solve(beta);
+                        const Vector trial = result.parameters + step;
+                        if(valid(trial, region)){
+                            model(trial, region, trialf, trialjacobian);
+                            const double chi2 = (weights.array()*(y - trialf).array().square()).sum();
+                            if(chi2 < result.chi2){
+                                const double improvement = result.chi2 - chi2;
+                                result.converged = improvement <= _tolerance*chi2 ||
+                                    step.norm() <= _tolerance*(result.parameters.norm() + _tolerance);
+                                result.parameters = trial;
+                                result.chi2 = chi2;
+                                std::swap(f, trialf);
+                                std::swap(jacobian, trialjacobian);
+                                lambda = std::max(1e-12, 0.1*lambda);
+                                break;
+                            }
+                        }
+                        lambda *= 10.0;
+                        // no step lowers the chi squared, at the minimum unless
+                        // no step ever has (still the first guess)
+                        if(lambda > 1e16){
+                            result.stalled = result.iterations == 1;
+                            result.converged = !result.stalled;
+                            break;
+                        }
+                    }
+                }
+
+                const Matrix alpha = jacobian.transpose()*weights.asDiagonal()*jacobian;
+                const Eigen::FullPivLU<Matrix> lu(alpha);
+                result.covariance = lu.isInvertible() ?
+                    Matrix(lu.inverse()) :
+                    Matrix::Constant(alpha.rows(), alpha.cols(), std::numeric_limits<double>::quiet_NaN());
+                return result;
+            }
+
+            void append(const FitRegion& region, const RegionFit& result, int index, PeakFits<T>& fits) const
+            {
+                const Vector& p = result.parameters;
+                const Matrix& covariance = result.covariance;
+                const int nb = nbackground();
+                const int npeaks = static_cast<int>(region.centroids.size());
+                const int ndf = (region.last - region.first) - static_cast<int>(p.size());
+                const int fractionindex = nb + 3*npeaks;
+                const double fraction = _tails ? p[fractionindex] : 0.0;
+                const double slope = _tails ? p[fractionindex + 1] : 0.0;
+                const auto error = [&](int j){ return std::sqrt(std::max(0.0, covariance(j, j))); };
+
+                for(int k=0; k<npeaks; ++k){
+                    const int j = nb + 3*k;
+                    const double height = p[j];
+                    const double sigma = p[j+2];
+
+                    // the area H*((1 - eta)*sqrt(2 pi)*s + eta*2*beta*exp(-s^2/(2 beta^2)))
+                    // and its gradient in the parameters for the error
+                    Vector gradient = Vector::Zero(p.size());
+                    const double gaussarea = SqrtTwoPi*sigma;
+                    double unitarea = gaussarea;
+                    gradient[j+2] = height*SqrtTwoPi;
+                    if(_tails){
+                        const double e = std::exp(-0.5*sigma*sigma/(slope*slope));
+                        const double tailarea = 2.0*slope*e;
+                        unitarea = (1.0 - fraction)*gaussarea + fraction*tailarea;
+                        gradient[j+2] = height*((1.0 - fraction)*SqrtTwoPi - 2.0*fraction*sigma*e/slope);
+                        gradient[fractionindex] = height*(tailarea - gaussarea);
+                        gradient[fractionindex + 1] = 2.0*height*fraction*e*(1.0 + sigma*sigma/(slope*slope));
+                    }
+                    gradient[j] = unitarea;
+
+                    fits.regions.push_back(index);
+                    fits.centroids.push_back(static_cast<T>(p[j+1]));
+                    fits.centroidErrors.push_back(static_cast<T>(error(j+1)));
+                    fits.heights.push_back(static_cast<T>(height));
+                    fits.heightErrors.push_back(static_cast<T>(error(j)));
+                    fits.fwhms.push_back(static_cast<T>(FWHMPerSigma*sigma));
+                    fits.fwhmErrors.push_back(static_cast<T>(FWHMPerSigma*error(j+2)));
+                    fits.areas.push_back(static_cast<T>(height*unitarea));
+                    fits.areaErrors.push_back(static_cast<T>(std::sqrt(std::max(0.0, gradient.dot(covariance*gradient)))));
+                    fits.tailFractions.push_back(static_cast<T>(fraction));
+                    fits.tailSlopes.push_back(static_cast<T>(slope));
+                    fits.reducedChi2s.push_back(static_cast<T>(result.chi2/ndf));
+                    fits.iterations.push_back(result.iterations);
+                    fits.converged.push_back(result.converged);
+                    fits.stalled.push_back(result.stalled);
+                }
+            }
+
+            const FitBackground _background;
+            const bool _tails;
+            const int _maxIterations;
+            const double _tolerance;
+            util::ThreadPool* _pool;
+    };
+
+    template<typename T>
+    constexpr double GaussianPeakFitter<T>::FWHMPerSigma;
+
+    /*!
+       @brief The groups of SimplePeakFinder(percentThreshold), the points 
+       above the threshold relative to the maximum, widened by margin 
+       channels either side (within the data) as fit regions, regions that 
+       overlap are joined into one. The centroids are the group maxima.
+
+        Peaks closer than their width are one group, with one maximum, 
+        see MultipletFitter for the peaks in each.
+    */
+    template<typename T>
+    std::vector<FitRegion> multipletRegions(const ConstNumericalView<T>& data, T percentThreshold, int margin)
+    {
+        if(margin < 0){
+            throw PeakingDuckException("Multiplet region margin must not be negative.");
+        }
+
+        std::vector<FitRegion> regions;
+        if(data.size() == 0){
+            return regions;
+        }
+        using Values = Eigen::Array<T, Eigen::Dynamic, 1>;
+        const Eigen::Map<const Values, Eigen::Unaligned, Eigen::InnerStride<>> values(
+            data.data(), data.size(), Eigen::InnerStride<>(data.stride()));
+        forEachGroupAbove(values, values.maxCoeff()*percentThreshold, [&](int first, int last, int maxindex, T){
+            const int start = std::max(0, first - margin);
+            const int end = std::min(static_cast<int>(data.size()), last + margin);
+            if(!regions.empty() && start < regions.back().last){
+                regions.back().last = std::max(regions.back().last, end);
+                regions.back().centroids.push_back(maxindex);
+            }
+            else{
+                regions.push_back(FitRegion{start, end, {static_cast<double>(maxindex)}});
+            }
+        });
+        return regions;
+    }
+
+    /*!
+       @brief Deconvolves multiplets, peaks closer than their width that a 
+       peak finder reports as one, by fitting 1 to maxComponents Gaussian
+       peaks jointly to each region and keeping the number of peaks with 
+       the lowest Bayesian information criterion, 
+            BIC = D + k*ln(n)
+       for the Poisson deviance D of the fit, k parameters and n points.
+
+        The peaks of a region share one width,
+            sum_k H_k*exp(-(x - c_k)^2/(2*s^2))
+        on a linear or quadratic background, with the Poisson weights and
+        Levenberg-Marquardt steps of GaussianPeakFitter. The centroids are
+        kept at least the width from the ends of the region. The first 
+        peak starts from the first centroid of the region (or its maximum
+        without one). Each further peak starts from the fit with one fewer,
+        both with the highest peak split in two and with a peak where it
+        lowers the chi squared the most, keeping the better of those that
+        end within the region. The numbers of peaks stop at the first that
+        does not lower the criterion, or has no such fit, or with as many
+        parameters as points.
+
+        The model, weighted Jacobian and normal equations of a region are
+        in one workspace sized for the most peaks, so the iterations and
+        the numbers of peaks reuse its storage. The regions are independent
+        and fitted concurrently on the thread pool, each writing only its 
+        own result, so the results do not depend on the number of threads.
+
+        Usage as:
+
+            const MultipletFitter<double> fitter(4);
+            const PeakFits<double> fits = fitter.fit(data, multipletRegions<double>(data, 0.05, 10));
+    */
+    template<typename T=DefaultType>
+    class MultipletFitter
+    {
+        public:
+            explicit MultipletFitter(int maxComponents=4, FitBackground background=FitBackground::Linear,
+                                     int maxIterations=100, double tolerance=1e-8,
+                                     util::ThreadPool& pool=util::ThreadPool::shared()) :
+                _maxComponents(maxComponents), _background(background), _maxIterations(maxIterations),
+                _tolerance(tolerance), _pool(&pool)
+            {
+                if(maxComponents < 1){
+                    throw PeakingDuckException("Multiplet fit needs at least one component.");
+                }
+                if(maxIterations < 1){
+                    throw PeakingDuckException("Fit needs at least one iteration.");
+                }
+                if(!(tolerance > 0.0)){
+                    throw PeakingDuckException("Fit tolerance must be positive.");
+                }
+            }
+
+            /*!
+                @brief Fit the peaks of each region, the number of peaks of 
+                each from the information criterion. The centroids of a
+                region are in order.
+            */
+            PeakFits<T> fit(const ConstNumericalView<T>& data, const std::vector<FitRegion>& regions) const
+            {
+                for(const auto& region: regions){
+                    check(data, region);
+                }
+
+                std::vector<Solution> results(regions.size());
+                _pool->parallelFor(static_cast<int>(regions.size()), [&](int r){
+                    results[r] = solve(data, regions[r]);
+                });
+
+                PeakFits<T> fits;
+                for(size_t r=0; r<regions.size(); ++r){
+                    append(regions[r], results[r], static_cast<int>(r), fits);
+                }
+                return fits;
+            }
+
+            /*!
+                @brief The information criterion (BIC) of a region for 1 to
+                maxComponents peaks, infinite for those not fitted (after 
+                the first that does not lower it).
+            */
+            std::vector<double> criteria(const ConstNumericalView<T>& data, const FitRegion& region) const
+            {
+                check(data, region);
+                return solve(data, region).criteria;
+            }
+
+            inline int maxComponents() const
+            {
+                return _maxComponents;
+            }
+
+        private:
+            using Vector = Eigen::VectorXd;
+            using Matrix = Eigen::MatrixXd;
+
+            static constexpr double FWHMPerSigma = GaussianPeakFitter<T>::FWHMPerSigma;
+            static constexpr double SqrtTwoPi = 2.5066282746310002;
+
+            struct Solution
+            {
+                Vector parameters;
+                Matrix covariance;
+                double chi2;
+                int iterations;
+                bool converged;
+                bool stalled;
+                std::vector<double> criteria;
+            };
+
+            // the storage of a region, the Jacobians for the most parameters
+            // with the first k columns used for k parameters
+            struct Workspace
+            {
+                Workspace(int n, int maxparameters) :
+                    y(n), roots(n), f(n), trialf(n), residual(n),
+                    jacobian(n, maxparameters), trialjacobian(n, maxparameters),
+                    alpha(maxparameters, maxparameters), damped(maxparameters, maxparameters)
+                {
+                }
+
+                Vector y;
+                Vector roots;
+                Vector f;
+                Vector trialf;
+                Vector residual;
+                Matrix jacobian;
+                Matrix trialjacobian;
+                Matrix alpha;
+                Matrix damped;
+                Eigen::LDLT<Matrix> ldlt;
+            };
+
+            inline int nbackground() const
+            {
+                return _background == FitBackground::Quadratic ? 3 : 2;
+            }
+
+            // the background, the shared width and a height and centroid per peak
+            inline int nparameters(int npeaks) const
+            {
+                return nbackground() + 1 + 2*npeaks;
+            }
+
+            // the most peaks with fewer parameters than points
+            inline int maxPeaks(int npoints) const
+            {
+                return std::min(_maxComponents, (npoints - nbackground() - 2)/2);
+            }
+
+            void check(const ConstNumericalView<T>& data, const FitRegion& region) const
+            {
+                if(region.first < 0 || region.last > data.size() || region.first >= region.last){
+                    throw PeakingDuckException("Fit region must be within the data.");
+                }
+                if(maxPeaks(region.last - region.first) < 1){
+                    throw PeakingDuckException("Fit region must have more points than parameters.");
+                }
+            }
+
+            // one peak, from its height above a line through the ends and 
+            // the points above half of that
+            Vector guess(const Vector& y, const FitRegion& region) const
+            {
+                const int n = static_cast<int>(y.size());
+                const int nb = nbackground();
+                const double middle = 0.5*(region.first + region.last - 1);
+                const double left = 0.5*(y[0] + y[std::min(1, n - 1)]);
+                const double right = 0.5*(y[std::max(0, n - 2)] + y[n-1]);
+                const double slope = (right - left)/std::max(1, n - 2);
+
+                Vector p = Vector::Zero(nparameters(1));
+                p[0] = left + slope*(middle - region.first - 0.5);
+                p[1] = slope;
+                const auto background = [&](int i){ return p[0] + p[1]*(region.first + i - middle); };
+
+                int centre = 0;
+                if(region.centroids.empty()){
+                    (y - Vector::NullaryExpr(n, background)).maxCoeff(&centre);
+                }
+                else{
+                    centre = std::min(n - 1, std::max(0, static_cast<int>(std::round(region.centroids[0])) - region.first));
+                }
+                const double height = std::max(1.0, y[centre] - background(centre));
+                int lower = centre;
+                while(lower > 0 && y[lower] - background(lower) > 0.5*height){
+                    --lower;
+                }
+                int upper = centre;
+                while(upper < n - 1 && y[upper] - background(upper) > 0.5*height){
+                    ++upper;
+                }
+                // within the width of the ends, as valid
+                const double sigma = std::min(std::max(1.0, upper - lower - 1.0)/FWHMPerSigma, 0.25*(n - 1));
+                p[nb] = sigma;
+                p[nb + 1] = height;
+                p[nb + 2] = std::min(std::max(region.first + centre + 0.0, region.first + sigma), region.last - 1 - sigma);
+                return p;
+            }
+
+            // the fit with one more peak, of the shared width and the height
+            // lowering the chi squared of the model in the workspace the most
+            // (the weighted residuals correlated with the peak at each point)
+            Vector addPeak(const Vector& p, const Workspace& workspace, const FitRegion& region) const
+            {
+                const int n = static_cast<int>(workspace.y.size());
+                const double sigma = p[nbackground()];
+                const Vector weighted = workspace.roots.cwiseProduct(workspace.roots).cwiseProduct(workspace.y - workspace.f);
+                const Vector weights = workspace.roots.cwiseProduct(workspace.roots);
+                const int edge = static_cast<int>(std::ceil(sigma));
+
+                // the peak to 5 widths either side
+                const int reach = std::min(n - 1, static_cast<int>(std::ceil(5.0*sigma)));
+                Vector kernel(reach + 1);
+                for(int d=0; d<=reach; ++d){
+                    kernel[d] = std::exp(-0.5*d*d/(sigma*sigma));
+                }
+
+                int centre = n/2;
+                double height = 1.0;
+                double best = -1.0;
+                for(int c=edge; c<n-edge; ++c){
+                    double correlation = 0.0;
+                    double norm = 0.0;
+                    for(int i=std::max(0, c - reach); i<=std::min(n - 1, c + reach); ++i){
+                        const double gauss = kernel[std::abs(i - c)];
+                        correlation += weighted[i]*gauss;
+                        norm += weights[i]*gauss*gauss;
+                    }
+                    // the drop in the chi squared with the best height
+                    const double drop = correlation > 0.0 ? correlation*correlation/norm : 0.0;
+                    if(drop > best){
+                        best = drop;
+                        centre = c;
+                        height = std::max(1.0, correlation/norm);
+                    }
+                }
+
+                Vector next(p.size() + 2);
+                next.head(p.size()) = p;
+                next[p.size()] = height;
+                next[p.size() + 1] = region.first + centre;
+                return next;
+            }
+
+            // the Poisson deviance, -2 ln(likelihood ratio) of the model
+            static double deviance(const Vector& y, const Vector& f)
+            {
+                double sum = 0.0;
+                for(int i=0; i<y.size(); ++i){
+                    const double mean = std::max(f[i], 1e-9);
+                    sum += 2.0*(mean - y[i] + (y[i] > 0.0 ? y[i]*std::log(y[i]/mean) : 0.0));
+                }
+                return sum;
+            }
+
+            // the fit with the highest peak split into two narrower peaks
+            // either side of it
+            Vector splitPeak(const Vector& p) const
+            {
+                const int nb = nbackground();
+                int highest = nb + 1;
+                for(int j=nb+3; j<p.size(); j+=2){
+                    if(p[j] > p[highest]){
+                        highest = j;
+                    }
+                }
+                const double sigma = p[nb];
+                Vector next(p.size() + 2);
+                next.head(p.size()) = p;
+                next[nb] = 0.8*sigma;
+                next[highest] = 0.6*p[highest];
+                next[highest + 1] = p[highest + 1] - 0.5*sigma;
+                next[p.size()] = 0.6*p[highest];
+                next[p.size() + 1] = p[highest + 1] + 0.5*sigma;
+                return next;
+            }
+
+            bool valid(const Vector& p, const FitRegion& region) const
+            {
+                const int nb = nbackground();
+                const double sigma = p[nb];
+                if(!(sigma > 0.0 && sigma <= region.last - region.first)){
+                    return false;
+                }
+                for(int j=nb+1; j<p.size(); j+=2){
+                    const double height = p[j];
+                    const double centroid = p[j+1];
+                    if(!(height >= 0.0 && centroid >= region.first + sigma && centroid <= region.last - 1 - sigma)){
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            // the model at each point of the region and its Jacobian in the
+            // first p.size() columns, the rows weighted by the roots of the weights
+            void model(const Vector& p, const FitRegion& region, const Vector& roots, Vector& f, Matrix& jacobian) const
+            {
+                const int n = region.last - region.first;
+                const int nb = nbackground();
+                const int k = static_cast<int>(p.size());
+                const double middle = 0.5*(region.first + region.last - 1);
+                const double sigma = p[nb];
+                const double inverse = 1.0/(sigma*sigma);
+
+                for(int i=0; i<n; ++i){
+                    const double x = region.first + i;
+                    const double v = x - middle;
+                    const double root = roots[i];
+                    f[i] = p[0] + p[1]*v;
+                    jacobian(i, 0) = root;
+                    jacobian(i, 1) = root*v;
+                    if(nb == 3){
+                        f[i] += p[2]*v*v;
+                        jacobian(i, 2) = root*v*v;
+                    }
+
+                    double dsigma = 0.0;
+                    for(int j=nb+1; j<k; j+=2){
+                        const double height = p[j];
+                        const double u = x - p[j+1];
+                        const double gauss = std::exp(-0.5*u*u*inverse);
+                        const double dgaussdc = gauss*u*inverse;
+                        f[i] += height*gauss;
+                        jacobian(i, j) = root*gauss;
+                        jacobian(i, j+1) = root*height*dgaussdc;
+                        dsigma += height*dgaussdc*u/sigma;
+                    }
+                    jacobian(i, nb) = root*dsigma;
+                }
+            }
+
+            // Levenberg-Marquardt from p, as GaussianPeakFitter, leaving the
+            // model and Jacobian of the solution in the workspace
+            Solution fitPeaks(const Vector& p, const FitRegion& region, Workspace& workspace) const
+            {
+                const int k = static_cast<int>(p.size());
+                Solution result;
+                result.parameters = p;
+                result.iterations = 0;
+                result.converged = false;
+                result.stalled = false;
+
+                Vector beta(k);
+                Vector step(k);
+                Vector trial(k);
+                model(result.parameters, region, workspace.roots, workspace.f, workspace.jacobian);
+                workspace.residual = workspace.roots.cwiseProduct(workspace.y - workspace.f);
+                result.chi2 = workspace.residual.squaredNorm();
+
+                double lambda = 1e-3;
+                while(result.iterations < _maxIterations && !result.converged && !result.stalled){
+                    ++result.iterations;
+                    const auto jacobian = workspace.jacobian.leftCols(k);
+                    auto alpha = workspace.alpha.topLeftCorner(k, k);
+                    auto damped = workspace.damped.topLeftCorner(k, k);
+                    alpha.noalias() = jacobian.transpose()*jacobian;
+                    beta.noalias() = jacobian.transpose()*workspace.residual;
+
+                    // damp along the diagonal until the chi squared drops
+                    const double floor = 1e-12*alpha.diagonal().maxCoeff();
+                    while(true){
+                        damped = alpha;
+                        damped.diagonal() += lambda*alpha.diagonal().cwiseMax(floor);
+                        workspace.ldlt.compute(damped);
+                        step = workspace.ldlt.solve(beta);
+                        trial = result.parameters + step;
+                        if(valid(trial, region)){
+                            model(trial, region, workspace.roots, workspace.trialf, workspace.trialjacobian);
+                            const double chi2 = (workspace.roots.cwiseProduct(workspace.y - workspace.trialf)).squaredNorm();
+                            if(chi2 < result.chi2){
+                                const double improvement = result.chi2 - chi2;
+                                result.converged = improvement <= _tolerance*chi2 ||
+                                    step.norm() <= _tolerance*(result.parameters.norm() + _tolerance);
+                                result.parameters = trial;
+                                result.chi2 = chi2;
+                                workspace.f.swap(workspace.trialf);
+                                workspace.jacobian.swap(workspace.trialjacobian);
+                                workspace.residual = workspace.roots.cwiseProduct(workspace.y - workspace.f);
+                                lambda = std::max(1e-12, 0.1*lambda);
+                                break;
+                            }
+                        }
+                        lambda *= 10.0;
+                        // no step lowers the chi squared, at the minimum unless
+                        // no step ever has (still the first guess)
+                        if(lambda > 1e16){
+                            result.stalled = result.iterations == 1;
+                            result.converged = !result.stalled;
+                            break;
+                        }
+                    }
+                }
+                return result;
+            }
+
+            Solution solve(const ConstNumericalView<T>& data, const FitRegion& region) const
+            {
+                const int n = region.last - region.first;
+                const int maxpeaks = maxPeaks(n);
+                Workspace workspace(n, nparameters(maxpeaks));
+                for(int i=0; i<n; ++i){
+                    workspace.y[i] = static_cast<double>(data[region.first + i]);
+                    workspace.roots[i] = 1.0/std::sqrt(std::max(1.0, workspace.y[i]));
+                }
+
+                std::vector<double> criteria(_maxComponents, std::numeric_limits<double>::infinity());
+                Solution best;
+                Matrix bestjacobian;
+                double lowest = std::numeric_limits<double>::infinity();
+                Vector p = guess(workspace.y, region);
+                for(int npeaks=1; npeaks<=maxpeaks; ++npeaks){
+                    Solution solution;
+                    if(npeaks == 1){
+                        solution = fitPeaks(p, region, workspace);
+                    }
+                    else{
+                        // from the residuals and from the highest peak split in two,
+                        // the model and Jacobian of the better left in the workspace.
+                        // A start that could not be moved into the region is 
+                        // still invalid after the fit, and is no candidate
+                        const Vector added = addPeak(p, workspace, region);
+                        Solution split = fitPeaks(splitPeak(p), region, workspace);
+                        Solution other = fitPeaks(added, region, workspace);
+                        const bool splitvalid = valid(split.parameters, region);
+                        const bool othervalid = valid(other.parameters, region);
+                        if(!splitvalid && !othervalid){
+                            break;
+                        }
+                        if(splitvalid && (!othervalid || split.chi2 <= other.chi2)){
+                            solution = std::move(split);
+                            model(solution.parameters, region, workspace.roots, workspace.f, workspace.jacobian);
+                        }
+                        else{
+                            solution = std::move(other);
+                        }
+                    }
+                    p = solution.parameters;
+                    const int k = static_cast<int>(p.size());
+                    criteria[npeaks-1] = deviance(workspace.y, workspace.f) + k*std::log(static_cast<double>(n));
+                    if(npeaks > 1 && !(criteria[npeaks-1] < lowest)){
+                        break;
+                    }
+                    lowest = criteria[npeaks-1];
+                    bestjacobian = workspace.jacobian.leftCols(k);
+                    best = std::move(solution);
+                }
+
+                const Matrix alpha = bestjacobian.transpose()*bestjacobian;
+                const Eigen::FullPivLU<Matrix> lu(alpha);
+                best.covariance = lu.isInvertible() ?
+                    Matrix(lu.inverse()) :
+                    Matrix::Constant(alpha.rows(), alpha.cols(), std::numeric_limits<double>::quiet_NaN());
+                best.criteria = criteria;
+                return best;
+            }
+
+            void append(const FitRegion& region, const Solution& result, int index, PeakFits<T>& fits) const
+            {
+                const Vector& p = result.parameters;
+                const Matrix& covariance = result.covariance;
+                const int nb = nbackground();
+                const int npeaks = (static_cast<int>(p.size()) - nb - 1)/2;
+                const int ndf = (region.last - region.first) - static_cast<int>(p.size());
+                const double sigma = p[nb];
+                const auto error = [&](int j){ return std::sqrt(std::max(0.0, covariance(j, j))); };
+
+                // in order of centroid
+                std::vector<int> order(npeaks);
+                std::iota(order.begin(), order.end(), 0);
+                std::sort(order.begin(), order.end(), [&](int a, int b){ return p[nb + 2 + 2*a] < p[nb + 2 + 2*b]; });
+
+                for(int k: order){
+                    const int j = nb + 1 + 2*k;
+                    const double height = p[j];
+
+                    // the area H*sqrt(2 pi)*s, with the error from H and the shared s
+                    const double variance = SqrtTwoPi*SqrtTwoPi*(sigma*sigma*covariance(j, j) + 
+                        2.0*height*sigma*covariance(j, nb) + height*height*covariance(nb, nb));
+
+                    fits.regions.push_back(index);
+                    fits.centroids.push_back(static_cast<T>(p[j+1]));
+                    fits.centroidErrors.push_back(static_cast<T>(error(j+1)));
+                    fits.heights.push_back(static_cast<T>(height));
+                    fits.heightErrors.push_back(static_cast<T>(error(j)));
+                    fits.fwhms.push_back(static_cast<T>(FWHMPerSigma*sigma));
+                    fits.fwhmErrors.push_back(static_cast<T>(FWHMPerSigma*error(nb)));
+                    fits.areas.push_back(static_cast<T>(SqrtTwoPi*height*sigma));
+                    fits.areaErrors.push_back(static_cast<T>(std::sqrt(std::max(0.0, variance))));
+                    fits.tailFractions.push_back(static_cast<T>(0));
+                    fits.tailSlopes.push_back(static_cast<T>(0));
+                    fits.reducedChi2s.push_back(static_cast<T>(result.chi2/ndf));
+                    fits.iterations.push_back(result.iterations);
+                    fits.converged.push_back(result.converged);
+                    fits.stalled.push_back(result.stalled);
+                }
+            }
+
+            const int _maxComponents;
+            const FitBackground _background;
+            const int _maxIterations;
+            const double _tolerance;
+            util::ThreadPool* _pool;
+    };
+
+    template<typename T>
+    constexpr double MultipletFitter<T>::FWHMPerSigma;
+
+    template<typename T>
+    constexpr double MultipletFitter<T>::SqrtTwoPi;
+
+PEAKINGDUCK_NAMESPACE_END
+PEAKINGDUCK_NAMESPACE_END
+
+#endif // CORE_FITTING_HPP
@@ -0,0 +1,203 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Defines a finite difference engine for higher order numerical gradients
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef CORE_GRADIENT_HPP
+#define CORE_GRADIENT_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+#include <vector>
+
+#include "common.hpp"
+#include "core/numerical.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(core)
+
+    /*!
+       @brief Computes the n-th order numerical gradient in a single pass.
+
+        NumericalFunctions::gradient(order) applies the first order gradient
+        recursively, with a full pass and a new array for each order. Since the
+        gradient is linear, applying it k times is the same as applying a single
+        combined stencil. This engine precomputes that stencil once for a given
+        order:
+            - an interior stencil of width 2k+1 (applied to all but the first and last k entries)
+            - k rows of coefficients for each end, which fold in the end point
+              handling of each order (first point grad = array[1]-array[0], etc..)
+
+        The coefficients are found by applying the recursive gradient to unit
+        vectors of a small probe array, so the results are the same as
+        NumericalFunctions::gradient, to within floating point rounding.
+
+        Arrays with less than 2k entries (where both ends interact) fall back to
+        the recursive gradient.
+
+        The engine does not change once constructed, so can be shared between threads.
+    */
+    template<typename T=DefaultType>
+    class GradientEngine
+    {
+        static_assert(std::is_floating_point<T>::value, "Gradient coefficients need a floating point type.");
+
+        public:
+            using value_type = T;
+
+            explicit GradientEngine(int order=1) : _order(order)
+            {
+                assert(order >= 0 && "Gradient order must be non-negative.");
+                computeCoefficients();
+            }
+
+            int order() const
+            {
+                return _order;
+            }
+
+            /*!
+                @brief Compute the gradient, writing into the given output.
+                The output is resized only if it is not the same size as the data.
+            */
+            void apply(const ConstNumericalView<T>& data, NumericalData<T>& output) const
+            {
+                const int size = data.size();
+                assert(size >= 2 && "Cannot compute gradient with less than 2 points.");
+                if(output.size() != size){
+                    output = NumericalData<T>(size);
+                }
+
+                if(_order == 0){
+                    std::copy(data.begin(), data.end(), output.begin());
+                    return;
+                }
+
+                // both ends interact - do it the slow way
+                if(size < 2*_order){
+                    const NumericalData<T> gradient = data.gradient(_order);
+                    std::copy(gradient.begin(), gradient.end(), output.begin());
+                    return;
+                }
+
+                const T* values = data.data();
+                const int stride = data.stride();
+                T* result = output.data();
+                const int width = 2*_order;
+
+                // end points
+                for(int i=0; i<_order; ++i){
+                    T lower = 0;
+                    T upper = 0;
+                    for(int j=0; j<width; ++j){
+                        lower += _lower(i, j)*values[j*stride];
+                        upper += _upper(i, j)*values[(size - width + j)*stride];
+                    }
+                    result[i] = lower;
+                    result[size - _order + i] = upper;
+                }
+
+                // interior
+                Eigen::Map<Array1D<T>> interior(result + _order, size - width);
+                if(stride == 1){
+                    applyInterior(Eigen::Map<const Array1D<T>>(values, size), interior);
+                }
+                else{
+                    applyInterior(Eigen::Map<const Array1D<T>, Eigen::Unaligned, Eigen::InnerStride<>>(values, size, Eigen::InnerStride<>(stride)), interior);
+                }
+            }
+
+            /*!
+                @brief Compute the gradient, returning a new array.
+            */
+            NumericalData<T> apply(const ConstNumericalView<T>& data) const
+            {
+                NumericalData<T> output(data.size());
+                apply(data, output);
+                return output;
+            }
+
+        private:
+            using Coefficients = Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>;
+
+            // small enough to stay in cache whilst all the taps are added
+            static constexpr int BlockSize = 512;
+
+            // applies only the non-zero coefficients, a block at a time so
+            // that each tap is a vectorized pass over data already in cache
+            template<class Values, class Output>
+            void applyInterior(const Values& values, Output& interior) const
+            {
+                const int ntaps = static_cast<int>(_offsets.size());
+                const int ninterior = interior.size();
+                for(int start=0; start<ninterior; start+=BlockSize){
+                    const int n = std::min(static_cast<int>(BlockSize), ninterior - start);
+                    auto block = interior.segment(start, n);
+                    block = _interior[0]*values.segment(start + _order + _offsets[0], n);
+                    for(int t=1; t<ntaps; ++t){
+                        block += _interior[t]*values.segment(start + _order + _offsets[t], n);
+                    }
+                }
+            }
+
+            // apply the recursive gradient to each unit vector of a probe
+            // long enough for the ends not to interact
+            void computeCoefficients()
+            {
+                if(_order == 0){
+                    return;
+                }
+
+                const int width = 2*_order;
+                const int probesize = 2*width + 2;
+                const int centre = probesize/2;
+
+                _lower = Coefficients::Zero(_order, width);
+                _upper = Coefficients::Zero(_order, width);
+                Array1D<double> interior = Array1D<double>::Zero(width + 1);
+
+                for(int j=0; j<probesize; ++j){
+                    NumericalData<double> unit = NumericalData<double>::Zero(probesize);
+                    unit[j] = 1.0;
+                    const NumericalData<double> column = unit.gradient(_order);
+
+                    for(int i=0; i<_order; ++i){
+                        if(j < width){
+                            _lower(i, j) = static_cast<T>(column[i]);
+                        }
+                        if(j >= probesize - width){
+                            _upper(i, j - probesize + width) = static_cast<T>(column[probesize - _order + i]);
+                        }
+                    }
+                    if(j >= centre - _order && j <= centre + _order){
+                        interior[j - centre + _order] = column[centre];
+                    }
+                }
+
+                for(int j=0; j<=width; ++j){
+                    if(interior[j] != 0.0){
+                        _offsets.push_back(j - _order);
+                        _interior.push_back(static_cast<T>(interior[j]));
+                    }
+                }
+            }
+
+            int _order;
+            Coefficients _lower;
+            Coefficients _upper;
+            std::vector<int> _offsets;
+            std::vector<T> _interior;
+    };
+
+PEAKINGDUCK_NAMESPACE_END
+PEAKINGDUCK_NAMESPACE_END
+
+#endif // CORE_GRADIENT_HPP
@@ -13,7 +13,10 @@
 #ifndef CORE_NUMERICAL_HPP
 #define CORE_NUMERICAL_HPP
 
+#include <algorithm>
 #include <cmath>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <Eigen/Core>
@@ -23,6 +26,7 @@
 #include "common.hpp"
 #include "core/numericalfunctions.hpp"
 #include "core/numericalmacros.h"
+#include "core/expression.hpp"
 
 PEAKINGDUCK_NAMESPACE_START(peakingduck)
 PEAKINGDUCK_NAMESPACE_START(core)
@@ -36,7 +40,29 @@ PEAKINGDUCK_NAMESPACE_START(core)
     using Array1Df = Array1D<float>;
     using Array1Dd = Array1D<double>;
 
+    // column major, i.e. each column is contiguous
+    template<typename Scalar>
+    using Array2D = Eigen::Array<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+
     using DefaultType = double;
+
+    // forward declare the non-owning view (defined below NumericalData)
+    template<typename T>
+    struct NumericalView;
+
+    // a read only view
+    template<typename T=DefaultType>
+    using ConstNumericalView = NumericalView<const T>;
+
+    // any operations on views that do not mutate return owning arrays
+    template<typename T, int Size>
+    struct NumericalData;
+
+    template<typename T>
+    struct NumericalFunctionsTraits<NumericalView<T>>
+    {
+        using PlainType = NumericalData<typename std::remove_const<T>::type, ArrayTypeDynamic>;
+    };
   
     /*!
        @brief Represents a 1-dimensional data structure (basically a 1D Eigen array)
@@ -65,6 +91,9 @@ PEAKINGDUCK_NAMESPACE_START(core)
     struct NumericalData : private Array1D<T, Size>, 
                            public NumericalFunctions<NumericalData<T, Size>>
     {
+            // views need access to the underlying Eigen array
+            template<typename> friend struct NumericalView;
+
             using value_type = T;
 
             using BaseEigenArray = Array1D<value_type, Size>;
@@ -91,6 +120,18 @@ PEAKINGDUCK_NAMESPACE_START(core)
                 from_vector(other);
             }
 
+            // This constructor materialises (copies) a view into a new array
+            template<typename ViewType>
+            NumericalData(const NumericalView<ViewType>& view)
+                : BaseEigenArray(static_cast<const typename NumericalView<ViewType>::BaseEigenMap&>(view))
+            { }
+
+            // This constructor evaluates a lazy expression, i.e. (x + 1.0).sqrt(), into a new array
+            template<class Expr>
+            NumericalData(const NumericalExpression<Expr>& expression)
+                : BaseEigenArray(toEigen(expression))
+            { }
+
             // This method allows you to assign Eigen expressions to Derived type
             template<typename OtherDerived>
             NumericalData& operator=(const Eigen::ArrayBase <OtherDerived>& other)
@@ -120,6 +161,28 @@ PEAKINGDUCK_NAMESPACE_START(core)
                 return *this;
             }
 
+            // This method materialises (copies) a view into this array
+            template<typename ViewType>
+            NumericalData& operator=(const NumericalView<ViewType>& view)
+            {
+                this->BaseEigenArray::operator=(static_cast<const typename NumericalView<ViewType>::BaseEigenMap&>(view));
+                return *this;
+            }
+
+            // This method evaluates a lazy expression into this array, in a single loop
+            template<class Expr>
+            NumericalData& operator=(const NumericalExpression<Expr>& expression)
+            {
+                this->BaseEigenArray::operator=(toEigen(expression));
+                return *this;
+            }
+
+            // the underlying Eigen array, used to build expressions
+            friend inline const BaseEigenArray& toEigen(const NumericalData& data)
+            {
+                return data;
+            }
+
             // clang does not like this, but gcc does,
             // not sure why?
             // maybe private inheritance was not a good 
@@ -143,17 +206,19 @@ PEAKINGDUCK_NAMESPACE_START(core)
             using BaseEigenArray::operator<;
             using BaseEigenArray::operator=;
             using BaseEigenArray::operator==;
-            using BaseEigenArray::operator*;
             using BaseEigenArray::operator*=;
-            using BaseEigenArray::operator+;
             using BaseEigenArray::operator+=;
-            using BaseEigenArray::operator-;
             using BaseEigenArray::operator-=;
-            using BaseEigenArray::operator/;
             using BaseEigenArray::operator/=;
             using BaseEigenArray::operator new;
             using BaseEigenArray::operator delete;
 
+            // arithmetic is lazy, see core/expression.hpp
+            inline auto operator-() const
+            {
+                return makeNumericalExpression(-toEigen(*this));
+            }
+
             PEAKINGDUCK_NUMERICAL_OPERATOR_IMP_MACRO(NumericalData,BaseEigenArray,+)
             PEAKINGDUCK_NUMERICAL_OPERATOR_IMP_MACRO(NumericalData,BaseEigenArray,-)
             PEAKINGDUCK_NUMERICAL_OPERATOR_IMP_MACRO(NumericalData,BaseEigenArray,*)
@@ -175,13 +240,22 @@ PEAKINGDUCK_NAMESPACE_START(core)
                 return std::vector<value_type>(this->data(), this->data() + this->size());
             }
 
+            // a copy with a different value type, i.e. to move between
+            // single and double precision
+            template<typename NewType>
+            NumericalData<NewType, Size> cast() const{
+                const BaseEigenArray& values = *this;
+                return NumericalData<NewType, Size>(values.template cast<NewType>());
+            }
+
             // some useful predefined methods 
-            // map
-            using BaseEigenArray::exp;
-            using BaseEigenArray::log;
-            using BaseEigenArray::sqrt;
-            using BaseEigenArray::square;
-            using BaseEigenArray::pow;
+            // map (lazy, see NumericalFunctions::exp)
+            using NumericalFunctions<NumericalData>::exp;
+            using NumericalFunctions<NumericalData>::log;
+            using NumericalFunctions<NumericalData>::sqrt;
+            using NumericalFunctions<NumericalData>::square;
+            using NumericalFunctions<NumericalData>::abs;
+            using NumericalFunctions<NumericalData>::pow;
             using BaseEigenArray::replicate;
             using BaseEigenArray::reverse;
             using BaseEigenArray::reverseInPlace;
@@ -200,28 +274,42 @@ PEAKINGDUCK_NAMESPACE_START(core)
             // arr.slice(1, 3) == arr[1:3] == [4, 5]
             // arr.slice(1, -2) == arr[1:-2] == [4, 5, 2, 10, 2, 2]
             //
+            // The slice is a read only view onto this array (no copy), 
+            // assign it to a NumericalData to get a copy.
+            //
             // can we add templates when sindex and eindex are known
             // at compile time?
-            NumericalData<value_type> slice(int sindex, int eindex) const
+            NumericalView<const value_type> slice(int sindex, int eindex) const
             {
-                if(eindex >= 0){
-                    return this->segment(sindex, eindex - sindex);
-                }
-                return this->segment(sindex, this->size() + eindex - sindex);
+                const int endindex = (eindex >= 0) ? eindex : this->size() + eindex;
+                return NumericalView<const value_type>(this->data() + sindex, endindex - sindex);
             }
 
             // uses the () operator with two indicies to do the slice
             // no way (overload comma operator?) to do this with square []
             // braces
-            NumericalData<value_type> operator()(int sindex, int eindex) const
+            NumericalView<const value_type> operator()(int sindex, int eindex) const
             {
                 return slice(sindex, eindex);
             }
 
+            // the same as slice but gives a writable view, 
+            // changes to the view change this array
+            NumericalView<value_type> view(int sindex, int eindex)
+            {
+                const int endindex = (eindex >= 0) ? eindex : this->size() + eindex;
+                return NumericalView<value_type>(this->data() + sindex, endindex - sindex);
+            }
+
             // TODO: These really belong in the numerical functions
             // interface, but I am getting compilation problems due to template 
             // parameter of derived. To not waste anymore time, we leave it here for now.
 
+            // The masking and thresholding kernels below are single coefficient-wise
+            // Eigen expressions (select/min/max) with no std::function or temporaries, so 
+            // they are inlined and vectorized, and the InPlace versions write straight 
+            // back into this array in one pass.
+
             /*!
                 @brief A simple function for filtering values above a certain
                 threshold (>=). This is useful to remove entries that are negative 
@@ -231,10 +319,8 @@ PEAKINGDUCK_NAMESPACE_START(core)
             */
             NumericalData ramp(const value_type& threshold) const
             {
-                std::function<value_type(value_type)> imp = [&](const value_type& x){
-                    return (x >= threshold) ? x : 0;
-                };
-                return this->unaryExpr(imp);
+                NumericalData result(*this);
+                return result.rampInPlace(threshold);
             }
 
             /*!
@@ -246,9 +332,272 @@ PEAKINGDUCK_NAMESPACE_START(core)
             */
             NumericalData& rampInPlace(const value_type& threshold)
             {
-                this->BaseEigenArray::operator=(this->ramp(threshold));
+                BaseEigenArray& values = *this;
+                values = (values >= threshold).select(values, value_type(0));
+                return *this;
+            }
+
+            /*!
+                @brief Limit the values to the range [lower, upper].
+
+                Returns a new array
+            */
+            NumericalData clip(const value_type& lower, const value_type& upper) const
+            {
+                NumericalData result(*this);
+                return result.clipInPlace(lower, upper);
+            }
+
+            /*!
+                @brief Limit the values to the range [lower, upper].
+
+                Mutates underlying array
+            */
+            NumericalData& clipInPlace(const value_type& lower, const value_type& upper)
+            {
+                assert(lower <= upper && "Lower clip value must not be above the upper.");
+                BaseEigenArray& values = *this;
+                values = values.max(lower).min(upper);
+                return *this;
+            }
+
+            /*!
+                @brief Set all values at or below a threshold (<=) to zero, only
+                values strictly above are kept. 
+                Unlike ramp, zeroBelow(0) removes negative and zero entries.
+
+                Returns a new array
+            */
+            NumericalData zeroBelow(const value_type& threshold) const
+            {
+                NumericalData result(*this);
+                return result.zeroBelowInPlace(threshold);
+            }
+
+            /*!
+                @brief Set all values at or below a threshold (<=) to zero, only
+                values strictly above are kept. 
+
+                Mutates underlying array
+            */
+            NumericalData& zeroBelowInPlace(const value_type& threshold)
+            {
+                BaseEigenArray& values = *this;
+                values = (values > threshold).select(values, value_type(0));
+                return *this;
+            }
+
+            /*!
+                @brief Keep only the values where the mask is non-zero, all other
+                values are set to zero. The mask must be the same size.
+
+                Returns a new array
+            */
+            NumericalData mask(const NumericalData& maskvalues) const
+            {
+                NumericalData result(*this);
+                return result.maskInPlace(maskvalues);
+            }
+
+            /*!
+                @brief Keep only the values where the mask is non-zero, all other
+                values are set to zero. The mask must be the same size.
+
+                Mutates underlying array
+            */
+            NumericalData& maskInPlace(const NumericalData& maskvalues)
+            {
+                assert(maskvalues.size() == this->size() && "Mask must be the same size as the data.");
+                BaseEigenArray& values = *this;
+                const BaseEigenArray& condition = maskvalues;
+                values = (condition != value_type(0)).select(values, value_type(0));
+                return *this;
+            }
+    };
+
+    /*!
+       @brief Represents a non-owning view onto 1-dimensional data 
+        (basically a 1D Eigen map with an inner stride).
+
+        Slicing a NumericalData (or another view) gives a view, 
+        no memory is allocated or copied. This means the viewed 
+        data must outlive the view.
+
+        Any numerical function that does not mutate (i.e. LLS, snip) 
+        returns a new NumericalData. InPlace functions write through the 
+        view into the viewed data (only for non-const views).
+        To get a copy assign the view to a NumericalData or call materialise.
+
+        Use NumericalView<const T> (ConstNumericalView<T>) for read only views.
+    */
+    template<typename T>
+    struct NumericalView : private Eigen::Map<typename std::conditional<std::is_const<T>::value, 
+                                                                        const Array1D<typename std::remove_const<T>::type>, 
+                                                                        Array1D<typename std::remove_const<T>::type>>::type, 
+                                              Eigen::Unaligned, Eigen::InnerStride<>>,
+                           public NumericalFunctions<NumericalView<T>>
+    {
+            // arrays need access to the underlying Eigen map to copy
+            template<typename, int> friend struct NumericalData;
+            template<typename> friend struct NumericalView;
+
+            using value_type = typename std::remove_const<T>::type;
+            using PlainType = NumericalData<value_type, ArrayTypeDynamic>;
+
+            using StrideType = Eigen::InnerStride<>;
+            using BaseEigenMap = Eigen::Map<typename std::conditional<std::is_const<T>::value, 
+                                                                      const Array1D<value_type>, 
+                                                                      Array1D<value_type>>::type, 
+                                            Eigen::Unaligned, StrideType>;
+
+            // view from raw memory, stride is the step between entries
+            NumericalView(T* data, int size, int stride=1)
+                : BaseEigenMap(data, size, StrideType(stride))
+            { }
+
+            // view over the whole of an array
+            template<int Size>
+            NumericalView(NumericalData<value_type, Size>& data)
+                : NumericalView(data.data(), data.size())
+            { }
+
+            // read only views can also be taken from const arrays
+            template<int Size, typename ViewType=T, 
+                     typename=typename std::enable_if<std::is_const<ViewType>::value>::type>
+            NumericalView(const NumericalData<value_type, Size>& data)
+                : NumericalView(data.data(), data.size())
+            { }
+
+            NumericalView(const NumericalView& other) = default;
+
+            // a view can always be made read only (but not the other way)
+            template<typename OtherT, 
+                     typename=typename std::enable_if<std::is_same<const OtherT, T>::value && !std::is_const<OtherT>::value>::type>
+            NumericalView(const NumericalView<OtherT>& other)
+                : BaseEigenMap(other.data(), other.size(), StrideType(other.stride()))
+            { }
+
+            // assignment writes into the viewed data (like Eigen::Map)
+            // it does not rebind the view
+            NumericalView& operator=(const NumericalView& other)
+            {
+                this->BaseEigenMap::operator=(static_cast<const BaseEigenMap&>(other));
+                return *this;
+            }
+
+            template<typename OtherT>
+            NumericalView& operator=(const NumericalView<OtherT>& other)
+            {
+                this->BaseEigenMap::operator=(static_cast<const typename NumericalView<OtherT>::BaseEigenMap&>(other));
+                return *this;
+            }
+
+            template<int Size>
+            NumericalView& operator=(const NumericalData<value_type, Size>& other)
+            {
+                this->BaseEigenMap::operator=(static_cast<const typename NumericalData<value_type, Size>::BaseEigenArray&>(other));
+                return *this;
+            }
+
+            template<typename OtherDerived>
+            NumericalView& operator=(const Eigen::ArrayBase<OtherDerived>& other)
+            {
+                this->BaseEigenMap::operator=(other);
                 return *this;
             }
+
+            template<class Expr>
+            NumericalView& operator=(const NumericalExpression<Expr>& expression)
+            {
+                this->BaseEigenMap::operator=(toEigen(expression));
+                return *this;
+            }
+
+            // the underlying Eigen map, used to build expressions
+            friend inline const BaseEigenMap& toEigen(const NumericalView& view)
+            {
+                return view;
+            }
+
+            // copy the viewed data into a new array
+            inline PlainType materialise() const
+            {
+                return PlainType(*this);
+            }
+
+            // the step between consecutive entries in memory
+            inline int stride() const
+            {
+                return static_cast<int>(this->innerStride());
+            }
+
+            using BaseEigenMap::eval;
+
+            // operations such as (x > 0).all()
+            using BaseEigenMap::all;
+            using BaseEigenMap::any;
+            using BaseEigenMap::count;
+
+            // essential operations on arrays
+            using BaseEigenMap::operator>;
+            using BaseEigenMap::operator<;
+            using BaseEigenMap::operator==;
+
+            // arithmetic is lazy, see core/expression.hpp
+            inline auto operator-() const
+            {
+                return makeNumericalExpression(-toEigen(*this));
+            }
+
+            PEAKINGDUCK_NUMERICAL_EXPRESSION_OPERATOR_IMP_MACRO(NumericalView,+)
+            PEAKINGDUCK_NUMERICAL_EXPRESSION_OPERATOR_IMP_MACRO(NumericalView,-)
+            PEAKINGDUCK_NUMERICAL_EXPRESSION_OPERATOR_IMP_MACRO(NumericalView,*)
+            PEAKINGDUCK_NUMERICAL_EXPRESSION_OPERATOR_IMP_MACRO(NumericalView,/)
+
+            // entry access operations
+            using BaseEigenMap::operator[];
+            using BaseEigenMap::data;
+            using BaseEigenMap::size;
+            using BaseEigenMap::begin;
+            using BaseEigenMap::end;
+            using BaseEigenMap::segment;
+
+            inline std::vector<value_type> to_vector() const{
+                return std::vector<value_type>(this->begin(), this->end());
+            }
+
+            // some useful predefined methods 
+            // map (lazy, see NumericalFunctions::exp)
+            using NumericalFunctions<NumericalView>::exp;
+            using NumericalFunctions<NumericalView>::log;
+            using NumericalFunctions<NumericalView>::sqrt;
+            using NumericalFunctions<NumericalView>::square;
+            using NumericalFunctions<NumericalView>::abs;
+            using NumericalFunctions<NumericalView>::pow;
+            using BaseEigenMap::reverse;
+
+            // reduce
+            using BaseEigenMap::mean;
+            using BaseEigenMap::sum;
+            using BaseEigenMap::maxCoeff;
+            using BaseEigenMap::minCoeff;
+
+            // custom unary operations
+            using BaseEigenMap::unaryExpr;
+
+            // slicing a view gives another view, see NumericalData::slice
+            // the constness of the view (not the viewed data) does not 
+            // matter, much like a pointer
+            NumericalView slice(int sindex, int eindex) const
+            {
+                const int endindex = (eindex >= 0) ? eindex : this->size() + eindex;
+                return NumericalView(const_cast<T*>(this->data()) + sindex*stride(), endindex - sindex, stride());
+            }
+
+            NumericalView operator()(int sindex, int eindex) const
+            {
+                return slice(sindex, eindex);
+            }
     };
 
     /*!
@@ -261,6 +610,37 @@ PEAKINGDUCK_NAMESPACE_START(core)
         return combined;
     }
 
+    /*!
+        @brief Combine (concatenate) arrays and/or views into a new array.
+    */
+    template<typename One, typename Two, 
+             typename T=typename One::value_type, int Size=ArrayTypeDynamic>
+    NumericalData<T, Size> combine(const One& one, const Two& two){
+        NumericalData<T, Size> combined(one.size() + two.size());
+        std::copy(two.begin(), two.end(), std::copy(one.begin(), one.end(), combined.begin()));
+        return combined;
+    }
+
+    /*!
+       @brief The same as window, but does not copy the values, 
+        instead it returns the views either side of the index
+        (lower, upper), both excluding the index itself.
+
+        See: core::window
+    */
+    template<typename T=DefaultType, int InputSize=ArrayTypeDynamic>
+    std::pair<ConstNumericalView<T>, ConstNumericalView<T>> windowViews(const NumericalData<T, InputSize>& data, 
+        int centerindex, int nouter=5, int ninner=0){
+
+        // no funny business
+        assert(ninner <= nouter);
+        assert((centerindex >= 0) && (centerindex < static_cast<int>(data.size())));
+
+        const int datasize = static_cast<int>(data.size());
+        return std::make_pair(data.slice(std::max(0, centerindex-nouter), std::max(0, centerindex-ninner)),
+                              data.slice(std::min(datasize, centerindex+1+ninner), std::min(datasize, centerindex+1+nouter)));
+    }
+
     /*!
        @brief Given a list of values take nouter points either side of 
         the index given and ignore ninner points.
@@ -318,19 +698,17 @@ PEAKINGDUCK_NAMESPACE_START(core)
         assert((centerindex >= 0) && (centerindex < static_cast<int>(data.size())));
         assert(data.size() > 0);
 
-        const NumericalData<T, ArrayTypeDynamic> slicelower = data.slice(std::max(0, centerindex-nouter), 
-                                                                         std::max(0, centerindex-ninner));
-        const NumericalData<T, ArrayTypeDynamic> sliceupper = data.slice(std::min(static_cast<int>(data.size()), centerindex+1+ninner), 
-                                                                         std::min(static_cast<int>(data.size()), centerindex+1+nouter));
+        const auto slices = windowViews(data, centerindex, nouter, ninner);
+        const ConstNumericalView<T>& slicelower = slices.first;
+        const ConstNumericalView<T>& sliceupper = slices.second;
 
         const size_t data_size = includeindex ? slicelower.size() + sliceupper.size() + 1 : slicelower.size() + sliceupper.size();
         NumericalData<T, WindowSize> combined(data_size);
+        auto it = std::copy(slicelower.begin(), slicelower.end(), combined.begin());
         if(includeindex){
-            combined << slicelower.eval(), data[centerindex], sliceupper.eval();
-        }
-        else{
-            combined << slicelower.eval(), sliceupper.eval();
+            *it++ = data[centerindex];
         }
+        std::copy(sliceupper.begin(), sliceupper.end(), it);
         return combined;
     }
 
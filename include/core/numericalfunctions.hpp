@@ -14,14 +14,39 @@
 #define CORE_NUMERICAL_FUNCTIONS_HPP
 
 #include <algorithm>
+#include <functional>
 #include <vector>
 
 #include "common.hpp"
 #include "crtp.hpp"
+#include "stencil.hpp"
+#include "statistics.hpp"
 
 PEAKINGDUCK_NAMESPACE_START(peakingduck)
 PEAKINGDUCK_NAMESPACE_START(core)
 
+    /*!
+       @brief Maps a type using NumericalFunctions onto the owning
+       array type that the non-mutating functions return.
+
+       By default this is the type itself (i.e. NumericalData), 
+       non-owning types (i.e. NumericalView) specialise this so that
+       they return a new owning array rather than another view.
+    */
+    template <class Derived>
+    struct NumericalFunctionsTraits
+    {
+        using PlainType = Derived;
+    };
+
+    // lazy expressions (see core/expression.hpp) returned from the 
+    // coefficient-wise functions
+    template<class Expr>
+    struct NumericalExpression;
+
+    template<class Expr>
+    inline NumericalExpression<Expr> makeNumericalExpression(const Expr& expr);
+
     /*!
        @brief To extend the NumericalData type with certain numerical 
        abilities, we add it to this using CRTP to keep it in the interface 
@@ -31,18 +56,69 @@ PEAKINGDUCK_NAMESPACE_START(core)
     struct NumericalFunctions : public crtp<Derived, NumericalFunctions>
     {
         // using typename Derived::value_type numerical_type;
+
+        // the owning type returned from all non-mutating functions
+        using PlainType = typename NumericalFunctionsTraits<Derived>::PlainType;
         
         // standard deviation - not in Eigen but is needed
         decltype(auto) stddev(int ddof=0) const{
             assert(this->underlying().size() > 1);
-            return std::sqrt((this->underlying() - this->underlying().mean()).square().sum()/(this->underlying().size()-ddof));
+            return statistics().stddev(ddof);
+        }
+
+        /*!
+            @brief The count, sum, mean, variance, min, max, argmin and argmax
+            in a single (numerically stable) pass, see core::Statistics.
+            Use this instead of separate calls to mean, stddev and maxCoeff.
+        */
+        auto statistics() const
+        {
+            return computeStatistics(toEigen(this->underlying()));
+        }
+
+        /*!
+            @brief Coefficient-wise maps, exp(value), log(value), etc..
+
+            These (and LLS, inverseLLS) return a lazy NumericalExpression, 
+            evaluated only when assigned to an array, so that chains
+            such as (x + 1.0).sqrt().log() are evaluated in a single loop.
+        */
+        auto exp() const
+        {
+            return makeNumericalExpression(toEigen(this->underlying()).exp());
+        }
+
+        auto log() const
+        {
+            return makeNumericalExpression(toEigen(this->underlying()).log());
+        }
+
+        auto sqrt() const
+        {
+            return makeNumericalExpression(toEigen(this->underlying()).sqrt());
+        }
+
+        auto square() const
+        {
+            return makeNumericalExpression(toEigen(this->underlying()).square());
+        }
+
+        auto abs() const
+        {
+            return makeNumericalExpression(toEigen(this->underlying()).abs());
+        }
+
+        template<typename Exponent>
+        auto pow(const Exponent& exponent) const
+        {
+            return makeNumericalExpression(toEigen(this->underlying()).pow(exponent));
         }
 
         /*!
             @brief log(log(sqrt(value + 1) + 1) + 1)
-            Returns a new array
+            Returns a lazy expression, assign it to get a new array
         */
-        Derived LLS() const
+        auto LLS() const
         {
             return (((this->underlying() + 1.0).sqrt() + 1.0).log() + 1.0).log();
         }
@@ -59,9 +135,9 @@ PEAKINGDUCK_NAMESPACE_START(core)
 
         /*!
             @brief exp(exp(sqrt(value + 1) + 1) + 1)
-            Returns a new array
+            Returns a lazy expression, assign it to get a new array
         */
-        Derived inverseLLS() const
+        auto inverseLLS() const
         {
             return ((((this->underlying().exp() - 1.0).exp()) - 1.0).square()) - 1.0;
         }
@@ -84,7 +160,7 @@ PEAKINGDUCK_NAMESPACE_START(core)
 
             Returns a new array
         */
-        Derived symmetricNeighbourOp(const std::function<void(int, int, const Derived&, Derived&)>& operation, int order=1) const
+        PlainType symmetricNeighbourOp(const std::function<void(int, int, const Derived&, PlainType&)>& operation, int order=1) const
         {            
             // perform algorithm between these two indices
             const int istart = order;
@@ -93,13 +169,40 @@ PEAKINGDUCK_NAMESPACE_START(core)
             // can we do this without copying twice, or even once?
             // since we cannot change in place for each entry in loop as this
             // changes results for other entries later.
-            Derived newvalues = this->underlying();
+            PlainType newvalues = this->underlying();
             for(int i=istart; i<iend; ++i){
                 operation(i, order, this->underlying(), newvalues);
             }            
             return newvalues;
         }
 
+        /*!
+            @brief For each element calculate a new value from the symmetric neigbour values
+            at a given order, using a compile time stencil (see core/stencil.hpp).
+            End points are not counted (stay as original).
+
+            Unlike the std::function version, the stencil is applied to the whole interior
+            at once so it is inlined and vectorized. For example:
+
+                data.template symmetricNeighbourOp<MidpointStencil>(2);
+
+            Returns a new array
+        */
+        template<class Stencil>
+        PlainType symmetricNeighbourOp(int order=1) const
+        {
+            const auto& values = this->underlying();
+            const int ninterior = values.size() - 2*order;
+
+            PlainType newvalues = values;
+            if(ninterior > 0){
+                newvalues.segment(order, ninterior) = Stencil::apply(values.segment(0, ninterior), 
+                                                                     values.segment(order, ninterior), 
+                                                                     values.segment(2*order, ninterior));
+            }
+            return newvalues;
+        }
+
         /*!
             @brief For each element calculate the numerical gradient value from the adjacent elements at a given 
             order. 
@@ -114,7 +217,7 @@ PEAKINGDUCK_NAMESPACE_START(core)
 
             Returns a new array
         */
-        Derived gradient(int order=1) const
+        PlainType gradient(int order=1) const
         {            
             const size_t datasize = this->underlying().size();
             assert(datasize >= 2 && "Cannot compute gradient with less than 2 points.");
@@ -122,13 +225,8 @@ PEAKINGDUCK_NAMESPACE_START(core)
             if(order == 0)
                 return this->underlying();
 
-            const size_t neighbourDiff = 1;
-            auto gradOp = [](int i, int , const Derived& values, Derived& newValues){
-                newValues[i] = (values[i+neighbourDiff] - values[i-neighbourDiff])/2.0;
-            };
-
             // this handles everything other than the end points which remain unchanged
-            Derived grad = this->underlying().symmetricNeighbourOp(gradOp, neighbourDiff);
+            PlainType grad = this->underlying().template symmetricNeighbourOp<GradientStencil>(1);
 
             // first and last points
             grad[0] = this->underlying()[1] - this->underlying()[0];
@@ -166,12 +264,9 @@ PEAKINGDUCK_NAMESPACE_START(core)
 
             Returns a new array
         */
-        Derived midpoint(int order=1) const
+        PlainType midpoint(int order=1) const
         {            
-            auto midpointOp = [](int i, int order, const Derived& values, Derived& newValues){
-                newValues[i] = (values[i-order] + values[i+order])/2.0;
-            };
-            return this->underlying().symmetricNeighbourOp(midpointOp, order);
+            return this->underlying().template symmetricNeighbourOp<MidpointStencil>(order);
         }        
 
         /*!
@@ -197,21 +292,16 @@ PEAKINGDUCK_NAMESPACE_START(core)
             Returns a new array
         */
         template<class Iterator>
-        Derived snip(Iterator first, Iterator last) const
+        PlainType snip(Iterator first, Iterator last) const
         { 
-            auto midpointMinOp = [](int i, int order, const Derived& values, Derived& newValues){
-                newValues[i] = (values[i-order] + values[i+order])/2.0;
-                newValues[i] = std::min(newValues[i], values[i]);
-            };
-
-            Derived snipped = this->underlying();
+            PlainType snipped = this->underlying();
 
             // first scale by LLS
             snipped.LLSInPlace();
 
             // iterations
             for(auto it=first; it!=last; ++it){
-                snipped = snipped.symmetricNeighbourOp(midpointMinOp, *it);
+                snipped = snipped.template symmetricNeighbourOp<MidpointMinStencil>(*it);
             }
 
             // lastly scale it back LLS
@@ -230,7 +320,7 @@ PEAKINGDUCK_NAMESPACE_START(core)
 
             Returns a new array
         */
-        Derived snip(int niterations) const
+        PlainType snip(int niterations) const
         { 
             std::vector<int> iterations(niterations);
             std::generate(iterations.begin(), iterations.end(), [n = 1] () mutable { return n++; });
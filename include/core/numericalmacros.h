@@ -14,23 +14,31 @@
 #ifndef CORE_NUMERICAL_MACROS_H
 #define CORE_NUMERICAL_MACROS_H
 
-#define PEAKINGDUCK_NUMERICAL_OPERATOR_IMP_MACRO(NUMERICAL_TYPE, BASE_NUMERICAL_TYPE, OP)                       \
-inline NUMERICAL_TYPE operator OP(const T& scalar) const                                                        \
-{                                                                                                               \
-    return this->BASE_NUMERICAL_TYPE::operator OP(scalar);                                                      \
-}                                                                                                               \
-friend inline NUMERICAL_TYPE operator OP (const T& scalar, const NUMERICAL_TYPE & rhs)                          \
-{                                                                                                               \
-    return scalar OP static_cast<const BASE_NUMERICAL_TYPE &>(rhs);                                             \
-}                                                                                                               \
-inline NUMERICAL_TYPE operator OP(const NUMERICAL_TYPE & rhs) const                                             \
-{                                                                                                               \
-    return static_cast<const BASE_NUMERICAL_TYPE &>(*this) OP static_cast<const BASE_NUMERICAL_TYPE &>(rhs);    \
-}                                                                                                                \
-inline const NUMERICAL_TYPE & operator OP ## =(const NUMERICAL_TYPE & rhs)                                      \
-{                                                                                                               \
-    this->BASE_NUMERICAL_TYPE::operator OP ## =(static_cast<const BASE_NUMERICAL_TYPE&>(rhs));                  \
-    return *this;                                                                                               \
-}     
+// lazy arithmetic, each operator returns a NumericalExpression (see core/expression.hpp)
+// which is only evaluated when assigned to an array 
+#define PEAKINGDUCK_NUMERICAL_EXPRESSION_OPERATOR_IMP_MACRO(NUMERICAL_TYPE, OP)                                     \
+inline auto operator OP(const value_type& scalar) const                                                             \
+{                                                                                                                   \
+    return makeNumericalExpression(toEigen(*this) OP scalar);                                                       \
+}                                                                                                                   \
+friend inline auto operator OP (const value_type& scalar, const NUMERICAL_TYPE & rhs)                               \
+{                                                                                                                   \
+    return makeNumericalExpression(scalar OP toEigen(rhs));                                                         \
+}                                                                                                                   \
+template<class Other, typename=typename std::enable_if<IsNumerical<Other>::value>::type>                            \
+inline auto operator OP(const Other& rhs) const                                                                     \
+{                                                                                                                   \
+    return makeNumericalExpression(toEigen(*this) OP toEigen(rhs));                                                 \
+}
+
+// as above, plus the compound assignment which evaluates straight into the array
+#define PEAKINGDUCK_NUMERICAL_OPERATOR_IMP_MACRO(NUMERICAL_TYPE, BASE_NUMERICAL_TYPE, OP)                           \
+PEAKINGDUCK_NUMERICAL_EXPRESSION_OPERATOR_IMP_MACRO(NUMERICAL_TYPE, OP)                                             \
+template<class Other, typename=typename std::enable_if<IsNumerical<Other>::value>::type>                            \
+inline NUMERICAL_TYPE & operator OP ## =(const Other& rhs)                                                          \
+{                                                                                                                   \
+    this->BASE_NUMERICAL_TYPE::operator OP ## =(toEigen(rhs));                                                      \
+    return *this;                                                                                                   \
+}
 
 #endif //CORE_NUMERICAL_MACROS_H
\ No newline at end of file
@@ -13,14 +13,23 @@
 #ifndef CORE_PEAKING_HPP
 #define CORE_PEAKING_HPP
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <utility>
 #include <vector>
 
+#include <Eigen/Core>
+
 #include "common.hpp"
+#include "exceptions.hpp"
 #include "core/numerical.hpp"
 #include "core/process.hpp"
 #include "core/smoothing.hpp"
+#include "util/threadpool.hpp"
 
 PEAKINGDUCK_NAMESPACE_START(peakingduck)
 PEAKINGDUCK_NAMESPACE_START(core)
@@ -38,59 +47,137 @@ PEAKINGDUCK_NAMESPACE_START(core)
 
         NumericalData<T, Size> 
         go(const NumericalData<T, Size>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalData<T, Size> 
+        go(const ConstNumericalView<T>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalBatch<T> 
+        go(const NumericalBatch<T>& batch) const override final
+        {
+            NumericalData<T> absThresholds = batch.maxCoeffs();
+            absThresholds *= _percentThreshold;
+            return batch.ramp(absThresholds);
+        };
+
+      private:
+        template<typename DataType>
+        NumericalData<T, Size> apply(const DataType& data) const
         {
             const T absThreshold = data.maxCoeff()*_percentThreshold;
-            NumericalData<T, Size> processed = data.ramp(absThreshold);
+            NumericalData<T, Size> processed = data;
+            processed.rampInPlace(absThreshold);
             // ToDo: check clusters and take the max value within each cluster
             return processed;
-        };
+        }
 
-      private:
         const T _percentThreshold;
     };  
 
     /*!
        @brief Simple threshold local/chunked peak filter
+
+        The data is split into chunks of chunkSize points, [0, chunkSize),
+        [chunkSize, 2*chunkSize), ..., the last may be shorter. Each point
+        is in exactly one chunk and is kept if it is at least 
+        percentThreshold of the maximum of its chunk, otherwise it is zero.
+
+        Works on views of each chunk (no copies) and runs groups of chunks
+        concurrently on the thread pool, each writing only its own part of
+        the output, so the result does not depend on the number of threads.
     */
     template<typename T=DefaultType, int Size=ArrayTypeDynamic>
     struct ChunkedThresholdPeakFilter : public IProcess<T, Size>
     {
 
-        explicit ChunkedThresholdPeakFilter(T percentThreshold, size_t chunkSize=10) 
-        : _percentThreshold(percentThreshold), _chunkSize(chunkSize)
+        explicit ChunkedThresholdPeakFilter(T percentThreshold, size_t chunkSize=10, 
+                                            util::ThreadPool& pool=util::ThreadPool::shared()) 
+        : _percentThreshold(percentThreshold), _chunkSize(static_cast<int>(chunkSize)), _pool(&pool)
         {
+            if(chunkSize == 0){
+                throw PeakingDuckException("Chunk size must be positive.");
+            }
         }
 
         NumericalData<T, Size> 
         go(const NumericalData<T, Size>& data) const override final
         {
-            // copy input data for output processing
-            NumericalData<T, Size> processed = NumericalData<T, Size>::Zero(data.size());
-
-            // get indicies for chunking
-            auto chunkindices = util::rrange<size_t>(0, data.size(), _chunkSize);
+            return apply(data);
+        };
 
-            // use the global threshold peak filter on each chunk
-            const GlobalThresholdPeakFilter<T> gpf(_percentThreshold);
+        NumericalData<T, Size> 
+        go(const ConstNumericalView<T>& data) const override final
+        {
+            return apply(data);
+        };
 
-            // iterate over chunks and apply peak finding
-            // what if list is empty?            
-            for(auto it=chunkindices.begin(); it!=std::prev(chunkindices.end()); ++it){
-                // slice it and apply the threshold
-                auto newdata = gpf.go(data(*it, std::min(*std::next(it, _chunkSize), *chunkindices.end())));
-                // copy over data
-                for(int i=0; i<newdata.size();++i){
-                    processed[*it+i] = newdata[i];
-                }
-            }
+        NumericalBatch<T> 
+        go(const NumericalBatch<T>& batch) const override final
+        {
+            // the tasks of all spectra together
+            NumericalBatch<T> processed(batch.nchannels(), batch.nspectra());
+            const int chunksPerTask = chunksPerTaskFor(batch.nchannels());
+            const int ntasks = (nchunks(batch.nchannels()) + chunksPerTask - 1)/chunksPerTask;
+            _pool->parallelFor(ntasks*batch.nspectra(), [&](int task){
+                NumericalView<T> output = processed.spectrum(task/ntasks);
+                threshold(batch.spectrum(task/ntasks), output, (task % ntasks)*chunksPerTask, chunksPerTask);
+            });
             return processed;
         };
 
+        // the fewest points given to each thread
+        static constexpr int MinTaskSize = 1 << 15;
+
       private:
+        NumericalData<T, Size> apply(const ConstNumericalView<T>& data) const
+        {
+            NumericalData<T, Size> processed(data.size());
+            NumericalView<T> output(processed);
+            const int chunksPerTask = chunksPerTaskFor(data.size());
+            const int ntasks = (nchunks(data.size()) + chunksPerTask - 1)/chunksPerTask;
+            _pool->parallelFor(ntasks, [&](int task){
+                threshold(data, output, task*chunksPerTask, chunksPerTask);
+            });
+            return processed;
+        }
+
+        inline int nchunks(int size) const
+        {
+            return (size + _chunkSize - 1)/_chunkSize;
+        }
+
+        inline int chunksPerTaskFor(int size) const
+        {
+            const int chunks = nchunks(size);
+            const int minchunks = std::max(1, MinTaskSize/_chunkSize);
+            return std::max(minchunks, (chunks + _pool->nthreads() - 1)/_pool->nthreads());
+        }
+
+        // thresholds chunks [firstchunk, firstchunk + count)
+        void threshold(const ConstNumericalView<T>& data, NumericalView<T>& output, int firstchunk, int count) const
+        {
+            const int size = data.size();
+            const int end = std::min(size, (firstchunk + count)*_chunkSize);
+            for(int start=firstchunk*_chunkSize; start<end; start+=_chunkSize){
+                const int n = std::min(_chunkSize, size - start);
+                const T absThreshold = data.segment(start, n).maxCoeff()*_percentThreshold;
+                output.segment(start, n) = (data.segment(start, n) >= absThreshold).select(data.segment(start, n), T(0));
+            }
+        }
+
         const T _percentThreshold;
-        const size_t _chunkSize;
+        const int _chunkSize;
+        util::ThreadPool* _pool;
     };  
 
+    template<typename T, int Size>
+    constexpr int ChunkedThresholdPeakFilter<T, Size>::MinTaskSize;
+
     /*!
        @brief Simple moving average peak filter 
     */
@@ -106,13 +193,34 @@ PEAKINGDUCK_NAMESPACE_START(core)
         NumericalData<T, Size> 
         go(const NumericalData<T, Size>& data) const override final
         {
-            NumericalData<T, Size> smoothed = data - _movingAverageSmoother->go(data);
-            for(int i=0;i<data.size();++i)
-                smoothed[i] = smoothed[i] > 0 ? smoothed[i] : 0.0;
+            return apply(data);
+        };
+
+        NumericalData<T, Size> 
+        go(const ConstNumericalView<T>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalBatch<T> 
+        go(const NumericalBatch<T>& batch) const override final
+        {
+            NumericalBatch<T> smoothed = batch;
+            smoothed -= _movingAverageSmoother->go(batch);
+            smoothed.zeroBelowInPlace(0);
             return smoothed;
         };
 
       private:
+        template<typename DataType>
+        NumericalData<T, Size> apply(const DataType& data) const
+        {
+            NumericalData<T, Size> smoothed = data;
+            smoothed -= _movingAverageSmoother->go(data);
+            smoothed.zeroBelowInPlace(0);
+            return smoothed;
+        }
+
         std::shared_ptr<IProcess<T,Size>> _movingAverageSmoother;
     };  
 
@@ -127,8 +235,8 @@ PEAKINGDUCK_NAMESPACE_START(core)
     template<typename ValueType=DefaultType>
     struct PeakInfo
     {
-        const size_t index;
-        const ValueType value;
+        size_t index;
+        ValueType value;
 
         PeakInfo(size_t pindex, ValueType pvalue) : index(pindex), value(pvalue) {}
     };
@@ -145,7 +253,7 @@ PEAKINGDUCK_NAMESPACE_START(core)
     template<typename ValueType=DefaultType, typename PropType=DefaultType>
     struct PeakInfoWithProp : public PeakInfo<ValueType>
     {
-        const PropType property;
+        PropType property;
 
         PeakInfoWithProp(size_t pindex, ValueType pvalue, PropType pprop) : PeakInfo<ValueType>(pindex, pvalue), property(pprop) {}
     };
@@ -161,6 +269,355 @@ PEAKINGDUCK_NAMESPACE_START(core)
     template<typename ValueType=DefaultType>
     using PeakList = std::vector<PeakInfo<ValueType>>;
 
+    /*!
+       @brief The columns of a PeakTable
+    */
+    enum class PeakColumn
+    {
+        Index,
+        Value,
+        Energy,
+        Area,
+        Width,
+        Score
+    };
+
+    /*!
+       @brief A table of peaks with one contiguous column per property (a
+       structure of arrays), rather than one object per peak.
+
+        The index and value columns are set by the peak finders, the
+        energy, area, width and score columns are zero unless a finder
+        or the caller fills them (i.e. the width and prominence of the
+        LocalMaximaPeakFinder). clear keeps the capacity, so a table can 
+        be reused for many spectra without allocating, and sorting and 
+        filtering move the rows within the columns in place.
+
+        The columns are views of the table, valid until it grows beyond 
+        its capacity (see reserve). Views kept for longer can pin the
+        table, while pinned growing beyond the capacity throws rather
+        than moving the columns.
+    */
+    template<typename T=DefaultType>
+    class PeakTable
+    {
+        public:
+            PeakTable()
+            {
+            }
+
+            explicit PeakTable(const PeakList<T>& peaks)
+            {
+                reserve(static_cast<int>(peaks.size()));
+                for(const auto& peak: peaks){
+                    append(peak);
+                }
+            }
+
+            PeakTable(const PeakTable&) = default;
+            PeakTable(PeakTable&&) = default;
+
+            /*!
+               @brief Copy the rows of the other. A pinned table keeps its
+               columns, so throws if the other has more rows than its capacity.
+            */
+            PeakTable& operator=(const PeakTable& other)
+            {
+                if(this != &other){
+                    if(other.size() > capacity()){
+                        checkUnpinned();
+                    }
+                    _indices.assign(other._indices.begin(), other._indices.end());
+                    _values.assign(other._values.begin(), other._values.end());
+                    _energies.assign(other._energies.begin(), other._energies.end());
+                    _areas.assign(other._areas.begin(), other._areas.end());
+                    _widths.assign(other._widths.begin(), other._widths.end());
+                    _scores.assign(other._scores.begin(), other._scores.end());
+                }
+                return *this;
+            }
+
+            /*!
+               @brief Take the columns of the other, or for a pinned table
+               copy the rows into its own (as the copy assignment).
+            */
+            PeakTable& operator=(PeakTable&& other)
+            {
+                if(pinned()){
+                    return *this = static_cast<const PeakTable&>(other);
+                }
+                if(this != &other){
+                    _indices = std::move(other._indices);
+                    _values = std::move(other._values);
+                    _energies = std::move(other._energies);
+                    _areas = std::move(other._areas);
+                    _widths = std::move(other._widths);
+                    _scores = std::move(other._scores);
+                }
+                return *this;
+            }
+
+            inline int size() const
+            {
+                return static_cast<int>(_indices.size());
+            }
+
+            inline bool empty() const
+            {
+                return _indices.empty();
+            }
+
+            inline int capacity() const
+            {
+                return static_cast<int>(_indices.capacity());
+            }
+
+            void reserve(int npeaks)
+            {
+                if(npeaks > capacity()){
+                    checkUnpinned();
+                }
+                _indices.reserve(npeaks);
+                forEachColumn([&](std::vector<T>& column){ column.reserve(npeaks); });
+            }
+
+            // removes the rows, keeping the capacity
+            void clear()
+            {
+                _indices.clear();
+                forEachColumn([](std::vector<T>& column){ column.clear(); });
+            }
+
+            inline void append(size_t index, T value, T energy=0, T area=0, T width=0, T score=0)
+            {
+                if(_indices.size() == _indices.capacity()){
+                    checkUnpinned();
+                }
+                _indices.push_back(index);
+                _values.push_back(value);
+                _energies.push_back(energy);
+                _areas.push_back(area);
+                _widths.push_back(width);
+                _scores.push_back(score);
+            }
+
+            inline void append(const PeakInfo<T>& peak)
+            {
+                append(peak.index, peak.value);
+            }
+
+            /*!
+               @brief Stop the columns from moving, until as many unpin calls.
+               While pinned, reserve, append and assignment beyond the 
+               capacity throw. Copies of the table are not pinned.
+            */
+            inline void pin()
+            {
+                ++_pins.count;
+            }
+
+            inline void unpin()
+            {
+                assert(_pins.count > 0);
+                --_pins.count;
+            }
+
+            inline bool pinned() const
+            {
+                return _pins.count > 0;
+            }
+
+            inline PeakInfo<T> peak(int row) const
+            {
+                return PeakInfo<T>(_indices[row], _values[row]);
+            }
+
+            PeakList<T> toPeakList() const
+            {
+                PeakList<T> peaks;
+                peaks.reserve(_indices.size());
+                for(int row=0; row<size(); ++row){
+                    peaks.push_back(peak(row));
+                }
+                return peaks;
+            }
+
+            inline const std::vector<size_t>& indices() const
+            {
+                return _indices;
+            }
+
+            NumericalView<T> column(PeakColumn column)
+            {
+                std::vector<T>& values = columnValues(column);
+                return NumericalView<T>(values.data(), size());
+            }
+
+            ConstNumericalView<T> column(PeakColumn column) const
+            {
+                const std::vector<T>& values = const_cast<PeakTable*>(this)->columnValues(column);
+                return ConstNumericalView<T>(values.data(), size());
+            }
+
+            inline NumericalView<T> values() { return column(PeakColumn::Value); }
+            inline NumericalView<T> energies() { return column(PeakColumn::Energy); }
+            inline NumericalView<T> areas() { return column(PeakColumn::Area); }
+            inline NumericalView<T> widths() { return column(PeakColumn::Width); }
+            inline NumericalView<T> scores() { return column(PeakColumn::Score); }
+
+            inline ConstNumericalView<T> values() const { return column(PeakColumn::Value); }
+            inline ConstNumericalView<T> energies() const { return column(PeakColumn::Energy); }
+            inline ConstNumericalView<T> areas() const { return column(PeakColumn::Area); }
+            inline ConstNumericalView<T> widths() const { return column(PeakColumn::Width); }
+            inline ConstNumericalView<T> scores() const { return column(PeakColumn::Score); }
+
+            /*!
+               @brief Sort the rows by a column (stable, equal values keep 
+               their order).
+            */
+            void sortBy(PeakColumn column, bool descending=false)
+            {
+                if(column == PeakColumn::Index){
+                    sortOrder(_indices, _indexKeys, descending);
+                }
+                else{
+                    sortOrder(columnValues(column), _valueKeys, descending);
+                }
+                permute(_indices);
+                forEachColumn([&](std::vector<T>& values){ permute(values); });
+            }
+
+            /*!
+               @brief Keep the rows for which keep(row) is true, in order.
+            */
+            template<class Predicate>
+            void filter(Predicate&& keep)
+            {
+                int kept = 0;
+                for(int row=0; row<size(); ++row){
+                    if(keep(row)){
+                        _indices[kept] = _indices[row];
+                        _values[kept] = _values[row];
+                        _energies[kept] = _energies[row];
+                        _areas[kept] = _areas[row];
+                        _widths[kept] = _widths[row];
+                        _scores[kept] = _scores[row];
+                        ++kept;
+                    }
+                }
+                _indices.resize(kept);
+                forEachColumn([&](std::vector<T>& values){ values.resize(kept); });
+            }
+
+            /*!
+               @brief Keep the rows with lower <= column <= upper.
+            */
+            void filter(PeakColumn column, T lower, T upper)
+            {
+                if(column == PeakColumn::Index){
+                    filter([&](int row){ return lower <= _indices[row] && _indices[row] <= upper; });
+                }
+                else{
+                    const std::vector<T>& values = columnValues(column);
+                    filter([&](int row){ return lower <= values[row] && values[row] <= upper; });
+                }
+            }
+
+        private:
+            // the pins of this table, never copied from another
+            struct Pins
+            {
+                Pins() = default;
+                Pins(const Pins&) {}
+                Pins& operator=(const Pins&) { return *this; }
+
+                int count = 0;
+            };
+
+            inline void checkUnpinned() const
+            {
+                if(pinned()){
+                    throw PeakingDuckException("Peak table is pinned (its columns are in use), it can not grow beyond its capacity.");
+                }
+            }
+
+            std::vector<T>& columnValues(PeakColumn column)
+            {
+                switch(column){
+                    case PeakColumn::Value: return _values;
+                    case PeakColumn::Energy: return _energies;
+                    case PeakColumn::Area: return _areas;
+                    case PeakColumn::Width: return _widths;
+                    case PeakColumn::Score: return _scores;
+                    default: throw PeakingDuckException("The index column is not a value column.");
+                }
+            }
+
+            template<class Function>
+            void forEachColumn(Function&& function)
+            {
+                for(std::vector<T>* values: {&_values, &_energies, &_areas, &_widths, &_scores}){
+                    function(*values);
+                }
+            }
+
+            // the rows in order of the keys, sorted with the keys alongside
+            // (contiguous) rather than through the rows
+            template<typename Key>
+            void sortOrder(const std::vector<Key>& keys, std::vector<std::pair<Key, int>>& keyed, bool descending)
+            {
+                keyed.resize(keys.size());
+                for(size_t row=0; row<keys.size(); ++row){
+                    keyed[row] = std::make_pair(keys[row], static_cast<int>(row));
+                }
+                if(descending){
+                    std::stable_sort(keyed.begin(), keyed.end(), [](const std::pair<Key, int>& a, const std::pair<Key, int>& b){
+                        return b.first < a.first;
+                    });
+                }
+                else{
+                    std::stable_sort(keyed.begin(), keyed.end(), [](const std::pair<Key, int>& a, const std::pair<Key, int>& b){
+                        return a.first < b.first;
+                    });
+                }
+                _order.resize(keyed.size());
+                for(size_t row=0; row<keyed.size(); ++row){
+                    _order[row] = keyed[row].second;
+                }
+            }
+
+            // reorders the rows by _order through a reused buffer, the
+            // columns stay where they are
+            template<typename Value>
+            void permute(std::vector<Value>& values)
+            {
+                std::vector<Value>& buffer = scratch(values);
+                buffer.resize(values.size());
+                for(size_t row=0; row<values.size(); ++row){
+                    buffer[row] = values[_order[row]];
+                }
+                std::copy(buffer.begin(), buffer.end(), values.begin());
+            }
+
+            inline std::vector<size_t>& scratch(std::vector<size_t>&) { return _indexBuffer; }
+            inline std::vector<T>& scratch(std::vector<T>&) { return _valueBuffer; }
+
+            std::vector<size_t> _indices;
+            std::vector<T> _values;
+            std::vector<T> _energies;
+            std::vector<T> _areas;
+            std::vector<T> _widths;
+            std::vector<T> _scores;
+            Pins _pins;
+
+            // reused by sortBy
+            std::vector<std::pair<size_t, int>> _indexKeys;
+            std::vector<std::pair<T, int>> _valueKeys;
+            std::vector<int> _order;
+            std::vector<size_t> _indexBuffer;
+            std::vector<T> _valueBuffer;
+    };
+
     /*!
        @brief Interface for peak finding algorithms
 
@@ -180,6 +637,19 @@ PEAKINGDUCK_NAMESPACE_START(core)
         virtual PeakList<ValueType>
         find(const NumericalData<ValueType, Size>& data) const = 0;
 
+        /*!
+           @brief Identifies potential peaks in the data into the table,
+           replacing its rows (keeping its capacity)
+        */
+        virtual void
+        find(const NumericalData<ValueType, Size>& data, PeakTable<ValueType>& table) const
+        {
+            table.clear();
+            for(const auto& peak: find(data)){
+                table.append(peak);
+            }
+        }
+
         // What else should this do?
         // If find is a slow process should we allow interface to provide
         // get last values? 
@@ -187,11 +657,69 @@ PEAKINGDUCK_NAMESPACE_START(core)
     };    
 
     /*!
-       @brief Interface for peak finding algorithms
+       @brief Calls group(first, last, maxindex, maxvalue) for each group of 
+       consecutive values above (>) the threshold, in order, where the group
+       is [first, last) and maxindex is the first of its maxima.
+
+        Blocks of BlockSize values with none above the threshold are skipped
+        with a vectorized comparison.
+    */
+    template<int BlockSize=64, class Values, typename T, class Group>
+    void forEachGroupAbove(const Values& values, T threshold, Group&& group)
+    {
+        const int size = static_cast<int>(values.size());
+
+        // the current group
+        bool ingroup = false;
+        int first = 0;
+        int maxindex = 0;
+        T maxvalue = 0;
+        for(int start=0; start<size; start+=BlockSize){
+            const int n = std::min(BlockSize, size-start);
+            if(!(values.segment(start, n) > threshold).any()){
+                if(ingroup){
+                    group(first, start, maxindex, maxvalue);
+                    ingroup = false;
+                }
+                continue;
+            }
+            for(int i=start; i<start+n; ++i){
+                const T value = values[i];
+                if(value > threshold){
+                    if(!ingroup){
+                        first = i;
+                        maxindex = i;
+                        maxvalue = value;
+                        ingroup = true;
+                    }
+                    else if(value > maxvalue){
+                        maxindex = i;
+                        maxvalue = value;
+                    }
+                }
+                else if(ingroup){
+                    group(first, i, maxindex, maxvalue);
+                    ingroup = false;
+                }
+            }
+        }
+        if(ingroup){
+            group(first, size, maxindex, maxvalue);
+        }
+    }
+
+    /*!
+       @brief Simple peak finder, the maximum of each group of consecutive 
+       points above a threshold, relative to the maximum of the data.
 
        Operates on numerical data (filtered or unfiltered)
        Never mutates the input (always const process)
        returns a list of peaks - PeakList
+
+       A single pass keeping the running maximum of the current group,
+       blocks with no point above the threshold are skipped with a 
+       vectorized comparison. Pass the output list (or table) to reuse 
+       its storage between calls.
     */
     template<typename ValueType=DefaultType, 
              int Size=ArrayTypeDynamic>
@@ -212,59 +740,992 @@ PEAKINGDUCK_NAMESPACE_START(core)
         */
         virtual PeakList<ValueType>
         find(const NumericalData<ValueType, Size>& data) const override{
+            PeakList<ValueType> peaks;
+            find(data, peaks);
+            return peaks;
+        }
 
-            const ValueType relativeThreshold = data.maxCoeff()*_percentThreshold;
-            
-            // find consecutive bins for a peak group (indices)
-            using PeakGroup = std::vector<size_t>;
-
-            // identify values greater than the threshold
-            // and store their consecutive indices
-            PeakGroup local_peak;
-            std::vector<PeakGroup> peak_groups;
-
-            // can we use the STL instead - maybe std::partition?
-            int last_index = -1;
-            for(auto i=0; i<data.size(); ++i){
-                if(data[i] > relativeThreshold){
-                    if((last_index + 1 < i) && (last_index >=0)){
-                        peak_groups.emplace_back(local_peak);
-                        local_peak.resize(0);
-                    }
-                    local_peak.emplace_back(i);
-                    last_index = i;
-                }
+        /*!
+           @brief Identifies potential peaks in the data, replacing the 
+           contents of peaks (no allocation once it has the capacity)
+        */
+        void find(const NumericalData<ValueType, Size>& data, PeakList<ValueType>& peaks) const
+        {
+            peaks.clear();
+            scan(data, [&](int maxindex, ValueType maxvalue){ peaks.emplace_back(maxindex, maxvalue); });
+        }
+
+        void find(const ConstNumericalView<ValueType>& data, PeakList<ValueType>& peaks) const
+        {
+            peaks.clear();
+            scan(data, [&](int maxindex, ValueType maxvalue){ peaks.emplace_back(maxindex, maxvalue); });
+        }
+
+        virtual void
+        find(const NumericalData<ValueType, Size>& data, PeakTable<ValueType>& table) const override
+        {
+            table.clear();
+            scan(data, [&](int maxindex, ValueType maxvalue){ table.append(maxindex, maxvalue); });
+        }
+
+        void find(const ConstNumericalView<ValueType>& data, PeakTable<ValueType>& table) const
+        {
+            table.clear();
+            scan(data, [&](int maxindex, ValueType maxvalue){ table.append(maxindex, maxvalue); });
+        }
+
+        // the points checked at once for any above the threshold
+        static constexpr int BlockSize = 64;
+        
+      private:
+        template<class Emit>
+        void scan(const NumericalData<ValueType, Size>& data, Emit&& emit) const
+        {
+            using Values = Eigen::Array<ValueType, Eigen::Dynamic, 1>;
+            scanValues(Eigen::Map<const Values>(data.data(), data.size()), emit);
+        }
+
+        template<class Emit>
+        void scan(const ConstNumericalView<ValueType>& data, Emit&& emit) const
+        {
+            using Values = Eigen::Array<ValueType, Eigen::Dynamic, 1>;
+            scanValues(Eigen::Map<const Values, Eigen::Unaligned, Eigen::InnerStride<>>(
+                data.data(), data.size(), Eigen::InnerStride<>(data.stride())), emit);
+        }
+
+        template<class Values, class Emit>
+        void scanValues(const Values& values, Emit&& emit) const
+        {
+            if(values.size() == 0){
+                return;
             }
+            const ValueType relativeThreshold = values.maxCoeff()*_percentThreshold;
+            forEachGroupAbove<BlockSize>(values, relativeThreshold, [&](int, int, int maxindex, ValueType maxvalue){
+                emit(maxindex, maxvalue);
+            });
+        }
 
-            if(local_peak.size() > 0){
-                peak_groups.emplace_back(local_peak);
+        const ValueType _percentThreshold;
+    };    
+
+    template<typename ValueType, int Size>
+    constexpr int SimplePeakFinder<ValueType, Size>::BlockSize;
+
+    /*!
+       @brief Chunked simple peak finder, the data is split into nchunks
+       (as numpy.array_split) and the threshold is relative to the maximum
+       of each chunk, so smaller peaks are found away from the largest.
+
+        A group of consecutive points above their chunk thresholds that
+        crosses the boundary between chunks is one peak, its maximum (the
+        first of equal maxima), rather than one either side.
+
+        The chunks are views of the data, scanned concurrently on the thread
+        pool and merged in order, so the peaks do not depend on the number 
+        of threads.
+    */
+    template<typename ValueType=DefaultType, 
+             int Size=ArrayTypeDynamic>
+    struct ChunkedSimplePeakFinder : public IPeakFinder<ValueType, Size>
+    {
+        explicit ChunkedSimplePeakFinder(ValueType percentThreshold=0.05, int nchunks=10,
+                                         util::ThreadPool& pool=util::ThreadPool::shared()) :
+            _percentThreshold(percentThreshold), _nchunks(nchunks), _pool(&pool)
+        {
+            if(nchunks < 1){
+                throw PeakingDuckException("Number of chunks must be positive.");
             }
+        };
+
+        virtual ~ChunkedSimplePeakFinder()
+        {
+        };
 
+        using IPeakFinder<ValueType, Size>::find;
+
+        virtual PeakList<ValueType>
+        find(const NumericalData<ValueType, Size>& data) const override{
             PeakList<ValueType> peaks;
+            find(data, peaks);
+            return peaks;
+        }
+
+        /*!
+           @brief Identifies peaks in the data (or a view), replacing the 
+           contents of peaks
+        */
+        void find(const ConstNumericalView<ValueType>& data, PeakList<ValueType>& peaks) const
+        {
+            peaks.clear();
+            const int size = data.size();
+
+            // the groups of each chunk, first chunks are one larger (as numpy)
+            struct Group
+            {
+                int first;
+                int last;
+                int maxindex;
+                ValueType maxvalue;
+            };
+            std::vector<std::vector<Group>> groups(_nchunks);
+            const int base = size/_nchunks;
+            const int extra = size % _nchunks;
+            auto chunkstart = [&](int chunk){
+                return chunk*base + std::min(chunk, extra);
+            };
 
-            // find maximum in each group
-            size_t max_index = -1;
-            ValueType max_value = -1;
-            for(auto& group: peak_groups){
-                max_value = -1.0;
-                max_index = -1;
-                for(auto i: group){
-                    if(data[i] > max_value){
-                        max_value = data[i];
-                        max_index = i;
+            const int chunksPerTask = std::max(1, std::min(_nchunks, MinTaskSize/std::max(1, base)));
+            const int ntasks = (_nchunks + chunksPerTask - 1)/chunksPerTask;
+            _pool->parallelFor(ntasks, [&](int task){
+                for(int chunk=task*chunksPerTask; chunk<std::min(_nchunks, (task + 1)*chunksPerTask); ++chunk){
+                    const int start = chunkstart(chunk);
+                    const int n = chunkstart(chunk + 1) - start;
+                    if(n == 0){
+                        continue;
                     }
+                    const ConstNumericalView<ValueType> values = data.slice(start, start + n);
+                    const ValueType threshold = values.maxCoeff()*_percentThreshold;
+                    forEachGroupAbove(values, threshold, [&](int first, int last, int maxindex, ValueType maxvalue){
+                        groups[chunk].push_back(Group{start + first, start + last, start + maxindex, maxvalue});
+                    });
                 }
+            });
 
-                peaks.emplace_back(PeakInfo<ValueType>(max_index, data[max_index]));
+            // in order, joining groups that meet at a chunk boundary
+            int lastend = -1;
+            for(const auto& chunkgroups: groups){
+                for(const Group& group: chunkgroups){
+                    if(group.first == lastend){
+                        if(group.maxvalue > peaks.back().value){
+                            peaks.back() = PeakInfo<ValueType>(group.maxindex, group.maxvalue);
+                        }
+                    }
+                    else{
+                        peaks.emplace_back(group.maxindex, group.maxvalue);
+                    }
+                    lastend = group.last;
+                }
             }
-
-            return peaks;
         }
-        
+
+        // the fewest points given to each thread
+        static constexpr int MinTaskSize = 1 << 15;
+
       private:
         const ValueType _percentThreshold;
+        const int _nchunks;
+        util::ThreadPool* _pool;
     };    
 
+    template<typename ValueType, int Size>
+    constexpr int ChunkedSimplePeakFinder<ValueType, Size>::MinTaskSize;
+
+    /*!
+       @brief Window peak finder, a point is a peak when it and its neighbours
+       are above the local threshold, mean + threshold*stddev (ddof=1) of the
+       nouter points either side, ignoring the ninner nearest (see core::window).
+
+        includePoint adds the point itself to the window, enforceMaximum 
+        also requires the point to be at least its neighbours. useGrad
+        also requires the gradient (as gradient()) to cross zero from
+        positive nearer the point than its neighbours, as the crossings
+        of GradientPeakFinder(3, 2) without the curvature. The first 3 
+        and last 3 points are never peaks.
+
+        The window sums come from prefix sums of the values and squares
+        (shifted by the rounded mean for precision), so the scan is O(N)
+        for any window size.
+    */
+    template<typename ValueType=DefaultType, 
+             int Size=ArrayTypeDynamic>
+    struct WindowPeakFinder : public IPeakFinder<ValueType, Size>
+    {
+        explicit WindowPeakFinder(ValueType threshold=2.0, int ninner=0, int nouter=40, 
+                                  bool includePoint=false, bool enforceMaximum=false, bool useGrad=false) :
+            _threshold(threshold), _ninner(ninner), _nouter(nouter),
+            _includePoint(includePoint), _enforceMaximum(enforceMaximum), _useGrad(useGrad)
+        {
+            if(ninner < 0 || ninner > nouter){
+                throw PeakingDuckException("Window peak finder needs 0 <= ninner <= nouter.");
+            }
+        };
+
+        virtual ~WindowPeakFinder()
+        {
+        };
+
+        using IPeakFinder<ValueType, Size>::find;
+
+        /*!
+           @brief Identifies peaks above the local (window) threshold
+        */
+        virtual PeakList<ValueType>
+        find(const NumericalData<ValueType, Size>& data) const override{
+            const int size = static_cast<int>(data.size());
+            if(size <= 2*_nouter){
+                throw PeakingDuckException("Window peak finder needs more than 2*nouter points.");
+            }
+
+            // prefix sums of (x - shift) and its square, an integer shift 
+            // keeps the sums exact for counts
+            const double shift = std::round(static_cast<double>(data.mean()));
+            std::vector<double> sums(size + 1, 0.0);
+            std::vector<double> squares(size + 1, 0.0);
+            for(int i=0; i<size; ++i){
+                const double value = static_cast<double>(data[i]) - shift;
+                sums[i+1] = sums[i] + value;
+                squares[i+1] = squares[i] + value*value;
+            }
+
+            PeakList<ValueType> peaks;
+            for(int i=3; i<=size-4; ++i){
+                // the window either side, as core::windowViews
+                const int lowerstart = std::max(0, i-_nouter);
+                const int lowerend = std::max(0, i-_ninner);
+                const int upperstart = std::min(size, i+1+_ninner);
+                const int upperend = std::min(size, i+1+_nouter);
+
+                int count = (lowerend - lowerstart) + (upperend - upperstart);
+                double sum = (sums[lowerend] - sums[lowerstart]) + (sums[upperend] - sums[upperstart]);
+                double square = (squares[lowerend] - squares[lowerstart]) + (squares[upperend] - squares[upperstart]);
+                if(_includePoint){
+                    const double value = static_cast<double>(data[i]) - shift;
+                    ++count;
+                    sum += value;
+                    square += value*value;
+                }
+
+                // the standard deviation (ddof=1) is not defined
+                if(count < 2){
+                    continue;
+                }
+                const double mean = sum/count;
+                const double variance = std::max(0.0, (square - sum*mean)/(count - 1));
+                const ValueType localthreshold = static_cast<ValueType>(shift + mean + std::sqrt(variance)*_threshold);
+
+                const ValueType value = data[i];
+                if((localthreshold < value) && (localthreshold <= data[i+1]) && (localthreshold <= data[i-1])){
+                    if(_enforceMaximum && ((data[i+1] > value) || (data[i-1] > value))){
+                        continue;
+                    }
+                    if(_useGrad && !gradientTurnsAt(data, i)){
+                        continue;
+                    }
+                    peaks.emplace_back(PeakInfo<ValueType>(i, value));
+                }
+            }
+            return peaks;
+        }
+
+      private:
+        // the central difference gradient crosses zero, from positive to
+        // zero or negative, nearest to i (the later point when halfway)
+        static bool gradientTurnsAt(const NumericalData<ValueType, Size>& data, int i)
+        {
+            const auto gradient = [&](int j){ return 0.5*(static_cast<double>(data[j+1]) - static_cast<double>(data[j-1])); };
+            const double before = gradient(i-1);
+            const double at = gradient(i);
+            const double after = gradient(i+1);
+            if(at > 0.0 && !(after > 0.0)){
+                return at/(at - after) < 0.5;
+            }
+            if(before > 0.0 && !(at > 0.0)){
+                return before/(before - at) >= 0.5;
+            }
+            return false;
+        }
+
+        const ValueType _threshold;
+        const int _ninner;
+        const int _nouter;
+        const bool _includePoint;
+        const bool _enforceMaximum;
+        const bool _useGrad;
+    };    
+
+    /*!
+       @brief Lower and upper (inclusive) limits on a property of a peak,
+       as the conditions of scipy.signal.find_peaks.
+
+        Each limit is either empty (no limit), one value for all of the
+        peaks or one value per point of the data, when the limit for a
+        peak is the value at its index.
+    */
+    template<typename T=DefaultType>
+    struct PeakCondition
+    {
+        PeakCondition() : lower(), upper() {}
+
+        PeakCondition(T plower, T pupper=std::numeric_limits<T>::infinity()) : 
+            lower(std::vector<T>{plower}), upper(std::vector<T>{pupper}) {}
+
+        PeakCondition(const NumericalData<T>& plower, const NumericalData<T>& pupper=NumericalData<T>()) : 
+            lower(plower), upper(pupper) {}
+
+        inline bool active() const
+        {
+            return lower.size() > 0 || upper.size() > 0;
+        }
+
+        // the limits are for all peaks or for each of size points
+        inline bool fits(int size) const
+        {
+            return (lower.size() <= 1 || lower.size() == size) && (upper.size() <= 1 || upper.size() == size);
+        }
+
+        inline bool accepts(T value, int index) const
+        {
+            return accepts(value, value, index);
+        }
+
+        // the smallest of the values must be above the lower limit and the largest below the upper
+        inline bool accepts(T smallest, T largest, int index) const
+        {
+            return (lower.size() == 0 || limit(lower, index) <= smallest) &&
+                   (upper.size() == 0 || largest <= limit(upper, index));
+        }
+
+        NumericalData<T> lower;
+        NumericalData<T> upper;
+
+      private:
+        static inline T limit(const NumericalData<T>& limits, int index)
+        {
+            return limits.size() == 1 ? limits[0] : limits[index];
+        }
+    };
+
+    /*!
+       @brief The peaks of a LocalMaximaPeakFinder and their properties, 
+       one entry per peak in order of index, as the properties of
+       scipy.signal.find_peaks.
+
+        The heights and plateau edges are always set, the prominences 
+        and bases only with a prominence or width condition and the 
+        widths only with a width condition, otherwise they are empty.
+    */
+    template<typename T=DefaultType>
+    struct PeakProperties
+    {
+        inline int size() const
+        {
+            return static_cast<int>(indices.size());
+        }
+
+        std::vector<int> indices;
+        std::vector<T> heights;
+        std::vector<int> leftEdges;
+        std::vector<int> rightEdges;
+        std::vector<T> prominences;
+        std::vector<int> leftBases;
+        std::vector<int> rightBases;
+        std::vector<T> widths;
+        std::vector<T> widthHeights;
+        std::vector<T> leftIps;
+        std::vector<T> rightIps;
+    };
+
+    /*!
+       @brief Local maxima peak finder, a native scipy.signal.find_peaks.
+
+        The peaks are the local maxima, the middle (rounded down) of a
+        flat top, not at the ends. Those kept must meet, in this order:
+            - plateauSize: the number of points of the flat top
+            - height: the value of the peak
+            - threshold: the drop to each neighbour
+            - distance: peaks closer than distance to a higher peak are 
+              removed, the highest first (on equal heights the later)
+            - prominence: the height above the higher of the lowest
+              points either side before a higher point (or the end), 
+              within wlen/2 of the peak if wlen is given (> 1)
+            - width: the width where the peak drops by relHeight of its
+              prominence, interpolated between points
+
+        The local maxima and prominences are O(N), the prominences come
+        from one monotonic stack through the data either way, unless a
+        wlen is given when each side is searched as scipy. The distance
+        sorts the peaks, O(P log P).
+    */
+    template<typename ValueType=DefaultType, 
+             int Size=ArrayTypeDynamic>
+    struct LocalMaximaPeakFinder : public IPeakFinder<ValueType, Size>
+    {
+        explicit LocalMaximaPeakFinder(const PeakCondition<ValueType>& height=PeakCondition<ValueType>(), 
+                                       const PeakCondition<ValueType>& threshold=PeakCondition<ValueType>(),
+                                       double distance=1.0,
+                                       const PeakCondition<ValueType>& prominence=PeakCondition<ValueType>(),
+                                       const PeakCondition<ValueType>& width=PeakCondition<ValueType>(),
+                                       double wlen=0.0,
+                                       double relHeight=0.5,
+                                       const PeakCondition<ValueType>& plateauSize=PeakCondition<ValueType>()) :
+            _height(height), _threshold(threshold), _distance(distance), _prominence(prominence),
+            _width(width), _wlen(wlen), _relHeight(relHeight), _plateauSize(plateauSize)
+        {
+            if(!(distance >= 1.0)){
+                throw PeakingDuckException("Peak distance must be at least 1.");
+            }
+            if(wlen != 0.0 && !(wlen > 1.0)){
+                throw PeakingDuckException("Prominence window length must be larger than 1.");
+            }
+            if(!(relHeight >= 0.0)){
+                throw PeakingDuckException("Relative height must not be negative.");
+            }
+        };
+
+        virtual ~LocalMaximaPeakFinder()
+        {
+        };
+
+        /*!
+           @brief Identifies the local maxima meeting the conditions
+        */
+        virtual PeakList<ValueType>
+        find(const NumericalData<ValueType, Size>& data) const override{
+            return toPeaks(data, candidates(data));
+        }
+
+        PeakList<ValueType>
+        find(const ConstNumericalView<ValueType>& data) const{
+            return toPeaks(data, candidates(data));
+        }
+
+        /*!
+           @brief Identifies the local maxima into the table, with the 
+           widths and prominences (as score) when they are found
+        */
+        virtual void
+        find(const NumericalData<ValueType, Size>& data, PeakTable<ValueType>& table) const override{
+            toTable(data, candidates(data), table);
+        }
+
+        void find(const ConstNumericalView<ValueType>& data, PeakTable<ValueType>& table) const{
+            toTable(data, candidates(data), table);
+        }
+
+        /*!
+           @brief Identifies the local maxima meeting the conditions, 
+           with their properties
+        */
+        PeakProperties<ValueType>
+        findWithProperties(const NumericalData<ValueType, Size>& data) const{
+            return toProperties(data, candidates(data));
+        }
+
+        PeakProperties<ValueType>
+        findWithProperties(const ConstNumericalView<ValueType>& data) const{
+            return toProperties(data, candidates(data));
+        }
+
+        // the prominences (and bases) are found for the prominence and width conditions
+        inline bool findsProminences() const
+        {
+            return _prominence.active() || _width.active();
+        }
+
+        inline bool findsWidths() const
+        {
+            return _width.active();
+        }
+
+      private:
+        struct Candidate
+        {
+            int index;
+            int leftEdge;
+            int rightEdge;
+            ValueType prominence;
+            int leftBase;
+            int rightBase;
+            ValueType width;
+            ValueType widthHeight;
+            ValueType leftIp;
+            ValueType rightIp;
+        };
+
+        template<class Predicate>
+        static void keepIf(std::vector<Candidate>& candidates, Predicate&& keep)
+        {
+            candidates.erase(std::remove_if(candidates.begin(), candidates.end(), 
+                [&](const Candidate& candidate){ return !keep(candidate); }), candidates.end());
+        }
+
+        template<typename DataType>
+        std::vector<Candidate> candidates(const DataType& data) const
+        {
+            const int size = static_cast<int>(data.size());
+            for(const auto* condition: {&_height, &_threshold, &_prominence, &_width, &_plateauSize}){
+                if(!condition->fits(size)){
+                    throw PeakingDuckException("Peak condition limits must have one value or one per point.");
+                }
+            }
+
+            std::vector<Candidate> peaks = localMaxima(data);
+            if(_plateauSize.active()){
+                keepIf(peaks, [&](const Candidate& peak){ 
+                    return _plateauSize.accepts(static_cast<ValueType>(peak.rightEdge - peak.leftEdge + 1), peak.index); 
+                });
+            }
+            if(_height.active()){
+                keepIf(peaks, [&](const Candidate& peak){ return _height.accepts(data[peak.index], peak.index); });
+            }
+            if(_threshold.active()){
+                keepIf(peaks, [&](const Candidate& peak){
+                    const ValueType left = data[peak.index] - data[peak.index-1];
+                    const ValueType right = data[peak.index] - data[peak.index+1];
+                    return _threshold.accepts(std::min(left, right), std::max(left, right), peak.index);
+                });
+            }
+            if(_distance > 1.0){
+                selectByDistance(data, peaks);
+            }
+            if(findsProminences()){
+                prominences(data, peaks);
+                keepIf(peaks, [&](const Candidate& peak){ return _prominence.accepts(peak.prominence, peak.index); });
+            }
+            if(findsWidths()){
+                widths(data, peaks);
+                keepIf(peaks, [&](const Candidate& peak){ return _width.accepts(peak.width, peak.index); });
+            }
+            return peaks;
+        }
+
+        // the local maxima and their flat tops, as scipy _local_maxima_1d
+        template<typename DataType>
+        static std::vector<Candidate> localMaxima(const DataType& data)
+        {
+            const int last = static_cast<int>(data.size()) - 1;
+            std::vector<Candidate> peaks;
+            for(int i=1; i<last; ++i){
+                if(data[i-1] < data[i]){
+                    int ahead = i + 1;
+                    while(ahead < last && data[ahead] == data[i]){
+                        ++ahead;
+                    }
+                    if(data[ahead] < data[i]){
+                        peaks.push_back(Candidate{(i + ahead - 1)/2, i, ahead - 1, 0, 0, 0, 0, 0, 0, 0});
+                        i = ahead;
+                    }
+                }
+            }
+            return peaks;
+        }
+
+        // removes the peaks within distance of a higher one, highest first
+        template<typename DataType>
+        void selectByDistance(const DataType& data, std::vector<Candidate>& peaks) const
+        {
+            const int npeaks = static_cast<int>(peaks.size());
+            const int distance = static_cast<int>(std::ceil(_distance));
+            std::vector<int> order(npeaks);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&](int a, int b){ 
+                return data[peaks[a].index] < data[peaks[b].index]; 
+            });
+
+            std::vector<char> keep(npeaks, 1);
+            for(int i=npeaks-1; i>=0; --i){
+                const int j = order[i];
+                if(!keep[j]){
+                    continue;
+                }
+                for(int k=j-1; k>=0 && peaks[j].index - peaks[k].index < distance; --k){
+                    keep[k] = 0;
+                }
+                for(int k=j+1; k<npeaks && peaks[k].index - peaks[j].index < distance; ++k){
+                    keep[k] = 0;
+                }
+            }
+
+            int kept = 0;
+            for(int i=0; i<npeaks; ++i){
+                if(keep[i]){
+                    peaks[kept++] = peaks[i];
+                }
+            }
+            peaks.resize(kept);
+        }
+
+        template<typename DataType>
+        void prominences(const DataType& data, std::vector<Candidate>& peaks) const
+        {
+            if(peaks.empty()){
+                return;
+            }
+            if(_wlen > 1.0){
+                windowBases(data, peaks);
+            }
+            else{
+                stackBases(data, peaks, false);
+                stackBases(data, peaks, true);
+            }
+            for(auto& peak: peaks){
+                peak.prominence = data[peak.index] - std::max(data[peak.leftBase], data[peak.rightBase]);
+            }
+        }
+
+        // the base either side is the lowest point between the peak and the 
+        // nearest point higher than it (or the end), the closest to the peak
+        // of equal lowest points. The points go through a stack decreasing 
+        // in value, each entry holding the lowest point since the entry below,
+        // so the bases of all peaks on one side take one pass
+        template<typename DataType>
+        static void stackBases(const DataType& data, std::vector<Candidate>& peaks, bool right)
+        {
+            struct Entry
+            {
+                int index;
+                int lowest;
+            };
+
+            const int npeaks = static_cast<int>(peaks.size());
+            const int step = right ? -1 : 1;
+            int next = right ? npeaks - 1 : 0;
+            std::vector<Entry> stack;
+            for(int i=(right ? static_cast<int>(data.size()) - 1 : 0); next >= 0 && next < npeaks; i+=step){
+                Entry entry{i, i};
+                while(!stack.empty() && !(data[i] < data[stack.back().index])){
+                    if(data[stack.back().lowest] < data[entry.lowest]){
+                        entry.lowest = stack.back().lowest;
+                    }
+                    stack.pop_back();
+                }
+                stack.push_back(entry);
+
+                if(i == peaks[next].index){
+                    (right ? peaks[next].rightBase : peaks[next].leftBase) = entry.lowest;
+                    next += step;
+                }
+            }
+        }
+
+        // the bases within the window, searched from each peak as scipy 
+        template<typename DataType>
+        void windowBases(const DataType& data, std::vector<Candidate>& peaks) const
+        {
+            const int size = static_cast<int>(data.size());
+            const int half = static_cast<int>(std::ceil(_wlen))/2;
+            for(auto& peak: peaks){
+                const ValueType value = data[peak.index];
+                const int first = std::max(0, peak.index - half);
+                const int last = std::min(size - 1, peak.index + half);
+
+                peak.leftBase = peak.index;
+                for(int i=peak.index; i>=first && !(value < data[i]); --i){
+                    if(data[i] < data[peak.leftBase]){
+                        peak.leftBase = i;
+                    }
+                }
+                peak.rightBase = peak.index;
+                for(int i=peak.index; i<=last && !(value < data[i]); ++i){
+                    if(data[i] < data[peak.rightBase]){
+                        peak.rightBase = i;
+                    }
+                }
+            }
+        }
+
+        // the width at relHeight of the prominence, between the bases, 
+        // as scipy _peak_widths
+        template<typename DataType>
+        void widths(const DataType& data, std::vector<Candidate>& peaks) const
+        {
+            for(auto& peak: peaks){
+                const ValueType height = data[peak.index] - peak.prominence*static_cast<ValueType>(_relHeight);
+
+                int i = peak.index;
+                while(peak.leftBase < i && height < data[i]){
+                    --i;
+                }
+                peak.leftIp = static_cast<ValueType>(i);
+                if(data[i] < height){
+                    peak.leftIp += (height - data[i])/(data[i+1] - data[i]);
+                }
+
+                i = peak.index;
+                while(i < peak.rightBase && height < data[i]){
+                    ++i;
+                }
+                peak.rightIp = static_cast<ValueType>(i);
+                if(data[i] < height){
+                    peak.rightIp -= (height - data[i])/(data[i-1] - data[i]);
+                }
+
+                peak.widthHeight = height;
+                peak.width = peak.rightIp - peak.leftIp;
+            }
+        }
+
+        template<typename DataType>
+        static PeakList<ValueType> toPeaks(const DataType& data, const std::vector<Candidate>& candidates)
+        {
+            PeakList<ValueType> peaks;
+            peaks.reserve(candidates.size());
+            for(const auto& candidate: candidates){
+                peaks.emplace_back(PeakInfo<ValueType>(candidate.index, data[candidate.index]));
+            }
+            return peaks;
+        }
+
+        template<typename DataType>
+        static void toTable(const DataType& data, const std::vector<Candidate>& candidates, PeakTable<ValueType>& table)
+        {
+            table.clear();
+            table.reserve(static_cast<int>(candidates.size()));
+            for(const auto& candidate: candidates){
+                table.append(candidate.index, data[candidate.index], 0, 0, candidate.width, candidate.prominence);
+            }
+        }
+
+        template<typename DataType>
+        PeakProperties<ValueType> toProperties(const DataType& data, const std::vector<Candidate>& candidates) const
+        {
+            PeakProperties<ValueType> properties;
+            for(const auto& candidate: candidates){
+                properties.indices.push_back(candidate.index);
+                properties.heights.push_back(data[candidate.index]);
+                properties.leftEdges.push_back(candidate.leftEdge);
+                properties.rightEdges.push_back(candidate.rightEdge);
+                if(findsProminences()){
+                    properties.prominences.push_back(candidate.prominence);
+                    properties.leftBases.push_back(candidate.leftBase);
+                    properties.rightBases.push_back(candidate.rightBase);
+                }
+                if(findsWidths()){
+                    properties.widths.push_back(candidate.width);
+                    properties.widthHeights.push_back(candidate.widthHeight);
+                    properties.leftIps.push_back(candidate.leftIp);
+                    properties.rightIps.push_back(candidate.rightIp);
+                }
+            }
+            return properties;
+        }
+
+        const PeakCondition<ValueType> _height;
+        const PeakCondition<ValueType> _threshold;
+        const double _distance;
+        const PeakCondition<ValueType> _prominence;
+        const PeakCondition<ValueType> _width;
+        const double _wlen;
+        const double _relHeight;
+        const PeakCondition<ValueType> _plateauSize;
+    };    
+
+    /*!
+       @brief The peaks of a GradientPeakFinder, one entry per peak in
+       order of position.
+
+        positions - where the smoothed first derivative crosses zero,
+                    interpolated between the points either side
+        indices - the nearest points to the positions
+        heights - the values at the indices
+        curvatures - minus the smoothed second derivative at the positions
+    */
+    template<typename T=DefaultType>
+    struct PeakPositions
+    {
+        inline int size() const
+        {
+            return static_cast<int>(indices.size());
+        }
+
+        std::vector<int> indices;
+        std::vector<T> positions;
+        std::vector<T> heights;
+        std::vector<T> curvatures;
+    };
+
+    /*!
+       @brief Gradient peak finder, a peak is where the smoothed first
+       derivative crosses zero from positive to zero or negative, with a
+       negative smoothed second derivative (curvature above minCurvature).
+
+        Both derivatives are the Savitzky-Golay derivatives of the given 
+        window size and polynomial order (see SavitzkyGolaySmoother), 
+        window size 3 and order 2 gives the first derivative of gradient().
+        They come from one pass over the data a block at a time, each 
+        point of the window is loaded once for both derivatives and the
+        block is scanned whilst it is in cache. Only the interior is 
+        scanned, the first and last windowsize/2 points are never peaks.
+
+        The position is interpolated linearly between the points either
+        side of the crossing, as is the second derivative, and the index 
+        is the nearest point (the later when halfway). The height 
+        condition is on the value at the index.
+    */
+    template<typename ValueType=DefaultType, 
+             int Size=ArrayTypeDynamic>
+    struct GradientPeakFinder : public IPeakFinder<ValueType, Size>
+    {
+        explicit GradientPeakFinder(int windowsize=5, int order=2, 
+                                    const PeakCondition<ValueType>& height=PeakCondition<ValueType>(),
+                                    ValueType minCurvature=0) :
+            _windowsize(windowsize), _order(order), _height(height), _minCurvature(minCurvature)
+        {
+            if(windowsize < 3 || windowsize % 2 == 0){
+                throw PeakingDuckException("Gradient peak finder window size must be an odd number of at least 3.");
+            }
+            if(order < 2 || order >= windowsize){
+                throw PeakingDuckException("Gradient peak finder polynomial order must be at least 2 and less than the window size.");
+            }
+            if(!(minCurvature >= 0)){
+                throw PeakingDuckException("Gradient peak finder minimum curvature must not be negative.");
+            }
+            _first = savitzkyGolayCoefficients<ValueType>(windowsize, order, 1);
+            _second = savitzkyGolayCoefficients<ValueType>(windowsize, order, 2);
+        };
+
+        virtual ~GradientPeakFinder()
+        {
+        };
+
+        using IPeakFinder<ValueType, Size>::find;
+
+        /*!
+           @brief Identifies the zero crossings of the first derivative
+        */
+        virtual PeakList<ValueType>
+        find(const NumericalData<ValueType, Size>& data) const override{
+            PeakList<ValueType> peaks;
+            scan(data, [&](int index, ValueType value, ValueType, ValueType){ peaks.emplace_back(index, value); });
+            return peaks;
+        }
+
+        PeakList<ValueType>
+        find(const ConstNumericalView<ValueType>& data) const{
+            PeakList<ValueType> peaks;
+            scan(data, [&](int index, ValueType value, ValueType, ValueType){ peaks.emplace_back(index, value); });
+            return peaks;
+        }
+
+        /*!
+           @brief Identifies the zero crossings into the table, with the 
+           curvature as score
+        */
+        virtual void
+        find(const NumericalData<ValueType, Size>& data, PeakTable<ValueType>& table) const override{
+            table.clear();
+            scan(data, [&](int index, ValueType value, ValueType, ValueType curvature){ 
+                table.append(index, value, 0, 0, 0, curvature); 
+            });
+        }
+
+        void find(const ConstNumericalView<ValueType>& data, PeakTable<ValueType>& table) const{
+            table.clear();
+            scan(data, [&](int index, ValueType value, ValueType, ValueType curvature){ 
+                table.append(index, value, 0, 0, 0, curvature); 
+            });
+        }
+
+        /*!
+           @brief Identifies the zero crossings of the first derivative, 
+           with their interpolated positions and curvatures
+        */
+        PeakPositions<ValueType>
+        findWithPositions(const NumericalData<ValueType, Size>& data) const{
+            PeakPositions<ValueType> peaks;
+            scan(data, [&](int index, ValueType value, ValueType position, ValueType curvature){ 
+                append(peaks, index, value, position, curvature); 
+            });
+            return peaks;
+        }
+
+        PeakPositions<ValueType>
+        findWithPositions(const ConstNumericalView<ValueType>& data) const{
+            PeakPositions<ValueType> peaks;
+            scan(data, [&](int index, ValueType value, ValueType position, ValueType curvature){ 
+                append(peaks, index, value, position, curvature); 
+            });
+            return peaks;
+        }
+
+        // the interior points differentiated at once
+        static constexpr int BlockSize = 512;
+
+      private:
+        static void append(PeakPositions<ValueType>& peaks, int index, ValueType value, ValueType position, ValueType curvature)
+        {
+            peaks.indices.push_back(index);
+            peaks.heights.push_back(value);
+            peaks.positions.push_back(position);
+            peaks.curvatures.push_back(curvature);
+        }
+
+        template<class Emit>
+        void scan(const NumericalData<ValueType, Size>& data, Emit&& emit) const
+        {
+            using Values = Eigen::Array<ValueType, Eigen::Dynamic, 1>;
+            scanValues(Eigen::Map<const Values>(data.data(), data.size()), emit);
+        }
+
+        template<class Emit>
+        void scan(const ConstNumericalView<ValueType>& data, Emit&& emit) const
+        {
+            using Values = Eigen::Array<ValueType, Eigen::Dynamic, 1>;
+            scanValues(Eigen::Map<const Values, Eigen::Unaligned, Eigen::InnerStride<>>(
+                data.data(), data.size(), Eigen::InnerStride<>(data.stride())), emit);
+        }
+
+        template<class Values, class Emit>
+        void scanValues(const Values& values, Emit&& emit) const
+        {
+            const int size = static_cast<int>(values.size());
+            if(!_height.fits(size)){
+                throw PeakingDuckException("Peak condition limits must have one value or one per point.");
+            }
+            const int half = _windowsize/2;
+            const int ninterior = size - 2*half;
+            if(ninterior < 2){
+                return;
+            }
+
+            // the derivatives of the block after those of the last point 
+            // of the previous block, for the crossings between blocks
+            const NumericalData<ValueType>& first = _first->weights;
+            const NumericalData<ValueType>& second = _second->weights;
+            Eigen::Array<ValueType, BlockSize + 1, 1> slopes;
+            Eigen::Array<ValueType, BlockSize + 1, 1> curves;
+            for(int start=0; start<ninterior; start+=BlockSize){
+                const int n = std::min(static_cast<int>(BlockSize), ninterior - start);
+                auto slope = slopes.segment(1, n);
+                auto curve = curves.segment(1, n);
+                slope = first[0]*values.segment(start, n);
+                curve = second[0]*values.segment(start, n);
+                for(int k=1; k<_windowsize; ++k){
+                    const auto window = values.segment(start + k, n);
+                    slope += first[k]*window;
+                    curve += second[k]*window;
+                }
+
+                for(int j=(start == 0 ? 1 : 0); j<n; ++j){
+                    if(slopes[j] > 0 && !(slopes[j+1] > 0)){
+                        const ValueType fraction = slopes[j]/(slopes[j] - slopes[j+1]);
+                        const ValueType curvature = -(curves[j] + fraction*(curves[j+1] - curves[j]));
+                        if(curvature > _minCurvature){
+                            const int point = half + start + j - 1;
+                            const int index = point + (fraction >= static_cast<ValueType>(0.5) ? 1 : 0);
+                            const ValueType value = values[index];
+                            if(!_height.active() || _height.accepts(value, index)){
+                                emit(index, value, static_cast<ValueType>(point) + fraction, curvature);
+                            }
+                        }
+                    }
+                }
+                slopes[0] = slopes[n];
+                curves[0] = curves[n];
+            }
+        }
+
+        const int _windowsize;
+        const int _order;
+        const PeakCondition<ValueType> _height;
+        const ValueType _minCurvature;
+        std::shared_ptr<const SavitzkyGolayCoefficients<ValueType>> _first;
+        std::shared_ptr<const SavitzkyGolayCoefficients<ValueType>> _second;
+    };    
+
+    template<typename ValueType, int Size>
+    constexpr int GradientPeakFinder<ValueType, Size>::BlockSize;
+
 PEAKINGDUCK_NAMESPACE_END
 PEAKINGDUCK_NAMESPACE_END
 
@@ -14,11 +14,14 @@
 #ifndef CORE_PROCESS_HPP
 #define CORE_PROCESS_HPP
 
+#include <algorithm>
+#include <cassert>
 #include <memory>
 #include <vector>
 
 #include "common.hpp"
 #include "core/numerical.hpp"
+#include "core/batch.hpp"
 
 PEAKINGDUCK_NAMESPACE_START(peakingduck)
 PEAKINGDUCK_NAMESPACE_START(core)
@@ -37,6 +40,38 @@ PEAKINGDUCK_NAMESPACE_START(core)
         
         virtual NumericalData<T, Size> 
         go(const NumericalData<T, Size>& data) const = 0;
+
+        /*!
+           @brief Operates on a view of the data.
+
+           By default the view is copied and passed to the 
+           array version of go, processes that can work directly
+           on views should override this to avoid the copy.
+        */
+        virtual NumericalData<T, Size> 
+        go(const ConstNumericalView<T>& data) const
+        {
+            return go(NumericalData<T, Size>(data));
+        }
+
+        /*!
+           @brief Operates on every spectrum in a batch.
+
+           By default each spectrum is passed (as a view) to go
+           in turn, processes that can work on the whole batch 
+           at once should override this.
+        */
+        virtual NumericalBatch<T> 
+        go(const NumericalBatch<T>& batch) const
+        {
+            NumericalBatch<T> processed(batch.nchannels(), batch.nspectra());
+            for(int i=0; i<batch.nspectra(); ++i){
+                const NumericalData<T, Size> result = go(batch.spectrum(i));
+                assert(result.size() == batch.nchannels() && "Process must not change the size of a spectrum in a batch.");
+                std::copy(result.begin(), result.end(), processed.spectrum(i).begin());
+            }
+            return processed;
+        }
     };    
 
     /*!
@@ -53,6 +88,24 @@ PEAKINGDUCK_NAMESPACE_START(core)
         virtual NumericalData<T, Size> 
         run(const NumericalData<T, Size>& data) const = 0;
 
+        /*!
+           @brief Run on every spectrum in a batch.
+           By default each spectrum is passed to run in turn,
+           managers that can work on the whole batch at once 
+           should override this.
+        */
+        virtual NumericalBatch<T> 
+        run(const NumericalBatch<T>& batch) const
+        {
+            NumericalBatch<T> processed(batch.nchannels(), batch.nspectra());
+            for(int i=0; i<batch.nspectra(); ++i){
+                const NumericalData<T, Size> result = run(batch.spectrum(i));
+                assert(result.size() == batch.nchannels() && "Process manager must not change the size of a spectrum in a batch.");
+                std::copy(result.begin(), result.end(), processed.spectrum(i).begin());
+            }
+            return processed;
+        }
+
         virtual size_t size() const = 0;
 
         virtual void reset() = 0;
@@ -82,6 +135,15 @@ PEAKINGDUCK_NAMESPACE_START(core)
             return processedData;
         }
 
+        NumericalBatch<T> 
+        run(const NumericalBatch<T>& batch) const override{
+            NumericalBatch<T> processedBatch = batch;
+            for(auto& process: _processes){
+                processedBatch = process->go(processedBatch);
+            }
+            return processedBatch;
+        }
+
         inline size_t size() const override{
             return _processes.size();
         }
@@ -0,0 +1,407 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Defines rolling (order statistic) quantile and median filters,
+    robust to spikes, for spike removal and baseline estimation.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef CORE_QUANTILE_HPP
+#define CORE_QUANTILE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+#include <set>
+#include <vector>
+
+#include "common.hpp"
+#include "exceptions.hpp"
+#include "core/numerical.hpp"
+#include "core/process.hpp"
+#include "core/smoothing.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(core)
+
+    /*!
+       @brief A quantile of a window of values that changes one value at a time,
+       O(log W) for each insert or erase.
+
+        The values are split in two ordered sets, the lower holding the
+        k+1 smallest where k = floor(quantile*(n-1)), so the quantile is
+        the largest of the lower set, interpolated linearly towards the
+        smallest of the upper set as numpy.quantile (the default 'linear').
+
+        The values must not be NaN.
+    */
+    template<typename T=DefaultType>
+    class SlidingQuantile
+    {
+        public:
+            explicit SlidingQuantile(double quantile=0.5) : _quantile(quantile)
+            {
+                if(!(quantile >= 0.0 && quantile <= 1.0)){
+                    throw PeakingDuckException("Quantile must be between 0 and 1.");
+                }
+            }
+
+            inline int size() const
+            {
+                return static_cast<int>(_lower.size() + _upper.size());
+            }
+
+            inline void clear()
+            {
+                _lower.clear();
+                _upper.clear();
+            }
+
+            void insert(T value)
+            {
+                if(_lower.empty() || !(*_lower.rbegin() < value)){
+                    _lower.insert(value);
+                }
+                else{
+                    _upper.insert(value);
+                }
+                balance();
+            }
+
+            // the value must be in the window
+            void erase(T value)
+            {
+                // all of the lower set are <= all of the upper set, so any
+                // value not above the largest of the lower set is in it
+                if(!_lower.empty() && !(*_lower.rbegin() < value)){
+                    _lower.erase(_lower.find(value));
+                }
+                else{
+                    _upper.erase(_upper.find(value));
+                }
+                balance();
+            }
+
+            // the window must not be empty
+            T value() const
+            {
+                const T lower = *_lower.rbegin();
+                const double position = _quantile*(size() - 1);
+                const T fraction = static_cast<T>(position - std::floor(position));
+                if(fraction > 0 && !_upper.empty()){
+                    return lower + fraction*(*_upper.begin() - lower);
+                }
+                return lower;
+            }
+
+        private:
+            // move values across until the lower set has k+1
+            void balance()
+            {
+                const size_t target = size() > 0 ? static_cast<size_t>(std::floor(_quantile*(size() - 1))) + 1 : 0;
+                while(_lower.size() > target){
+                    auto largest = std::prev(_lower.end());
+                    _upper.insert(*largest);
+                    _lower.erase(largest);
+                }
+                while(_lower.size() < target){
+                    _lower.insert(*_upper.begin());
+                    _upper.erase(_upper.begin());
+                }
+            }
+
+            double _quantile;
+            std::multiset<T> _lower;
+            std::multiset<T> _upper;
+    };
+
+    /*!
+       @brief A quantile of a small window of values that changes one value
+       at a time, kept sorted in a contiguous buffer, O(W) moves for each
+       insert or erase but no allocation. Quicker than a SlidingQuantile
+       for windows up to SizeLimit.
+
+        The quantile is interpolated linearly as numpy.quantile (the 
+        default 'linear'), the values must not be NaN.
+    */
+    template<typename T=DefaultType>
+    class SortedQuantile
+    {
+        public:
+            // the largest window kept sorted in a buffer, the buffer moves
+            // are quicker than the set updates up to about 2000 (benchmarks)
+            static constexpr int SizeLimit = 2049;
+
+            explicit SortedQuantile(double quantile=0.5, int capacity=SizeLimit) : _quantile(quantile)
+            {
+                if(!(quantile >= 0.0 && quantile <= 1.0)){
+                    throw PeakingDuckException("Quantile must be between 0 and 1.");
+                }
+                _values.reserve(capacity + 1);
+            }
+
+            inline int size() const
+            {
+                return static_cast<int>(_values.size());
+            }
+
+            inline void clear()
+            {
+                _values.clear();
+            }
+
+            inline void insert(T value)
+            {
+                _values.insert(std::upper_bound(_values.begin(), _values.end(), value), value);
+            }
+
+            // the value must be in the window
+            inline void erase(T value)
+            {
+                _values.erase(std::lower_bound(_values.begin(), _values.end(), value));
+            }
+
+            // the window must not be empty
+            inline T value() const
+            {
+                const double position = _quantile*(_values.size() - 1);
+                const size_t k = static_cast<size_t>(std::floor(position));
+                const T fraction = static_cast<T>(position - k);
+                if(fraction > 0 && k + 1 < _values.size()){
+                    return _values[k] + fraction*(_values[k+1] - _values[k]);
+                }
+                return _values[k];
+            }
+
+        private:
+            double _quantile;
+            std::vector<T> _values;
+    };
+
+    template<typename T>
+    constexpr int SortedQuantile<T>::SizeLimit;
+
+    /*!
+       @brief A quantile of a window of one array that changes one point at
+       a time, the points are ranked once, O(N log N), and the window is a
+       count per rank (a Fenwick tree), O(log N) for each insert, erase 
+       or quantile with no allocation. Quicker than a SlidingQuantile for
+       wide windows sliding over the whole array.
+
+        The window holds the points (indices), not the values. The quantile
+        is interpolated linearly as numpy.quantile (the default 'linear'),
+        the values must not be NaN.
+    */
+    template<typename T=DefaultType>
+    class RankedQuantile
+    {
+        public:
+            RankedQuantile(const ConstNumericalView<T>& values, double quantile=0.5) :
+                _quantile(quantile), _sorted(values.size()), _ranks(values.size()), _counts(values.size() + 1, 0)
+            {
+                if(!(quantile >= 0.0 && quantile <= 1.0)){
+                    throw PeakingDuckException("Quantile must be between 0 and 1.");
+                }
+                std::vector<int> order(values.size());
+                std::iota(order.begin(), order.end(), 0);
+                std::stable_sort(order.begin(), order.end(), [&](int a, int b){ return values[a] < values[b]; });
+                for(int rank=0; rank<values.size(); ++rank){
+                    _sorted[rank] = values[order[rank]];
+                    _ranks[order[rank]] = rank;
+                }
+                _top = 1;
+                while(2*_top <= values.size()){
+                    _top *= 2;
+                }
+            }
+
+            inline int size() const
+            {
+                return _size;
+            }
+
+            inline void insert(int index)
+            {
+                update(_ranks[index], 1);
+            }
+
+            // the point must be in the window
+            inline void erase(int index)
+            {
+                update(_ranks[index], -1);
+            }
+
+            // the window must not be empty
+            T value() const
+            {
+                const double position = _quantile*(_size - 1);
+                const int k = static_cast<int>(std::floor(position));
+                const T fraction = static_cast<T>(position - k);
+                const T lower = _sorted[smallest(k)];
+                if(fraction > 0 && k + 1 < _size){
+                    return lower + fraction*(_sorted[smallest(k + 1)] - lower);
+                }
+                return lower;
+            }
+
+        private:
+            inline void update(int rank, int change)
+            {
+                _size += change;
+                for(int i=rank+1; i<static_cast<int>(_counts.size()); i+=i&(-i)){
+                    _counts[i] += change;
+                }
+            }
+
+            // the rank of the k-th smallest (from 0) in the window
+            int smallest(int k) const
+            {
+                int position = 0;
+                for(int step=_top; step>0; step/=2){
+                    if(position + step < static_cast<int>(_counts.size()) && _counts[position + step] <= k){
+                        position += step;
+                        k -= _counts[position];
+                    }
+                }
+                return position;
+            }
+
+            double _quantile;
+            std::vector<T> _sorted;
+            std::vector<int> _ranks;
+            std::vector<int> _counts;
+            int _top = 1;
+            int _size = 0;
+    };
+
+    /*!
+       @brief Rolling quantile filter, the quantile of the window
+       data(i-windowsize, i+windowsize+1) at each point.
+
+        Robust to spikes narrower than the window, as a spike remover
+        (quantile 0.5, see RollingMedianFilter) or a baseline estimate
+        (a low quantile with a window wider than the peaks). The window
+        is updated one value in and one out rather than copied and
+        sorted at every point, kept sorted in a buffer (SortedQuantile)
+        for windows up to SortedQuantile::SizeLimit and in a 
+        SlidingQuantile, O(N log W), for wider.
+
+        With EdgeMode::Truncate the quantile of the part of the window
+        in the data is used at the ends, otherwise they are kept.
+    */
+    template<typename T=DefaultType, int Size=ArrayTypeDynamic>
+    struct RollingQuantileFilter : public IProcess<T, Size>
+    {
+        explicit RollingQuantileFilter(int windowsize, double quantile=0.5, EdgeMode edgemode=EdgeMode::Keep)
+        : _windowsize(windowsize), _quantile(quantile), _edgemode(edgemode)
+        {
+            if(windowsize < 0){
+                throw PeakingDuckException("Rolling quantile window size must not be negative.");
+            }
+            if(!(quantile >= 0.0 && quantile <= 1.0)){
+                throw PeakingDuckException("Quantile must be between 0 and 1.");
+            }
+        }
+
+        inline double quantile() const
+        {
+            return _quantile;
+        }
+
+        NumericalData<T, Size>
+        go(const NumericalData<T, Size>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalData<T, Size>
+        go(const ConstNumericalView<T>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalBatch<T>
+        go(const NumericalBatch<T>& batch) const override final
+        {
+            NumericalBatch<T> filtered = batch;
+            for(int i=0; i<batch.nspectra(); ++i){
+                NumericalView<T> output = filtered.spectrum(i);
+                slide(batch.spectrum(i), output);
+            }
+            return filtered;
+        };
+
+      private:
+        template<typename DataType>
+        NumericalData<T, Size> apply(const DataType& data) const
+        {
+            NumericalData<T, Size> filtered = data;
+            slide(data, filtered);
+            return filtered;
+        }
+
+        // the output must start as a copy of the data (for the kept edges)
+        template<typename DataType, typename OutputType>
+        void slide(const DataType& data, OutputType& filtered) const
+        {
+            if(2*_windowsize + 1 <= SortedQuantile<T>::SizeLimit){
+                SortedQuantile<T> window(_quantile, 2*_windowsize + 1);
+                slide(data, filtered, window);
+            }
+            else{
+                SlidingQuantile<T> window(_quantile);
+                slide(data, filtered, window);
+            }
+        }
+
+        template<typename DataType, typename OutputType, class Window>
+        void slide(const DataType& data, OutputType& filtered, Window& window) const
+        {
+            const int size = data.size();
+
+            // the window [lower, upper)
+            int lower = 0;
+            int upper = 0;
+            for(int i=0; i<size; ++i){
+                const int newupper = std::min(size, i+_windowsize+1);
+                const int newlower = std::max(0, i-_windowsize);
+                for(; upper<newupper; ++upper){
+                    window.insert(data[upper]);
+                }
+                for(; lower<newlower; ++lower){
+                    window.erase(data[lower]);
+                }
+                if(_edgemode == EdgeMode::Truncate || upper - lower == 2*_windowsize + 1){
+                    filtered[i] = window.value();
+                }
+            }
+        }
+
+        const int _windowsize;
+        const double _quantile;
+        const EdgeMode _edgemode;
+    };
+
+    /*!
+       @brief Rolling median filter, the median of the window
+       data(i-windowsize, i+windowsize+1), removes spikes narrower
+       than the window.
+    */
+    template<typename T=DefaultType, int Size=ArrayTypeDynamic>
+    struct RollingMedianFilter : public RollingQuantileFilter<T, Size>
+    {
+        explicit RollingMedianFilter(int windowsize, EdgeMode edgemode=EdgeMode::Keep)
+        : RollingQuantileFilter<T, Size>(windowsize, 0.5, edgemode)
+        {}
+    };
+
+PEAKINGDUCK_NAMESPACE_END
+PEAKINGDUCK_NAMESPACE_END
+
+#endif // CORE_QUANTILE_HPP
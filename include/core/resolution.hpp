@@ -0,0 +1,287 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Defines the detector resolution (FWHM) calibration and the energy
+    dependent Gaussian smoothing it drives.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef CORE_RESOLUTION_HPP
+#define CORE_RESOLUTION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "common.hpp"
+#include "exceptions.hpp"
+#include "core/numerical.hpp"
+#include "core/process.hpp"
+#include "core/smoothing.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(core)
+
+    /*!
+       @brief The full width at half maximum (FWHM) of the detector response
+       as a function of energy, FWHM(E) = sqrt(a + b*E + c*E^2).
+
+        The usual form for semiconductor detectors, a for the electronic
+        noise, b for the statistics of the charge carriers and c for the
+        collection. The energy and FWHM are in the units of the bin edges.
+    */
+    struct FWHMCalibration
+    {
+        FWHMCalibration(double a, double b=0.0, double c=0.0) : a(a), b(b), c(c)
+        {}
+
+        inline double operator()(double energy) const
+        {
+            return std::sqrt(std::max(0.0, a + b*energy + c*energy*energy));
+        }
+
+        double a;
+        double b;
+        double c;
+    };
+
+    /*!
+       @brief The Gaussian kernel of every channel for one resolution calibration
+       and binning, built once and reused for any number of spectra.
+
+        The kernel of a channel is the Gaussian with the FWHM at the centre
+        of the channel integrated over each bin (so uneven binning is
+        handled), out to truncate standard deviations either side and
+        scaled by its sum. The kernels are stored one after the other in a
+        single array, with the first channel and offset of each, so applying
+        the bank is a single pass of (vectorized) dot products.
+
+        With EdgeMode::Keep the channels whose kernel does not fit in the
+        data are left as they are, with EdgeMode::Truncate their kernel is
+        the part in the data, scaled by its sum.
+
+        Immutable once built, so can be shared between threads and smoothers.
+    */
+    template<typename T=DefaultType>
+    class GaussianKernelBank
+    {
+        public:
+            using value_type = T;
+
+            /*!
+                @brief Build the bank from the bin edges (nchannels + 1, increasing)
+                and the FWHM as a function of energy (i.e. FWHMCalibration).
+            */
+            template<typename XScalar>
+            GaussianKernelBank(const NumericalData<XScalar>& edges, const std::function<double(double)>& fwhm,
+                               double truncate=4.0, EdgeMode edgemode=EdgeMode::Keep)
+            {
+                const int nchannels = static_cast<int>(edges.size()) - 1;
+                if(nchannels < 1){
+                    throw PeakingDuckException("Kernel bank needs at least two bin edges.");
+                }
+                if(truncate <= 0.0){
+                    throw PeakingDuckException("Kernel bank truncate must be positive.");
+                }
+                std::vector<double> x(edges.begin(), edges.end());
+                if(!std::is_sorted(x.begin(), x.end())){
+                    throw PeakingDuckException("Kernel bank bin edges must be increasing.");
+                }
+
+                _first.resize(nchannels);
+                _offsets.resize(nchannels + 1);
+                _offsets[0] = 0;
+                std::vector<T> weights;
+                for(int i=0; i<nchannels; ++i){
+                    const double centre = 0.5*(x[i] + x[i+1]);
+                    const double sigma = fwhm(centre)/FWHMPerSigma;
+                    if(!(sigma > 0.0)){
+                        throw PeakingDuckException("Kernel bank FWHM must be positive.");
+                    }
+
+                    // the channels that overlap [centre - truncate*sigma, centre + truncate*sigma]
+                    const double lower = centre - truncate*sigma;
+                    const double upper = centre + truncate*sigma;
+                    const bool fits = lower >= x.front() && upper <= x.back();
+                    int first = i;
+                    int last = i + 1;
+                    if(fits || edgemode == EdgeMode::Truncate){
+                        first = std::max(0, static_cast<int>(std::upper_bound(x.begin(), x.end(), lower) - x.begin()) - 1);
+                        last = std::min(nchannels, static_cast<int>(std::lower_bound(x.begin(), x.end(), upper) - x.begin()));
+                        last = std::max(last, i + 1);
+                    }
+
+                    const size_t offset = weights.size();
+                    if(last - first == 1){
+                        weights.push_back(1);
+                    }
+                    else{
+                        double sum = 0.0;
+                        std::vector<double> kernel(last - first);
+                        const double scale = 1.0/(std::sqrt(2.0)*sigma);
+                        for(int j=first; j<last; ++j){
+                            kernel[j-first] = 0.5*(std::erf((x[j+1] - centre)*scale) - std::erf((x[j] - centre)*scale));
+                            sum += kernel[j-first];
+                        }
+                        for(double weight: kernel){
+                            weights.push_back(static_cast<T>(weight/sum));
+                        }
+                    }
+                    _first[i] = first;
+                    _offsets[i+1] = static_cast<int>(offset) + (last - first);
+                }
+                _weights = NumericalData<T>(weights);
+            }
+
+            inline int nchannels() const
+            {
+                return static_cast<int>(_first.size());
+            }
+
+            // the first channel of the kernel of the channel
+            inline int first(int channel) const
+            {
+                return _first[channel];
+            }
+
+            // the weights of the kernel of the channel
+            inline ConstNumericalView<T> kernel(int channel) const
+            {
+                return ConstNumericalView<T>(_weights.data() + _offsets[channel], _offsets[channel+1] - _offsets[channel]);
+            }
+
+            // the total number of weights over all kernels
+            inline int size() const
+            {
+                return static_cast<int>(_weights.size());
+            }
+
+            /*!
+                @brief Smooth the data, writing into the given output (array or view).
+                Both must be nchannels long.
+            */
+            template<class Output>
+            void apply(const ConstNumericalView<T>& data, Output& output) const
+            {
+                if(data.size() != nchannels() || output.size() != nchannels()){
+                    throw PeakingDuckException("Kernel bank must be applied to data with the same number of channels.");
+                }
+
+                using Vector = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+                if(data.stride() == 1){
+                    gather(Eigen::Map<const Vector>(data.data(), data.size()), output);
+                }
+                else{
+                    gather(Vector(Eigen::Map<const Vector, Eigen::Unaligned, Eigen::InnerStride<>>(
+                        data.data(), data.size(), Eigen::InnerStride<>(data.stride()))), output);
+                }
+            }
+
+            /*!
+                @brief Smooth the data, returning a new array.
+            */
+            NumericalData<T> apply(const ConstNumericalView<T>& data) const
+            {
+                NumericalData<T> output(data.size());
+                apply(data, output);
+                return output;
+            }
+
+            // sqrt(8 ln 2)
+            static constexpr double FWHMPerSigma = 2.3548200450309493;
+
+        private:
+            // the dot product of each kernel with the (contiguous) data under it
+            template<class Values, class Output>
+            void gather(const Values& values, Output& output) const
+            {
+                using Vector = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+                const T* weights = _weights.data();
+                for(int i=0; i<nchannels(); ++i){
+                    const int n = _offsets[i+1] - _offsets[i];
+                    output[i] = Eigen::Map<const Vector>(weights + _offsets[i], n).dot(values.segment(_first[i], n));
+                }
+            }
+
+            std::vector<int> _first;
+            std::vector<int> _offsets;
+            NumericalData<T> _weights;
+    };
+
+    template<typename T>
+    constexpr double GaussianKernelBank<T>::FWHMPerSigma;
+
+    /*!
+       @brief Energy dependent Gaussian smoother, the width follows the detector
+       resolution (FWHM(E)) across the spectrum.
+
+        The kernels are built once (GaussianKernelBank) for the calibration
+        and binning, and shared by copies of the smoother, so each spectrum
+        is a single pass. Only applies to data with the number of channels
+        of the binning.
+    */
+    template<typename T=DefaultType, int Size=ArrayTypeDynamic>
+    struct ResolutionSmoother : public IProcess<T, Size>
+    {
+        explicit ResolutionSmoother(const std::shared_ptr<const GaussianKernelBank<T>>& bank)
+        : _bank(bank)
+        {}
+
+        template<typename XScalar>
+        ResolutionSmoother(const NumericalData<XScalar>& edges, const std::function<double(double)>& fwhm,
+                           double truncate=4.0, EdgeMode edgemode=EdgeMode::Keep)
+        : _bank(std::make_shared<const GaussianKernelBank<T>>(edges, fwhm, truncate, edgemode))
+        {}
+
+        inline const GaussianKernelBank<T>& bank() const
+        {
+            return *_bank;
+        }
+
+        NumericalData<T, Size>
+        go(const NumericalData<T, Size>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalData<T, Size>
+        go(const ConstNumericalView<T>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalBatch<T>
+        go(const NumericalBatch<T>& batch) const override final
+        {
+            NumericalBatch<T> smoothed(batch.nchannels(), batch.nspectra());
+            for(int i=0; i<batch.nspectra(); ++i){
+                NumericalView<T> output = smoothed.spectrum(i);
+                _bank->apply(batch.spectrum(i), output);
+            }
+            return smoothed;
+        };
+
+      private:
+        NumericalData<T, Size> apply(const ConstNumericalView<T>& data) const
+        {
+            NumericalData<T, Size> smoothed(data.size());
+            _bank->apply(data, smoothed);
+            return smoothed;
+        }
+
+        std::shared_ptr<const GaussianKernelBank<T>> _bank;
+    };
+
+PEAKINGDUCK_NAMESPACE_END
+PEAKINGDUCK_NAMESPACE_END
+
+#endif // CORE_RESOLUTION_HPP
@@ -13,45 +13,175 @@
 #ifndef CORE_SMOOTHING_HPP
 #define CORE_SMOOTHING_HPP
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "common.hpp"
+#include "exceptions.hpp"
 #include "core/numerical.hpp"
 #include "core/process.hpp"
+#include "core/stencil.hpp"
 
 PEAKINGDUCK_NAMESPACE_START(peakingduck)
 PEAKINGDUCK_NAMESPACE_START(core)
 
+    /*!
+       @brief How a smoother treats the points within a window size of 
+       either end of the data, where the full window does not fit.
+
+        Keep - the values are left as they are (the original behaviour)
+        Truncate - the average over the part of the window that is in the data
+    */
+    enum class EdgeMode
+    {
+        Keep,
+        Truncate
+    };
+
     /*!
        @brief Simple moving average smoother
 
-        Can we support windowsize given at compile time too?
-        It would certainly help with unit tests.
+        The window is slid along the data keeping a running (compensated) 
+        sum, adding the value entering and subtracting the value leaving, 
+        so it is O(N) regardless of the window size and only allocates the
+        output. The result is the same as averaging each window to within 
+        floating point rounding.
+
+        See FixedMovingAverageSmoother for a window size given at compile time.
     */
     template<typename T=DefaultType, int Size=ArrayTypeDynamic>
     struct MovingAverageSmoother : public IProcess<T, Size>
     {
 
-        explicit MovingAverageSmoother(int windowsize) : _windowsize(windowsize)
+        explicit MovingAverageSmoother(int windowsize, EdgeMode edgemode=EdgeMode::Keep) 
+        : _windowsize(windowsize), _edgemode(edgemode)
         {}
 
         NumericalData<T, Size> 
         go(const NumericalData<T, Size>& data) const override final
         {
-            NumericalData<T, Size> smoothed = data;
+            return apply(data);
+        };
 
-            // loop over array and get the mean from nearby points
-            for(int i=_windowsize; i<data.size()-_windowsize; ++i){
-                smoothed[i] = data(i-_windowsize, i+_windowsize+1).mean();
-            }
+        NumericalData<T, Size> 
+        go(const ConstNumericalView<T>& data) const override final
+        {
+            return apply(data);
+        };
 
+        NumericalBatch<T> 
+        go(const NumericalBatch<T>& batch) const override final
+        {
+            // smooth each spectrum straight into the copy, no other allocations
+            NumericalBatch<T> smoothed = batch;
+            for(int i=0; i<batch.nspectra(); ++i){
+                NumericalView<T> output = smoothed.spectrum(i);
+                slide(batch.spectrum(i), output);
+            }
             return smoothed;
         };
 
       private:
+        template<typename DataType>
+        NumericalData<T, Size> apply(const DataType& data) const
+        {
+            NumericalData<T, Size> smoothed = data;
+            slide(data, smoothed);
+            return smoothed;
+        }
+
+        // the output must start as a copy of the data (for the kept edges)
+        template<typename DataType, typename OutputType>
+        void slide(const DataType& data, OutputType& smoothed) const
+        {
+            const int size = data.size();
+            const int ninterior = size - 2*_windowsize;
+            const T width = static_cast<T>(2*_windowsize + 1);
+
+            // the sum over the window [lower, upper)
+            CompensatedSum<T> sum;
+            int lower = 0;
+            int upper = 0;
+
+            // the ends, where the window is truncated
+            auto edge = [&](int i){
+                const int newlower = std::max(0, i-_windowsize);
+                const int newupper = std::min(size, i+_windowsize+1);
+                for(; upper<newupper; ++upper){
+                    sum.add(data[upper]);
+                }
+                for(; lower<newlower; ++lower){
+                    sum.subtract(data[lower]);
+                }
+                if(_edgemode == EdgeMode::Truncate){
+                    smoothed[i] = sum.value()/static_cast<T>(upper - lower);
+                }
+            };
+
+            int i = 0;
+            for(; i<std::min(_windowsize, size); ++i){
+                edge(i);
+            }
+
+            // the full windows, one value in and one out
+            if(ninterior > 0){
+                for(; upper<i+_windowsize+1; ++upper){
+                    sum.add(data[upper]);
+                }
+                smoothed[i] = sum.value()/width;
+                for(++i; i<_windowsize+ninterior; ++i){
+                    sum.slide(data[i+_windowsize], data[i-_windowsize-1]);
+                    smoothed[i] = sum.value()/width;
+                }
+                lower = i-_windowsize-1;
+                upper = i+_windowsize;
+            }
+
+            for(; i<size; ++i){
+                edge(i);
+            }
+        }
+
         const int _windowsize;
+        const EdgeMode _edgemode;
     };  
 
+    /*!
+       @brief The weights of the weighted moving average smoother, 
+       scaled by their sum.
+
+        The triangle of length windowsize (see WeightedMovingAverageSmoother)
+        centred (as numpy.convolve mode='same') in an array of size 
+        windowsize*2 + 1, the weights of data(i-windowsize, i+windowsize+1).
+
+        Shared by the dynamic and fixed window smoothers so they agree.
+    */
+    template<typename T=DefaultType>
+    NumericalData<T> weightedMovingAverageWeights(int windowsize)
+    {
+        NumericalData<T> weights = NumericalData<T>::Zero((windowsize*2)+1);
+
+        const int offset = windowsize - windowsize/2;
+        for(int i=0;i<ceil(windowsize/2.0);++i){
+            weights[offset+i] = static_cast<double>(i+1);
+        }
+        for(int i=floor(windowsize/2.0);i>0;--i){
+            weights[offset+windowsize-i] = static_cast<double>(i);                
+        }
+
+        // scale by the sum
+        weights *= 1.0/weights.sum();
+        return weights;
+    }
+
     /*!
        @brief Weighted moving average smoother
 
@@ -63,46 +193,517 @@ PEAKINGDUCK_NAMESPACE_START(core)
             if N=5, weights=[1,2,3,2,1] -> [1/9, 2/9, 3/9, 2/9, 1/9]
             ....
 
+        centred on each point as numpy.convolve(data, weights, mode='same'),
+        the first and last windowsize points are left as they are.
+
+        The triangle of length N is two boxes in cascade, 
+        box(N/2+1)*box((N+1)/2), so each box is done as the difference of 
+        prefix sums (restarted every block, so the sums do not grow with 
+        the data) which is O(N) for any window size, vectorized and only 
+        allocates the output and two block sized buffers.
     */
     template<typename T=DefaultType, int Size=ArrayTypeDynamic>
     struct WeightedMovingAverageSmoother : public IProcess<T, Size>
     {
-        explicit WeightedMovingAverageSmoother(int windowsize) : _windowsize(windowsize)
+        explicit WeightedMovingAverageSmoother(int windowsize) : _windowsize(windowsize),
+            _first(windowsize/2 + 1), _second((windowsize + 1)/2)
+        {}
+
+        NumericalData<T, Size> 
+        go(const NumericalData<T, Size>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalData<T, Size> 
+        go(const ConstNumericalView<T>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalBatch<T> 
+        go(const NumericalBatch<T>& batch) const override final
+        {
+            // smooth each spectrum straight into the copy
+            NumericalBatch<T> smoothed = batch;
+            for(int i=0; i<batch.nspectra(); ++i){
+                NumericalView<T> output = smoothed.spectrum(i);
+                cascade(batch.spectrum(i), output);
+            }
+            return smoothed;
+        };
+
+      private:
+        template<typename DataType>
+        NumericalData<T, Size> apply(const DataType& data) const
         {
-            // weights should be of size windowsize*2 + 1
-            // because we take windowsize either side and then including 
-            // the current point
-            _weights = NumericalData<T>((_windowsize*2)+1);
+            NumericalData<T, Size> smoothed = data;
+            cascade(data, smoothed);
+            return smoothed;
+        }
 
-            // determine weights at construction
-            for(int i=0;i<ceil(_windowsize/2.0);++i){
-                _weights[i] = static_cast<double>(i+1);
+        // the output must start as a copy of the data (for the kept edges)
+        template<typename DataType, typename OutputType>
+        void cascade(const DataType& data, OutputType& smoothed) const
+        {
+            constexpr int BlockSize = 1024;
+            const int ninterior = data.size() - 2*_windowsize;
+            if(ninterior <= 0){
+                return;
             }
-            for(int i=floor(_windowsize/2.0);i>0;--i){
-                _weights[_windowsize-i] = static_cast<double>(i);                
+
+            // each block of outputs needs the first box over n+second-1
+            // points and so the data over n+first+second-2 points
+            const int centre = (_windowsize - 1)/2;
+            const int nhalo = _first + _second - 2;
+            const T norm = static_cast<T>(1.0/(static_cast<double>(_first)*_second));
+            Array1D<T> sums(BlockSize + nhalo + 1);
+            Array1D<T> boxed(BlockSize + _second);
+
+            for(int start=_windowsize; start<_windowsize+ninterior; start+=BlockSize){
+                const int n = std::min(BlockSize, _windowsize + ninterior - start);
+                const int lower = start + centre - nhalo;
+                const int nboxed = n + _second - 1;
+
+                // relative to the first value, as the weights sum to one, 
+                // so a large background does not cost precision
+                const T base = data[lower];
+                sums[0] = 0;
+                for(int k=0; k<n+nhalo; ++k){
+                    sums[k+1] = sums[k] + (data[lower+k] - base);
+                }
+                boxed.head(nboxed) = sums.segment(_first, nboxed) - sums.head(nboxed);
+
+                for(int k=0; k<nboxed; ++k){
+                    sums[k+1] = sums[k] + boxed[k];
+                }
+                boxed.head(n) = (sums.segment(_second, n) - sums.head(n))*norm + base;
+                std::copy(boxed.data(), boxed.data() + n, smoothed.begin() + start);
             }
+        }
+
+        const int _windowsize;
+        const int _first;
+        const int _second;
+    };  
+
+    /*!
+       @brief Applies a window kernel to the interior of the data (all but
+       the first and last windowsize points, which are left as they are).
+
+       The data is mapped as contiguous where possible so that the kernel
+       can be vectorized.
+    */
+    template<class Kernel, typename T, int Size>
+    void applyFixedWindow(const Kernel& kernel, int windowsize, 
+                          const ConstNumericalView<T>& data, NumericalData<T, Size>& smoothed)
+    {
+        const int ninterior = data.size() - 2*windowsize;
+        if(ninterior <= 0){
+            return;
+        }
 
-            // scale by the sum
-            _weights *= 1.0/_weights.sum();
+        Eigen::Map<Array1D<T>> interior(smoothed.data() + windowsize, ninterior);
+        if(data.stride() == 1){
+            kernel.apply(Eigen::Map<const Array1D<T>>(data.data(), data.size()), interior);
         }
+        else{
+            kernel.apply(Eigen::Map<const Array1D<T>, Eigen::Unaligned, Eigen::InnerStride<>>(data.data(), data.size(), Eigen::InnerStride<>(data.stride())), interior);
+        }
+    }
+
+    /*!
+       @brief Moving average smoother with the window size known at compile time.
+
+        Gives the same result as MovingAverageSmoother(WindowSize, edgemode)
+        (to within floating point rounding), but the window sum is a single
+        unrolled expression (WindowSumStencil), so the whole interior is 
+        smoothed in one vectorized pass rather than one reduction per point.
+
+        See makeMovingAverageSmoother to pick one at runtime.
+    */
+    template<int WindowSize, typename T=DefaultType, int Size=ArrayTypeDynamic>
+    struct FixedMovingAverageSmoother : public IProcess<T, Size>
+    {
+        static_assert(WindowSize > 0, "Window size must be positive.");
+
+        static constexpr int windowsize = WindowSize;
+
+        explicit FixedMovingAverageSmoother(EdgeMode edgemode=EdgeMode::Keep) : _edgemode(edgemode)
+        {}
 
         NumericalData<T, Size> 
         go(const NumericalData<T, Size>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalData<T, Size> 
+        go(const ConstNumericalView<T>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalBatch<T> 
+        go(const NumericalBatch<T>& batch) const override final
+        {
+            // the batch mean keeps the edges
+            if(_edgemode == EdgeMode::Truncate){
+                return IProcess<T, Size>::go(batch);
+            }
+            const NumericalData<T> weights = NumericalData<T>::Ones(Width);
+            return batch.weightedWindowMean(weights);
+        };
+
+      private:
+        static constexpr int Width = 2*WindowSize + 1;
+
+        struct Kernel
+        {
+            template<class Values, class Output>
+            void apply(const Values& values, Output& interior) const
+            {
+                interior = WindowSumStencil<Width>::apply(values, interior.size())/T(Width);
+            }
+        };
+
+        NumericalData<T, Size> apply(const ConstNumericalView<T>& data) const
         {
             NumericalData<T, Size> smoothed = data;
+            applyFixedWindow(Kernel(), WindowSize, data, smoothed);
+            if(_edgemode == EdgeMode::Truncate){
+                const int size = data.size();
+                auto edge = [&](int i){
+                    const int lower = std::max(0, i - WindowSize);
+                    const int upper = std::min(size, i + WindowSize + 1);
+                    CompensatedSum<T> sum;
+                    for(int j=lower; j<upper; ++j){
+                        sum.add(data[j]);
+                    }
+                    smoothed[i] = sum.value()/static_cast<T>(upper - lower);
+                };
+                const int first = std::min(WindowSize, size);
+                for(int i=0; i<first; ++i){
+                    edge(i);
+                }
+                for(int i=std::max(first, size - WindowSize); i<size; ++i){
+                    edge(i);
+                }
+            }
+            return smoothed;
+        }
+
+        const EdgeMode _edgemode;
+    };
+
+    template<int WindowSize, typename T, int Size>
+    constexpr int FixedMovingAverageSmoother<WindowSize, T, Size>::windowsize;
+
+    /*!
+       @brief Weighted moving average smoother with the window size known at 
+       compile time.
 
-            // loop over array and get the mean from nearby points
-            for(int i=_windowsize; i<data.size()-_windowsize; ++i){
-                smoothed[i] = (data(i-_windowsize, i+_windowsize+1)*_weights).mean();
+        Uses the same weights as WeightedMovingAverageSmoother(WindowSize),
+        held in a fixed size array, with the weighted sum as a single 
+        unrolled expression (WindowSumStencil).
+
+        See makeWeightedMovingAverageSmoother to pick one at runtime.
+    */
+    template<int WindowSize, typename T=DefaultType, int Size=ArrayTypeDynamic>
+    struct FixedWeightedMovingAverageSmoother : public IProcess<T, Size>
+    {
+        static_assert(WindowSize > 0, "Window size must be positive.");
+
+        static constexpr int windowsize = WindowSize;
+
+        FixedWeightedMovingAverageSmoother()
+        {
+            const NumericalData<T> weights = weightedMovingAverageWeights<T>(WindowSize);
+            std::copy(weights.begin(), weights.end(), _kernel.weights.begin());
+        }
+
+        NumericalData<T, Size> 
+        go(const NumericalData<T, Size>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalData<T, Size> 
+        go(const ConstNumericalView<T>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalBatch<T> 
+        go(const NumericalBatch<T>& batch) const override final
+        {
+            // the weights sum to one, the mean divides by the width
+            NumericalData<T> weights(std::vector<T>(_kernel.weights.begin(), _kernel.weights.end()));
+            weights *= static_cast<T>(Width);
+            return batch.weightedWindowMean(weights);
+        };
+
+      private:
+        static constexpr int Width = 2*WindowSize + 1;
+
+        struct Kernel
+        {
+            template<class Values, class Output>
+            void apply(const Values& values, Output& interior) const
+            {
+                interior = WindowSumStencil<Width>::apply(values, weights, interior.size());
             }
 
+            std::array<T, Width> weights;
+        };
+
+        NumericalData<T, Size> apply(const ConstNumericalView<T>& data) const
+        {
+            NumericalData<T, Size> smoothed = data;
+            applyFixedWindow(_kernel, WindowSize, data, smoothed);
             return smoothed;
+        }
+
+        Kernel _kernel;
+    };
+
+    template<int WindowSize, typename T, int Size>
+    constexpr int FixedWeightedMovingAverageSmoother<WindowSize, T, Size>::windowsize;
+
+    /*!
+       @brief The window sizes with a fixed (compile time) smoother, 
+       used by makeMovingAverageSmoother and makeWeightedMovingAverageSmoother
+    */
+    using FixedWindowSizes = std::integer_sequence<int, 1, 2, 3, 4, 5, 6, 7, 8>;
+
+    // picks the fixed smoother matching the window size (if any), 
+    // otherwise the dynamic one, both made with args (after the window size)
+    template<template<int, typename, int> class Fixed, class Dynamic, 
+             typename T, int Size, int... WindowSizes, typename... Args>
+    std::shared_ptr<IProcess<T, Size>> 
+    dispatchWindowSize(int windowsize, std::integer_sequence<int, WindowSizes...>, const Args&... args)
+    {
+        std::shared_ptr<IProcess<T, Size>> process;
+        (void)std::initializer_list<int>{ 
+            (windowsize == WindowSizes ? (process = std::make_shared<Fixed<WindowSizes, T, Size>>(args...), 0) : 0)... 
+        };
+        if(!process){
+            process = std::make_shared<Dynamic>(windowsize, args...);
+        }
+        return process;
+    }
+
+    /*!
+       @brief Create a moving average smoother, using the fixed window size 
+       version for the common sizes (FixedWindowSizes) and
+       MovingAverageSmoother otherwise, with the given edge mode.
+    */
+    template<typename T=DefaultType, int Size=ArrayTypeDynamic>
+    std::shared_ptr<IProcess<T, Size>> makeMovingAverageSmoother(int windowsize, EdgeMode edgemode=EdgeMode::Keep)
+    {
+        return dispatchWindowSize<FixedMovingAverageSmoother, MovingAverageSmoother<T, Size>, T, Size>(
+            windowsize, FixedWindowSizes(), edgemode);
+    }
+
+    /*!
+       @brief Create a weighted moving average smoother, using the fixed window
+       size version for the common sizes (FixedWindowSizes) and
+       WeightedMovingAverageSmoother otherwise.
+    */
+    template<typename T=DefaultType, int Size=ArrayTypeDynamic>
+    std::shared_ptr<IProcess<T, Size>> makeWeightedMovingAverageSmoother(int windowsize)
+    {
+        return dispatchWindowSize<FixedWeightedMovingAverageSmoother, WeightedMovingAverageSmoother<T, Size>, T, Size>(
+            windowsize, FixedWindowSizes());
+    }
+
+    /*!
+       @brief The Savitzky-Golay coefficients for one window size, polynomial
+       order and derivative (computed in double precision).
+
+        weights - the convolution weights for the interior, i.e. the (derivative 
+                  of the) least squares polynomial at the centre of the window
+        fit - maps the values in a window onto the coefficients of the
+              least squares polynomial (order+1 x windowsize)
+        evaluate - the derivative of the polynomial at each position in
+                   the window (windowsize x order+1), used at the edges
+
+        The positions are scaled to [-1, 1] to keep the fit well 
+        conditioned for wide windows.
+    */
+    template<typename T=DefaultType>
+    struct SavitzkyGolayCoefficients
+    {
+        using Matrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+
+        SavitzkyGolayCoefficients(int windowsize, int order, int deriv)
+        {
+            const int ncoefficients = order + 1;
+            const double centre = 0.5*(windowsize - 1);
+            const double scale = std::max(centre, 1.0);
+
+            Eigen::MatrixXd vandermonde(windowsize, ncoefficients);
+            Eigen::MatrixXd derivative = Eigen::MatrixXd::Zero(windowsize, ncoefficients);
+            for(int i=0; i<windowsize; ++i){
+                const double t = (i - centre)/scale;
+                for(int j=0; j<ncoefficients; ++j){
+                    vandermonde(i, j) = std::pow(t, j);
+                    if(j >= deriv){
+                        // d^deriv/dx^deriv of t^j with t = (x - centre)/scale
+                        double factor = 1.0;
+                        for(int k=0; k<deriv; ++k){
+                            factor *= j - k;
+                        }
+                        derivative(i, j) = factor*std::pow(t, j - deriv)/std::pow(scale, deriv);
+                    }
+                }
+            }
+
+            const Eigen::MatrixXd pseudoinverse = vandermonde.completeOrthogonalDecomposition().pseudoInverse();
+            const Eigen::MatrixXd centreweights = derivative.row(windowsize/2)*pseudoinverse;
+            weights = NumericalData<T>(centreweights.transpose().array().template cast<T>());
+            fit = pseudoinverse.cast<T>();
+            evaluate = derivative.cast<T>();
+        }
+
+        NumericalData<T> weights;
+        Matrix fit;
+        Matrix evaluate;
+    };
+
+    /*!
+       @brief The cached Savitzky-Golay coefficients, computed on first use of a
+       (windowsize, order, deriv) and shared by all smoothers using it.
+       Thread safe.
+    */
+    template<typename T=DefaultType>
+    std::shared_ptr<const SavitzkyGolayCoefficients<T>> 
+    savitzkyGolayCoefficients(int windowsize, int order, int deriv=0)
+    {
+        using Key = std::tuple<int, int, int>;
+        static std::mutex mutex;
+        static std::map<Key, std::shared_ptr<const SavitzkyGolayCoefficients<T>>> cache;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& coefficients = cache[Key(windowsize, order, deriv)];
+        if(!coefficients){
+            coefficients = std::make_shared<const SavitzkyGolayCoefficients<T>>(windowsize, order, deriv);
+        }
+        return coefficients;
+    }
+
+    /*!
+       @brief Savitzky-Golay smoother (or differentiator), the value (or 
+       derivative) of the least squares polynomial of the given order fitted 
+       to the window around each point.
+
+        Follows scipy.signal.savgol_filter with mode='interp'. The windowsize is 
+        the full (odd) window length, not the number either side as for the
+        moving average smoothers. The interior is a convolution with the 
+        cached coefficients (see savitzkyGolayCoefficients), and the first 
+        and last windowsize/2 points are from the polynomial fitted to the 
+        first and last window. When the data is shorter than the window 
+        the polynomial is fitted to all of it.
+
+        deriv > 0 gives the derivative, with delta the spacing of the points.
+    */
+    template<typename T=DefaultType, int Size=ArrayTypeDynamic>
+    struct SavitzkyGolaySmoother : public IProcess<T, Size>
+    {
+        explicit SavitzkyGolaySmoother(int windowsize, int order=2, int deriv=0, T delta=1)
+        : _windowsize(windowsize), _order(order), _deriv(deriv), 
+          _scale(static_cast<T>(1.0/std::pow(delta, deriv)))
+        {
+            if(windowsize < 1 || windowsize % 2 == 0){
+                throw PeakingDuckException("Savitzky-Golay window size must be a positive odd number.");
+            }
+            if(order < 0 || order >= windowsize){
+                throw PeakingDuckException("Savitzky-Golay polynomial order must be less than the window size.");
+            }
+            if(deriv < 0){
+                throw PeakingDuckException("Savitzky-Golay derivative must not be negative.");
+            }
+            _coefficients = savitzkyGolayCoefficients<T>(windowsize, order, deriv);
+        }
+
+        // batches are done a spectrum at a time
+        using IProcess<T, Size>::go;
+
+        NumericalData<T, Size> 
+        go(const NumericalData<T, Size>& data) const override final
+        {
+            return apply(data);
+        };
+
+        NumericalData<T, Size> 
+        go(const ConstNumericalView<T>& data) const override final
+        {
+            return apply(data);
         };
 
       private:
+        struct Kernel
+        {
+            template<class Values, class Output>
+            void apply(const Values& values, Output& interior) const
+            {
+                const int n = interior.size();
+                interior = weights[0]*values.segment(0, n);
+                for(int k=1; k<weights.size(); ++k){
+                    interior += weights[k]*values.segment(k, n);
+                }
+            }
+
+            const NumericalData<T>& weights;
+        };
+
+        NumericalData<T, Size> apply(const ConstNumericalView<T>& data) const
+        {
+            NumericalData<T, Size> smoothed = data;
+            const int size = data.size();
+            if(size == 0){
+                return smoothed;
+            }
+
+            if(size < _windowsize){
+                const SavitzkyGolayCoefficients<T> whole(size, std::min(_order, size-1), _deriv);
+                fitWindow(whole, data, 0, 0, size, smoothed);
+            }
+            else{
+                const int half = _windowsize/2;
+                applyFixedWindow(Kernel{_coefficients->weights}, half, data, smoothed);
+                fitWindow(*_coefficients, data, 0, 0, half, smoothed);
+                fitWindow(*_coefficients, data, size-_windowsize, _windowsize-half, _windowsize, smoothed);
+            }
+
+            if(_deriv > 0){
+                smoothed *= _scale;
+            }
+            return smoothed;
+        }
+
+        // fit the polynomial to the window starting at start and
+        // evaluate it at the positions [first, last) of the window
+        static void fitWindow(const SavitzkyGolayCoefficients<T>& coefficients, const ConstNumericalView<T>& data, 
+                              int start, int first, int last, NumericalData<T, Size>& smoothed)
+        {
+            const int windowsize = static_cast<int>(coefficients.fit.cols());
+            Eigen::Matrix<T, Eigen::Dynamic, 1> window(windowsize);
+            for(int i=0; i<windowsize; ++i){
+                window[i] = data[start+i];
+            }
+            const Eigen::Matrix<T, Eigen::Dynamic, 1> polynomial = coefficients.fit*window;
+            for(int k=first; k<last; ++k){
+                smoothed[start+k] = coefficients.evaluate.row(k).dot(polynomial);
+            }
+        }
+
         const int _windowsize;
-        NumericalData<T> _weights;
-    };  
+        const int _order;
+        const int _deriv;
+        const T _scale;
+        std::shared_ptr<const SavitzkyGolayCoefficients<T>> _coefficients;
+    };
 
 PEAKINGDUCK_NAMESPACE_END
 PEAKINGDUCK_NAMESPACE_END
@@ -14,6 +14,7 @@
 #define CORE_SPECTRAL_HPP
 
 #include "common.hpp"
+#include "core/background.hpp"
 #include "core/numerical.hpp"
 
 PEAKINGDUCK_NAMESPACE_START(peakingduck)
@@ -92,12 +93,13 @@ PEAKINGDUCK_NAMESPACE_START(core)
         template<class Iterator>
         void removeBackground(Iterator first, Iterator last){
             // perform snip on Y values
-            this->_Y = this->_Y - this->_Y.snip(first, last);
+            this->_Y -= estimateBackground(first, last);
         }
 
         template<class Iterator>
         NumericalData<YScalar> estimateBackground(Iterator first, Iterator last) const{
-            return this->_Y.snip(first, last);
+            SNIPEngine<YScalar> engine;
+            return engine.estimate(this->_Y, first, last);
         }
     };
 
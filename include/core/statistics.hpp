@@ -0,0 +1,218 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Defines the single pass summary statistics (count, sum, mean, variance,
+    min, max, argmin and argmax) of numerical arrays.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef CORE_STATISTICS_HPP
+#define CORE_STATISTICS_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#include <Eigen/Core>
+
+#include "common.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(core)
+
+    /*!
+       @brief A running sum with compensation, the rounding error of each 
+       addition is found exactly (Knuth's TwoSum) and summed separately, 
+       so that long (or sliding) sums do not drift.
+
+        Unlike Kahan summation the error terms are not fed back into the
+        next addition, so the running sum is a single add per value.
+    */
+    template<typename T>
+    struct CompensatedSum
+    {
+        inline void add(const T& value)
+        {
+            T error;
+            _sum = twoSum(_sum, value, error);
+            _compensation += error;
+        }
+
+        inline void subtract(const T& value)
+        {
+            add(-value);
+        }
+
+        /*!
+            @brief Add one value and remove another, i.e. slide a window
+        */
+        inline void slide(const T& entering, const T& leaving)
+        {
+            T differenceError;
+            T sumError;
+            const T difference = twoSum(entering, -leaving, differenceError);
+            _sum = twoSum(_sum, difference, sumError);
+            _compensation += differenceError + sumError;
+        }
+
+        inline T value() const
+        {
+            return _sum + _compensation;
+        }
+
+      private:
+        // a + b, with the exact rounding error of the addition
+        static inline T twoSum(const T& a, const T& b, T& error)
+        {
+            const T sum = a + b;
+            const T bapprox = sum - a;
+            error = (a - (sum - bapprox)) + (b - bapprox);
+            return sum;
+        }
+
+        T _sum = 0;
+        T _compensation = 0;
+    };
+
+    /*!
+       @brief The floating point type the mean and variance of T are
+       accumulated in, T itself for floating point types and double
+       otherwise (i.e. integer counts).
+    */
+    template<typename T>
+    using StatisticsRealType = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+
+    /*!
+       @brief The summary statistics of an array, from a single pass.
+
+        The variance is kept as the sum of squared differences from the
+        mean (m2) and two sets of statistics are combined with the pairwise
+        update of Chan et al. (the parallel form of Welford's algorithm), so
+        it does not suffer from the cancellation of the naive sum of squares.
+
+        argmin and argmax are the first index of the min and max (as numpy),
+        both -1 for an empty array. The sum, min and max are of the value
+        type, the mean and m2 are always floating point (see StatisticsRealType).
+    */
+    template<typename T>
+    struct Statistics
+    {
+        using value_type = T;
+        using real_type = StatisticsRealType<T>;
+
+        int count = 0;
+        T sum = 0;
+        real_type mean = 0;
+        real_type m2 = 0;
+        T min = std::numeric_limits<T>::max();
+        T max = std::numeric_limits<T>::lowest();
+        int argmin = -1;
+        int argmax = -1;
+
+        /*!
+            @brief The variance, ddof=1 gives the sample variance
+        */
+        inline real_type variance(int ddof=0) const
+        {
+            assert(count > ddof);
+            return m2/static_cast<real_type>(count - ddof);
+        }
+
+        inline real_type stddev(int ddof=0) const
+        {
+            return std::sqrt(variance(ddof));
+        }
+
+        /*!
+            @brief Combine with the statistics of the values that follow,
+            i.e. the next block of the same array. The indices of the
+            other are offset by the count of this.
+        */
+        Statistics& merge(const Statistics& other)
+        {
+            if(other.count == 0){
+                return *this;
+            }
+
+            // ties keep the first index, an empty this takes those of the other
+            if(count == 0 || other.min < min){
+                min = other.min;
+                argmin = count + other.argmin;
+            }
+            if(count == 0 || other.max > max){
+                max = other.max;
+                argmax = count + other.argmax;
+            }
+
+            const int total = count + other.count;
+            const real_type delta = other.mean - mean;
+            const real_type fraction = static_cast<real_type>(other.count)/static_cast<real_type>(total);
+            mean += delta*fraction;
+            m2 += other.m2 + delta*delta*static_cast<real_type>(count)*fraction;
+            sum += other.sum;
+            count = total;
+            return *this;
+        }
+    };
+
+    /*!
+       @brief Compute the statistics of any Eigen array expression (use
+       NumericalFunctions::statistics rather than this directly).
+
+        The values are read in blocks that fit in cache. The sum, min and max
+        of each block are vectorized reductions, the squared differences
+        from the block mean are summed while the block is still in cache
+        and the blocks are merged with Statistics::merge. The block sums are
+        accumulated with compensated summation.
+    */
+    template<class EigenType, typename T=typename EigenType::Scalar>
+    Statistics<T> computeStatistics(const Eigen::DenseBase<EigenType>& values)
+    {
+        using Real = typename Statistics<T>::real_type;
+        constexpr int BlockSize = 512;
+
+        Statistics<T> stats;
+        CompensatedSum<T> total;
+        const int size = static_cast<int>(values.size());
+        for(int start=0; start<size; start+=BlockSize){
+            const int n = std::min(BlockSize, size - start);
+            const auto block = values.segment(start, n);
+
+            Statistics<T> blockstats;
+            blockstats.count = n;
+            blockstats.sum = block.sum();
+            blockstats.mean = static_cast<Real>(blockstats.sum)/static_cast<Real>(n);
+            blockstats.m2 = (block.array().template cast<Real>() - blockstats.mean).square().sum();
+            blockstats.min = block.minCoeff();
+            blockstats.max = block.maxCoeff();
+
+            // only search for the index when it could change, the first
+            // block always (so that any values, i.e. infinite, have an index)
+            if(stats.count == 0 || blockstats.min < stats.min){
+                blockstats.argmin = 0;
+                while(block.coeff(blockstats.argmin) != blockstats.min) ++blockstats.argmin;
+            }
+            if(stats.count == 0 || blockstats.max > stats.max){
+                blockstats.argmax = 0;
+                while(block.coeff(blockstats.argmax) != blockstats.max) ++blockstats.argmax;
+            }
+
+            // compensated sum of the blocks
+            total.add(blockstats.sum);
+            stats.merge(blockstats);
+            stats.sum = total.value();
+        }
+        return stats;
+    }
+
+PEAKINGDUCK_NAMESPACE_END
+PEAKINGDUCK_NAMESPACE_END
+
+#endif // CORE_STATISTICS_HPP
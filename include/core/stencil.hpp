@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Defines compile time stencil operators for symmetric neighbour operations.
+
+    A stencil is a type with a static apply function taking the lower (i-order),
+    centre (i) and upper (i+order) neighbours as Eigen expressions over the
+    whole interior of the array and returning an expression for the new values.
+    Since the operation is known at compile time it is inlined and Eigen can
+    vectorize the whole interior in a single pass.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef CORE_STENCIL_HPP
+#define CORE_STENCIL_HPP
+
+#include "common.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(core)
+
+    /*!
+       @brief The midpoint of the neighbours - (array[i-j]+array[i+j])/2
+    */
+    struct MidpointStencil
+    {
+        template<class Lower, class Centre, class Upper>
+        static decltype(auto) apply(const Lower& lower, const Centre&, const Upper& upper)
+        {
+            using Scalar = typename Centre::Scalar;
+            return (lower + upper)/Scalar(2);
+        }
+    };
+
+    /*!
+       @brief The central difference of the neighbours - (array[i+j]-array[i-j])/2
+    */
+    struct GradientStencil
+    {
+        template<class Lower, class Centre, class Upper>
+        static decltype(auto) apply(const Lower& lower, const Centre&, const Upper& upper)
+        {
+            using Scalar = typename Centre::Scalar;
+            return (upper - lower)/Scalar(2);
+        }
+    };
+
+    /*!
+       @brief The midpoint of the neighbours clipped to the centre value -
+       min((array[i-j]+array[i+j])/2, array[i])
+
+       This is the clipping step of the SNIP algorithm.
+    */
+    struct MidpointMinStencil
+    {
+        template<class Lower, class Centre, class Upper>
+        static decltype(auto) apply(const Lower& lower, const Centre& centre, const Upper& upper)
+        {
+            return MidpointStencil::apply(lower, centre, upper).min(centre);
+        }
+    };
+
+    /*!
+       @brief The (weighted) sum of a window of Width neighbours known at
+       compile time - sum_k weights[k]*array[i+k] for k in [0, Width).
+
+       Unlike the symmetric stencils this takes the values (a contiguous or
+       strided Eigen array/map) and the number of outputs n, and returns a 
+       single expression of Width terms over the values. The window is therefore
+       fully unrolled and the result is evaluated in one vectorized pass.
+    */
+    template<int Width>
+    struct WindowSumStencil
+    {
+        static_assert(Width > 0, "Window must have at least one entry.");
+
+        template<class Values>
+        static decltype(auto) apply(const Values& values, int n)
+        {
+            return WindowSumStencil<Width-1>::apply(values, n) + values.segment(Width-1, n);
+        }
+
+        template<class Values, class Weights>
+        static decltype(auto) apply(const Values& values, const Weights& weights, int n)
+        {
+            return WindowSumStencil<Width-1>::apply(values, weights, n) + weights[Width-1]*values.segment(Width-1, n);
+        }
+    };
+
+    template<>
+    struct WindowSumStencil<1>
+    {
+        template<class Values>
+        static decltype(auto) apply(const Values& values, int n)
+        {
+            return values.segment(0, n);
+        }
+
+        template<class Values, class Weights>
+        static decltype(auto) apply(const Values& values, const Weights& weights, int n)
+        {
+            return weights[0]*values.segment(0, n);
+        }
+    };
+
+PEAKINGDUCK_NAMESPACE_END
+PEAKINGDUCK_NAMESPACE_END
+
+#endif // CORE_STENCIL_HPP
@@ -0,0 +1,444 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Defines the continuous wavelet transform (a bank of Mexican hat
+    wavelets) and the peak finder following its ridge lines, as
+    scipy.signal.find_peaks_cwt.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef CORE_WAVELET_HPP
+#define CORE_WAVELET_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "exceptions.hpp"
+#include "core/convolution.hpp"
+#include "core/numerical.hpp"
+#include "core/peaking.hpp"
+#include "core/quantile.hpp"
+#include "util/threadpool.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(core)
+
+    /*!
+       @brief The Mexican hat (Ricker) wavelet of width a, the negative
+       second derivative of a Gaussian, at ceil(points) points centred
+       on (points-1)/2, as scipy.signal.ricker.
+    */
+    template<typename T=DefaultType>
+    NumericalData<T> rickerWavelet(double points, double a)
+    {
+        if(!(points > 0.0) || !(a > 0.0)){
+            throw PeakingDuckException("Ricker wavelet needs positive points and width.");
+        }
+        const double amplitude = 2.0/(std::sqrt(3.0*a)*std::pow(std::acos(-1.0), 0.25));
+        const double centre = (points - 1.0)/2.0;
+        NumericalData<T> wavelet(static_cast<int>(std::ceil(points)));
+        for(int i=0; i<wavelet.size(); ++i){
+            const double x = (i - centre)/a;
+            wavelet[i] = static_cast<T>(amplitude*(1.0 - x*x)*std::exp(-0.5*x*x));
+        }
+        return wavelet;
+    }
+
+    /*!
+       @brief Continuous wavelet transform peak finder, the peaks are the
+       ridge lines of local maxima through the transform from the widest
+       to the narrowest wavelet that are long enough and stand out from
+       the noise, as scipy.signal.find_peaks_cwt (with the Ricker wavelet).
+
+        The transform is one row per width, the data convolved with the
+        Ricker wavelet of min(10*width, N) points (see ConvolutionEngine,
+        by overlap-save for the wider wavelets), each row on the thread
+        pool. The engines (the wavelet spectra) are made once for each
+        size of data and kept for the last MaxCachedSizes sizes used,
+        copies of the finder share them.
+
+        A local maximum of a row joins the ridge line ending nearest to it
+        (within maxDistances of the row, widths/4 by default) or starts a
+        new one, a line ends after more than gapThreshold rows without a
+        maximum (ceil(widths[0]) by default). A line is a peak, at its
+        column last joined (as scipy), with at least minLength points
+        (ceil(widths/4) by default) and a signal to noise ratio of at least
+        minSNR, where the noise is the noisePercentile of the first
+        row in a window of windowSize points (ceil(N/20) by default), so
+        the widths are expected in increasing order.
+
+        The nearest line is found by a binary search of the line ends, so
+        the ridges are O(S*N*log(N)) at worst, as the transform.
+    */
+    template<typename ValueType=DefaultType,
+             int Size=ArrayTypeDynamic>
+    struct CWTPeakFinder : public IPeakFinder<ValueType, Size>
+    {
+        /*!
+           @brief The number of sizes of data the engines are kept for,
+           the least recently used are dropped
+        */
+        static constexpr int MaxCachedSizes = 8;
+
+        explicit CWTPeakFinder(const std::vector<double>& widths,
+                               const std::vector<double>& maxDistances=std::vector<double>(),
+                               double gapThreshold=0.0,
+                               int minLength=0,
+                               double minSNR=1.0,
+                               double noisePercentile=10.0,
+                               int windowSize=0,
+                               util::ThreadPool& pool=util::ThreadPool::shared()) :
+            _widths(widths), _maxDistances(maxDistances), _gapThreshold(gapThreshold),
+            _minLength(minLength), _minSNR(minSNR), _noisePercentile(noisePercentile),
+            _windowSize(windowSize), _pool(&pool), _cache(std::make_shared<Cache>())
+        {
+            if(widths.empty() || !(*std::min_element(widths.begin(), widths.end()) > 0.0)){
+                throw PeakingDuckException("Wavelet widths must be positive.");
+            }
+            if(_maxDistances.empty()){
+                for(double width: widths){
+                    _maxDistances.push_back(width/4.0);
+                }
+            }
+            if(_maxDistances.size() != widths.size()){
+                throw PeakingDuckException("Need one maximum distance for each wavelet width.");
+            }
+            if(gapThreshold == 0.0){
+                _gapThreshold = std::ceil(widths[0]);
+            }
+            if(minLength == 0){
+                _minLength = static_cast<int>(std::ceil(widths.size()/4.0));
+            }
+            if(!(noisePercentile >= 0.0 && noisePercentile <= 100.0)){
+                throw PeakingDuckException("Noise percentile must be between 0 and 100.");
+            }
+            if(minLength < 0 || windowSize < 0 || gapThreshold < 0.0){
+                throw PeakingDuckException("Ridge line limits must not be negative.");
+            }
+        };
+
+        virtual ~CWTPeakFinder()
+        {
+        };
+
+        using IPeakFinder<ValueType, Size>::find;
+
+        /*!
+           @brief Identifies the peaks from the ridge lines of the transform
+        */
+        virtual PeakList<ValueType>
+        find(const NumericalData<ValueType, Size>& data) const override{
+            return find(ConstNumericalView<ValueType>(data));
+        }
+
+        PeakList<ValueType>
+        find(const ConstNumericalView<ValueType>& data) const{
+            PeakList<ValueType> peaks;
+            for(const Ridge& ridge: ridges(data)){
+                peaks.emplace_back(ridge.column, data[ridge.column]);
+            }
+            return peaks;
+        }
+
+        /*!
+           @brief Identifies the peaks into the table, the score is the
+           signal to noise ratio and the width the widest wavelet of
+           the ridge line
+        */
+        virtual void
+        find(const NumericalData<ValueType, Size>& data, PeakTable<ValueType>& table) const override{
+            table.clear();
+            for(const Ridge& ridge: ridges(data)){
+                table.append(ridge.column, data[ridge.column], 0, 0,
+                             static_cast<ValueType>(_widths[ridge.top]), static_cast<ValueType>(ridge.snr));
+            }
+        }
+
+        /*!
+           @brief The transform, one row (the size of the data) per width
+        */
+        std::vector<NumericalData<ValueType>> transform(const ConstNumericalView<ValueType>& data) const
+        {
+            const int size = data.size();
+            std::vector<NumericalData<ValueType>> rows(_widths.size(), NumericalData<ValueType>(size));
+            if(size == 0){
+                return rows;
+            }
+            const std::shared_ptr<const Bank> bank = engines(size);
+            _pool->parallelFor(static_cast<int>(_widths.size()), [&](int row){
+                (*bank)[row].convolve(data, rows[row]);
+            });
+            return rows;
+        }
+
+        inline const std::vector<double>& widths() const
+        {
+            return _widths;
+        }
+
+        /*!
+           @brief The number of sizes of data with engines kept
+        */
+        int cachedSizes() const
+        {
+            std::lock_guard<std::mutex> lock(_cache->mutex);
+            return static_cast<int>(_cache->banks.size());
+        }
+
+        /*!
+           @brief Drop the engines kept for all sizes of data
+        */
+        void clearCache() const
+        {
+            std::lock_guard<std::mutex> lock(_cache->mutex);
+            _cache->banks.clear();
+        }
+
+      private:
+        using Bank = std::vector<ConvolutionEnginePool<ValueType>>;
+
+        // the engines for a size of data, and when they were last used
+        struct CachedBank
+        {
+            int size;
+            unsigned long lastUsed;
+            std::shared_ptr<const Bank> bank;
+        };
+
+        // the engines for the most recently used sizes of data
+        struct Cache
+        {
+            std::mutex mutex;
+            unsigned long uses = 0;
+            std::vector<CachedBank> banks;
+        };
+
+        // a ridge line that is a peak, at the column last joined,
+        // from the widest row top
+        struct Ridge
+        {
+            int column;
+            int top;
+            double snr;
+        };
+
+        // a ridge line, from the widest row top down to the point last
+        // joined, of length points. The rows only decrease, so the last
+        // point is in the narrowest row, the last of its maxima to join
+        struct Line
+        {
+            int top;
+            int lastRow;
+            int lastColumn;
+            int length;
+            int gap;
+
+            Line(int row, int column) :
+                top(row), lastRow(row), lastColumn(column), length(1), gap(0)
+            {
+            }
+
+            inline void join(int row, int column)
+            {
+                lastRow = row;
+                lastColumn = column;
+                ++length;
+                gap = 0;
+            }
+        };
+
+        std::shared_ptr<const Bank> engines(int size) const
+        {
+            std::lock_guard<std::mutex> lock(_cache->mutex);
+            std::vector<CachedBank>& banks = _cache->banks;
+            const unsigned long use = ++_cache->uses;
+            auto cached = std::find_if(banks.begin(), banks.end(), [&](const CachedBank& entry){ return entry.size == size; });
+            if(cached != banks.end()){
+                cached->lastUsed = use;
+                return cached->bank;
+            }
+
+            // reversed, as the transform is a correlation
+            Bank wavelets;
+            for(double width: _widths){
+                NumericalData<ValueType> wavelet = rickerWavelet<ValueType>(std::min(10.0*width, static_cast<double>(size)), width);
+                std::reverse(wavelet.begin(), wavelet.end());
+                wavelets.emplace_back(ConvolutionEngine<ValueType>(wavelet));
+            }
+            const std::shared_ptr<const Bank> bank = std::make_shared<const Bank>(std::move(wavelets));
+
+            // calls still using a dropped bank keep it alive until they finish
+            if(static_cast<int>(banks.size()) >= MaxCachedSizes){
+                auto oldest = std::min_element(banks.begin(), banks.end(), [](const CachedBank& a, const CachedBank& b){
+                    return a.lastUsed < b.lastUsed;
+                });
+                banks.erase(oldest);
+            }
+            banks.push_back(CachedBank{size, use, bank});
+            return bank;
+        }
+
+        std::vector<Ridge> ridges(const ConstNumericalView<ValueType>& data) const
+        {
+            const std::vector<NumericalData<ValueType>> rows = transform(data);
+            std::vector<Line> lines = ridgeLines(rows);
+            return filterLines(rows, lines);
+        }
+
+        // strict local maxima of the row, never the ends
+        static void localMaxima(const NumericalData<ValueType>& row, std::vector<int>& columns)
+        {
+            columns.clear();
+            for(int i=1; i<row.size()-1; ++i){
+                if(row[i] > row[i-1] && row[i] > row[i+1]){
+                    columns.push_back(i);
+                }
+            }
+        }
+
+        // follows the maxima from the widest row with any to the narrowest
+        std::vector<Line> ridgeLines(const std::vector<NumericalData<ValueType>>& rows) const
+        {
+            std::vector<int> maxima;
+            int start = static_cast<int>(rows.size()) - 1;
+            for(; start >= 0; --start){
+                localMaxima(rows[start], maxima);
+                if(!maxima.empty()){
+                    break;
+                }
+            }
+            std::vector<Line> finished;
+            std::vector<Line> lines;
+            if(start < 0){
+                return lines;
+            }
+            for(int column: maxima){
+                lines.emplace_back(start, column);
+            }
+
+            // the line ends (column, line) sorted, the nearest line is
+            // the first (in line order) of the nearest column either side
+            std::vector<std::pair<int, int>> ends;
+            for(int row=start-1; row>=0; --row){
+                localMaxima(rows[row], maxima);
+                ends.clear();
+                for(int l=0; l<static_cast<int>(lines.size()); ++l){
+                    ++lines[l].gap;
+                    ends.emplace_back(lines[l].lastColumn, l);
+                }
+                std::sort(ends.begin(), ends.end());
+
+                const int nlines = static_cast<int>(lines.size());
+                for(int column: maxima){
+                    int nearest = -1;
+                    if(nlines > 0){
+                        const auto after = std::lower_bound(ends.begin(), ends.end(), std::make_pair(column, -1));
+                        int distance = std::numeric_limits<int>::max();
+                        if(after != ends.end()){
+                            distance = after->first - column;
+                            nearest = after->second;
+                        }
+                        if(after != ends.begin()){
+                            // the first line ending at the nearest column before
+                            const int before = std::prev(after)->first;
+                            const auto first = std::lower_bound(ends.begin(), after, std::make_pair(before, -1));
+                            if(column - before < distance || (column - before == distance && first->second < nearest)){
+                                distance = column - before;
+                                nearest = first->second;
+                            }
+                        }
+                        if(distance > _maxDistances[row]){
+                            nearest = -1;
+                        }
+                    }
+                    if(nearest >= 0){
+                        lines[nearest].join(row, column);
+                    }
+                    else{
+                        lines.emplace_back(row, column);
+                    }
+                }
+
+                // the lines with too long a gap are finished, the others keep their order
+                auto ended = std::stable_partition(lines.begin(), lines.end(), [&](const Line& line){
+                    return !(line.gap > _gapThreshold);
+                });
+                finished.insert(finished.end(), ended, lines.end());
+                lines.erase(ended, lines.end());
+            }
+            finished.insert(finished.end(), lines.begin(), lines.end());
+            return finished;
+        }
+
+        // the lines long enough and above the noise, by column
+        std::vector<Ridge> filterLines(const std::vector<NumericalData<ValueType>>& rows, const std::vector<Line>& lines) const
+        {
+            // the first row, normally the narrowest
+            const NumericalData<ValueType>& narrowest = rows[0];
+            const int size = narrowest.size();
+            const int windowSize = _windowSize > 0 ? _windowSize : static_cast<int>(std::ceil(size/20.0));
+            const int halfWindow = windowSize/2;
+            const int odd = windowSize % 2;
+
+            // the noise, the percentile of the window [i-halfWindow, i+halfWindow+odd)
+            std::vector<ValueType> noise(size);
+            RankedQuantile<ValueType> window(narrowest, _noisePercentile/100.0);
+            int first = 0;
+            int last = 0;
+            for(int i=0; i<size; ++i){
+                for(; last < std::min(i + halfWindow + odd, size); ++last){
+                    window.insert(last);
+                }
+                for(; first < std::max(i - halfWindow, 0); ++first){
+                    window.erase(first);
+                }
+                noise[i] = window.size() > 0 ? window.value() : ValueType(0);
+            }
+
+            std::vector<Ridge> ridges;
+            for(const Line& line: lines){
+                if(line.length < _minLength){
+                    continue;
+                }
+                const int column = line.lastColumn;
+                const double snr = std::abs(static_cast<double>(rows[line.lastRow][column])/noise[column]);
+                if(snr < _minSNR){
+                    continue;
+                }
+                ridges.push_back(Ridge{column, line.top, snr});
+            }
+            std::stable_sort(ridges.begin(), ridges.end(), [](const Ridge& a, const Ridge& b){
+                return a.column < b.column;
+            });
+            return ridges;
+        }
+
+        std::vector<double> _widths;
+        std::vector<double> _maxDistances;
+        double _gapThreshold;
+        int _minLength;
+        double _minSNR;
+        double _noisePercentile;
+        int _windowSize;
+        util::ThreadPool* _pool;
+        std::shared_ptr<Cache> _cache;
+    };
+
+    template<typename ValueType, int Size>
+    constexpr int CWTPeakFinder<ValueType, Size>::MaxCachedSizes;
+
+PEAKINGDUCK_NAMESPACE_END // core
+PEAKINGDUCK_NAMESPACE_END // peakingduck
+
+#endif //CORE_WAVELET_HPP
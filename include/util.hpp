@@ -17,6 +17,7 @@
 #include "util/range.hpp"
 #include "util/stream.hpp"
 #include "util/string.hpp"
+#include "util/threadpool.hpp"
 #include "util/window.hpp"
 
 #endif //UTIL_HPP
\ No newline at end of file
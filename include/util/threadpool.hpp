@@ -0,0 +1,203 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+/*!
+    @file
+    Defines a simple fixed size thread pool for running independent
+    tasks (i.e. chunks of a spectrum) concurrently.
+
+    @copyright UK Atomic Energy Authority (UKAEA) - 2019-20
+*/
+#ifndef UTIL_THREADPOOL_HPP
+#define UTIL_THREADPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(util)
+
+    /*!
+        @brief A fixed number of worker threads taking jobs from a queue.
+
+        Use parallelFor to run ntasks tasks and wait for them, the calling
+        thread works on the tasks too, so a pool with no workers runs them
+        in order on the calling thread and parallelFor can be nested.
+
+        Tasks must write only to their own outputs, then the results do
+        not depend on the number of threads or the order tasks run in.
+
+        Usage as:
+
+            std::vector<double> maxima(nchunks);
+            util::ThreadPool::shared().parallelFor(nchunks, [&](int i){
+                maxima[i] = chunk(i).maxCoeff();
+            });
+    */
+    class ThreadPool
+    {
+        public:
+            // the number of worker threads, in addition to the caller
+            explicit ThreadPool(int nworkers) : _stop(false)
+            {
+                for(int i=0; i<nworkers; ++i){
+                    _workers.emplace_back([this](){ work(); });
+                }
+            }
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            ~ThreadPool()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _stop = true;
+                }
+                _condition.notify_all();
+                for(auto& worker: _workers){
+                    worker.join();
+                }
+            }
+
+            inline int nworkers() const
+            {
+                return static_cast<int>(_workers.size());
+            }
+
+            // the threads that work on a parallelFor, including the caller
+            inline int nthreads() const
+            {
+                return nworkers() + 1;
+            }
+
+            /*!
+                @brief Run task(i) for i in [0, ntasks) and wait for all of them.
+                If any throw, the exception of the lowest task is rethrown once
+                all have finished.
+            */
+            template<class Function>
+            void parallelFor(int ntasks, Function&& task)
+            {
+                if(ntasks <= 0){
+                    return;
+                }
+                if(ntasks == 1 || nworkers() == 0){
+                    for(int i=0; i<ntasks; ++i){
+                        task(i);
+                    }
+                    return;
+                }
+
+                // the workers may pick up their job after the tasks are done,
+                // so the state they share outlives this call
+                auto state = std::make_shared<ParallelState>(ntasks, task);
+                const int nhelpers = std::min(nworkers(), ntasks - 1);
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    for(int i=0; i<nhelpers; ++i){
+                        _jobs.emplace([state](){ state->run(); });
+                    }
+                }
+                _condition.notify_all();
+
+                state->run();
+                state->wait();
+
+                for(const auto& error: state->errors){
+                    if(error){
+                        std::rethrow_exception(error);
+                    }
+                }
+            }
+
+            /*!
+                @brief The pool shared by the library, one thread per
+                hardware thread (with the caller).
+            */
+            static ThreadPool& shared()
+            {
+                static ThreadPool pool(std::max(1, static_cast<int>(std::thread::hardware_concurrency())) - 1);
+                return pool;
+            }
+
+        private:
+            struct ParallelState
+            {
+                ParallelState(int ntasks, const std::function<void(int)>& task)
+                : task(task), ntasks(ntasks), next(0), remaining(ntasks), errors(ntasks)
+                {}
+
+                // take tasks until there are none left
+                void run()
+                {
+                    for(int i=next++; i<ntasks; i=next++){
+                        try{
+                            task(i);
+                        }
+                        catch(...){
+                            errors[i] = std::current_exception();
+                        }
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if(--remaining == 0){
+                            done.notify_all();
+                        }
+                    }
+                }
+
+                void wait()
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    done.wait(lock, [this](){ return remaining == 0; });
+                }
+
+                const std::function<void(int)> task;
+                const int ntasks;
+                std::atomic<int> next;
+                int remaining;
+                std::vector<std::exception_ptr> errors;
+                std::mutex mutex;
+                std::condition_variable done;
+            };
+
+            void work()
+            {
+                while(true){
+                    std::function<void()> job;
+                    {
+                        std::unique_lock<std::mutex> lock(_mutex);
+                        _condition.wait(lock, [this](){ return _stop || !_jobs.empty(); });
+                        if(_stop && _jobs.empty()){
+                            return;
+                        }
+                        job = std::move(_jobs.front());
+                        _jobs.pop();
+                    }
+                    job();
+                }
+            }
+
+            std::vector<std::thread> _workers;
+            std::queue<std::function<void()>> _jobs;
+            std::mutex _mutex;
+            std::condition_variable _condition;
+            bool _stop;
+    };
+
+PEAKINGDUCK_NAMESPACE_END //util
+PEAKINGDUCK_NAMESPACE_END //peakingduck
+
+#endif //UTIL_THREADPOOL_HPP
@@ -1,4 +1,3 @@
-import scipy.signal
 import numpy as np
 import math
 
@@ -35,12 +34,3 @@ class WeightedMovingAverageNative(IProcess):
         weights = list(range(1, math.ceil(self.windowsize/2)+1)) + list(range(math.floor(self.windowsize/2),0,-1))
         weights = [w/sum(weights) for w in weights]
         return NumericalData(np.convolve(data.to_list(), weights, mode='same'))
-
-class SavitzkyGolaySmoother(IProcess):      
-    def __init__(self, windowsize, order=2):
-        IProcess.__init__(self)
-        self.windowsize = windowsize
-        self.order = order
-
-    def go(self, data):  
-        return NumericalData(scipy.signal.savgol_filter(data.to_list(), self.windowsize, self.order))
@@ -6,9 +6,11 @@
 
 #include <fstream>
 #include <functional>
+#include <string>
 
 #include <pybind11/eigen.h>
 #include <pybind11/functional.h>
+#include <pybind11/numpy.h>
 #include <pybind11/operators.h>
 #include <pybind11/stl.h>
 #include <pybind11/pybind11.h>
@@ -20,71 +22,21 @@ namespace py = pybind11;
 
 PEAKINGDUCK_NAMESPACE_USING(peakingduck)
 
-PYBIND11_MODULE(PEAKINGDUCK, m) {
-    
-    m.doc() = R"pbdoc(
-        Peaking duck library using pybind11
-
-        ToDo: write
-
-        A list:
-            - Entry 1
-            - Entry 2
-
-    )pbdoc"; // optional module docstring
-
-    // version
-    m.attr("__version__") = "0.0.1";
-
-    // util module
-    py::module m_util = m.def_submodule("util");
-
-    // core module 
-    py::module m_core = m.def_submodule("core");
-
-    // io module
-    py::module m_io = m.def_submodule("io");
-
-    m_util.def("get_window", &util::get_window<double>,
-	       R"pbdoc(
-                Given a list of values take nouter points either side of 
-                the index given and ignore ninner points.
-
-                Examples:
-
-                    ::
-    
-                        >>> get_window([8, 2, 5, 2, 6, 6, 9, 23, 12], 4, 3, 0, True)
-                        [2, 5, 2, 6, 6, 9, 23]
-                        >>> get_window([8, 2, 5, 2, 6, 6, 9, 23, 12], 4, 3, 0, False)
-                        [2, 5, 2, 6, 9, 23]
-                        >>> get_window([8, 2, 5, 2, 6, 6, 9, 23, 12], 4, 3, 1, True)
-                        [2, 5, 6, 9, 23]
-                        >>> get_window([8, 2, 5, 2, 6, 6, 9, 23, 12], 4, 3, 1, False)
-                        [2, 5, 9, 23]
-
-                Therefore:
-                    - ninner >= 0
-                    - ninner <= nouter
-                    - index >= nouter
-                    - index < values.size()
-        
-                It will clip at (0, len(values)))pbdoc",
-            py::arg("values"),
-            py::arg("centerindex"),
-            py::arg("nouter") = 5,
-            py::arg("ninner") = 0,
-            py::arg("includeindex") = true);
+// The type dependent bindings are registered for each floating point type,
+// double keeps the original names and float (single precision) adds the
+// F32 suffix, i.e. NumericalData and NumericalDataF32
 
+template<typename T>
+void register_numerical(py::module& m_core, const std::string& suffix) {
     // core numerical object - tries to be like numpy array
     // but why you ask?
     // well this is a custom type specific for custom operations
     // like SNIP and others, that can be implemented in python
     // but we want it as quick as possible
     // can swap between numpy if need be
-    using NumericalDataCoreType = double;
+    using NumericalDataCoreType = T;
     using NumericalDataPyType = core::NumericalData<NumericalDataCoreType,core::ArrayTypeDynamic>;
-    py::class_<NumericalDataPyType>(m_core, "NumericalData",
+    py::class_<NumericalDataPyType>(m_core, (std::string("NumericalData") + suffix).c_str(),
 	       R"pbdoc(
                  Represents a 1-dimensional data structure of floats 
                  (basically a 1D Eigen array)
@@ -119,29 +71,56 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
                  sorted properly first!)pbdoc")
         .def(py::init<>())
         .def(py::init<const std::vector<NumericalDataCoreType>&>())
-        .def(py::init<const Eigen::Ref<core::Array1Dd>&>())
-        .def(py::self + py::self)
-        .def(py::self + NumericalDataCoreType())
-        .def(py::self - py::self)
-        .def(py::self - NumericalDataCoreType())
-        .def(py::self * NumericalDataCoreType())
-        .def(py::self / NumericalDataCoreType())
-        .def(py::self * py::self)
-        .def(py::self / py::self)
+        .def(py::init<const Eigen::Ref<core::Array1D<NumericalDataCoreType>>&>())
+        // arithmetic on arrays is lazy in C++, here each result is evaluated into a new array
+        .def("__add__", [](const NumericalDataPyType& lhs, const NumericalDataPyType& rhs){
+            return NumericalDataPyType(lhs + rhs);
+        }, py::is_operator())
+        .def("__add__", [](const NumericalDataPyType& lhs, NumericalDataCoreType rhs){
+            return NumericalDataPyType(lhs + rhs);
+        }, py::is_operator())
+        .def("__radd__", [](const NumericalDataPyType& rhs, NumericalDataCoreType lhs){
+            return NumericalDataPyType(lhs + rhs);
+        }, py::is_operator())
+        .def("__sub__", [](const NumericalDataPyType& lhs, const NumericalDataPyType& rhs){
+            return NumericalDataPyType(lhs - rhs);
+        }, py::is_operator())
+        .def("__sub__", [](const NumericalDataPyType& lhs, NumericalDataCoreType rhs){
+            return NumericalDataPyType(lhs - rhs);
+        }, py::is_operator())
+        .def("__rsub__", [](const NumericalDataPyType& rhs, NumericalDataCoreType lhs){
+            return NumericalDataPyType(lhs - rhs);
+        }, py::is_operator())
+        .def("__mul__", [](const NumericalDataPyType& lhs, const NumericalDataPyType& rhs){
+            return NumericalDataPyType(lhs * rhs);
+        }, py::is_operator())
+        .def("__mul__", [](const NumericalDataPyType& lhs, NumericalDataCoreType rhs){
+            return NumericalDataPyType(lhs * rhs);
+        }, py::is_operator())
+        .def("__rmul__", [](const NumericalDataPyType& rhs, NumericalDataCoreType lhs){
+            return NumericalDataPyType(lhs * rhs);
+        }, py::is_operator())
+        .def("__truediv__", [](const NumericalDataPyType& lhs, const NumericalDataPyType& rhs){
+            return NumericalDataPyType(lhs / rhs);
+        }, py::is_operator())
+        .def("__truediv__", [](const NumericalDataPyType& lhs, NumericalDataCoreType rhs){
+            return NumericalDataPyType(lhs / rhs);
+        }, py::is_operator())
+        .def("__rtruediv__", [](const NumericalDataPyType& rhs, NumericalDataCoreType lhs){
+            return NumericalDataPyType(lhs / rhs);
+        }, py::is_operator())
         .def(py::self += py::self)
         .def(py::self -= py::self)
         .def(py::self *= NumericalDataCoreType())
         .def(py::self /= NumericalDataCoreType())
         .def(py::self *= py::self)
         .def(py::self /= py::self)
-        .def(NumericalDataCoreType() + py::self)
-        .def(NumericalDataCoreType() - py::self)
-        .def(NumericalDataCoreType() * py::self)
-        .def(NumericalDataCoreType() / py::self)
-        .def(-py::self)
+        .def("__neg__", [](const NumericalDataPyType& data){
+            return NumericalDataPyType(-data);
+        }, py::is_operator())
         .def("__call__",
              [](const NumericalDataPyType& data, int sindex, int eindex) {
-                 return data(sindex, eindex);
+                 return NumericalDataPyType(data(sindex, eindex));
              })
         .def("__iter__", 
              [](const NumericalDataPyType &data) { 
@@ -171,23 +150,31 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
         .def("stddev", [](const NumericalDataPyType& data, int ddof){
             return data.stddev(ddof);
         }, py::arg("ddof") = 0)
+        .def("statistics", [](const NumericalDataPyType& data){
+            return data.statistics();
+        }, R"pbdoc(
+              The count, sum, mean, variance, min, max, argmin and argmax
+              in a single (numerically stable) pass.
+
+              Returns:
+                  A Statistics object.)pbdoc")
         .def("sum", [](const NumericalDataPyType& data){
             return data.sum();
         })
         .def("exp", [](const NumericalDataPyType& data){
-            return data.exp();
+            return NumericalDataPyType(data.exp());
         })
         .def("log", [](const NumericalDataPyType& data){
-            return data.log();
+            return NumericalDataPyType(data.log());
         })
         .def("sqrt", [](const NumericalDataPyType& data){
-            return data.sqrt();
+            return NumericalDataPyType(data.sqrt());
         })
         .def("square", [](const NumericalDataPyType& data){
-            return data.square();
+            return NumericalDataPyType(data.square());
         })
         .def("pow", [](const NumericalDataPyType& data, NumericalDataCoreType exponent){
-            return data.pow(exponent);
+            return NumericalDataPyType(data.pow(exponent));
         })
         .def("reverse", [](const NumericalDataPyType& data){
             return data.reverse();
@@ -197,8 +184,18 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
         })
         .def("from_list", &NumericalDataPyType::from_vector)
         .def("to_list", &NumericalDataPyType::to_vector)
-        .def("slice", &NumericalDataPyType::slice)
-        .def("LLS", &NumericalDataPyType::LLS,
+        .def("to_float32", &NumericalDataPyType::template cast<float>,
+	     R"pbdoc(
+              A single precision (float32) copy of the array.)pbdoc")
+        .def("to_float64", &NumericalDataPyType::template cast<double>,
+	     R"pbdoc(
+              A double precision (float64) copy of the array.)pbdoc")
+        .def("slice", [](const NumericalDataPyType& data, int sindex, int eindex) {
+            return NumericalDataPyType(data.slice(sindex, eindex));
+        })
+        .def("LLS", [](const NumericalDataPyType& data){
+            return NumericalDataPyType(data.LLS());
+        },
 	     R"pbdoc(
               log(log(sqrt(value + 1) + 1) + 1)
 
@@ -209,7 +206,9 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
               log(log(sqrt(value + 1) + 1) + 1)
 
               Changes the underlying array.)pbdoc")
-        .def("inverseLLS", &NumericalDataPyType::inverseLLS,
+        .def("inverseLLS", [](const NumericalDataPyType& data){
+            return NumericalDataPyType(data.inverseLLS());
+        },
 	     R"pbdoc(
                exp(exp(sqrt(value + 1) + 1) + 1)
 
@@ -291,7 +290,65 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
               threshold (>=). This is useful to remove entries that
               are negative for example.
 
-              Mutates underlyindg data.)pbdoc");
+              Mutates underlyindg data.)pbdoc")
+        .def("clip", &NumericalDataPyType::clip, R"pbdoc(
+              Limit the values to the range [lower, upper].
+
+              Returns:
+                  A new array.)pbdoc",
+            py::arg("lower"),
+            py::arg("upper"))
+        .def("clipInPlace", &NumericalDataPyType::clipInPlace, R"pbdoc(
+              Limit the values to the range [lower, upper].
+
+              Mutates underlying data.)pbdoc",
+            py::arg("lower"),
+            py::arg("upper"))
+        .def("zeroBelow", &NumericalDataPyType::zeroBelow, R"pbdoc(
+              Set all values at or below the threshold (<=) 
+              to zero, only values strictly above are kept.
+
+              Returns:
+                  A new array.)pbdoc",
+            py::arg("threshold"))
+        .def("zeroBelowInPlace", &NumericalDataPyType::zeroBelowInPlace, R"pbdoc(
+              Set all values at or below the threshold (<=) 
+              to zero, only values strictly above are kept.
+
+              Mutates underlying data.)pbdoc",
+            py::arg("threshold"))
+        .def("mask", &NumericalDataPyType::mask, R"pbdoc(
+              Keep only the values where the mask is non-zero,
+              all other values are set to zero.
+
+              Returns:
+                  A new array.)pbdoc",
+            py::arg("mask"))
+        .def("maskInPlace", &NumericalDataPyType::maskInPlace, R"pbdoc(
+              Keep only the values where the mask is non-zero,
+              all other values are set to zero.
+
+              Mutates underlying data.)pbdoc",
+            py::arg("mask"));
+
+    using StatisticsPyType = core::Statistics<NumericalDataCoreType>;
+    py::class_<StatisticsPyType>(m_core, (std::string("Statistics") + suffix).c_str(),
+	       R"pbdoc(
+                 The summary statistics of an array, from a single pass.
+                 argmin and argmax are the first index of the min and max.)pbdoc")
+        .def(py::init<>())
+        .def_readonly("count", &StatisticsPyType::count)
+        .def_readonly("sum", &StatisticsPyType::sum)
+        .def_readonly("mean", &StatisticsPyType::mean)
+        .def_readonly("min", &StatisticsPyType::min)
+        .def_readonly("max", &StatisticsPyType::max)
+        .def_readonly("argmin", &StatisticsPyType::argmin)
+        .def_readonly("argmax", &StatisticsPyType::argmax)
+        .def("variance", &StatisticsPyType::variance, py::arg("ddof") = 0)
+        .def("stddev", &StatisticsPyType::stddev, py::arg("ddof") = 0)
+        .def("merge", &StatisticsPyType::merge, R"pbdoc(
+              Combine with the statistics of the values that follow.)pbdoc",
+            py::arg("other"));
 
     m_core.def("combine", &core::combine<NumericalDataCoreType,core::ArrayTypeDynamic>);
     m_core.def("window", &core::window<NumericalDataCoreType,core::ArrayTypeDynamic>,
@@ -300,124 +357,131 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
             py::arg("nouter") = 5,
             py::arg("ninner") = 0,
             py::arg("includeindex") = true);
+}
 
-    // integral type
-    using IntegerDataCoreType = int;
-    using IntegerDataPyType = core::NumericalData<IntegerDataCoreType,core::ArrayTypeDynamic>;
-    py::class_<IntegerDataPyType>(m_core, "IntegerData",
+template<typename T>
+void register_batch(py::module& m_core, const std::string& suffix) {
+    // batch of spectra
+    using NumericalDataCoreType = T;
+    using NumericalDataPyType = core::NumericalData<NumericalDataCoreType,core::ArrayTypeDynamic>;
+    using NumericalBatchPyType = core::NumericalBatch<NumericalDataCoreType>;
+    py::class_<NumericalBatchPyType>(m_core, (std::string("NumericalBatch") + suffix).c_str(),
 		 R"pbdoc(
-                 Represents a 1-dimensional data structure of ints
-                 (basically a 1D Eigen array)
-
-                 Dynamic array - most use cases will be determined at
-                 runtime (I am assuming).  We don't want anyone to
-                 know we are using Eigen beyond this file, since (in
-                 theory) it should make it easier to change library if
-                 need be. We only really need the array datastructure
-                 from Eigen and not much else and instead of
-                 reinventing the wheel, we wrap Eigen array.
+                 A batch of spectra all with the same number of channels.
 
-                 We wrap this with private inheritance on the Eigen
-                 type but there are a lot of methods to expose, easy
-                 to add when/if we need them.
-        
-                 Eigen array is pretty good, it has things like sqrt,
-                 exp on array coefficients, but we need to extend this
-                 to other functions, so we use CRTP to do this.
-
-                 For all of this, you may ask why not just use Eigen
-                 and use an alias?  Well for one, we don't need all of
-                 Eigen just the array, and not all of the array type
-                 (we require a simpler interface). Additionally, at
-                 some point we may wish to use another data structure
-                 as std::array for example.  In this case we just
-                 change the NumericalData class to wrap that instead.
-                 If we change the alias this could break existing
-                 interfaces and APIs, causing big changes later
-                 on. Since this datastructure is fundamental to
-                 everything we need to make sure that we have this
-                 sorted properly first!)pbdoc")
+                 Stored as a single contiguous channels x spectra array,
+                 so that the numerical functions, smoothers and filters 
+                 can be applied to all spectra in one call, rather than
+                 one call per spectrum.)pbdoc")
         .def(py::init<>())
-        .def(py::init<const std::vector<IntegerDataCoreType>&>())
-        .def(py::init<const Eigen::Ref<core::Array1Di>&>())
-        .def(py::self + py::self)
-        .def(py::self + IntegerDataCoreType())
-        .def(py::self - py::self)
-        .def(py::self - IntegerDataCoreType())
-        .def(py::self * IntegerDataCoreType())
-        .def(py::self / IntegerDataCoreType())
-        .def(py::self * py::self)
-        .def(py::self / py::self)
-        .def(py::self += py::self)
-        .def(py::self -= py::self)
-        .def(py::self *= IntegerDataCoreType())
-        .def(py::self /= IntegerDataCoreType())
-        .def(py::self *= py::self)
-        .def(py::self /= py::self)
-        .def(IntegerDataCoreType() + py::self)
-        .def(IntegerDataCoreType() - py::self)
-        .def(IntegerDataCoreType() * py::self)
-        .def(IntegerDataCoreType() / py::self)
-        .def(-py::self)
-        .def("__call__",
-             [](const IntegerDataPyType& data, int sindex, int eindex) {
-                 return data(sindex, eindex);
-             })
-        .def("__iter__", 
-             [](const IntegerDataPyType &data) { 
-                return py::make_iterator(data.begin(), data.end()); 
-             }, py::keep_alive<0, 1>() /* Essential: keep object alive while iterator exists */)
-        .def("__len__", 
-             [](const IntegerDataPyType& data) {
-                 return data.size();
-             })
-        .def("__getitem__",
-             [](const IntegerDataPyType& data, size_t index) {
-                 return data[index];
-             })
-        .def("__setitem__",
-             [](IntegerDataPyType& data, size_t index, IntegerDataCoreType value) {
-                data[index] = value;
-             })
-        .def("maxCoeff", [](const IntegerDataPyType& data){
-            return data.maxCoeff();
-        })
-        .def("minCoeff", [](const IntegerDataPyType& data){
-            return data.minCoeff();
-        })
-        .def("sum", [](const IntegerDataPyType& data){
-            return data.sum();
-        })
-        .def("reverse", [](const IntegerDataPyType& data){
-            return data.reverse();
+        .def(py::init<int, int>(), py::arg("nchannels"), py::arg("nspectra"))
+        .def(py::init<const std::vector<NumericalDataPyType>&>(), py::arg("spectra"))
+        .def(py::init([](const Eigen::Array<NumericalDataCoreType, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>& values){
+            // numpy arrays are (spectra, channels) in C order, which is 
+            // the same memory layout as the batch
+            return NumericalBatchPyType(values.transpose());
+        }), R"pbdoc(
+              Construct from a 2D numpy array of shape (nspectra, nchannels).)pbdoc",
+            py::arg("values"))
+        .def_property_readonly("nchannels", &NumericalBatchPyType::nchannels)
+        .def_property_readonly("nspectra", &NumericalBatchPyType::nspectra)
+        .def("__len__", &NumericalBatchPyType::nspectra)
+        .def("__getitem__", [](const NumericalBatchPyType& batch, int index) {
+            if(index < 0 || index >= batch.nspectra())
+                throw py::index_error();
+            return NumericalDataPyType(batch.spectrum(index));
         })
-        .def("reverseInPlace", [](IntegerDataPyType& data){
-            data.reverseInPlace();
+        .def("spectrum", [](const NumericalBatchPyType& batch, int index) {
+            return NumericalDataPyType(batch.spectrum(index));
+        }, R"pbdoc(
+              A copy of a single spectrum in the batch.)pbdoc",
+            py::arg("index"))
+        .def("to_list", &NumericalBatchPyType::to_vector)
+        .def("to_float32", &NumericalBatchPyType::template cast<float>)
+        .def("to_float64", &NumericalBatchPyType::template cast<double>)
+        .def("maxCoeffs", &NumericalBatchPyType::maxCoeffs)
+        .def("LLS", &NumericalBatchPyType::LLS)
+        .def("LLSInPlace", &NumericalBatchPyType::LLSInPlace)
+        .def("inverseLLS", &NumericalBatchPyType::inverseLLS)
+        .def("inverseLLSInPlace", &NumericalBatchPyType::inverseLLSInPlace)
+        .def("midpoint", &NumericalBatchPyType::midpoint, py::arg("order")=1)
+        .def("midpointInPlace", &NumericalBatchPyType::midpointInPlace, py::arg("order")=1)
+        .def("gradient", &NumericalBatchPyType::gradient, py::arg("order")=1)
+        .def("gradientInPlace", &NumericalBatchPyType::gradientInPlace, py::arg("order")=1)
+        .def("snip", [](const NumericalBatchPyType& batch, int niterations){
+            return batch.snip(niterations);
+        }, py::arg("niterations") = 20)
+        .def("snip", [](const NumericalBatchPyType& batch, const std::vector<int>& iteration_list){
+            return batch.snip(iteration_list.begin(), iteration_list.end());
         })
-        .def("slice", &IntegerDataPyType::slice)
-        .def("from_list", &IntegerDataPyType::from_vector)
-        .def("to_list", &IntegerDataPyType::to_vector)
-      .def("ramp", &IntegerDataPyType::ramp, R"pbdoc(
-              A simple function for filtering values above a certain
-              threshold (>=). This is useful to remove entries that
-              are negative for example.
+        .def("snipInPlace", &NumericalBatchPyType::snipInPlace, py::arg("niterations") = 20)
+        .def("ramp", (NumericalBatchPyType (NumericalBatchPyType::*)(const NumericalDataCoreType&) const)&NumericalBatchPyType::ramp,
+            py::arg("threshold"))
+        .def("rampInPlace", (NumericalBatchPyType& (NumericalBatchPyType::*)(const NumericalDataCoreType&))&NumericalBatchPyType::rampInPlace,
+            py::arg("threshold"))
+        .def("clip", &NumericalBatchPyType::clip, py::arg("lower"), py::arg("upper"))
+        .def("clipInPlace", &NumericalBatchPyType::clipInPlace, py::arg("lower"), py::arg("upper"))
+        .def("zeroBelow", &NumericalBatchPyType::zeroBelow, py::arg("threshold"))
+        .def("zeroBelowInPlace", &NumericalBatchPyType::zeroBelowInPlace, py::arg("threshold"));
+}
 
-              Returns:
-                  A new array.)pbdoc")
-      .def("rampInPlace", &IntegerDataPyType::rampInPlace, R"pbdoc(
-              A simple function for filtering values above a certain
-              threshold (>=). This is useful to remove entries that
-              are negative for example.
+// a scipy.signal.find_peaks condition, None, a lower limit or a 
+// (lower, upper) tuple, each limit None, a number or an array
+template<typename T>
+core::PeakCondition<T> to_peak_condition(const py::object& condition) {
+    using NumericalDataPyType = core::NumericalData<T,core::ArrayTypeDynamic>;
+    const auto to_limit = [](const py::handle& limit){
+        if(limit.is_none()){
+            return NumericalDataPyType();
+        }
+        if(py::isinstance<py::float_>(limit) || py::isinstance<py::int_>(limit)){
+            return NumericalDataPyType(std::vector<T>{limit.cast<T>()});
+        }
+        if(py::isinstance<NumericalDataPyType>(limit)){
+            return limit.cast<NumericalDataPyType>();
+        }
+        return NumericalDataPyType(limit.cast<std::vector<T>>());
+    };
 
-              Mutates underlyindg data.)pbdoc");
+    if(py::isinstance<py::tuple>(condition)){
+        const py::tuple limits = condition.cast<py::tuple>();
+        if(limits.size() != 2){
+            throw py::value_error("A peak condition tuple must be (lower, upper).");
+        }
+        return core::PeakCondition<T>(to_limit(py::object(limits[0])), to_limit(py::object(limits[1])));
+    }
+    return core::PeakCondition<T>(to_limit(condition));
+}
+
+// a numpy array of a PeakTable column sharing its memory, the table
+// is kept alive and pinned (its columns can not move) by the array
+template<typename Table, typename Value>
+py::array_t<Value> to_column_array(const py::object& self, const Value* values, int size, bool writeable=true) {
+    py::capsule owner(new py::object(self), [](void* pointer){
+        py::object* table = static_cast<py::object*>(pointer);
+        table->cast<Table&>().unpin();
+        delete table;
+    });
+    self.cast<Table&>().pin();
+    py::array_t<Value> column({static_cast<py::ssize_t>(size)}, {static_cast<py::ssize_t>(sizeof(Value))}, values, owner);
+    if(!writeable){
+        column.attr("setflags")(false);
+    }
+    return column;
+}
 
+template<typename T>
+void register_processes(py::module& m_core, const std::string& suffix) {
     // core process object
+    using NumericalDataCoreType = T;
+    using NumericalDataPyType = core::NumericalData<NumericalDataCoreType,core::ArrayTypeDynamic>;
+    using NumericalBatchPyType = core::NumericalBatch<NumericalDataCoreType>;
     using IProcessPyType = core::IProcess<NumericalDataCoreType,core::ArrayTypeDynamic>;
 
     class PyProcess : public IProcessPyType {
         public:
             /* Inherit the constructors */
-            using IProcessPyType::IProcess;
+            using IProcessPyType::IProcessPyType;
 
             /* Trampoline (need one for each virtual function) */
             NumericalDataPyType
@@ -431,7 +495,7 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
             }
     };
 
-    py::class_<IProcessPyType, PyProcess, std::shared_ptr<IProcessPyType>>(m_core, "IProcess",
+    py::class_<IProcessPyType, PyProcess, std::shared_ptr<IProcessPyType>>(m_core, (std::string("IProcess") + suffix).c_str(),
 		 R"pbdoc(
                  Interface for all process algorithms
 
@@ -441,7 +505,8 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
                  Returns:
                      A new numerical array.)pbdoc")
         .def(py::init_alias<>())
-        .def("go", &IProcessPyType::go);
+        .def("go", (NumericalDataPyType (IProcessPyType::*)(const NumericalDataPyType&) const)&IProcessPyType::go)
+        .def("go", (NumericalBatchPyType (IProcessPyType::*)(const NumericalBatchPyType&) const)&IProcessPyType::go);
 
     // process manager
     using IProcessManagerPyType = core::IProcessManager<NumericalDataCoreType,core::ArrayTypeDynamic>;
@@ -449,14 +514,14 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
     class PyProcessManager : public IProcessManagerPyType {
         public:
             /* Inherit the constructors */
-            using IProcessManagerPyType::IProcessManager;
+            using IProcessManagerPyType::IProcessManagerPyType;
 
             /* Trampoline (need one for each virtual function) */
-            IProcessManager&
+            IProcessManagerPyType&
             append(const std::shared_ptr<IProcessPyType>& process) override {
                 PYBIND11_OVERLOAD_PURE(
-                    IProcessManager&,   /* Return type */
-                    IProcessManager,    /* Parent class */
+                    IProcessManagerPyType&,     /* Return type */
+                    IProcessManagerPyType,      /* Parent class */
                     append,             /* Name of function in C++ (must match Python name) */
                     process             /* Argument(s) */
                 );
@@ -466,7 +531,7 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
             run(const NumericalDataPyType& data) const override {
                 PYBIND11_OVERLOAD_PURE(
                     NumericalDataPyType,    /* Return type */
-                    IProcessManager,        /* Parent class */
+                    IProcessManagerPyType,  /* Parent class */
                     run,                    /* Name of function in C++ (must match Python name) */
                     data                    /* Argument(s) */
                 );
@@ -476,7 +541,7 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
             size() const override {
                 PYBIND11_OVERLOAD_PURE(
                     size_t,                 /* Return type */
-                    IProcessManager,        /* Parent class */
+                    IProcessManagerPyType,  /* Parent class */
                     size                    /* Name of function in C++ (must match Python name) */
                 );
             }
@@ -485,42 +550,47 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
             reset() override {
                 PYBIND11_OVERLOAD_PURE(
                     void,                   /* Return type */
-                    IProcessManager,        /* Parent class */
+                    IProcessManagerPyType,  /* Parent class */
                     reset                   /* Name of function in C++ (must match Python name) */
                 );
             }
     };
 
-    py::class_<IProcessManagerPyType, PyProcessManager, std::shared_ptr<IProcessManagerPyType>>(m_core, "IProcessManager", "A general process manager interface")
+    py::class_<IProcessManagerPyType, PyProcessManager, std::shared_ptr<IProcessManagerPyType>>(m_core, (std::string("IProcessManager") + suffix).c_str(), "A general process manager interface")
         .def(py::init_alias<>())
         .def("append", &IProcessManagerPyType::append)
-        .def("run", &IProcessManagerPyType::run)
+        .def("run", (NumericalDataPyType (IProcessManagerPyType::*)(const NumericalDataPyType&) const)&IProcessManagerPyType::run)
+        .def("run", (NumericalBatchPyType (IProcessManagerPyType::*)(const NumericalBatchPyType&) const)&IProcessManagerPyType::run)
         .def("__len__", &IProcessManagerPyType::size)
         .def("reset", &IProcessManagerPyType::reset);
 
     // simple process manager
     using SimpleProcessManagerPyType = core::SimpleProcessManager<NumericalDataCoreType,core::ArrayTypeDynamic>;
-    py::class_<SimpleProcessManagerPyType, IProcessManagerPyType, std::shared_ptr<SimpleProcessManagerPyType>>(m_core, "SimpleProcessManager", "A simple process manager")
+    py::class_<SimpleProcessManagerPyType, IProcessManagerPyType, std::shared_ptr<SimpleProcessManagerPyType>>(m_core, (std::string("SimpleProcessManager") + suffix).c_str(), "A simple process manager")
         .def(py::init<>())
         .def("append", &SimpleProcessManagerPyType::append)
-        .def("run", &SimpleProcessManagerPyType::run)
+        .def("run", (NumericalDataPyType (SimpleProcessManagerPyType::*)(const NumericalDataPyType&) const)&SimpleProcessManagerPyType::run)
+        .def("run", (NumericalBatchPyType (SimpleProcessManagerPyType::*)(const NumericalBatchPyType&) const)&SimpleProcessManagerPyType::run)
         .def("__len__", &SimpleProcessManagerPyType::size)
         .def("reset", &SimpleProcessManagerPyType::reset);
 
     // smoothing objects
     using MovingAverageSmootherPyType = core::MovingAverageSmoother<NumericalDataCoreType,core::ArrayTypeDynamic>;
-    py::class_<MovingAverageSmootherPyType, IProcessPyType, std::shared_ptr<MovingAverageSmootherPyType>>(m_core, "MovingAverageSmoother",
+    py::class_<MovingAverageSmootherPyType, IProcessPyType, std::shared_ptr<MovingAverageSmootherPyType>>(m_core, (std::string("MovingAverageSmoother") + suffix).c_str(),
 		 R"pbdoc(
                   Simple moving average smoother
 
-                  Can we support windowsize given at compile time too?
-                  It would certainly help with unit tests.)pbdoc")
-        .def(py::init<int>());
+                  Uses a running (compensated) sum, so it is O(N)
+                  for any window size. The edges are kept as they are
+                  unless edgemode is EdgeMode.Truncate.)pbdoc")
+        .def(py::init<int, core::EdgeMode>(),
+            py::arg("windowsize"),
+            py::arg("edgemode") = core::EdgeMode::Keep);
 
     using WeightedMovingAverageSmootherPyType = core::WeightedMovingAverageSmoother<NumericalDataCoreType,core::ArrayTypeDynamic>;
-    py::class_<WeightedMovingAverageSmootherPyType, IProcessPyType, std::shared_ptr<WeightedMovingAverageSmootherPyType>>(m_core, "WeightedMovingAverageSmoother",
+    py::class_<WeightedMovingAverageSmootherPyType, IProcessPyType, std::shared_ptr<WeightedMovingAverageSmootherPyType>>(m_core, (std::string("WeightedMovingAverageSmoother") + suffix).c_str(),
 		 R"pbdoc(
-                  Simple moving average smoother
+                  Weighted moving average smoother
 
                  Uses weights determined, with windowsize = N
                      - if N=1, weights=[1] -> [1/N]
@@ -528,27 +598,228 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
                      - if N=3, weights=[1,2,1] -> [1/4, 2/4, 1/4]
                      - if N=4, weights=[1,2,2,1] -> [1/6, 2/6, 2/6, 1/6]
                      - if N=5, weights=[1,2,3,2,1] -> [1/9, 2/9, 3/9, 2/9, 1/9]
-                     - ...)pbdoc")
+                     - ...
+
+                 centred as numpy.convolve mode='same', the first and
+                 last N points are kept. Done as two box filters in
+                 cascade so O(N) for any window size.)pbdoc")
         .def(py::init<int>());
 
+    using SavitzkyGolaySmootherPyType = core::SavitzkyGolaySmoother<NumericalDataCoreType,core::ArrayTypeDynamic>;
+    py::class_<SavitzkyGolaySmootherPyType, IProcessPyType, std::shared_ptr<SavitzkyGolaySmootherPyType>>(m_core, (std::string("SavitzkyGolaySmoother") + suffix).c_str(),
+		 R"pbdoc(
+                  Savitzky-Golay smoother (or differentiator)
+
+                  The same as scipy.signal.savgol_filter with mode='interp',
+                  windowsize is the full (odd) window length. The
+                  coefficients are cached for each windowsize, order
+                  and deriv.
+
+                  deriv > 0 gives the derivative, with delta the spacing
+                  of the points.)pbdoc")
+        .def(py::init<int, int, int, NumericalDataCoreType>(),
+            py::arg("windowsize"),
+            py::arg("order") = 2,
+            py::arg("deriv") = 0,
+            py::arg("delta") = 1.0);
+
+    // convolution
+    using ConvolutionEnginePyType = core::ConvolutionEngine<NumericalDataCoreType>;
+    py::class_<ConvolutionEnginePyType>(m_core, (std::string("ConvolutionEngine") + suffix).c_str(),
+		 R"pbdoc(
+                  Convolves data with a kernel, the same as
+                  numpy.convolve(data, kernel, mode='same').
+
+                  Done directly, by FFT (overlap-save) or as running
+                  sums (for boxes), the FFT plan and kernel spectrum
+                  are kept between calls.)pbdoc")
+        .def(py::init<NumericalDataPyType, core::ConvolutionMethod>(),
+            py::arg("kernel"),
+            py::arg("method") = core::ConvolutionMethod::Automatic)
+        .def_static("boxes", &ConvolutionEnginePyType::boxes,
+            R"pbdoc(
+                 The kernel scale*box(widths[0])*box(widths[1])*...,
+                 where box(w) is w ones, as a cascade of running sums.)pbdoc",
+            py::arg("widths"),
+            py::arg("scale") = 1.0,
+            py::arg("method") = core::ConvolutionMethod::Automatic)
+        .def_property_readonly("kernel", &ConvolutionEnginePyType::kernel)
+        .def("method", &ConvolutionEnginePyType::method, py::arg("datasize"))
+        .def("convolve", [](ConvolutionEnginePyType& engine, const NumericalDataPyType& data) {
+                return engine.convolve(data);
+            },
+            py::arg("data"));
+
+    m_core.def((std::string("convolve") + suffix).c_str(), 
+            [](const NumericalDataPyType& data, const NumericalDataPyType& kernel, core::ConvolutionMethod method) {
+                return core::convolve<NumericalDataCoreType>(data, kernel, method);
+            },
+            R"pbdoc(
+                 Convolve the data with the kernel, as 
+                 numpy.convolve(data, kernel, mode='same'))pbdoc",
+            py::arg("data"),
+            py::arg("kernel"),
+            py::arg("method") = core::ConvolutionMethod::Automatic);
+    m_core.def((std::string("correlate") + suffix).c_str(), 
+            [](const NumericalDataPyType& data, const NumericalDataPyType& kernel, core::ConvolutionMethod method) {
+                return core::correlate<NumericalDataCoreType>(data, kernel, method);
+            },
+            R"pbdoc(
+                 Correlate the data with the kernel, as 
+                 numpy.correlate(data, kernel, mode='same'))pbdoc",
+            py::arg("data"),
+            py::arg("kernel"),
+            py::arg("method") = core::ConvolutionMethod::Automatic);
+    m_core.def((std::string("gaussian_kernel") + suffix).c_str(), 
+            &core::gaussianKernel<NumericalDataCoreType>,
+            R"pbdoc(
+                 The normalised Gaussian kernel out to truncate standard 
+                 deviations either side.)pbdoc",
+            py::arg("sigma"),
+            py::arg("truncate") = 4.0);
+
+    using ConvolutionSmootherPyType = core::ConvolutionSmoother<NumericalDataCoreType,core::ArrayTypeDynamic>;
+    py::class_<ConvolutionSmootherPyType, IProcessPyType, std::shared_ptr<ConvolutionSmootherPyType>>(m_core, (std::string("ConvolutionSmoother") + suffix).c_str(),
+		 R"pbdoc(
+                  Smooths by convolution with a (odd sized) kernel
+
+                  Picks direct or FFT convolution from the kernel and
+                  data size. The edges are kept as they are unless
+                  edgemode is EdgeMode.Truncate.)pbdoc")
+        .def(py::init<NumericalDataPyType, core::EdgeMode, core::ConvolutionMethod>(),
+            py::arg("kernel"),
+            py::arg("edgemode") = core::EdgeMode::Keep,
+            py::arg("method") = core::ConvolutionMethod::Automatic)
+        .def(py::init<ConvolutionEnginePyType, core::EdgeMode>(),
+            py::arg("engine"),
+            py::arg("edgemode") = core::EdgeMode::Keep)
+        .def_property_readonly("kernel", &ConvolutionSmootherPyType::kernel);
+
+    m_core.def((std::string("make_gaussian_smoother") + suffix).c_str(), 
+            &core::makeGaussianSmoother<NumericalDataCoreType,core::ArrayTypeDynamic>,
+            R"pbdoc(
+                 Create a Gaussian smoother, a ConvolutionSmoother 
+                 with gaussian_kernel(sigma, truncate).)pbdoc",
+            py::arg("sigma"),
+            py::arg("truncate") = 4.0,
+            py::arg("edgemode") = core::EdgeMode::Keep);
+    m_core.def((std::string("make_triangular_smoother") + suffix).c_str(), 
+            &core::makeTriangularSmoother<NumericalDataCoreType,core::ArrayTypeDynamic>,
+            R"pbdoc(
+                 Create a triangular smoother, weights w+1-|i| for
+                 |i| <= windowsize, as two running sums so O(N).)pbdoc",
+            py::arg("windowsize"),
+            py::arg("edgemode") = core::EdgeMode::Keep);
+
+    // energy dependent (resolution) smoothing
+    using GaussianKernelBankPyType = core::GaussianKernelBank<NumericalDataCoreType>;
+    py::class_<GaussianKernelBankPyType, std::shared_ptr<GaussianKernelBankPyType>>(m_core, (std::string("GaussianKernelBank") + suffix).c_str(),
+		 R"pbdoc(
+                  The Gaussian kernel of every channel for a FWHM(E)
+                  calibration and the bin edges (nchannels + 1).
+
+                  Built once and reused for any number of spectra,
+                  each kernel is the Gaussian integrated over the bins
+                  out to truncate standard deviations.)pbdoc")
+        .def(py::init<core::NumericalData<double>, std::function<double(double)>, double, core::EdgeMode>(),
+            py::arg("edges"),
+            py::arg("fwhm"),
+            py::arg("truncate") = 4.0,
+            py::arg("edgemode") = core::EdgeMode::Keep)
+        .def_property_readonly("nchannels", &GaussianKernelBankPyType::nchannels)
+        .def("first", &GaussianKernelBankPyType::first, py::arg("channel"))
+        .def("kernel", [](const GaussianKernelBankPyType& bank, int channel) {
+                return NumericalDataPyType(bank.kernel(channel));
+            },
+            py::arg("channel"))
+        .def("apply", [](const GaussianKernelBankPyType& bank, const NumericalDataPyType& data) {
+                return bank.apply(data);
+            },
+            py::arg("data"));
+
+    using ResolutionSmootherPyType = core::ResolutionSmoother<NumericalDataCoreType,core::ArrayTypeDynamic>;
+    py::class_<ResolutionSmootherPyType, IProcessPyType, std::shared_ptr<ResolutionSmootherPyType>>(m_core, (std::string("ResolutionSmoother") + suffix).c_str(),
+		 R"pbdoc(
+                  Energy dependent Gaussian smoother, the width follows
+                  the detector resolution FWHM(E) across the spectrum.
+
+                  Only for data with the channels of the bin edges,
+                  the kernels are built once and shared.)pbdoc")
+        .def(py::init([](const std::shared_ptr<GaussianKernelBankPyType>& bank) {
+                return std::make_shared<ResolutionSmootherPyType>(bank);
+            }),
+            py::arg("bank"))
+        .def(py::init<core::NumericalData<double>, std::function<double(double)>, double, core::EdgeMode>(),
+            py::arg("edges"),
+            py::arg("fwhm"),
+            py::arg("truncate") = 4.0,
+            py::arg("edgemode") = core::EdgeMode::Keep);
+
+    // robust (order statistic) filters
+    using RollingQuantileFilterPyType = core::RollingQuantileFilter<NumericalDataCoreType,core::ArrayTypeDynamic>;
+    py::class_<RollingQuantileFilterPyType, IProcessPyType, std::shared_ptr<RollingQuantileFilterPyType>>(m_core, (std::string("RollingQuantileFilter") + suffix).c_str(),
+		 R"pbdoc(
+                  Rolling quantile filter, the quantile (as numpy.quantile)
+                  of the window of 2*windowsize + 1 points at each point.
+
+                  Robust to spikes, a low quantile with a wide window is
+                  a baseline estimate. O(N log W).)pbdoc")
+        .def(py::init<int, double, core::EdgeMode>(),
+            py::arg("windowsize"),
+            py::arg("quantile") = 0.5,
+            py::arg("edgemode") = core::EdgeMode::Keep)
+        .def_property_readonly("quantile", &RollingQuantileFilterPyType::quantile);
+
+    using RollingMedianFilterPyType = core::RollingMedianFilter<NumericalDataCoreType,core::ArrayTypeDynamic>;
+    py::class_<RollingMedianFilterPyType, RollingQuantileFilterPyType, std::shared_ptr<RollingMedianFilterPyType>>(m_core, (std::string("RollingMedianFilter") + suffix).c_str(),
+		 R"pbdoc(
+                  Rolling median filter, removes spikes narrower than
+                  the window of 2*windowsize + 1 points.)pbdoc")
+        .def(py::init<int, core::EdgeMode>(),
+            py::arg("windowsize"),
+            py::arg("edgemode") = core::EdgeMode::Keep);
+
+    // smoothers with a compile time window size for the common sizes
+    m_core.def((std::string("make_moving_average_smoother") + suffix).c_str(), 
+            &core::makeMovingAverageSmoother<NumericalDataCoreType,core::ArrayTypeDynamic>,
+            R"pbdoc(
+                 Create a moving average smoother, with the window size
+                 fixed at compile time for the common sizes (1 to 8) for
+                 speed, otherwise the same as MovingAverageSmoother.)pbdoc",
+            py::arg("windowsize"),
+            py::arg("edgemode") = core::EdgeMode::Keep);
+    m_core.def((std::string("make_weighted_moving_average_smoother") + suffix).c_str(), 
+            &core::makeWeightedMovingAverageSmoother<NumericalDataCoreType,core::ArrayTypeDynamic>,
+            R"pbdoc(
+                 Create a weighted moving average smoother, with the window 
+                 size fixed at compile time for the common sizes (1 to 8) for
+                 speed, otherwise the same as WeightedMovingAverageSmoother.)pbdoc",
+            py::arg("windowsize"));
+
     // peak filter objects
     using GlobalThresholdPeakFilterPyType = core::GlobalThresholdPeakFilter<NumericalDataCoreType,core::ArrayTypeDynamic>;
-    py::class_<GlobalThresholdPeakFilterPyType, IProcessPyType, std::shared_ptr<GlobalThresholdPeakFilterPyType>>(m_core, "GlobalThresholdPeakFilter", "Simple threshold global peak filter")
+    py::class_<GlobalThresholdPeakFilterPyType, IProcessPyType, std::shared_ptr<GlobalThresholdPeakFilterPyType>>(m_core, (std::string("GlobalThresholdPeakFilter") + suffix).c_str(), "Simple threshold global peak filter")
         .def(py::init<NumericalDataCoreType>());
 
     using ChunkedThresholdPeakFilterPyType = core::ChunkedThresholdPeakFilter<NumericalDataCoreType,core::ArrayTypeDynamic>;
-    py::class_<ChunkedThresholdPeakFilterPyType, IProcessPyType, std::shared_ptr<ChunkedThresholdPeakFilterPyType>>(m_core, "ChunkedThresholdPeakFilter", "Simple threshold local/chunked peak filter")
+    py::class_<ChunkedThresholdPeakFilterPyType, IProcessPyType, std::shared_ptr<ChunkedThresholdPeakFilterPyType>>(m_core, (std::string("ChunkedThresholdPeakFilter") + suffix).c_str(), 
+                R"pbdoc(
+                 Simple threshold local/chunked peak filter
+
+                 Points below percentThreshold of the maximum of their 
+                 chunk (of chunkSize points, the last may be shorter)
+                 are set to zero. The chunks are done concurrently.)pbdoc")
         .def(py::init<NumericalDataCoreType, size_t>(), 
             py::arg("percentThreshold"), 
             py::arg("chunkSize") = 10);
 
     using MovingAveragePeakFilterPyType = core::MovingAveragePeakFilter<NumericalDataCoreType,core::ArrayTypeDynamic>;
-    py::class_<MovingAveragePeakFilterPyType, IProcessPyType, std::shared_ptr<MovingAveragePeakFilterPyType>>(m_core, "MovingAveragePeakFilter", "Simple moving average peak filter")
+    py::class_<MovingAveragePeakFilterPyType, IProcessPyType, std::shared_ptr<MovingAveragePeakFilterPyType>>(m_core, (std::string("MovingAveragePeakFilter") + suffix).c_str(), "Simple moving average peak filter")
         .def(py::init<int>());
 
     // peak info struct
     using PeakInfoPyType = core::PeakInfo<NumericalDataCoreType>;
-    py::class_<PeakInfoPyType>(m_core, "PeakInfo" , R"pbdoc(
+    py::class_<PeakInfoPyType>(m_core, (std::string("PeakInfo") + suffix).c_str(), R"pbdoc(
                  Simple struct for holding peak info.
                  
                  Attributes:
@@ -564,13 +835,82 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
             return peak.value;
         });
 
+    // peaks as columns
+    using PeakTablePyType = core::PeakTable<NumericalDataCoreType>;
+    py::class_<PeakTablePyType>(m_core, (std::string("PeakTable") + suffix).c_str(), R"pbdoc(
+                 A table of peaks with one contiguous column per property,
+                 index, value, energy, area, width and score.
+
+                 The columns are numpy arrays sharing the memory of the 
+                 table (index is read only). While any of them is alive 
+                 the table is pinned, growing it beyond its capacity 
+                 (reserve, append or find_table) raises rather than 
+                 moving the columns, so reserve first or delete the 
+                 arrays. clear keeps the capacity so a table can be 
+                 reused with find_table.)pbdoc")
+        .def(py::init<>())
+        .def(py::init<const core::PeakList<NumericalDataCoreType>&>(), py::arg("peaks"))
+        .def("__len__", &PeakTablePyType::size)
+        .def("reserve", &PeakTablePyType::reserve, py::arg("npeaks"))
+        .def("clear", &PeakTablePyType::clear)
+        .def_property_readonly("capacity", &PeakTablePyType::capacity)
+        .def_property_readonly("pinned", &PeakTablePyType::pinned)
+        .def("append", [](PeakTablePyType& table, size_t index, NumericalDataCoreType value, NumericalDataCoreType energy,
+                          NumericalDataCoreType area, NumericalDataCoreType width, NumericalDataCoreType score){
+                table.append(index, value, energy, area, width, score);
+            },
+            py::arg("index"),
+            py::arg("value"),
+            py::arg("energy") = 0.0,
+            py::arg("area") = 0.0,
+            py::arg("width") = 0.0,
+            py::arg("score") = 0.0)
+        .def("sort_by", &PeakTablePyType::sortBy, "Sort the rows by a column (stable)",
+            py::arg("column"),
+            py::arg("descending") = false)
+        .def("filter", [](PeakTablePyType& table, core::PeakColumn column, NumericalDataCoreType lower, NumericalDataCoreType upper){
+                table.filter(column, lower, upper);
+            }, "Keep the rows with lower <= column <= upper",
+            py::arg("column"),
+            py::arg("lower"),
+            py::arg("upper"))
+        .def("to_peak_list", &PeakTablePyType::toPeakList)
+        .def_property_readonly("indices", [](const py::object& self){
+            const PeakTablePyType& table = self.cast<const PeakTablePyType&>();
+            return to_column_array<PeakTablePyType>(self, table.indices().data(), table.size(), false);
+        })
+        .def("column", [](const py::object& self, core::PeakColumn column){
+            PeakTablePyType& table = self.cast<PeakTablePyType&>();
+            return to_column_array<PeakTablePyType>(self, table.column(column).data(), table.size());
+        }, py::arg("column"))
+        .def_property_readonly("values", [](const py::object& self){
+            PeakTablePyType& table = self.cast<PeakTablePyType&>();
+            return to_column_array<PeakTablePyType>(self, table.values().data(), table.size());
+        })
+        .def_property_readonly("energies", [](const py::object& self){
+            PeakTablePyType& table = self.cast<PeakTablePyType&>();
+            return to_column_array<PeakTablePyType>(self, table.energies().data(), table.size());
+        })
+        .def_property_readonly("areas", [](const py::object& self){
+            PeakTablePyType& table = self.cast<PeakTablePyType&>();
+            return to_column_array<PeakTablePyType>(self, table.areas().data(), table.size());
+        })
+        .def_property_readonly("widths", [](const py::object& self){
+            PeakTablePyType& table = self.cast<PeakTablePyType&>();
+            return to_column_array<PeakTablePyType>(self, table.widths().data(), table.size());
+        })
+        .def_property_readonly("scores", [](const py::object& self){
+            PeakTablePyType& table = self.cast<PeakTablePyType&>();
+            return to_column_array<PeakTablePyType>(self, table.scores().data(), table.size());
+        });
+
     // core peak finding interface
     using IPeakFinderPyType = core::IPeakFinder<NumericalDataCoreType,core::ArrayTypeDynamic>;
 
     class PyPeakFinder : public IPeakFinderPyType {
         public:
             /* Inherit the constructors */
-            using IPeakFinderPyType::IPeakFinder;
+            using IPeakFinderPyType::IPeakFinderPyType;
 
             /* Trampoline (need one for each virtual function) */
             core::PeakList<NumericalDataCoreType>
@@ -584,7 +924,7 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
             }
     };
 
-    py::class_<IPeakFinderPyType, PyPeakFinder, std::shared_ptr<IPeakFinderPyType>>(m_core, "IPeakFinder",
+    py::class_<IPeakFinderPyType, PyPeakFinder, std::shared_ptr<IPeakFinderPyType>>(m_core, (std::string("IPeakFinder") + suffix).c_str(),
                 R"pbdoc(
                  Interface for peak finding algorithms
 
@@ -595,79 +935,414 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
                  Returns:
                      PeakList:  A list of peaks)pbdoc")
         .def(py::init_alias<>())
-    .def("find", &IPeakFinderPyType::find,
-	 "Identifies potential peaks in the data");
+    .def("find", [](const IPeakFinderPyType& finder, const NumericalDataPyType& data) {
+            return finder.find(data);
+        }, "Identifies potential peaks in the data",
+        py::arg("data"))
+    .def("find_table", [](const IPeakFinderPyType& finder, const NumericalDataPyType& data) {
+            PeakTablePyType table;
+            finder.find(data, table);
+            return table;
+        }, "Identifies potential peaks in the data as a PeakTable",
+        py::arg("data"))
+    .def("find_table", [](const IPeakFinderPyType& finder, const NumericalDataPyType& data, PeakTablePyType& table) {
+            finder.find(data, table);
+        }, "Identifies potential peaks in the data into the table, replacing its rows",
+        py::arg("data"),
+        py::arg("table"));
 
     // peak finder objects
     using SimplePeakFinderPyType = core::SimplePeakFinder<NumericalDataCoreType,core::ArrayTypeDynamic>;
-    py::class_<SimplePeakFinderPyType, IPeakFinderPyType, std::shared_ptr<SimplePeakFinderPyType>>(m_core, "SimplePeakFinder")
+    py::class_<SimplePeakFinderPyType, IPeakFinderPyType, std::shared_ptr<SimplePeakFinderPyType>>(m_core, (std::string("SimplePeakFinder") + suffix).c_str())
         .def(py::init<NumericalDataCoreType>(), 
             py::arg("threshold") = 0)
-        .def("find", &SimplePeakFinderPyType::find);
+        .def("find", [](const SimplePeakFinderPyType& finder, const NumericalDataPyType& data) {
+                return finder.find(data);
+            },
+            py::arg("data"));
 
-    // histogram objects
-    using HistPyType = core::Histogram<double,double>;
-    using HistChannelPyType = core::Histogram<int,double>;
+    using ChunkedSimplePeakFinderPyType = core::ChunkedSimplePeakFinder<NumericalDataCoreType,core::ArrayTypeDynamic>;
+    py::class_<ChunkedSimplePeakFinderPyType, IPeakFinderPyType, std::shared_ptr<ChunkedSimplePeakFinderPyType>>(m_core, (std::string("ChunkedSimplePeakFinder") + suffix).c_str(),
+                R"pbdoc(
+                 Breaks the spectrum up into nchunks (as numpy.array_split)
+                 applying the threshold relative to that chunk
+
+                 A group above the thresholds that crosses a chunk
+                 boundary is one peak. The chunks are done concurrently,
+                 the peaks are the same for any number of threads.)pbdoc")
+        .def(py::init<NumericalDataCoreType, int>(), 
+            py::arg("threshold") = 0.05,
+            py::arg("nchunks") = 10)
+        .def("find", [](const ChunkedSimplePeakFinderPyType& finder, const NumericalDataPyType& data) {
+                return finder.find(data);
+            },
+            py::arg("data"));
+
+    using WindowPeakFinderPyType = core::WindowPeakFinder<NumericalDataCoreType,core::ArrayTypeDynamic>;
+    py::class_<WindowPeakFinderPyType, IPeakFinderPyType, std::shared_ptr<WindowPeakFinderPyType>>(m_core, (std::string("WindowPeakFinder") + suffix).c_str(),
+                R"pbdoc(
+                 A bespoke window method peak finder
+
+                 A point is a peak when it and its neighbours are above
+                 mean + threshold*stddev (ddof=1) of the nouter points
+                 either side, ignoring the ninner nearest. O(N) for any
+                 window size. use_grad also requires the gradient to
+                 cross zero from positive nearest the point.)pbdoc")
+        .def(py::init<NumericalDataCoreType, int, int, bool, bool, bool>(), 
+            py::arg("threshold") = 2.0,
+            py::arg("ninner") = 0,
+            py::arg("nouter") = 40,
+            py::arg("include_point") = false,
+            py::arg("enforce_maximum") = false,
+            py::arg("use_grad") = false)
+        .def("find", [](const WindowPeakFinderPyType& finder, const NumericalDataPyType& data) {
+                return finder.find(data);
+            },
+            py::arg("data"));
+
+    using LocalMaximaPeakFinderPyType = core::LocalMaximaPeakFinder<NumericalDataCoreType,core::ArrayTypeDynamic>;
+    py::class_<LocalMaximaPeakFinderPyType, IPeakFinderPyType, std::shared_ptr<LocalMaximaPeakFinderPyType>>(m_core, (std::string("LocalMaximaPeakFinder") + suffix).c_str(),
+                R"pbdoc(
+                 Local maxima peak finder, a native scipy.signal.find_peaks
+
+                 The conditions are as find_peaks, None, a lower limit
+                 or a (lower, upper) tuple where each limit is None, a
+                 number or an array (one value per point). The local
+                 maxima and prominences are O(N), the prominences
+                 from one pass through the data unless wlen is given.)pbdoc")
+        .def(py::init([](const py::object& height, const py::object& threshold, const py::object& distance,
+                         const py::object& prominence, const py::object& width, const py::object& wlen,
+                         double rel_height, const py::object& plateau_size){
+                return std::make_shared<LocalMaximaPeakFinderPyType>(
+                    to_peak_condition<NumericalDataCoreType>(height),
+                    to_peak_condition<NumericalDataCoreType>(threshold),
+                    distance.is_none() ? 1.0 : distance.cast<double>(),
+                    to_peak_condition<NumericalDataCoreType>(prominence),
+                    to_peak_condition<NumericalDataCoreType>(width),
+                    wlen.is_none() ? 0.0 : wlen.cast<double>(),
+                    rel_height,
+                    to_peak_condition<NumericalDataCoreType>(plateau_size));
+            }),
+            py::arg("height") = py::none(),
+            py::arg("threshold") = py::none(),
+            py::arg("distance") = py::none(),
+            py::arg("prominence") = py::none(),
+            py::arg("width") = py::none(),
+            py::arg("wlen") = py::none(),
+            py::arg("rel_height") = 0.5,
+            py::arg("plateau_size") = py::none())
+        .def("find", [](const LocalMaximaPeakFinderPyType& finder, const NumericalDataPyType& data) {
+                return finder.find(data);
+            },
+            py::arg("data"))
+        .def("find_with_properties", [](const LocalMaximaPeakFinderPyType& finder, const NumericalDataPyType& data) {
+                const core::PeakProperties<NumericalDataCoreType> properties = finder.findWithProperties(data);
+                std::vector<int> plateaus(properties.size());
+                for(int p=0; p<properties.size(); ++p){
+                    plateaus[p] = properties.rightEdges[p] - properties.leftEdges[p] + 1;
+                }
+                py::dict values;
+                values["peak_heights"] = properties.heights;
+                values["plateau_sizes"] = plateaus;
+                values["left_edges"] = properties.leftEdges;
+                values["right_edges"] = properties.rightEdges;
+                if(finder.findsProminences()){
+                    values["prominences"] = properties.prominences;
+                    values["left_bases"] = properties.leftBases;
+                    values["right_bases"] = properties.rightBases;
+                }
+                if(finder.findsWidths()){
+                    values["widths"] = properties.widths;
+                    values["width_heights"] = properties.widthHeights;
+                    values["left_ips"] = properties.leftIps;
+                    values["right_ips"] = properties.rightIps;
+                }
+                return py::make_tuple(properties.indices, values);
+            }, R"pbdoc(
+              As find_peaks, the peak indices and a dict of their 
+              properties (as lists, the same keys as find_peaks). The 
+              prominences and bases are only there with a prominence 
+              or width condition and the widths with a width condition.)pbdoc",
+            py::arg("data"));
+
+    using GradientPeakFinderPyType = core::GradientPeakFinder<NumericalDataCoreType,core::ArrayTypeDynamic>;
+    py::class_<GradientPeakFinderPyType, IPeakFinderPyType, std::shared_ptr<GradientPeakFinderPyType>>(m_core, (std::string("GradientPeakFinder") + suffix).c_str(),
+                R"pbdoc(
+                 Gradient peak finder, where the Savitzky-Golay first
+                 derivative crosses zero from positive with a negative
+                 second derivative (curvature above min_curvature)
+
+                 Both derivatives come from one pass over the data. The
+                 height condition is as LocalMaximaPeakFinder, on the 
+                 value at the nearest point to the crossing.)pbdoc")
+        .def(py::init([](int window_size, int order, const py::object& height, NumericalDataCoreType min_curvature){
+                return std::make_shared<GradientPeakFinderPyType>(window_size, order, 
+                    to_peak_condition<NumericalDataCoreType>(height), min_curvature);
+            }),
+            py::arg("window_size") = 5,
+            py::arg("order") = 2,
+            py::arg("height") = py::none(),
+            py::arg("min_curvature") = 0.0)
+        .def("find", [](const GradientPeakFinderPyType& finder, const NumericalDataPyType& data) {
+                return finder.find(data);
+            },
+            py::arg("data"))
+        .def("find_with_positions", [](const GradientPeakFinderPyType& finder, const NumericalDataPyType& data) {
+                const core::PeakPositions<NumericalDataCoreType> peaks = finder.findWithPositions(data);
+                py::dict values;
+                values["indices"] = peaks.indices;
+                values["positions"] = peaks.positions;
+                values["heights"] = peaks.heights;
+                values["curvatures"] = peaks.curvatures;
+                return values;
+            }, R"pbdoc(
+              A dict of the peak indices, the positions of the crossings
+              interpolated between points, the heights and curvatures 
+              (minus the second derivative), as lists.)pbdoc",
+            py::arg("data"));
+
+    m_core.def((std::string("ricker_wavelet") + suffix).c_str(), &core::rickerWavelet<NumericalDataCoreType>, R"pbdoc(
+              The Mexican hat (Ricker) wavelet, as scipy.signal.ricker.)pbdoc",
+        py::arg("points"),
+        py::arg("a"));
+
+    using CWTPeakFinderPyType = core::CWTPeakFinder<NumericalDataCoreType,core::ArrayTypeDynamic>;
+    py::class_<CWTPeakFinderPyType, IPeakFinderPyType, std::shared_ptr<CWTPeakFinderPyType>>(m_core, (std::string("CWTPeakFinder") + suffix).c_str(),
+                R"pbdoc(
+                 Continuous wavelet transform peak finder, a native 
+                 scipy.signal.find_peaks_cwt (with the Ricker wavelet)
+
+                 The transform is one row per width (in increasing order)
+                 done concurrently, the wavelet spectra are kept for each
+                 size of data. None is the find_peaks_cwt default.)pbdoc")
+        .def(py::init([](const std::vector<double>& widths, const py::object& max_distances, const py::object& gap_thresh,
+                         const py::object& min_length, double min_snr, double noise_perc, const py::object& window_size){
+                return std::make_shared<CWTPeakFinderPyType>(
+                    widths,
+                    max_distances.is_none() ? std::vector<double>() : max_distances.cast<std::vector<double>>(),
+                    gap_thresh.is_none() ? 0.0 : gap_thresh.cast<double>(),
+                    min_length.is_none() ? 0 : min_length.cast<int>(),
+                    min_snr,
+                    noise_perc,
+                    window_size.is_none() ? 0 : window_size.cast<int>());
+            }),
+            py::arg("widths"),
+            py::arg("max_distances") = py::none(),
+            py::arg("gap_thresh") = py::none(),
+            py::arg("min_length") = py::none(),
+            py::arg("min_snr") = 1.0,
+            py::arg("noise_perc") = 10.0,
+            py::arg("window_size") = py::none())
+        .def("find", [](const CWTPeakFinderPyType& finder, const NumericalDataPyType& data) {
+                return finder.find(data);
+            },
+            py::arg("data"))
+        .def("transform", [](const CWTPeakFinderPyType& finder, const NumericalDataPyType& data) {
+                return finder.transform(data);
+            }, "The transform, a NumericalData (the size of the data) per width",
+            py::arg("data"))
+        .def("clear_cache", &CWTPeakFinderPyType::clearCache,
+             "Drop the wavelet engines kept for each size of data")
+        .def_property_readonly("widths", &CWTPeakFinderPyType::widths);
+
+    // peak fitting
+    m_core.def("fit_regions", &core::fitRegions<NumericalDataCoreType>, R"pbdoc(
+              The regions halfwidth channels either side of each peak
+              (within the data of size points), regions that overlap
+              are joined into one with all of their peaks.
 
-    py::class_<HistPyType>(m_core, "Histogram", R"pbdoc(
-                 Represents a basic 1D histogram
-                 
-                 Energies vs values.)pbdoc")
+              Returns:
+                  A list of FitRegion.)pbdoc",
+        py::arg("peaks"),
+        py::arg("halfwidth"),
+        py::arg("size"));
+
+    using PeakFitsPyType = core::PeakFits<NumericalDataCoreType>;
+    py::class_<PeakFitsPyType>(m_core, (std::string("PeakFits") + suffix).c_str(), R"pbdoc(
+                 The fitted peaks as a table, each attribute a list with
+                 one value per peak in order of region, the errors are
+                 one standard deviation.)pbdoc")
+        .def("__len__", &PeakFitsPyType::size)
+        .def_readonly("regions", &PeakFitsPyType::regions)
+        .def_readonly("centroids", &PeakFitsPyType::centroids)
+        .def_readonly("centroid_errors", &PeakFitsPyType::centroidErrors)
+        .def_readonly("heights", &PeakFitsPyType::heights)
+        .def_readonly("height_errors", &PeakFitsPyType::heightErrors)
+        .def_readonly("fwhms", &PeakFitsPyType::fwhms)
+        .def_readonly("fwhm_errors", &PeakFitsPyType::fwhmErrors)
+        .def_readonly("areas", &PeakFitsPyType::areas)
+        .def_readonly("area_errors", &PeakFitsPyType::areaErrors)
+        .def_readonly("tail_fractions", &PeakFitsPyType::tailFractions)
+        .def_readonly("tail_slopes", &PeakFitsPyType::tailSlopes)
+        .def_readonly("reduced_chi2s", &PeakFitsPyType::reducedChi2s)
+        .def_readonly("iterations", &PeakFitsPyType::iterations)
+        .def_readonly("converged", &PeakFitsPyType::converged)
+        .def_readonly("stalled", &PeakFitsPyType::stalled);
+
+    using GaussianPeakFitterPyType = core::GaussianPeakFitter<NumericalDataCoreType>;
+    py::class_<GaussianPeakFitterPyType>(m_core, (std::string("GaussianPeakFitter") + suffix).c_str(), R"pbdoc(
+                 Fits Gaussian peaks, with an optional low energy tail,
+                 on a linear or quadratic background to regions of the
+                 data by Levenberg-Marquardt, the regions concurrently.
+
+                 The residuals are weighted by the Poisson variance, 
+                 max(counts, 1).)pbdoc")
+        .def(py::init([](core::FitBackground background, bool tails, int max_iterations, double tolerance){
+                return GaussianPeakFitterPyType(background, tails, max_iterations, tolerance);
+            }),
+            py::arg("background") = core::FitBackground::Linear,
+            py::arg("tails") = false,
+            py::arg("max_iterations") = 100,
+            py::arg("tolerance") = 1e-8)
+        .def("fit", [](const GaussianPeakFitterPyType& fitter, const NumericalDataPyType& data, const core::PeakList<NumericalDataCoreType>& peaks, int halfwidth) {
+                return fitter.fit(data, peaks, halfwidth);
+            }, R"pbdoc(
+              Fit the peaks in regions of halfwidth channels either
+              side of each, see fit_regions.
+
+              Returns:
+                  PeakFits)pbdoc",
+            py::arg("data"),
+            py::arg("peaks"),
+            py::arg("halfwidth") = 10)
+        .def("fit", [](const GaussianPeakFitterPyType& fitter, const NumericalDataPyType& data, const std::vector<core::FitRegion>& regions) {
+                return fitter.fit(data, regions);
+            }, R"pbdoc(
+              Fit the peaks of each region.
+
+              Returns:
+                  PeakFits)pbdoc",
+            py::arg("data"),
+            py::arg("regions"));
+
+    m_core.def("multiplet_regions", [](const NumericalDataPyType& data, NumericalDataCoreType threshold, int margin){
+            return core::multipletRegions<NumericalDataCoreType>(data, threshold, margin);
+        }, R"pbdoc(
+              The groups of SimplePeakFinder(threshold) widened by
+              margin channels either side as fit regions, regions that 
+              overlap are joined into one. A group of peaks closer than
+              their width has one centroid, see MultipletFitter.
+
+              Returns:
+                  A list of FitRegion.)pbdoc",
+        py::arg("data"),
+        py::arg("threshold"),
+        py::arg("margin") = 10);
+
+    using MultipletFitterPyType = core::MultipletFitter<NumericalDataCoreType>;
+    py::class_<MultipletFitterPyType>(m_core, (std::string("MultipletFitter") + suffix).c_str(), R"pbdoc(
+                 Deconvolves multiplets, fits 1 to max_components Gaussian 
+                 peaks of one shared width jointly to each region, keeping
+                 the number with the lowest Bayesian information criterion.
+                 The regions are fitted in parallel.)pbdoc")
+        .def(py::init([](int max_components, core::FitBackground background, int max_iterations, double tolerance){
+                return MultipletFitterPyType(max_components, background, max_iterations, tolerance);
+            }),
+            py::arg("max_components") = 4,
+            py::arg("background") = core::FitBackground::Linear,
+            py::arg("max_iterations") = 100,
+            py::arg("tolerance") = 1e-8)
+        .def("fit", [](const MultipletFitterPyType& fitter, const NumericalDataPyType& data, const std::vector<core::FitRegion>& regions) {
+                return fitter.fit(data, regions);
+            }, R"pbdoc(
+              Fit the peaks of each region, the number of peaks of each
+              from the information criterion.
+
+              Returns:
+                  PeakFits)pbdoc",
+            py::arg("data"),
+            py::arg("regions"))
+        .def("criteria", [](const MultipletFitterPyType& fitter, const NumericalDataPyType& data, const core::FitRegion& region) {
+                return fitter.criteria(data, region);
+            }, "The information criterion (BIC) of the region for 1 to max_components peaks, inf for those not fitted",
+            py::arg("data"),
+            py::arg("region"))
+        .def_property_readonly("max_components", &MultipletFitterPyType::maxComponents);
+
+    // background engines
+    using SNIPEnginePyType = core::SNIPEngine<NumericalDataCoreType>;
+    py::class_<SNIPEnginePyType>(m_core, (std::string("SNIPEngine") + suffix).c_str(), R"pbdoc(
+                 Sensitive Nonlinear Iterative Peak (SNIP) background engine.
+
+                 Gives the same result as NumericalData.snip but reuses
+                 its internal buffers between iterations and calls, so
+                 keep hold of one engine when processing many spectra.)pbdoc")
         .def(py::init<>())
-        .def(py::init<const core::NumericalData<double>&, const core::NumericalData<double>&>())
+        .def("estimate", [](SNIPEnginePyType& engine, const NumericalDataPyType& data, const std::vector<int>& iteration_list){
+            return engine.estimate(data, iteration_list.begin(), iteration_list.end());
+        }, R"pbdoc(
+              Estimate the background of the data using the given
+              iterations (window orders).
+
+              Returns:
+                  A new array.)pbdoc",
+            py::arg("data"),
+            py::arg("iterations"))
+        .def("estimate", [](SNIPEnginePyType& engine, const NumericalDataPyType& data, int niterations){
+            NumericalDataPyType background(data.size());
+            engine.estimate(data, niterations, background);
+            return background;
+        }, R"pbdoc(
+              Estimate the background of the data using an increasing
+              window of 1, 2, ..., niterations (as NumericalData.snip).
+
+              Returns:
+                  A new array.)pbdoc",
+            py::arg("data"),
+            py::arg("niterations") = 20);
+
+    // gradient engine
+    using GradientEnginePyType = core::GradientEngine<NumericalDataCoreType>;
+    py::class_<GradientEnginePyType>(m_core, (std::string("GradientEngine") + suffix).c_str(), R"pbdoc(
+                 Computes the n-th order numerical gradient in a single pass,
+                 using precomputed finite difference coefficients.
+
+                 Gives the same result as NumericalData.gradient(order).)pbdoc")
+        .def(py::init<int>(), py::arg("order")=1)
+        .def_property_readonly("order", &GradientEnginePyType::order)
+        .def("apply", [](const GradientEnginePyType& engine, const NumericalDataPyType& data){
+            return engine.apply(data);
+        }, R"pbdoc(
+              Compute the gradient of the data.
+
+              Returns:
+                  A new array.)pbdoc",
+            py::arg("data"));
+}
+
+template<typename XScalar, typename YScalar>
+void register_spectrum(py::module& m_core, const char* histname, const char* spectrumname, const char* doc) {
+    // histogram and spectrum objects
+    using HistPyType = core::Histogram<XScalar,YScalar>;
+    py::class_<HistPyType>(m_core, histname, doc)
+        .def(py::init<>())
+        .def(py::init<const core::NumericalData<XScalar>&, const core::NumericalData<YScalar>&>())
         .def(py::init<const HistPyType&>())
         .def_property_readonly("X", &HistPyType::X)
         .def_property_readonly("Y", &HistPyType::Y);
 
-    py::class_<HistChannelPyType>(m_core, "HistogramChannelBased",  R"pbdoc(
-                 Represents a basic 1D histogram
-                 
-                 Channels vs values.)pbdoc")
-        .def(py::init<>())
-        .def(py::init<const core::NumericalData<int>&, const core::NumericalData<double>&>())
-        .def(py::init<const HistChannelPyType&>())
-        .def_property_readonly("X", &HistChannelPyType::X)
-        .def_property_readonly("Y", &HistChannelPyType::Y);
-
-    // spectrum objects
-    using SpectrumChannelBasedPyType = core::Spectrum<int,double>;
-    py::class_<SpectrumChannelBasedPyType, HistChannelPyType>(m_core, "SpectrumChannelBased",
-                R"pbdoc(
-                 Represents a basic 1D histogram
-                 
-                 Channels vs values.)pbdoc")
-        .def(py::init<>())
-        .def(py::init<const core::NumericalData<int>&, const core::NumericalData<double>&>())
-        .def(py::init<const SpectrumChannelBasedPyType&>())
-        .def("estimateBackground", [](const SpectrumChannelBasedPyType& spectrum, const std::vector<int>& iteration_list){
-            return spectrum.estimateBackground(iteration_list.begin(), iteration_list.end());
-        })
-        .def("removeBackground", [](SpectrumChannelBasedPyType& spectrum, const std::vector<int>& iteration_list){
-            spectrum.removeBackground(iteration_list.begin(), iteration_list.end());
-        });
-
-    using SpectrumEnergyBasedPyType = core::Spectrum<double,double>;
-    py::class_<SpectrumEnergyBasedPyType, HistPyType>(m_core, "SpectrumEnergyBased",
-                R"pbdoc(
-                 Represents a basic 1D histogram
-                 
-                 Energies vs values.)pbdoc")
+    using SpectrumPyType = core::Spectrum<XScalar,YScalar>;
+    py::class_<SpectrumPyType, HistPyType>(m_core, spectrumname, doc)
         .def(py::init<>())
-        .def(py::init<const core::NumericalData<double>&, const core::NumericalData<double>&>())
-        .def(py::init<const SpectrumEnergyBasedPyType&>())
-        .def("estimateBackground", [](const SpectrumEnergyBasedPyType& spectrum, const std::vector<int>& iteration_list){
+        .def(py::init<const core::NumericalData<XScalar>&, const core::NumericalData<YScalar>&>())
+        .def(py::init<const SpectrumPyType&>())
+        .def("estimateBackground", [](const SpectrumPyType& spectrum, const std::vector<int>& iteration_list){
             return spectrum.estimateBackground(iteration_list.begin(), iteration_list.end());
         })
-        .def("removeBackground", [](SpectrumEnergyBasedPyType& spectrum, const std::vector<int>& iteration_list){
+        .def("removeBackground", [](SpectrumPyType& spectrum, const std::vector<int>& iteration_list){
             spectrum.removeBackground(iteration_list.begin(), iteration_list.end());
         });
+}
 
+template<typename T>
+void register_io(py::module& m_io) {
     // IO module read/write to file, etc...
+    using SpectrumEnergyBasedPyType = core::Spectrum<T,T>;
     m_io.def("from_csv", 
             [](SpectrumEnergyBasedPyType& hist, const std::string& filename) {
                 std::ifstream file(filename);
                 //file >> m;
-                io::Deserialize<double, double, ','>(file, hist);
+                io::Deserialize<T, T, ','>(file, hist);
                 file.close();
             }, R"pbdoc(
                  Deserialization method for histogram
@@ -679,3 +1354,338 @@ PYBIND11_MODULE(PEAKINGDUCK, m) {
                      channel, lowerenergy, upperenergy, count
                  )pbdoc");
 }
+
+PYBIND11_MODULE(PEAKINGDUCK, m) {
+    
+    m.doc() = R"pbdoc(
+        Peaking duck library using pybind11
+
+        ToDo: write
+
+        A list:
+            - Entry 1
+            - Entry 2
+
+    )pbdoc"; // optional module docstring
+
+    // version
+    m.attr("__version__") = "0.0.1";
+
+    // util module
+    py::module m_util = m.def_submodule("util");
+
+    // core module 
+    py::module m_core = m.def_submodule("core");
+
+    // io module
+    py::module m_io = m.def_submodule("io");
+
+    m_util.def("get_window", &util::get_window<double>,
+	       R"pbdoc(
+                Given a list of values take nouter points either side of 
+                the index given and ignore ninner points.
+
+                Examples:
+
+                    ::
+    
+                        >>> get_window([8, 2, 5, 2, 6, 6, 9, 23, 12], 4, 3, 0, True)
+                        [2, 5, 2, 6, 6, 9, 23]
+                        >>> get_window([8, 2, 5, 2, 6, 6, 9, 23, 12], 4, 3, 0, False)
+                        [2, 5, 2, 6, 9, 23]
+                        >>> get_window([8, 2, 5, 2, 6, 6, 9, 23, 12], 4, 3, 1, True)
+                        [2, 5, 6, 9, 23]
+                        >>> get_window([8, 2, 5, 2, 6, 6, 9, 23, 12], 4, 3, 1, False)
+                        [2, 5, 9, 23]
+
+                Therefore:
+                    - ninner >= 0
+                    - ninner <= nouter
+                    - index >= nouter
+                    - index < values.size()
+        
+                It will clip at (0, len(values)))pbdoc",
+            py::arg("values"),
+            py::arg("centerindex"),
+            py::arg("nouter") = 5,
+            py::arg("ninner") = 0,
+            py::arg("includeindex") = true);
+
+    // double precision (default) and single precision types
+    register_numerical<double>(m_core, "");
+    register_numerical<float>(m_core, "F32");
+
+    // integral type
+    using IntegerDataCoreType = int;
+    using IntegerDataPyType = core::NumericalData<IntegerDataCoreType,core::ArrayTypeDynamic>;
+    py::class_<IntegerDataPyType>(m_core, "IntegerData",
+		 R"pbdoc(
+                 Represents a 1-dimensional data structure of ints
+                 (basically a 1D Eigen array)
+
+                 Dynamic array - most use cases will be determined at
+                 runtime (I am assuming).  We don't want anyone to
+                 know we are using Eigen beyond this file, since (in
+                 theory) it should make it easier to change library if
+                 need be. We only really need the array datastructure
+                 from Eigen and not much else and instead of
+                 reinventing the wheel, we wrap Eigen array.
+
+                 We wrap this with private inheritance on the Eigen
+                 type but there are a lot of methods to expose, easy
+                 to add when/if we need them.
+        
+                 Eigen array is pretty good, it has things like sqrt,
+                 exp on array coefficients, but we need to extend this
+                 to other functions, so we use CRTP to do this.
+
+                 For all of this, you may ask why not just use Eigen
+                 and use an alias?  Well for one, we don't need all of
+                 Eigen just the array, and not all of the array type
+                 (we require a simpler interface). Additionally, at
+                 some point we may wish to use another data structure
+                 as std::array for example.  In this case we just
+                 change the NumericalData class to wrap that instead.
+                 If we change the alias this could break existing
+                 interfaces and APIs, causing big changes later
+                 on. Since this datastructure is fundamental to
+                 everything we need to make sure that we have this
+                 sorted properly first!)pbdoc")
+        .def(py::init<>())
+        .def(py::init<const std::vector<IntegerDataCoreType>&>())
+        .def(py::init<const Eigen::Ref<core::Array1Di>&>())
+        // arithmetic on arrays is lazy in C++, here each result is evaluated into a new array
+        .def("__add__", [](const IntegerDataPyType& lhs, const IntegerDataPyType& rhs){
+            return IntegerDataPyType(lhs + rhs);
+        }, py::is_operator())
+        .def("__add__", [](const IntegerDataPyType& lhs, IntegerDataCoreType rhs){
+            return IntegerDataPyType(lhs + rhs);
+        }, py::is_operator())
+        .def("__radd__", [](const IntegerDataPyType& rhs, IntegerDataCoreType lhs){
+            return IntegerDataPyType(lhs + rhs);
+        }, py::is_operator())
+        .def("__sub__", [](const IntegerDataPyType& lhs, const IntegerDataPyType& rhs){
+            return IntegerDataPyType(lhs - rhs);
+        }, py::is_operator())
+        .def("__sub__", [](const IntegerDataPyType& lhs, IntegerDataCoreType rhs){
+            return IntegerDataPyType(lhs - rhs);
+        }, py::is_operator())
+        .def("__rsub__", [](const IntegerDataPyType& rhs, IntegerDataCoreType lhs){
+            return IntegerDataPyType(lhs - rhs);
+        }, py::is_operator())
+        .def("__mul__", [](const IntegerDataPyType& lhs, const IntegerDataPyType& rhs){
+            return IntegerDataPyType(lhs * rhs);
+        }, py::is_operator())
+        .def("__mul__", [](const IntegerDataPyType& lhs, IntegerDataCoreType rhs){
+            return IntegerDataPyType(lhs * rhs);
+        }, py::is_operator())
+        .def("__rmul__", [](const IntegerDataPyType& rhs, IntegerDataCoreType lhs){
+            return IntegerDataPyType(lhs * rhs);
+        }, py::is_operator())
+        .def("__truediv__", [](const IntegerDataPyType& lhs, const IntegerDataPyType& rhs){
+            return IntegerDataPyType(lhs / rhs);
+        }, py::is_operator())
+        .def("__truediv__", [](const IntegerDataPyType& lhs, IntegerDataCoreType rhs){
+            return IntegerDataPyType(lhs / rhs);
+        }, py::is_operator())
+        .def("__rtruediv__", [](const IntegerDataPyType& rhs, IntegerDataCoreType lhs){
+            return IntegerDataPyType(lhs / rhs);
+        }, py::is_operator())
+        .def(py::self += py::self)
+        .def(py::self -= py::self)
+        .def(py::self *= IntegerDataCoreType())
+        .def(py::self /= IntegerDataCoreType())
+        .def(py::self *= py::self)
+        .def(py::self /= py::self)
+        .def("__neg__", [](const IntegerDataPyType& data){
+            return IntegerDataPyType(-data);
+        }, py::is_operator())
+        .def("__call__",
+             [](const IntegerDataPyType& data, int sindex, int eindex) {
+                 return IntegerDataPyType(data(sindex, eindex));
+             })
+        .def("__iter__", 
+             [](const IntegerDataPyType &data) { 
+                return py::make_iterator(data.begin(), data.end()); 
+             }, py::keep_alive<0, 1>() /* Essential: keep object alive while iterator exists */)
+        .def("__len__", 
+             [](const IntegerDataPyType& data) {
+                 return data.size();
+             })
+        .def("__getitem__",
+             [](const IntegerDataPyType& data, size_t index) {
+                 return data[index];
+             })
+        .def("__setitem__",
+             [](IntegerDataPyType& data, size_t index, IntegerDataCoreType value) {
+                data[index] = value;
+             })
+        .def("maxCoeff", [](const IntegerDataPyType& data){
+            return data.maxCoeff();
+        })
+        .def("minCoeff", [](const IntegerDataPyType& data){
+            return data.minCoeff();
+        })
+        .def("sum", [](const IntegerDataPyType& data){
+            return data.sum();
+        })
+        .def("reverse", [](const IntegerDataPyType& data){
+            return data.reverse();
+        })
+        .def("reverseInPlace", [](IntegerDataPyType& data){
+            data.reverseInPlace();
+        })
+        .def("slice", [](const IntegerDataPyType& data, int sindex, int eindex) {
+            return IntegerDataPyType(data.slice(sindex, eindex));
+        })
+        .def("from_list", &IntegerDataPyType::from_vector)
+        .def("to_list", &IntegerDataPyType::to_vector)
+      .def("ramp", &IntegerDataPyType::ramp, R"pbdoc(
+              A simple function for filtering values above a certain
+              threshold (>=). This is useful to remove entries that
+              are negative for example.
+
+              Returns:
+                  A new array.)pbdoc")
+      .def("rampInPlace", &IntegerDataPyType::rampInPlace, R"pbdoc(
+              A simple function for filtering values above a certain
+              threshold (>=). This is useful to remove entries that
+              are negative for example.
+
+              Mutates underlyindg data.)pbdoc")
+      .def("clip", &IntegerDataPyType::clip, R"pbdoc(
+              Limit the values to the range [lower, upper].
+
+              Returns:
+                  A new array.)pbdoc",
+            py::arg("lower"),
+            py::arg("upper"))
+      .def("clipInPlace", &IntegerDataPyType::clipInPlace, R"pbdoc(
+              Limit the values to the range [lower, upper].
+
+              Mutates underlying data.)pbdoc",
+            py::arg("lower"),
+            py::arg("upper"))
+      .def("zeroBelow", &IntegerDataPyType::zeroBelow, R"pbdoc(
+              Set all values at or below the threshold (<=) 
+              to zero, only values strictly above are kept.
+
+              Returns:
+                  A new array.)pbdoc",
+            py::arg("threshold"))
+      .def("zeroBelowInPlace", &IntegerDataPyType::zeroBelowInPlace, R"pbdoc(
+              Set all values at or below the threshold (<=) 
+              to zero, only values strictly above are kept.
+
+              Mutates underlying data.)pbdoc",
+            py::arg("threshold"))
+      .def("mask", &IntegerDataPyType::mask, R"pbdoc(
+              Keep only the values where the mask is non-zero,
+              all other values are set to zero.
+
+              Returns:
+                  A new array.)pbdoc",
+            py::arg("mask"))
+      .def("maskInPlace", &IntegerDataPyType::maskInPlace, R"pbdoc(
+              Keep only the values where the mask is non-zero,
+              all other values are set to zero.
+
+              Mutates underlying data.)pbdoc",
+            py::arg("mask"));
+
+
+    register_batch<double>(m_core, "");
+    register_batch<float>(m_core, "F32");
+
+    py::enum_<core::EdgeMode>(m_core, "EdgeMode",
+	       R"pbdoc(
+                 How a smoother treats the points within a window size of
+                 either end of the data.
+
+                 Keep - the values are left as they are
+                 Truncate - the average over the part of the window in the data)pbdoc")
+        .value("Keep", core::EdgeMode::Keep)
+        .value("Truncate", core::EdgeMode::Truncate);
+
+    py::enum_<core::ConvolutionMethod>(m_core, "ConvolutionMethod",
+	       R"pbdoc(
+                 How a ConvolutionEngine computes the convolution.
+
+                 Automatic - pick from the kernel and data size
+                 Direct - the weighted sum of the shifted data
+                 FFT - overlap-save FFT
+                 Separable - running sums, only for boxes)pbdoc")
+        .value("Automatic", core::ConvolutionMethod::Automatic)
+        .value("Direct", core::ConvolutionMethod::Direct)
+        .value("FFT", core::ConvolutionMethod::FFT)
+        .value("Separable", core::ConvolutionMethod::Separable);
+
+    py::class_<core::FWHMCalibration>(m_core, "FWHMCalibration",
+	       R"pbdoc(
+                 The detector resolution, FWHM(E) = sqrt(a + b*E + c*E^2),
+                 callable with the energy.)pbdoc")
+        .def(py::init<double, double, double>(),
+            py::arg("a"),
+            py::arg("b") = 0.0,
+            py::arg("c") = 0.0)
+        .def("__call__", &core::FWHMCalibration::operator(), py::arg("energy"))
+        .def_readwrite("a", &core::FWHMCalibration::a)
+        .def_readwrite("b", &core::FWHMCalibration::b)
+        .def_readwrite("c", &core::FWHMCalibration::c);
+
+    py::enum_<core::PeakColumn>(m_core, "PeakColumn",
+	       R"pbdoc(
+                 The columns of a PeakTable.)pbdoc")
+        .value("Index", core::PeakColumn::Index)
+        .value("Value", core::PeakColumn::Value)
+        .value("Energy", core::PeakColumn::Energy)
+        .value("Area", core::PeakColumn::Area)
+        .value("Width", core::PeakColumn::Width)
+        .value("Score", core::PeakColumn::Score);
+
+    py::enum_<core::FitBackground>(m_core, "FitBackground",
+	       R"pbdoc(
+                 The background under the peaks of a fit region.
+
+                 Linear - b0 + b1*v
+                 Quadratic - b0 + b1*v + b2*v^2)pbdoc")
+        .value("Linear", core::FitBackground::Linear)
+        .value("Quadratic", core::FitBackground::Quadratic);
+
+    py::class_<core::FitRegion>(m_core, "FitRegion",
+	       R"pbdoc(
+                 A region of the data, [first, last), with a peak at
+                 each of the centroids (in channels, the first guesses).)pbdoc")
+        .def(py::init([](int first, int last, const std::vector<double>& centroids){
+                return core::FitRegion{first, last, centroids};
+            }),
+            py::arg("first"),
+            py::arg("last"),
+            py::arg("centroids"))
+        .def_readwrite("first", &core::FitRegion::first)
+        .def_readwrite("last", &core::FitRegion::last)
+        .def_readwrite("centroids", &core::FitRegion::centroids);
+
+    register_processes<double>(m_core, "");
+    register_processes<float>(m_core, "F32");
+
+    register_spectrum<double,double>(m_core, "Histogram", "SpectrumEnergyBased", R"pbdoc(
+                 Represents a basic 1D histogram
+                 
+                 Energies vs values.)pbdoc");
+    register_spectrum<int,double>(m_core, "HistogramChannelBased", "SpectrumChannelBased", R"pbdoc(
+                 Represents a basic 1D histogram
+                 
+                 Channels vs values.)pbdoc");
+    register_spectrum<float,float>(m_core, "HistogramF32", "SpectrumEnergyBasedF32", R"pbdoc(
+                 Represents a basic 1D histogram (single precision)
+                 
+                 Energies vs values.)pbdoc");
+    register_spectrum<int,float>(m_core, "HistogramChannelBasedF32", "SpectrumChannelBasedF32", R"pbdoc(
+                 Represents a basic 1D histogram (single precision)
+                 
+                 Channels vs values.)pbdoc");
+
+    register_io<double>(m_io);
+    register_io<float>(m_io);
+}
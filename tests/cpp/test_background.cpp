@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "common.hpp"
+
+#include "peakingduck.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(unittests)
+
+    template<typename T=double, int Size=core::ArrayTypeDynamic>
+    void REQUIRE_NUMERICS_EXACTLY_THE_SAME(const core::NumericalData<T, Size>& lhs, const core::NumericalData<T, Size>& rhs){
+        REQUIRE( lhs.size() == rhs.size());
+        for(int i=0;i<lhs.size();++i){
+            REQUIRE( lhs[i] == rhs[i] );
+        }
+    }
+
+    // a smooth background with some gaussian peaks on top
+    core::NumericalData<double> make_spectrum(int size){
+        core::NumericalData<double> data(size);
+        for(int i=0;i<size;++i){
+            data[i] = 200.0*std::exp(-i/500.0) + 10.0 
+                    + 1e3*std::exp(-std::pow(i-300, 2)/18.0)
+                    + 5e2*std::exp(-std::pow(i-1234, 2)/50.0)
+                    + (i % 7);
+        }
+        return data;
+    }
+
+    SCENARIO( "Test SNIP engine" ) {
+        const core::NumericalData<double> data = make_spectrum(2001);
+        std::vector<int> iterations(40);
+        std::generate(iterations.begin(), iterations.end(), [n = 1] () mutable { return n++; });
+
+        core::SNIPEngine<double> engine;
+
+        THEN( "check same as snip" ) {
+            const core::NumericalData<double> expected = data.snip(iterations.begin(), iterations.end());
+            const core::NumericalData<double> background = engine.estimate(data, iterations.begin(), iterations.end());
+            REQUIRE_NUMERICS_EXACTLY_THE_SAME(expected, background);
+        }
+        THEN( "check decreasing window and reuse of the engine" ) {
+            const std::vector<int> reversed(iterations.rbegin(), iterations.rend());
+            const core::NumericalData<double> expected = data.snip(reversed.begin(), reversed.end());
+            core::NumericalData<double> background(data.size());
+            const double* address = background.data();
+            for(int repeat=0;repeat<3;++repeat){
+                engine.estimate(data, reversed.begin(), reversed.end(), background);
+                REQUIRE_NUMERICS_EXACTLY_THE_SAME(expected, background);
+            }
+            // output buffer is reused
+            REQUIRE( background.data() == address );
+        }
+        THEN( "check small arrays and large orders" ) {
+            core::NumericalData<double> small(16);
+            small << 1.0, 42.2, 61.4, 2.1, 4.2, 23.4, 52.32, 2.3, 213.21, 32.4, 1.2, 3.4, 5.2, 123.3, 23.2, 4.1;
+            const core::NumericalData<double> expected = small.snip(20);
+            auto rn = util::range<int,1,21,1>();
+            const core::NumericalData<double> background = engine.estimate(small, rn.begin(), rn.end());
+            REQUIRE_NUMERICS_EXACTLY_THE_SAME(expected, background);
+        }
+        THEN( "check on a view" ) {
+            const core::NumericalData<double> expected = core::NumericalData<double>(data.slice(100, 1100)).snip(iterations.begin(), iterations.end());
+            REQUIRE_NUMERICS_EXACTLY_THE_SAME(expected, engine.estimate(data.slice(100, 1100), iterations.begin(), iterations.end()));
+
+            const core::ConstNumericalView<double> strided(data.data(), 1000, 2);
+            const core::NumericalData<double> expectedStrided = strided.snip(iterations.begin(), iterations.end());
+            REQUIRE_NUMERICS_EXACTLY_THE_SAME(expectedStrided, engine.estimate(strided, iterations.begin(), iterations.end()));
+        }
+        THEN( "check spectrum background" ) {
+            core::NumericalData<double> energies(data.size()+1);
+            for(int i=0;i<energies.size();++i){
+                energies[i] = i*0.5;
+            }
+            core::Spectrum<double, double> spectrum(energies, data);
+            const core::NumericalData<double> expected = data.snip(iterations.begin(), iterations.end());
+            REQUIRE_NUMERICS_EXACTLY_THE_SAME(expected, spectrum.estimateBackground(iterations.begin(), iterations.end()));
+
+            spectrum.removeBackground(iterations.begin(), iterations.end());
+            REQUIRE_NUMERICS_EXACTLY_THE_SAME(core::NumericalData<double>(data - expected), spectrum.Y());
+        }
+        THEN( "check compile time schedules" ) {
+            REQUIRE( core::IncreasingSNIPSchedule<40>::size == 40 );
+            const core::NumericalData<double> expected = data.snip(iterations.begin(), iterations.end());
+            REQUIRE_NUMERICS_EXACTLY_THE_SAME(expected, engine.estimate(data, core::IncreasingSNIPSchedule<40>()));
+
+            const std::vector<int> custom = {8, 4, 2, 1};
+            REQUIRE_NUMERICS_EXACTLY_THE_SAME(data.snip(custom.begin(), custom.end()), 
+                                              engine.estimate(data, core::SNIPSchedule<8, 4, 2, 1>()));
+
+            // dispatched for common and uncommon numbers of iterations
+            for(int niterations: {1, 10, 17, 20, 30, 40, 41}){
+                core::NumericalData<double> background(data.size());
+                engine.estimate(data, niterations, background);
+                REQUIRE_NUMERICS_EXACTLY_THE_SAME(data.snip(niterations), background);
+            }
+        }
+    }
+
+PEAKINGDUCK_NAMESPACE_END // unittests
+PEAKINGDUCK_NAMESPACE_END // peakingduck
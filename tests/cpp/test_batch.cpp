@@ -0,0 +1,160 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "common.hpp"
+
+#include "peakingduck.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(unittests)
+
+    // compare every spectrum in the batch with the expected arrays
+    template<typename T=double>
+    void REQUIRE_BATCH_APPROX_THE_SAME(const std::vector<core::NumericalData<T>>& expected, const core::NumericalBatch<T>& batch){
+        REQUIRE( static_cast<int>(expected.size()) == batch.nspectra() );
+        for(int s=0;s<batch.nspectra();++s){
+            REQUIRE( expected[s].size() == batch.nchannels() );
+            for(int i=0;i<batch.nchannels();++i){
+                REQUIRE( batch(i, s) == Approx(expected[s][i]) );
+            }
+        }
+    }
+
+    // some different spectra with peaks on a background
+    std::vector<core::NumericalData<double>> make_spectra(int nspectra, int nchannels){
+        std::vector<core::NumericalData<double>> spectra;
+        for(int s=0;s<nspectra;++s){
+            core::NumericalData<double> data(nchannels);
+            for(int i=0;i<nchannels;++i){
+                data[i] = 100.0*std::exp(-i/(50.0 + s)) + 5.0 
+                        + 4e2*std::exp(-std::pow(i-20-3*s, 2)/8.0)
+                        + ((i + s) % 5);
+            }
+            spectra.push_back(data);
+        }
+        return spectra;
+    }
+
+    // apply a function to each spectrum 
+    template<class Function>
+    std::vector<core::NumericalData<double>> each(const std::vector<core::NumericalData<double>>& spectra, Function function){
+        std::vector<core::NumericalData<double>> result;
+        for(const auto& spectrum: spectra){
+            result.push_back(function(spectrum));
+        }
+        return result;
+    }
+
+    SCENARIO( "Test numerical batch" ) {
+        const std::vector<core::NumericalData<double>> spectra = make_spectra(7, 96);
+        const core::NumericalBatch<double> batch(spectra);
+
+        THEN( "check construction and views" ) {
+            REQUIRE( batch.nspectra() == 7 );
+            REQUIRE( batch.nchannels() == 96 );
+            REQUIRE_BATCH_APPROX_THE_SAME(spectra, batch);
+
+            // spectra are contiguous columns
+            REQUIRE( batch.spectrum(3).data() == batch.data() + 3*96 );
+            REQUIRE( batch.spectrum(3).stride() == 1 );
+
+            const std::vector<core::NumericalData<double>> copies = batch.to_vector();
+            REQUIRE_BATCH_APPROX_THE_SAME(copies, batch);
+
+            core::NumericalBatch<double> zeros(4, 2);
+            REQUIRE( zeros(3, 1) == 0.0 );
+            zeros.spectrum(1)[3] = 2.5;
+            REQUIRE( zeros(3, 1) == 2.5 );
+            REQUIRE( zeros.maxCoeffs()[1] == 2.5 );
+            REQUIRE( zeros.maxCoeffs()[0] == 0.0 );
+        }
+        THEN( "check numerical functions" ) {
+            REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [](const core::NumericalData<double>& d){ return d.LLS(); }), batch.LLS());
+            REQUIRE_BATCH_APPROX_THE_SAME(spectra, batch.LLS().inverseLLS());
+            for(int order=0;order<4;++order){
+                REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [&](const core::NumericalData<double>& d){ return d.midpoint(order); }), batch.midpoint(order));
+                REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [&](const core::NumericalData<double>& d){ return d.gradient(order); }), batch.gradient(order));
+            }
+            core::NumericalBatch<double> copy = batch;
+            copy.gradientInPlace(2).midpointInPlace(3);
+            REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [&](const core::NumericalData<double>& d){ return d.gradient(2).midpoint(3); }), copy);
+        }
+        THEN( "check snip" ) {
+            // each spectrum is the same as the single spectrum snip
+            const core::NumericalBatch<double> snipped = batch.snip(12);
+            for(int s=0;s<batch.nspectra();++s){
+                const core::NumericalData<double> expected = spectra[s].snip(12);
+                for(int i=0;i<batch.nchannels();++i){
+                    REQUIRE( snipped(i, s) == expected[i] );
+                }
+            }
+        }
+        THEN( "check thresholds" ) {
+            REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [](const core::NumericalData<double>& d){ return d.ramp(50.0); }), batch.ramp(50.0));
+            REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [](const core::NumericalData<double>& d){ return d.clip(10.0, 60.0); }), batch.clip(10.0, 60.0));
+            REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [](const core::NumericalData<double>& d){ return d.zeroBelow(8.0); }), batch.zeroBelow(8.0));
+        }
+    }
+
+    // a manager written before batches existed, only knows about single spectra
+    struct OnlySpectrumProcessManager : public core::IProcessManager<double>
+    {
+        core::IProcessManager<double>& append(const std::shared_ptr<core::IProcess<double>>&) override{
+            return *this;
+        }
+
+        using core::IProcessManager<double>::run;
+
+        core::NumericalData<double> 
+        run(const core::NumericalData<double>& data) const override{
+            return data*2.0 + 1.0;
+        }
+
+        size_t size() const override{
+            return 0;
+        }
+
+        void reset() override{}
+    };
+
+    SCENARIO( "Test processes on a batch" ) {
+        const std::vector<core::NumericalData<double>> spectra = make_spectra(5, 80);
+        const core::NumericalBatch<double> batch(spectra);
+
+        THEN( "check smoothers" ) {
+            const core::MovingAverageSmoother<double> mas(3);
+            REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [&](const core::NumericalData<double>& d){ return mas.go(d); }), mas.go(batch));
+            const core::WeightedMovingAverageSmoother<double> wmas(2);
+            REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [&](const core::NumericalData<double>& d){ return wmas.go(d); }), wmas.go(batch));
+        }
+        THEN( "check peak filters" ) {
+            const core::GlobalThresholdPeakFilter<double> gpf(0.4);
+            REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [&](const core::NumericalData<double>& d){ return gpf.go(d); }), gpf.go(batch));
+            const core::ChunkedThresholdPeakFilter<double> cpf(0.4, 10);
+            REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [&](const core::NumericalData<double>& d){ return cpf.go(d); }), cpf.go(batch));
+            const core::MovingAveragePeakFilter<double> mapf(4);
+            REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [&](const core::NumericalData<double>& d){ return mapf.go(d); }), mapf.go(batch));
+        }
+        THEN( "check process manager" ) {
+            core::SimpleProcessManager<double> manager;
+            manager.append(std::make_shared<core::MovingAverageSmoother<double>>(2))
+                   .append(std::make_shared<core::GlobalThresholdPeakFilter<double>>(0.2));
+            REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [&](const core::NumericalData<double>& d){ return manager.run(d); }), manager.run(batch));
+        }
+        THEN( "check default batch run of a process manager" ) {
+            const OnlySpectrumProcessManager manager;
+            REQUIRE_BATCH_APPROX_THE_SAME(each(spectra, [&](const core::NumericalData<double>& d){ return manager.run(d); }), manager.run(batch));
+        }
+    }
+
+PEAKINGDUCK_NAMESPACE_END // unittests
+PEAKINGDUCK_NAMESPACE_END // peakingduck
@@ -0,0 +1,207 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "common.hpp"
+
+#include "peakingduck.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(unittests)
+
+    // numpy.convolve(data, kernel, mode='same')
+    core::NumericalData<double> naiveConvolve(const core::NumericalData<double>& data, const core::NumericalData<double>& kernel){
+        const int centre = (kernel.size() - 1)/2;
+        core::NumericalData<double> result = core::NumericalData<double>::Zero(data.size());
+        for(int i=0; i<data.size(); ++i){
+            for(int j=0; j<kernel.size(); ++j){
+                const int index = i + centre - j;
+                if(index >= 0 && index < data.size()){
+                    result[i] += kernel[j]*data[index];
+                }
+            }
+        }
+        return result;
+    }
+
+    // values near zero, so compare with a margin
+    template<typename T, int Size>
+    void REQUIRE_CONVOLUTION_THE_SAME(const core::NumericalData<T, Size>& lhs, const core::NumericalData<T, Size>& rhs, double margin=1e-9){
+        REQUIRE( lhs.size() == rhs.size() );
+        for(int i=0; i<lhs.size(); ++i){
+            REQUIRE( lhs[i] == Approx(rhs[i]).margin(margin) );
+        }
+    }
+
+    // a spectrum like signal, peaks on a falling background
+    core::NumericalData<double> testSignal(int size){
+        core::NumericalData<double> data(size);
+        for(int i=0; i<size; ++i){
+            data[i] = 100.0*std::exp(-0.001*i) + 50.0*std::exp(-0.5*std::pow((i % 400 - 200)/3.0, 2)) + (i*7919 % 13);
+        }
+        return data;
+    }
+
+    SCENARIO( "Test convolution" ) {
+        const core::NumericalData<double> data(std::vector<double>({1, 2, 3, 4, 5}));
+
+        THEN( "check against numpy" ) {
+            const core::NumericalData<double> difference(std::vector<double>({1, 0, -1}));
+            const core::NumericalData<double> pair(std::vector<double>({1, 1}));
+            for(auto method: {core::ConvolutionMethod::Direct, core::ConvolutionMethod::FFT}){
+                REQUIRE_CONVOLUTION_THE_SAME(core::NumericalData<double>(std::vector<double>({2, 2, 2, 2, -4})),
+                    core::convolve<double>(data, difference, method));
+                REQUIRE_CONVOLUTION_THE_SAME(core::NumericalData<double>(std::vector<double>({1, 3, 5, 7, 9})),
+                    core::convolve<double>(data, pair, method));
+                REQUIRE_CONVOLUTION_THE_SAME(core::NumericalData<double>(std::vector<double>({-2, -2, -2, -2, 4})),
+                    core::correlate<double>(data, difference, method));
+            }
+        }
+        THEN( "check direct and FFT against the naive convolution" ) {
+            const core::NumericalData<double> signal = testSignal(5000);
+            for(int kernelsize: {1, 2, 31, 300, 301, 1200}){
+                core::NumericalData<double> kernel(kernelsize);
+                for(int i=0; i<kernelsize; ++i){
+                    kernel[i] = std::cos(0.1*i) + 0.01*i;
+                }
+                const core::NumericalData<double> expected = naiveConvolve(signal, kernel);
+                core::ConvolutionEngine<double> direct(kernel, core::ConvolutionMethod::Direct);
+                core::ConvolutionEngine<double> fft(kernel, core::ConvolutionMethod::FFT);
+                REQUIRE_CONVOLUTION_THE_SAME(expected, direct.convolve(signal), 1e-6);
+                REQUIRE_CONVOLUTION_THE_SAME(expected, fft.convolve(signal), 1e-6);
+
+                // again, reusing the buffers on a shorter spectrum
+                REQUIRE_CONVOLUTION_THE_SAME(naiveConvolve(data, kernel), fft.convolve(data), 1e-9);
+                REQUIRE_CONVOLUTION_THE_SAME(expected, fft.convolve(signal), 1e-6);
+            }
+        }
+        THEN( "check boxes" ) {
+            const core::NumericalData<double> signal = testSignal(3000);
+            core::ConvolutionEngine<double> separable = core::ConvolutionEngine<double>::boxes({5, 5, 8}, 0.5);
+            REQUIRE( separable.method(signal.size()) == core::ConvolutionMethod::Separable );
+            REQUIRE( separable.kernel().size() == 16 );
+            REQUIRE( separable.kernel().sum() == Approx(0.5*5*5*8) );
+            REQUIRE_CONVOLUTION_THE_SAME(naiveConvolve(signal, separable.kernel()), separable.convolve(signal), 1e-6);
+            REQUIRE_CONVOLUTION_THE_SAME(naiveConvolve(data, separable.kernel()), separable.convolve(data));
+
+            core::ConvolutionEngine<double> fft = core::ConvolutionEngine<double>::boxes({5, 5, 8}, 0.5, core::ConvolutionMethod::FFT);
+            REQUIRE( fft.method(signal.size()) == core::ConvolutionMethod::FFT );
+            REQUIRE_CONVOLUTION_THE_SAME(separable.convolve(signal), fft.convolve(signal), 1e-6);
+        }
+        THEN( "check the automatic choice" ) {
+            core::ConvolutionEngine<double> narrow(core::NumericalData<double>::Ones(3));
+            core::ConvolutionEngine<double> wide(core::NumericalData<double>::Ones(501));
+            REQUIRE( narrow.method(16384) == core::ConvolutionMethod::Direct );
+            REQUIRE( wide.method(16384) == core::ConvolutionMethod::FFT );
+            REQUIRE( wide.method(10) == core::ConvolutionMethod::Direct );
+        }
+        THEN( "check strided views and single precision" ) {
+            const core::NumericalData<double> signal = testSignal(2000);
+            const core::ConstNumericalView<double> strided(signal.data(), 1000, 2);
+            const core::NumericalData<double> kernel = core::gaussianKernel<double>(20.0);
+            const core::NumericalData<double> expected = naiveConvolve(core::NumericalData<double>(strided), kernel);
+            REQUIRE_CONVOLUTION_THE_SAME(expected, core::convolve<double>(strided, kernel, core::ConvolutionMethod::FFT), 1e-9);
+            REQUIRE_CONVOLUTION_THE_SAME(expected, core::convolve<double>(strided, kernel, core::ConvolutionMethod::Direct), 1e-9);
+
+            const core::NumericalData<float> single = core::convolve<float>(signal.cast<float>(), kernel.cast<float>(), core::ConvolutionMethod::FFT);
+            REQUIRE_CONVOLUTION_THE_SAME(naiveConvolve(signal, kernel), core::NumericalData<double>(single.cast<double>()), 1e-3);
+        }
+        THEN( "check throws" ) {
+            REQUIRE_THROWS_AS( core::ConvolutionEngine<double>(core::NumericalData<double>()), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::ConvolutionEngine<double>(data, core::ConvolutionMethod::Separable), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::ConvolutionEngine<double>::boxes({3, 0}), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::gaussianKernel<double>(0.0), PeakingDuckException );
+        }
+    }
+
+    SCENARIO( "Test convolution smoothers" ) {
+        const core::NumericalData<double> signal = testSignal(1000);
+
+        THEN( "check the moving average as a kernel" ) {
+            const int windowsize = 40;
+            core::NumericalData<double> box = core::NumericalData<double>::Ones(2*windowsize+1);
+            box *= 1.0/(2*windowsize+1);
+            for(auto edgemode: {core::EdgeMode::Keep, core::EdgeMode::Truncate}){
+                const core::MovingAverageSmoother<double> expected(windowsize, edgemode);
+                for(auto method: {core::ConvolutionMethod::Direct, core::ConvolutionMethod::FFT}){
+                    const core::ConvolutionSmoother<double> smoother(box, edgemode, method);
+                    REQUIRE_CONVOLUTION_THE_SAME(expected.go(signal), smoother.go(signal), 1e-9);
+                }
+            }
+        }
+        THEN( "check triangular" ) {
+            const int windowsize = 25;
+            core::NumericalData<double> weights(2*windowsize+1);
+            for(int i=-windowsize; i<=windowsize; ++i){
+                weights[i+windowsize] = (windowsize + 1.0 - std::abs(i))/std::pow(windowsize + 1.0, 2);
+            }
+            const core::ConvolutionSmoother<double> direct(weights, core::EdgeMode::Truncate, core::ConvolutionMethod::Direct);
+            const auto triangular = core::makeTriangularSmoother<double>(windowsize, core::EdgeMode::Truncate);
+            REQUIRE( weights.sum() == Approx(1.0) );
+            REQUIRE_CONVOLUTION_THE_SAME(direct.go(signal), triangular->go(signal), 1e-9);
+
+            const core::NumericalData<double> kept = core::makeTriangularSmoother<double>(windowsize)->go(signal);
+            REQUIRE( kept[windowsize-1] == signal[windowsize-1] );
+            REQUIRE( kept[windowsize] == Approx(direct.go(signal)[windowsize]) );
+        }
+        THEN( "check gaussian" ) {
+            const core::NumericalData<double> kernel = core::gaussianKernel<double>(2.0, 3.0);
+            REQUIRE( kernel.size() == 13 );
+            REQUIRE( kernel.sum() == Approx(1.0) );
+            REQUIRE( kernel[6] == Approx(1.0/(2.0*std::sqrt(2.0*M_PI))).epsilon(1e-2) );
+
+            // a constant is unchanged, including the truncated edges
+            const core::NumericalData<double> flat = core::NumericalData<double>::Ones(200)*3.0;
+            const auto smoother = core::makeGaussianSmoother<double>(10.0, 4.0, core::EdgeMode::Truncate);
+            REQUIRE_CONVOLUTION_THE_SAME(flat, smoother->go(flat));
+
+            // shorter than the kernel
+            const core::NumericalData<double> few = core::NumericalData<double>::Ones(5)*2.0;
+            REQUIRE_CONVOLUTION_THE_SAME(few, smoother->go(few));
+            REQUIRE_CONVOLUTION_THE_SAME(few, core::makeGaussianSmoother<double>(10.0)->go(few));
+        }
+        THEN( "check views and batches" ) {
+            const auto smoother = core::makeGaussianSmoother<double>(5.0);
+            const core::NumericalData<double> expected = smoother->go(core::NumericalData<double>(signal.slice(100, 600)));
+            REQUIRE_CONVOLUTION_THE_SAME(expected, smoother->go(signal.slice(100, 600)));
+
+            core::NumericalBatch<double> batch(500, 3);
+            for(int i=0; i<batch.nspectra(); ++i){
+                const auto spectrum = signal.slice(100*i, 100*i+500);
+                std::copy(spectrum.begin(), spectrum.end(), batch.spectrum(i).begin());
+            }
+            const core::NumericalBatch<double> smoothed = smoother->go(batch);
+            for(int i=0; i<batch.nspectra(); ++i){
+                REQUIRE_CONVOLUTION_THE_SAME(smoother->go(core::NumericalData<double>(batch.spectrum(i))), core::NumericalData<double>(smoothed.spectrum(i)));
+            }
+        }
+        THEN( "check one smoother from several threads" ) {
+            const core::ConvolutionSmoother<double> smoother(core::gaussianKernel<double>(20.0), core::EdgeMode::Truncate,
+                                                             core::ConvolutionMethod::FFT);
+            const core::NumericalData<double> expected = smoother.go(signal);
+
+            util::ThreadPool pool(4);
+            std::vector<core::NumericalData<double>> results(16);
+            pool.parallelFor(static_cast<int>(results.size()), [&](int i){
+                results[i] = smoother.go(signal);
+            });
+            for(const auto& result: results){
+                REQUIRE_CONVOLUTION_THE_SAME(expected, result, 0.0);
+            }
+
+            // copies share the plan, not the buffers
+            core::ConvolutionEngine<double> engine(core::gaussianKernel<double>(20.0), core::ConvolutionMethod::FFT);
+            const core::ConvolutionEngine<double> copy = engine;
+            REQUIRE( &copy.kernel() == &engine.kernel() );
+        }
+    }
+
+PEAKINGDUCK_NAMESPACE_END // unittests
+PEAKINGDUCK_NAMESPACE_END // peakingduck
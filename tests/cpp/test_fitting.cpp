@@ -0,0 +1,336 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "common.hpp"
+
+#include "peakingduck.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(unittests)
+
+    // a peak of the fit model, with a tail for fraction > 0
+    double modelPeak(double x, double height, double centroid, double sigma, double fraction=0.0, double slope=1.0)
+    {
+        const double u = x - centroid;
+        const double gauss = std::exp(-0.5*u*u/(sigma*sigma));
+        const double tail = std::exp(u/slope)*std::erfc(u/(std::sqrt(2.0)*sigma) + sigma/(std::sqrt(2.0)*slope));
+        return height*((1.0 - fraction)*gauss + fraction*tail);
+    }
+
+    SCENARIO( "Test Gaussian peak fitting" ) {
+        const double fwhmPerSigma = 2.3548200450309493;
+        const double sqrtTwoPi = std::sqrt(2.0*std::acos(-1.0));
+        util::ThreadPool serial(0);
+        util::ThreadPool parallel(3);
+
+        THEN( "check a peak on a linear background" ) {
+            core::NumericalData<double> data(200);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = 20.0 + 0.05*i + modelPeak(i, 1000.0, 100.3, 2.1);
+            }
+            const core::PeakList<double> peaks{core::PeakInfo<double>(100, data[100])};
+            const core::PeakFits<double> fits = core::GaussianPeakFitter<double>(core::FitBackground::Linear, false, 100, 1e-10, parallel).fit(data, peaks, 15);
+            REQUIRE( fits.size() == 1 );
+            REQUIRE( fits.regions[0] == 0 );
+            REQUIRE( fits.converged[0] );
+            REQUIRE( !fits.stalled[0] );
+            REQUIRE( fits.centroids[0] == Approx(100.3).epsilon(1e-8) );
+            REQUIRE( fits.heights[0] == Approx(1000.0).epsilon(1e-8) );
+            REQUIRE( fits.fwhms[0] == Approx(2.1*fwhmPerSigma).epsilon(1e-8) );
+            REQUIRE( fits.areas[0] == Approx(1000.0*2.1*sqrtTwoPi).epsilon(1e-8) );
+            REQUIRE( fits.tailFractions[0] == 0.0 );
+            REQUIRE( fits.reducedChi2s[0] < 1e-12 );
+            REQUIRE( fits.centroidErrors[0] > 0.0 );
+            REQUIRE( fits.areaErrors[0] > 0.0 );
+        }
+        THEN( "check a peak on a quadratic background" ) {
+            core::NumericalData<double> data(200);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = 50.0 - 0.2*i + 0.004*(i - 90)*(i - 90) + modelPeak(i, 300.0, 87.6, 3.2);
+            }
+            const core::PeakList<double> peaks{core::PeakInfo<double>(88, data[88])};
+            const core::PeakFits<double> linear = core::GaussianPeakFitter<double>(core::FitBackground::Linear).fit(data, peaks, 25);
+            const core::PeakFits<double> quadratic = core::GaussianPeakFitter<double>(core::FitBackground::Quadratic, false, 100, 1e-10).fit(data, peaks, 25);
+            REQUIRE( quadratic.centroids[0] == Approx(87.6).epsilon(1e-8) );
+            REQUIRE( quadratic.fwhms[0] == Approx(3.2*fwhmPerSigma).epsilon(1e-8) );
+            REQUIRE( quadratic.heights[0] == Approx(300.0).epsilon(1e-8) );
+            REQUIRE( quadratic.reducedChi2s[0] < 1e-12 );
+            REQUIRE( linear.reducedChi2s[0] > 1e-3 );
+        }
+        THEN( "check a peak with a tail" ) {
+            core::NumericalData<double> data(300);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = 10.0 + modelPeak(i, 2000.0, 150.2, 2.5, 0.3, 4.0);
+            }
+            const core::PeakList<double> peaks{core::PeakInfo<double>(150, data[150])};
+            const core::PeakFits<double> fits = core::GaussianPeakFitter<double>(core::FitBackground::Linear, true, 200, 1e-12).fit(data, peaks, 40);
+            REQUIRE( fits.converged[0] );
+            REQUIRE( fits.centroids[0] == Approx(150.2).epsilon(1e-6) );
+            REQUIRE( fits.fwhms[0] == Approx(2.5*fwhmPerSigma).epsilon(1e-6) );
+            REQUIRE( fits.tailFractions[0] == Approx(0.3).epsilon(1e-6) );
+            REQUIRE( fits.tailSlopes[0] == Approx(4.0).epsilon(1e-6) );
+
+            // the area (with the tail) is the sum of the counts above the background
+            double net = 0.0;
+            for(int i=0; i<data.size(); ++i){
+                net += data[i] - 10.0;
+            }
+            REQUIRE( fits.areas[0] == Approx(net).epsilon(1e-6) );
+
+            // without the tail the fit is worse
+            const core::PeakFits<double> gaussian = core::GaussianPeakFitter<double>().fit(data, peaks, 40);
+            REQUIRE( gaussian.reducedChi2s[0] > 1.0 );
+        }
+        THEN( "check overlapping regions are one fit" ) {
+            core::NumericalData<double> data(200);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = 30.0 + modelPeak(i, 800.0, 90.4, 2.0) + modelPeak(i, 400.0, 98.1, 2.0) + modelPeak(i, 600.0, 150.0, 3.0);
+            }
+            const core::PeakList<double> peaks{core::PeakInfo<double>(90, data[90]), core::PeakInfo<double>(98, data[98]), core::PeakInfo<double>(150, data[150])};
+            const std::vector<core::FitRegion> regions = core::fitRegions(peaks, 12, data.size());
+            REQUIRE( regions.size() == 2 );
+            REQUIRE( regions[0].first == 78 );
+            REQUIRE( regions[0].last == 111 );
+            REQUIRE( regions[0].centroids == std::vector<double>({90.0, 98.0}) );
+            REQUIRE( regions[1].first == 138 );
+
+            const core::PeakFits<double> fits = core::GaussianPeakFitter<double>(core::FitBackground::Linear, false, 100, 1e-10, parallel).fit(data, regions);
+            REQUIRE( fits.size() == 3 );
+            REQUIRE( fits.regions == std::vector<int>({0, 0, 1}) );
+            REQUIRE( fits.centroids[0] == Approx(90.4).epsilon(1e-8) );
+            REQUIRE( fits.centroids[1] == Approx(98.1).epsilon(1e-8) );
+            REQUIRE( fits.centroids[2] == Approx(150.0).epsilon(1e-8) );
+            REQUIRE( fits.heights[1] == Approx(400.0).epsilon(1e-8) );
+
+            // a peak outside of its region can not be moved in, so is stuck at the guess
+            core::FitRegion outside;
+            outside.first = 138;
+            outside.last = 163;
+            outside.centroids = {120.0};
+            const core::PeakFits<double> stuck = core::GaussianPeakFitter<double>().fit(data, std::vector<core::FitRegion>{outside});
+            REQUIRE( stuck.stalled[0] );
+            REQUIRE( !stuck.converged[0] );
+            REQUIRE( stuck.iterations[0] == 1 );
+            REQUIRE( stuck.centroids[0] == 120.0 );
+
+            // regions at the ends of the data are cut
+            const std::vector<core::FitRegion> ends = core::fitRegions(core::PeakList<double>{core::PeakInfo<double>(3, 1.0), core::PeakInfo<double>(198, 1.0)}, 12, data.size());
+            REQUIRE( ends[0].first == 0 );
+            REQUIRE( ends[1].last == 200 );
+        }
+        THEN( "check counts are within the uncertainties and the same with any number of threads" ) {
+            std::mt19937 generator(42);
+            core::NumericalData<double> data(20000);
+            std::vector<double> centroids;
+            core::PeakList<double> peaks;
+            for(int i=0; i<data.size(); ++i){
+                data[i] = 100.0;
+            }
+            for(int p=0; p<data.size()/100 - 1; ++p){
+                const double centroid = 100.0*(p + 1) + 0.37*(p % 3);
+                centroids.push_back(centroid);
+                peaks.emplace_back(static_cast<size_t>(std::round(centroid)), 0.0);
+                for(int i=static_cast<int>(centroid) - 20; i<static_cast<int>(centroid) + 20; ++i){
+                    data[i] += modelPeak(i, 2000.0, centroid, 2.5);
+                }
+            }
+            for(int i=0; i<data.size(); ++i){
+                data[i] = std::poisson_distribution<int>(data[i])(generator);
+            }
+
+            const core::PeakFits<double> fits = core::GaussianPeakFitter<double>(core::FitBackground::Linear, false, 100, 1e-8, parallel).fit(data, peaks, 15);
+            REQUIRE( fits.size() == static_cast<int>(centroids.size()) );
+            int outside = 0;
+            for(int p=0; p<fits.size(); ++p){
+                REQUIRE( fits.converged[p] );
+                REQUIRE( std::abs(fits.centroids[p] - centroids[p]) < 5.0*fits.centroidErrors[p] );
+                REQUIRE( std::abs(fits.areas[p] - 2000.0*2.5*sqrtTwoPi) < 5.0*fits.areaErrors[p] );
+                outside += std::abs(fits.centroids[p] - centroids[p]) > 2.0*fits.centroidErrors[p];
+                REQUIRE( fits.reducedChi2s[p] < 3.0 );
+            }
+            // about 5% beyond 2 sigma
+            REQUIRE( outside < fits.size()/5 );
+
+            const core::PeakFits<double> serialfits = core::GaussianPeakFitter<double>(core::FitBackground::Linear, false, 100, 1e-8, serial).fit(data, peaks, 15);
+            REQUIRE( serialfits.centroids == fits.centroids );
+            REQUIRE( serialfits.areaErrors == fits.areaErrors );
+            REQUIRE( serialfits.iterations == fits.iterations );
+        }
+        THEN( "check single precision and views" ) {
+            core::NumericalData<float> data(100);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = static_cast<float>(5.0 + modelPeak(i, 100.0, 50.5, 1.5));
+            }
+            const core::PeakList<float> peaks{core::PeakInfo<float>(50, data[50])};
+            const core::PeakFits<float> fits = core::GaussianPeakFitter<float>().fit(data, peaks, 10);
+            REQUIRE( fits.centroids[0] == Approx(50.5).epsilon(1e-5) );
+
+            // a view of the second half, the channels are of the view
+            const core::PeakFits<float> fromview = core::GaussianPeakFitter<float>().fit(data.slice(20, 100), core::PeakList<float>{core::PeakInfo<float>(30, data[50])}, 10);
+            REQUIRE( fromview.centroids[0] == Approx(30.5).epsilon(1e-5) );
+        }
+        THEN( "check invalid regions" ) {
+            const core::NumericalData<double> data(std::vector<double>(50, 1.0));
+            const core::GaussianPeakFitter<double> fitter;
+            REQUIRE_THROWS_AS( fitter.fit(data, std::vector<core::FitRegion>{core::FitRegion{10, 15, {12.0}}}), PeakingDuckException );
+            REQUIRE_THROWS_AS( fitter.fit(data, std::vector<core::FitRegion>{core::FitRegion{40, 60, {45.0}}}), PeakingDuckException );
+            REQUIRE_THROWS_AS( fitter.fit(data, std::vector<core::FitRegion>{core::FitRegion{10, 30, {}}}), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::fitRegions(core::PeakList<double>{core::PeakInfo<double>(3, 1.0)}, 0, 50), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::GaussianPeakFitter<double>(core::FitBackground::Linear, false, 0), PeakingDuckException );
+            REQUIRE( fitter.fit(data, std::vector<core::FitRegion>()).size() == 0 );
+        }
+    }
+
+    SCENARIO( "Test multiplet fitting" ) {
+        const double fwhmPerSigma = 2.3548200450309493;
+        util::ThreadPool serial(0);
+        util::ThreadPool parallel(3);
+
+        // a doublet and a triplet closer than their FWHM and a singlet
+        auto multiplets = [&](int size, double spacing){
+            core::NumericalData<double> data(size);
+            for(int i=0; i<size; ++i){
+                data[i] = 20.0;
+            }
+            for(int m=0; m<size/spacing - 1; ++m){
+                const double start = spacing*(m + 0.5);
+                for(int i=std::max(0, static_cast<int>(start) - 30); i<std::min(size, static_cast<int>(start) + 40); ++i){
+                    data[i] += modelPeak(i, 1000.0, start, 2.0) + modelPeak(i, 600.0, start + 3.5, 2.0);
+                }
+            }
+            return data;
+        };
+
+        THEN( "check the peaks of a group are found" ) {
+            core::NumericalData<double> data(400);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = 20.0 + 0.02*i + modelPeak(i, 1000.0, 100.0, 2.0) + modelPeak(i, 600.0, 103.5, 2.0)
+                    + modelPeak(i, 800.0, 200.0, 2.0) + modelPeak(i, 500.0, 205.0, 2.0) + modelPeak(i, 300.0, 209.0, 2.0)
+                    + modelPeak(i, 700.0, 300.3, 2.0);
+            }
+            // the simple finder has one peak per group
+            REQUIRE( core::SimplePeakFinder<double>(0.05).find(data).size() == 3 );
+            const std::vector<core::FitRegion> regions = core::multipletRegions<double>(data, 0.05, 8);
+            REQUIRE( regions.size() == 3 );
+            REQUIRE( regions[0].centroids.size() == 1 );
+
+            const core::MultipletFitter<double> fitter(5, core::FitBackground::Linear, 100, 1e-10, parallel);
+            const core::PeakFits<double> fits = fitter.fit(data, regions);
+            REQUIRE( fits.size() == 6 );
+            REQUIRE( fits.regions == std::vector<int>({0, 0, 1, 1, 1, 2}) );
+            const std::vector<double> centroids{100.0, 103.5, 200.0, 205.0, 209.0, 300.3};
+            const std::vector<double> heights{1000.0, 600.0, 800.0, 500.0, 300.0, 700.0};
+            for(int p=0; p<fits.size(); ++p){
+                REQUIRE( fits.converged[p] );
+                REQUIRE( !fits.stalled[p] );
+                REQUIRE( fits.centroids[p] == Approx(centroids[p]).epsilon(1e-8) );
+                REQUIRE( fits.heights[p] == Approx(heights[p]).epsilon(1e-8) );
+                REQUIRE( fits.fwhms[p] == Approx(2.0*fwhmPerSigma).epsilon(1e-8) );
+                REQUIRE( fits.areas[p] == Approx(heights[p]*2.0*std::sqrt(2.0*std::acos(-1.0))).epsilon(1e-8) );
+                REQUIRE( fits.areaErrors[p] > 0.0 );
+                REQUIRE( fits.tailFractions[p] == 0.0 );
+            }
+
+            // the criterion is lowest for the number of peaks
+            for(size_t r=0; r<regions.size(); ++r){
+                const std::vector<double> criteria = fitter.criteria(data, regions[r]);
+                REQUIRE( criteria.size() == 5 );
+                const int npeaks = static_cast<int>(std::count(fits.regions.begin(), fits.regions.end(), static_cast<int>(r)));
+                REQUIRE( std::min_element(criteria.begin(), criteria.end()) - criteria.begin() == npeaks - 1 );
+            }
+        }
+        THEN( "check counts choose the peaks, the same with any number of threads" ) {
+            std::mt19937 generator(7);
+            core::NumericalData<double> data = multiplets(20000, 100.0);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = std::poisson_distribution<int>(data[i])(generator);
+            }
+            const std::vector<core::FitRegion> regions = core::multipletRegions<double>(data, 0.1, 8);
+            REQUIRE( regions.size() == 199 );
+
+            const core::MultipletFitter<double> fitter(4, core::FitBackground::Linear, 100, 1e-8, parallel);
+            const core::PeakFits<double> fits = fitter.fit(data, regions);
+            int doublets = 0;
+            for(size_t r=0; r<regions.size(); ++r){
+                const std::vector<int>::const_iterator first = std::find(fits.regions.begin(), fits.regions.end(), static_cast<int>(r));
+                const int p = static_cast<int>(first - fits.regions.begin());
+                if(std::count(fits.regions.begin(), fits.regions.end(), static_cast<int>(r)) != 2){
+                    continue;
+                }
+                ++doublets;
+                const double start = 100.0*(r + 0.5);
+                REQUIRE( std::abs(fits.centroids[p] - start) < 5.0*fits.centroidErrors[p] );
+                REQUIRE( std::abs(fits.centroids[p+1] - start - 3.5) < 5.0*fits.centroidErrors[p+1] );
+                REQUIRE( fits.reducedChi2s[p] < 3.0 );
+            }
+            // a few are closer to a triplet by chance
+            REQUIRE( doublets > 180 );
+
+            // only fits that end within their regions are kept
+            for(int p=0; p<fits.size(); ++p){
+                const core::FitRegion& region = regions[fits.regions[p]];
+                const double sigma = fits.fwhms[p]/fwhmPerSigma;
+                REQUIRE( !fits.stalled[p] );
+                REQUIRE( fits.centroids[p] >= region.first + sigma );
+                REQUIRE( fits.centroids[p] <= region.last - 1 - sigma );
+            }
+
+            const core::PeakFits<double> serialfits = core::MultipletFitter<double>(4, core::FitBackground::Linear, 100, 1e-8, serial).fit(data, regions);
+            REQUIRE( serialfits.regions == fits.regions );
+            REQUIRE( serialfits.centroids == fits.centroids );
+            REQUIRE( serialfits.areaErrors == fits.areaErrors );
+        }
+        THEN( "check one peak is one peak" ) {
+            std::mt19937 generator(11);
+            core::NumericalData<double> data(200);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = std::poisson_distribution<int>(50.0 + modelPeak(i, 2000.0, 100.4, 2.5))(generator);
+            }
+            const core::PeakFits<double> fits = core::MultipletFitter<double>(3, core::FitBackground::Quadratic).fit(data, core::multipletRegions<double>(data, 0.2, 10));
+            REQUIRE( fits.size() == 1 );
+            REQUIRE( std::abs(fits.centroids[0] - 100.4) < 5.0*fits.centroidErrors[0] );
+        }
+        THEN( "check single precision, views and regions without centroids" ) {
+            core::NumericalData<float> data(200);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = static_cast<float>(10.0 + modelPeak(i, 500.0, 100.0, 2.0) + modelPeak(i, 300.0, 103.5, 2.0));
+            }
+            const core::MultipletFitter<float> fitter(3);
+            const core::PeakFits<float> fits = fitter.fit(data, std::vector<core::FitRegion>{core::FitRegion{80, 125, {}}});
+            REQUIRE( fits.size() == 2 );
+            REQUIRE( fits.centroids[0] == Approx(100.0).epsilon(1e-4) );
+            REQUIRE( fits.centroids[1] == Approx(103.5).epsilon(1e-4) );
+
+            const core::PeakFits<float> fromview = fitter.fit(data.slice(50, 200), core::multipletRegions<float>(data.slice(50, 200), 0.05f, 8));
+            REQUIRE( fromview.size() == 2 );
+            REQUIRE( fromview.centroids[1] == Approx(53.5).epsilon(1e-4) );
+        }
+        THEN( "check invalid regions" ) {
+            const core::NumericalData<double> data(std::vector<double>(50, 1.0));
+            const core::MultipletFitter<double> fitter;
+            REQUIRE_THROWS_AS( core::MultipletFitter<double>(0), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::MultipletFitter<double>(2, core::FitBackground::Linear, 0), PeakingDuckException );
+            REQUIRE_THROWS_AS( fitter.fit(data, std::vector<core::FitRegion>{core::FitRegion{10, 15, {12.0}}}), PeakingDuckException );
+            REQUIRE_THROWS_AS( fitter.fit(data, std::vector<core::FitRegion>{core::FitRegion{40, 60, {45.0}}}), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::multipletRegions<double>(data, 0.5, -1), PeakingDuckException );
+            REQUIRE( core::multipletRegions<double>(core::NumericalData<double>(), 0.5, 2).empty() );
+            REQUIRE( fitter.fit(data, std::vector<core::FitRegion>()).size() == 0 );
+            // only as many peaks as fit in the points
+            REQUIRE( fitter.criteria(data, core::FitRegion{10, 17, {}}) == std::vector<double>({fitter.criteria(data, core::FitRegion{10, 17, {}})[0], 
+                std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()}) );
+        }
+    }
+
+PEAKINGDUCK_NAMESPACE_END // unittests
+PEAKINGDUCK_NAMESPACE_END // peakingduck
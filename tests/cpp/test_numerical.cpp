@@ -410,6 +410,66 @@ PEAKINGDUCK_NAMESPACE_START(unittests)
         }    
     }
 
+    SCENARIO( "Test numerical view" ) {
+        core::NumericalData<double> data(9);
+        data << 1, 4, 5, 2, 10, -2, 2, -8, 2;
+
+        THEN( "check writable view" ) {
+            auto view = data.view(1, 4);
+            REQUIRE( view.size() == 3);
+            REQUIRE( view.data() == data.data() + 1);
+            REQUIRE( view[0] == 4);
+            REQUIRE( view[2] == 2);
+
+            // writes go through to the data
+            view[0] = 42;
+            REQUIRE( data[1] == 42);
+        }
+        THEN( "check slice and materialise" ) {
+            const core::ConstNumericalView<double> view = data(3, -2);
+            REQUIRE( view.data() == data.data() + 3);
+            REQUIRE( view.size() == 4);
+            REQUIRE( view.to_vector() == std::vector<double>({2, 10, -2, 2}));
+
+            // a copy is only made when asked for
+            core::NumericalData<double> copied = view.materialise();
+            copied[0] = 100;
+            REQUIRE( data[3] == 2);
+            REQUIRE( copied.to_vector() == std::vector<double>({100, 10, -2, 2}));
+        }
+        THEN( "check strided view" ) {
+            const core::ConstNumericalView<double> view(data.data(), 5, 2);
+            REQUIRE( view.stride() == 2);
+            REQUIRE( view.to_vector() == std::vector<double>({1, 5, 10, 2, 2}));
+            REQUIRE( view.sum() == 20);
+            REQUIRE( view.maxCoeff() == 10);
+
+            const core::ConstNumericalView<double> subview = view.slice(1, -1);
+            REQUIRE( subview.to_vector() == std::vector<double>({5, 10, 2}));
+        }
+        THEN( "check operations on a view" ) {
+            const auto view = data.slice(0, 7);
+            REQUIRE( view.mean() == Approx(22.0/7.0));
+            REQUIRE( view.stddev() == Approx(data.slice(0, 7).materialise().stddev()));
+            REQUIRE( (view*2.0).to_vector() == std::vector<double>({2, 8, 10, 4, 20, -4, 4}));
+            REQUIRE( (view - view).sum() == 0);
+            REQUIRE_NUMERICS_APPROX_THE_SAME(view.midpoint(2), core::NumericalData<double>(data.slice(0, 7)).midpoint(2));
+            REQUIRE_NUMERICS_APPROX_THE_SAME(data.slice(0, 5).snip(3), core::NumericalData<double>(data.slice(0, 5)).snip(3));
+        }
+        THEN( "check in place operations write through the view" ) {
+            auto view = data.view(2, 7);
+            view.midpointInPlace(1);
+            REQUIRE( data.to_vector() == std::vector<double>({1, 4, 5, 7.5, 0, 6, 2, -8, 2}));
+        }
+        THEN( "check window views" ) {
+            const auto views = core::windowViews(data, 4, 3, 1);
+            REQUIRE( views.first.to_vector() == std::vector<double>({4, 5}));
+            REQUIRE( views.second.to_vector() == std::vector<double>({2, -8}));
+            REQUIRE( views.first.data() == data.data() + 1);
+            REQUIRE( views.second.data() == data.data() + 6);
+        }
+    }
+
     SCENARIO( "Test assignment" ) {
         core::NumericalData<double> data = core::NumericalData<double>::Ones(10);
         REQUIRE( data.to_vector() == std::vector<double>(10, 1.0));
@@ -432,6 +492,28 @@ PEAKINGDUCK_NAMESPACE_START(unittests)
             REQUIRE( data[2] == 3);
             REQUIRE( data[3] == 4);
         }    
+        THEN( "check clip" ) {
+            core::NumericalData<double, 5> data(-3, 1, 2.5, 4, 8);
+            REQUIRE_NUMERICS_THE_SAME<double, 5>(core::NumericalData<double, 5>(0, 1, 2.5, 4, 5), data.clip(0, 5));
+            data.clipInPlace(1.5, 3);
+            REQUIRE_NUMERICS_THE_SAME<double, 5>(core::NumericalData<double, 5>(1.5, 1.5, 2.5, 3, 3), data);
+        }
+        THEN( "check zero below" ) {
+            core::NumericalData<int, 5> data(-3, 0, 2, 4, 8);
+            REQUIRE_NUMERICS_THE_SAME<int, 5>(core::NumericalData<int, 5>(0, 0, 2, 4, 8), data.ramp(0));
+            REQUIRE_NUMERICS_THE_SAME<int, 5>(core::NumericalData<int, 5>(0, 0, 0, 4, 8), data.zeroBelow(2));
+            data.zeroBelowInPlace(0);
+            REQUIRE_NUMERICS_THE_SAME<int, 5>(core::NumericalData<int, 5>(0, 0, 2, 4, 8), data);
+        }
+        THEN( "check mask" ) {
+            core::NumericalData<double, 5> data(-3, 1, 2.5, 4, 8);
+            const core::NumericalData<double, 5> mask(1, 0, 0, 2, -1);
+            REQUIRE_NUMERICS_THE_SAME<double, 5>(core::NumericalData<double, 5>(-3, 0, 0, 4, 8), data.mask(mask));
+            const double* before = data.data();
+            data.maskInPlace(mask);
+            REQUIRE( data.data() == before );
+            REQUIRE_NUMERICS_THE_SAME<double, 5>(core::NumericalData<double, 5>(-3, 0, 0, 4, 8), data);
+        }
         THEN( "check LLS" ) {
             core::NumericalData<double, 3> data(3, 8, 15);
             const core::NumericalData<double, 3> lls = data.LLS();
@@ -850,5 +932,184 @@ PEAKINGDUCK_NAMESPACE_START(unittests)
         }          
     }
 
+    // user defined stencil - difference between the upper and lower neighbours
+    struct DifferenceStencil
+    {
+        template<class Lower, class Centre, class Upper>
+        static decltype(auto) apply(const Lower& lower, const Centre&, const Upper& upper)
+        {
+            return upper - lower;
+        }
+    };
+
+    SCENARIO( "Test compile time stencils" ) {
+        const core::NumericalData<double> data(std::vector<double>{1, 4, 6, 2, 4, 2, 5, 9, 3, 7, 8});
+
+        // reference implementations using the std::function path
+        auto midpointOp = [](int i, int order, const core::NumericalData<double>& values, core::NumericalData<double>& newValues){
+            newValues[i] = (values[i-order] + values[i+order])/2.0;
+        };
+        auto midpointMinOp = [](int i, int order, const core::NumericalData<double>& values, core::NumericalData<double>& newValues){
+            newValues[i] = std::min((values[i-order] + values[i+order])/2.0, values[i]);
+        };
+        auto gradOp = [](int i, int, const core::NumericalData<double>& values, core::NumericalData<double>& newValues){
+            newValues[i] = (values[i+1] - values[i-1])/2.0;
+        };
+
+        THEN( "check stencils give the same result as std::function" ) {
+            for(int order=0; order<8; ++order){
+                REQUIRE_NUMERICS_THE_SAME<double>(data.symmetricNeighbourOp(midpointOp, order), 
+                                                  data.symmetricNeighbourOp<core::MidpointStencil>(order));
+                REQUIRE_NUMERICS_THE_SAME<double>(data.symmetricNeighbourOp(midpointMinOp, order), 
+                                                  data.symmetricNeighbourOp<core::MidpointMinStencil>(order));
+            }
+            REQUIRE_NUMERICS_THE_SAME<double>(data.symmetricNeighbourOp(gradOp, 1), 
+                                              data.symmetricNeighbourOp<core::GradientStencil>(1));
+        }
+        THEN( "check user defined stencil" ) {
+            const core::NumericalData<double> diff = data.symmetricNeighbourOp<DifferenceStencil>(2);
+            REQUIRE_NUMERICS_THE_SAME<double>(core::NumericalData<double>(std::vector<double>{1, 4, 3, -2, -1, 7, -1, 5, 3, 7, 8}), diff);
+        }
+        THEN( "check stencil on integer data" ) {
+            const core::NumericalData<int> values(std::vector<int>{1, 4, 6, 2, 4, 2, 5});
+            REQUIRE_NUMERICS_THE_SAME<int>(core::NumericalData<int>(std::vector<int>{1, 3, 3, 5, 2, 4, 5}), values.midpoint(1));
+        }
+        THEN( "check stencil on a strided view" ) {
+            const core::ConstNumericalView<double> view(data.data(), 6, 2);
+            const core::NumericalData<double> strided = view;
+            REQUIRE_NUMERICS_THE_SAME<double>(strided.midpoint(1), view.midpoint(1));
+            REQUIRE_NUMERICS_THE_SAME<double>(strided.snip(2), view.snip(2));
+        }
+    }
+
+    SCENARIO( "Test gradient engine" ) {
+        const core::NumericalData<double> data(std::vector<double>{1., 2.0, 4.0, 7.0, 11.0, 16.0});
+
+        THEN( "check known gradients" ) {
+            REQUIRE_NUMERICS_APPROX_THE_SAME(core::NumericalData<double>(std::vector<double>{1., 2.0, 4.0, 7.0, 11.0, 16.0}), 
+                                             core::GradientEngine<double>(0).apply(data));
+            REQUIRE_NUMERICS_APPROX_THE_SAME(core::NumericalData<double>(std::vector<double>{1., 1.5, 2.5, 3.5, 4.5, 5.}), 
+                                             core::GradientEngine<double>(1).apply(data));
+            REQUIRE_NUMERICS_APPROX_THE_SAME(core::NumericalData<double>(std::vector<double>{0.5, 0.75, 1.0, 1.0, 0.75, 0.5}), 
+                                             core::GradientEngine<double>(2).apply(data));
+            REQUIRE_NUMERICS_APPROX_THE_SAME(core::NumericalData<double>(std::vector<double>{0.25, 0.25, 0.125, -0.125, -0.25, -0.25}), 
+                                             core::GradientEngine<double>(3).apply(data));
+        }
+        THEN( "check same as recursive gradient for all sizes" ) {
+            for(int order=0; order<7; ++order){
+                const core::GradientEngine<double> engine(order);
+                REQUIRE( engine.order() == order );
+                for(int size=2; size<40; ++size){
+                    core::NumericalData<double> values(size);
+                    for(int i=0; i<size; ++i){
+                        values[i] = std::sin(0.3*i) + 0.01*i*i;
+                    }
+                    const core::NumericalData<double> expected = values.gradient(order);
+                    const core::NumericalData<double> result = engine.apply(values);
+                    REQUIRE( result.size() == size );
+                    for(int i=0; i<size; ++i){
+                        REQUIRE( result[i] == Approx(expected[i]).margin(1e-12) );
+                    }
+                }
+            }
+        }
+        THEN( "check output buffer and strided view" ) {
+            const core::GradientEngine<double> engine(2);
+            core::NumericalData<double> output(3);
+            engine.apply(data, output);
+            REQUIRE_NUMERICS_APPROX_THE_SAME(data.gradient(2), output);
+
+            // reuses the output buffer when the size is the same
+            const double* before = output.data();
+            engine.apply(data, output);
+            REQUIRE( output.data() == before );
+
+            const core::ConstNumericalView<double> small(data.data(), 3, 2);
+            output = core::NumericalData<double>(3);
+            before = output.data();
+            engine.apply(small, output);
+            REQUIRE( output.data() == before );
+            REQUIRE_NUMERICS_APPROX_THE_SAME(core::NumericalData<double>(small).gradient(2), output);
+
+            core::NumericalData<double> values(20);
+            for(int i=0; i<values.size(); ++i){
+                values[i] = i*i*i;
+            }
+            const core::ConstNumericalView<double> view(values.data(), 10, 2);
+            REQUIRE_NUMERICS_APPROX_THE_SAME(core::NumericalData<double>(view).gradient(2), engine.apply(view));
+        }
+    }
+
+    SCENARIO( "Test lazy expressions" ) {
+        core::NumericalData<double> data(std::vector<double>({1, 4, 5, 2, 10, -2, 2, 8, 3}));
+        const core::NumericalData<double> other(std::vector<double>({3, 1, 2, 7, 1, 4, 6, 2, 5}));
+
+        THEN( "check chains match the step by step results" ) {
+            const core::NumericalData<double> shifted = data + 3.0;
+            const core::NumericalData<double> rooted = shifted.sqrt();
+            const core::NumericalData<double> stepbystep = rooted.log();
+            const core::NumericalData<double> chained = (data + 3.0).sqrt().log();
+            REQUIRE_NUMERICS_THE_SAME(stepbystep, chained);
+
+            const core::NumericalData<double> mixed = 2.0*data - other/4.0 + (-data)*other;
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( mixed[i] == 2.0*data[i] - other[i]/4.0 - data[i]*other[i] );
+            }
+
+            const core::NumericalData<double> withabs = (data - other).abs().pow(2);
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( withabs[i] == Approx(std::pow(data[i] - other[i], 2)) );
+            }
+        }
+        THEN( "check LLS expressions" ) {
+            const core::NumericalData<double> positive = data.abs();
+            core::NumericalData<double> lls = positive.LLS();
+            REQUIRE_NUMERICS_THE_SAME(core::NumericalData<double>(positive).LLSInPlace(), lls);
+            REQUIRE_NUMERICS_APPROX_THE_SAME(positive, core::NumericalData<double>(positive.LLS().inverseLLS()));
+
+            // background subtraction in one loop
+            const core::NumericalData<double> signal = positive - positive.snip(2);
+            const core::NumericalData<double> background = positive.snip(2);
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( signal[i] == positive[i] - background[i] );
+            }
+        }
+        THEN( "check evaluation is only on assignment" ) {
+            const auto expression = data*2.0 + other;
+            REQUIRE( expression.size() == data.size() );
+            REQUIRE( expression[4] == 21.0 );
+            data[4] = 0.0;
+            REQUIRE( expression[4] == 1.0 );
+            REQUIRE( expression.sum() == Approx((data*2.0 + other).eval().sum()) );
+            REQUIRE( expression.to_vector() == std::vector<double>({5, 9, 12, 11, 1, 0, 10, 18, 11}) );
+
+            // the other numerical functions evaluate the expression first
+            REQUIRE_NUMERICS_THE_SAME(expression.midpoint(1), expression.eval().midpoint(1));
+        }
+        THEN( "check compound assignment and views" ) {
+            core::NumericalData<double> result = data;
+            result += other*2.0;
+            result -= data.slice(0, 9);
+            REQUIRE_NUMERICS_THE_SAME(result, core::NumericalData<double>(other*2.0));
+
+            // writing an expression through a view
+            core::NumericalView<double> view = result.view(2, 5);
+            view = data.slice(0, 3) + other.slice(0, 3);
+            REQUIRE( result.to_vector() == std::vector<double>({6, 2, 4, 5, 7, 8, 12, 4, 10}) );
+            REQUIRE( (-data.slice(0, 3)).to_vector() == std::vector<double>({-1, -4, -5}) );
+        }
+        THEN( "check integer and single precision data" ) {
+            const core::NumericalData<int> integers(std::vector<int>({1, 4, 5}));
+            const core::NumericalData<int> summed = integers*2 + integers - 1;
+            REQUIRE( summed.to_vector() == std::vector<int>({2, 11, 14}) );
+
+            const core::NumericalData<float> floats = data.cast<float>();
+            const core::NumericalData<float> lls = floats.abs().LLS();
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( lls[i] == Approx(data.abs().LLS().eval()[i]).epsilon(1e-5) );
+            }
+        }
+    }
+
 PEAKINGDUCK_NAMESPACE_END // unittests
 PEAKINGDUCK_NAMESPACE_END // peakingduck
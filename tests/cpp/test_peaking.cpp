@@ -0,0 +1,700 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "common.hpp"
+
+#include "peakingduck.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(unittests)
+
+    // the original (Python) window peak finder, a window copy per point
+    std::vector<int> windowPeaks(const core::NumericalData<double>& data, double threshold, 
+        int ninner, int nouter, bool includePoint, bool enforceMaximum)
+    {
+        std::vector<int> indices;
+        for(int i=3; i<=data.size()-4; ++i){
+            const core::NumericalData<double> values = core::window(data, i, nouter, ninner, includePoint);
+            const double localthreshold = values.mean() + values.stddev(1)*threshold;
+            if((localthreshold < data[i]) && (localthreshold <= data[i+1]) && (localthreshold <= data[i-1])){
+                if(enforceMaximum && ((data[i+1] > data[i]) || (data[i-1] > data[i]))){
+                    continue;
+                }
+                indices.push_back(i);
+            }
+        }
+        return indices;
+    }
+
+    // the original simple peak finder, the groups then the maximum of each
+    std::vector<int> groupPeaks(const core::NumericalData<double>& data, double percentThreshold)
+    {
+        const double threshold = data.maxCoeff()*percentThreshold;
+        std::vector<std::vector<int>> groups;
+        int last = -2;
+        for(int i=0; i<data.size(); ++i){
+            if(data[i] > threshold){
+                if(last + 1 < i){
+                    groups.emplace_back();
+                }
+                groups.back().push_back(i);
+                last = i;
+            }
+        }
+        std::vector<int> indices;
+        for(const auto& group: groups){
+            int maxindex = group.front();
+            for(int i: group){
+                if(data[i] > data[maxindex]){
+                    maxindex = i;
+                }
+            }
+            indices.push_back(maxindex);
+        }
+        return indices;
+    }
+
+    // a background with noise and Gaussian peaks of different widths
+    core::NumericalData<double> peakySpectrum(int size, double offset=0.0)
+    {
+        core::NumericalData<double> data(size);
+        for(int i=0; i<size; ++i){
+            data[i] = offset + 50.0 + 5.0*std::sin(0.37*i) + 3.0*((i*7919) % 13)/13.0
+                + 400.0*std::exp(-0.5*std::pow((i - 120)/2.0, 2))
+                + 150.0*std::exp(-0.5*std::pow((i - 300)/4.0, 2))
+                + 60.0*std::exp(-0.5*std::pow((i - 305)/1.5, 2))
+                + 90.0*std::exp(-0.5*std::pow((i - 450)/1.0, 2));
+        }
+        return data;
+    }
+
+    // the prominence of a peak by searching each side from it, as scipy
+    double scanProminence(const core::NumericalData<double>& data, int peak, int& leftbase, int& rightbase)
+    {
+        leftbase = peak;
+        for(int i=peak; i>=0 && data[i] <= data[peak]; --i){
+            if(data[i] < data[leftbase]){
+                leftbase = i;
+            }
+        }
+        rightbase = peak;
+        for(int i=peak; i<data.size() && data[i] <= data[peak]; ++i){
+            if(data[i] < data[rightbase]){
+                rightbase = i;
+            }
+        }
+        return data[peak] - std::max(data[leftbase], data[rightbase]);
+    }
+
+    SCENARIO( "Test window peak finder" ) {
+        const core::NumericalData<double> data = peakySpectrum(500);
+
+        THEN( "check same as the window per point" ) {
+            for(int nouter: {5, 20, 40}){
+                for(int ninner: {0, 3}){
+                    for(bool includePoint: {false, true}){
+                        for(bool enforceMaximum: {false, true}){
+                            const core::WindowPeakFinder<double> finder(2.0, ninner, nouter, includePoint, enforceMaximum);
+                            const std::vector<int> expected = windowPeaks(data, 2.0, ninner, nouter, includePoint, enforceMaximum);
+                            const core::PeakList<double> peaks = finder.find(data);
+                            REQUIRE( peaks.size() == expected.size() );
+                            for(size_t p=0; p<peaks.size(); ++p){
+                                REQUIRE( peaks[p].index == static_cast<size_t>(expected[p]) );
+                                REQUIRE( peaks[p].value == data[expected[p]] );
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        THEN( "check peaks are found" ) {
+            const core::PeakList<double> peaks = core::WindowPeakFinder<double>(2.0, 3, 40, false, true).find(data);
+            std::vector<size_t> indices;
+            for(const auto& peak: peaks){
+                indices.push_back(peak.index);
+            }
+            for(size_t expected: {120, 300, 450}){
+                REQUIRE( std::find(indices.begin(), indices.end(), expected) != indices.end() );
+            }
+        }
+        THEN( "check a large offset" ) {
+            // the prefix sums are shifted, so the variance keeps its precision
+            const core::NumericalData<double> offset = peakySpectrum(500, 1e7);
+            const core::PeakList<double> peaks = core::WindowPeakFinder<double>(2.0, 3, 40).find(offset);
+            const std::vector<int> expected = windowPeaks(offset, 2.0, 3, 40, false, false);
+            REQUIRE( peaks.size() == expected.size() );
+            for(size_t p=0; p<peaks.size(); ++p){
+                REQUIRE( peaks[p].index == static_cast<size_t>(expected[p]) );
+            }
+        }
+        THEN( "check the gradient turns at the peaks with useGrad" ) {
+            const core::NumericalData<double> gradient = data.gradient();
+            const std::vector<int> all = windowPeaks(data, 2.0, 3, 40, false, false);
+            std::vector<int> expected;
+            for(int i: all){
+                // the crossing of the gradient nearest to i
+                const bool after = gradient[i] > 0.0 && gradient[i+1] <= 0.0 && gradient[i]/(gradient[i] - gradient[i+1]) < 0.5;
+                const bool before = gradient[i-1] > 0.0 && gradient[i] <= 0.0 && gradient[i-1]/(gradient[i-1] - gradient[i]) >= 0.5;
+                if(after || before){
+                    expected.push_back(i);
+                }
+            }
+            const core::PeakList<double> peaks = core::WindowPeakFinder<double>(2.0, 3, 40, false, false, true).find(data);
+            REQUIRE( expected.size() < all.size() );
+            REQUIRE( peaks.size() == expected.size() );
+            for(size_t p=0; p<peaks.size(); ++p){
+                REQUIRE( peaks[p].index == static_cast<size_t>(expected[p]) );
+            }
+            std::vector<size_t> indices;
+            for(const auto& peak: peaks){
+                indices.push_back(peak.index);
+            }
+            for(size_t peak: {120, 300, 450}){
+                REQUIRE( std::find(indices.begin(), indices.end(), peak) != indices.end() );
+            }
+        }
+        THEN( "check throws" ) {
+            REQUIRE_THROWS_AS( core::WindowPeakFinder<double>(2.0, 5, 4), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::WindowPeakFinder<double>(2.0, 0, 250).find(data), PeakingDuckException );
+        }
+    }
+
+    SCENARIO( "Test simple peak finder" ) {
+        const core::NumericalData<double> data = peakySpectrum(500);
+
+        THEN( "check same as the groups" ) {
+            for(double threshold: {0.05, 0.1, 0.2, 0.5, 0.9, 1.0}){
+                const core::PeakList<double> peaks = core::SimplePeakFinder<double>(threshold).find(data);
+                const std::vector<int> expected = groupPeaks(data, threshold);
+                REQUIRE( peaks.size() == expected.size() );
+                for(size_t p=0; p<peaks.size(); ++p){
+                    REQUIRE( peaks[p].index == static_cast<size_t>(expected[p]) );
+                    REQUIRE( peaks[p].value == data[expected[p]] );
+                }
+            }
+        }
+        THEN( "check groups across blocks, equal maxima and the ends" ) {
+            core::NumericalData<double> steps = core::NumericalData<double>::Zero(300);
+            const int block = core::SimplePeakFinder<double>::BlockSize;
+            for(int i=block-3; i<block+5; ++i){
+                steps[i] = 5.0;
+            }
+            steps[2*block] = 7.0;
+            steps[2*block+1] = 7.0;
+            steps[0] = 10.0;
+            steps[299] = 6.0;
+            const core::PeakList<double> peaks = core::SimplePeakFinder<double>(0.4).find(steps);
+            REQUIRE( peaks.size() == 4 );
+            REQUIRE( peaks[0].index == 0 );
+            REQUIRE( peaks[1].index == static_cast<size_t>(block-3) );
+            REQUIRE( peaks[2].index == static_cast<size_t>(2*block) );
+            REQUIRE( peaks[3].index == 299 );
+            REQUIRE( core::SimplePeakFinder<double>(0.5).find(core::NumericalData<double>()).empty() );
+        }
+        THEN( "check the output is reused and views" ) {
+            const core::SimplePeakFinder<double> finder(0.1);
+            core::PeakList<double> peaks;
+            finder.find(data, peaks);
+            const size_t npeaks = peaks.size();
+            const auto* storage = peaks.data();
+            finder.find(data, peaks);
+            REQUIRE( peaks.size() == npeaks );
+            REQUIRE( peaks.data() == storage );
+
+            core::NumericalData<double> strided(2*data.size());
+            for(int i=0; i<data.size(); ++i){
+                strided[2*i] = data[i];
+                strided[2*i+1] = 1e6;
+            }
+            core::PeakList<double> fromview;
+            finder.find(core::ConstNumericalView<double>(strided.data(), data.size(), 2), fromview);
+            REQUIRE( fromview.size() == npeaks );
+            for(size_t p=0; p<npeaks; ++p){
+                REQUIRE( fromview[p].index == peaks[p].index );
+            }
+        }
+    }
+
+    SCENARIO( "Test chunked peak filter and finder" ) {
+        // larger than a task, so the chunks are split between threads
+        core::NumericalData<double> data(100001);
+        for(int i=0; i<data.size(); ++i){
+            data[i] = 20.0 + 5.0*std::sin(0.37*i) + (i % 101 == 0 ? 200.0 : 0.0) + (i % 997 == 0 ? 2000.0 : 0.0);
+        }
+        util::ThreadPool serial(0);
+        util::ThreadPool parallel(3);
+
+        THEN( "check the filter thresholds each chunk" ) {
+            for(size_t chunksize: {10, 1000, 100000, 200000}){
+                const core::ChunkedThresholdPeakFilter<double> filter(0.4, chunksize, parallel);
+                const core::NumericalData<double> filtered = filter.go(data);
+                REQUIRE( filtered.size() == data.size() );
+
+                // the last chunk (a single point for 100000) is included
+                for(int start=0; start<data.size(); start+=chunksize){
+                    const int end = std::min<int>(data.size(), start + chunksize);
+                    const double threshold = data(start, end).maxCoeff()*0.4;
+                    for(int i=start; i<end; ++i){
+                        REQUIRE( filtered[i] == (data[i] >= threshold ? data[i] : 0.0) );
+                    }
+                }
+
+                const core::NumericalData<double> serialfiltered = core::ChunkedThresholdPeakFilter<double>(0.4, chunksize, serial).go(data);
+                REQUIRE( serialfiltered.to_vector() == filtered.to_vector() );
+            }
+        }
+        THEN( "check the filter on views and batches" ) {
+            const core::ChunkedThresholdPeakFilter<double> filter(0.4, 10, parallel);
+            const core::NumericalData<double> small = data(0, 2000);
+            const core::NumericalData<double> expected = filter.go(small);
+            const core::NumericalData<double> fromview = filter.go(data.slice(0, 2000));
+            REQUIRE( fromview.to_vector() == expected.to_vector() );
+
+            const core::NumericalBatch<double> batch(std::vector<core::NumericalData<double>>{small, small*2.0, data(2000, 4000)});
+            const core::NumericalBatch<double> filtered = filter.go(batch);
+            for(int s=0; s<batch.nspectra(); ++s){
+                REQUIRE( filtered.spectrum(s).to_vector() == filter.go(batch.spectrum(s)).to_vector() );
+            }
+            REQUIRE_THROWS_AS( core::ChunkedThresholdPeakFilter<double>(0.4, 0), PeakingDuckException );
+        }
+        THEN( "check the finder is the same with any number of threads" ) {
+            for(int nchunks: {1, 10, 37}){
+                const core::PeakList<double> expected = core::ChunkedSimplePeakFinder<double>(0.5, nchunks, serial).find(data);
+                const core::PeakList<double> peaks = core::ChunkedSimplePeakFinder<double>(0.5, nchunks, parallel).find(data);
+                REQUIRE( peaks.size() == expected.size() );
+                for(size_t p=0; p<peaks.size(); ++p){
+                    REQUIRE( peaks[p].index == expected[p].index );
+                    REQUIRE( peaks[p].value == expected[p].value );
+                }
+            }
+
+            // one chunk is the simple peak finder
+            const core::PeakList<double> simple = core::SimplePeakFinder<double>(0.05).find(data);
+            const core::PeakList<double> one = core::ChunkedSimplePeakFinder<double>(0.05, 1, parallel).find(data);
+            REQUIRE( simple.size() == one.size() );
+            for(size_t p=0; p<one.size(); ++p){
+                REQUIRE( one[p].index == simple[p].index );
+            }
+        }
+        THEN( "check chunks as numpy.array_split and the boundaries" ) {
+            // chunks of 4, 3 and 3, a group across the first boundary is one peak
+            const core::NumericalData<double> values(std::vector<double>{0.0, 1.0, 5.0, 6.0, 7.0, 1.0, 0.0, 4.0, 0.0, 0.0});
+            const core::PeakList<double> peaks = core::ChunkedSimplePeakFinder<double>(0.5, 3, parallel).find(values);
+            REQUIRE( peaks.size() == 2 );
+            REQUIRE( peaks[0].index == 4 );
+            REQUIRE( peaks[1].index == 7 );
+
+            // more chunks than points, every positive point is above its own 
+            // threshold so the groups join across the boundaries
+            const core::PeakList<double> single = core::ChunkedSimplePeakFinder<double>(0.5, 20, parallel).find(values);
+            REQUIRE( single.size() == 2 );
+            REQUIRE( single[0].index == 4 );
+
+            core::PeakList<double> reused;
+            core::ChunkedSimplePeakFinder<double>(0.5, 3, parallel).find(values.slice(0, 7), reused);
+            REQUIRE( reused.size() == 1 );
+            REQUIRE( reused[0].index == 4 );
+            REQUIRE_THROWS_AS( core::ChunkedSimplePeakFinder<double>(0.5, 0), PeakingDuckException );
+        }
+    }
+
+    SCENARIO( "Test local maxima peak finder" ) {
+        // a flat top at 5-7 and at 9-10 (not at the end)
+        const core::NumericalData<double> data(std::vector<double>{0.0, 2.0, 1.0, 3.0, 1.0, 4.0, 4.0, 4.0, 0.0, 2.0, 2.0, 0.0});
+        using Condition = core::PeakCondition<double>;
+        const auto indices = [](const core::PeakList<double>& peaks){
+            std::vector<int> result;
+            for(const auto& peak: peaks){
+                result.push_back(peak.index);
+            }
+            return result;
+        };
+
+        THEN( "check the local maxima and flat tops" ) {
+            const core::PeakProperties<double> properties = core::LocalMaximaPeakFinder<double>().findWithProperties(data);
+            REQUIRE( properties.indices == std::vector<int>({1, 3, 6, 9}) );
+            REQUIRE( properties.heights == std::vector<double>({2.0, 3.0, 4.0, 2.0}) );
+            REQUIRE( properties.leftEdges == std::vector<int>({1, 3, 5, 9}) );
+            REQUIRE( properties.rightEdges == std::vector<int>({1, 3, 7, 10}) );
+            REQUIRE( properties.prominences.empty() );
+            REQUIRE( properties.widths.empty() );
+
+            const core::PeakList<double> peaks = core::LocalMaximaPeakFinder<double>().find(data);
+            REQUIRE( indices(peaks) == properties.indices );
+            REQUIRE( peaks[2].value == 4.0 );
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>().find(data.slice(2, 12))) == std::vector<int>({1, 4, 7}) );
+            REQUIRE( core::LocalMaximaPeakFinder<double>().find(data.slice(0, 2)).empty() );
+        }
+        THEN( "check the height, threshold and plateau size conditions" ) {
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>(2.5).find(data)) == std::vector<int>({3, 6}) );
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>(Condition(2.0, 3.0)).find(data)) == std::vector<int>({1, 3, 9}) );
+
+            // a limit per point
+            core::NumericalData<double> lower(std::vector<double>(data.size(), 1.0));
+            lower[3] = 3.5;
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>(Condition(lower)).find(data)) == std::vector<int>({1, 6, 9}) );
+
+            // the drop to the nearest neighbour is at least 1 and to the other at most 2
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>({}, Condition(1.0, 2.0)).find(data)) == std::vector<int>({1, 3}) );
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>({}, {}, 1.0, {}, {}, 0.0, 0.5, 2.0).find(data)) == std::vector<int>({6, 9}) );
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>({}, {}, 1.0, {}, {}, 0.0, 0.5, Condition(2.0, 2.0)).find(data)) == std::vector<int>({9}) );
+        }
+        THEN( "check the distance removes the lower peaks first" ) {
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>({}, {}, 3.0).find(data)) == std::vector<int>({3, 6, 9}) );
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>({}, {}, 2.5).find(data)) == std::vector<int>({3, 6, 9}) );
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>({}, {}, 4.0).find(data)) == std::vector<int>({1, 6}) );
+
+            // equal heights, the later is kept
+            const core::NumericalData<double> twins(std::vector<double>{0.0, 1.0, 0.0, 1.0, 0.0});
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>({}, {}, 3.0).find(twins)) == std::vector<int>({3}) );
+        }
+        THEN( "check the prominences and widths" ) {
+            const core::LocalMaximaPeakFinder<double> finder({}, {}, 1.0, {}, Condition(0.0));
+            const core::PeakProperties<double> properties = finder.findWithProperties(data);
+            REQUIRE( properties.indices == std::vector<int>({1, 3, 6, 9}) );
+            REQUIRE( properties.prominences == std::vector<double>({1.0, 2.0, 4.0, 2.0}) );
+            REQUIRE( properties.leftBases == std::vector<int>({0, 0, 0, 8}) );
+            REQUIRE( properties.rightBases == std::vector<int>({2, 4, 8, 11}) );
+            REQUIRE( properties.widthHeights == std::vector<double>({1.5, 2.0, 2.0, 1.0}) );
+            const std::vector<double> leftips{0.75, 2.5, 13.0/3.0, 8.5};
+            const std::vector<double> rightips{1.5, 3.5, 7.5, 10.5};
+            for(int p=0; p<properties.size(); ++p){
+                REQUIRE( properties.leftIps[p] == Approx(leftips[p]).epsilon(1e-12) );
+                REQUIRE( properties.rightIps[p] == Approx(rightips[p]).epsilon(1e-12) );
+                REQUIRE( properties.widths[p] == Approx(rightips[p] - leftips[p]).epsilon(1e-12) );
+            }
+
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>({}, {}, 1.0, 2.0).find(data)) == std::vector<int>({3, 6, 9}) );
+            REQUIRE( indices(core::LocalMaximaPeakFinder<double>({}, {}, 1.0, {}, Condition(1.0, 2.0)).find(data)) == std::vector<int>({3, 9}) );
+
+            // the full width is between the bases
+            const core::PeakProperties<double> full = core::LocalMaximaPeakFinder<double>({}, {}, 1.0, {}, Condition(0.0), 0.0, 1.0).findWithProperties(data);
+            REQUIRE( full.widths[2] == Approx(8.0).epsilon(1e-12) );
+        }
+        THEN( "check the prominence window" ) {
+            // the bases within one point either side
+            const core::PeakProperties<double> properties = core::LocalMaximaPeakFinder<double>({}, {}, 1.0, 0.0, {}, 3.0).findWithProperties(data);
+            REQUIRE( properties.prominences == std::vector<double>({1.0, 2.0, 0.0, 0.0}) );
+            REQUIRE( properties.leftBases == std::vector<int>({0, 2, 6, 8}) );
+            REQUIRE( properties.rightBases == std::vector<int>({2, 4, 6, 9}) );
+
+            // wider than the data is no window
+            const core::PeakProperties<double> wide = core::LocalMaximaPeakFinder<double>({}, {}, 1.0, 0.0, {}, 100.0).findWithProperties(data);
+            REQUIRE( wide.prominences == std::vector<double>({1.0, 2.0, 4.0, 2.0}) );
+        }
+        THEN( "check the prominences are as searching from each peak" ) {
+            // counts with many equal values, so flat tops and equal bases
+            core::NumericalData<double> counts(5000);
+            for(int i=0; i<counts.size(); ++i){
+                counts[i] = static_cast<double>((i*7919 + (i*i) % 31) % 9) + (i % 500 == 0 ? 20.0 : 0.0);
+            }
+            const core::PeakProperties<double> properties = core::LocalMaximaPeakFinder<double>({}, {}, 1.0, 0.0).findWithProperties(counts);
+            REQUIRE( properties.size() > 100 );
+            for(int p=0; p<properties.size(); ++p){
+                int leftbase = 0;
+                int rightbase = 0;
+                const double prominence = scanProminence(counts, properties.indices[p], leftbase, rightbase);
+                REQUIRE( properties.prominences[p] == prominence );
+                REQUIRE( properties.leftBases[p] == leftbase );
+                REQUIRE( properties.rightBases[p] == rightbase );
+            }
+
+            const core::NumericalData<double> spectrum = peakySpectrum(600);
+            const core::PeakList<double> peaks = core::LocalMaximaPeakFinder<double>({}, {}, 1.0, 50.0).find(spectrum);
+            REQUIRE( indices(peaks) == std::vector<int>({120, 300, 450}) );
+        }
+        THEN( "check invalid conditions" ) {
+            REQUIRE_THROWS_AS( core::LocalMaximaPeakFinder<double>({}, {}, 0.5), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::LocalMaximaPeakFinder<double>({}, {}, 1.0, {}, {}, 1.0), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::LocalMaximaPeakFinder<double>({}, {}, 1.0, {}, {}, 0.0, -0.5), PeakingDuckException );
+            const core::NumericalData<double> lower(std::vector<double>(3, 1.0));
+            REQUIRE_THROWS_AS( core::LocalMaximaPeakFinder<double>(Condition(lower)).find(data), PeakingDuckException );
+        }
+    }
+
+    SCENARIO( "Test peak table" ) {
+        const core::NumericalData<double> data = peakySpectrum(500);
+        core::PeakTable<double> table;
+        table.append(40, 3.0, 100.0, 30.0, 2.0, 0.5);
+        table.append(10, 5.0, 20.0, 10.0, 1.0, 0.9);
+        table.append(core::PeakInfo<double>(25, 4.0));
+        table.append(70, 5.0, 180.0, 50.0, 3.0, 0.1);
+
+        THEN( "check the columns" ) {
+            REQUIRE( table.size() == 4 );
+            REQUIRE( table.indices() == std::vector<size_t>({40, 10, 25, 70}) );
+            REQUIRE( table.values().to_vector() == std::vector<double>({3.0, 5.0, 4.0, 5.0}) );
+            REQUIRE( table.energies().to_vector() == std::vector<double>({100.0, 20.0, 0.0, 180.0}) );
+            REQUIRE( table.scores().to_vector() == std::vector<double>({0.5, 0.9, 0.0, 0.1}) );
+            REQUIRE( table.column(core::PeakColumn::Area)[3] == 50.0 );
+            REQUIRE( table.peak(1).index == 10 );
+            REQUIRE( table.peak(1).value == 5.0 );
+            REQUIRE_THROWS_AS( table.column(core::PeakColumn::Index), PeakingDuckException );
+
+            // the columns are writable
+            table.widths()[2] = 1.5;
+            REQUIRE( table.widths().to_vector() == std::vector<double>({2.0, 1.0, 1.5, 3.0}) );
+
+            const core::PeakList<double> peaks = table.toPeakList();
+            REQUIRE( core::PeakTable<double>(peaks).indices() == table.indices() );
+        }
+        THEN( "check sorting is stable and in place" ) {
+            const double* values = table.values().data();
+            table.sortBy(core::PeakColumn::Value, true);
+            REQUIRE( table.indices() == std::vector<size_t>({10, 70, 25, 40}) );
+            REQUIRE( table.energies().to_vector() == std::vector<double>({20.0, 180.0, 0.0, 100.0}) );
+            REQUIRE( table.values().data() == values );
+
+            table.sortBy(core::PeakColumn::Index);
+            REQUIRE( table.indices() == std::vector<size_t>({10, 25, 40, 70}) );
+            REQUIRE( table.areas().to_vector() == std::vector<double>({10.0, 0.0, 30.0, 50.0}) );
+        }
+        THEN( "check filtering" ) {
+            table.filter(core::PeakColumn::Energy, 20.0, 150.0);
+            REQUIRE( table.indices() == std::vector<size_t>({40, 10}) );
+            REQUIRE( table.scores().to_vector() == std::vector<double>({0.5, 0.9}) );
+            table.filter(core::PeakColumn::Index, 0.0, 20.0);
+            REQUIRE( table.indices() == std::vector<size_t>({10}) );
+            table.filter([](int){ return false; });
+            REQUIRE( table.empty() );
+        }
+        THEN( "check the finders fill the table as their lists" ) {
+            const std::vector<std::shared_ptr<core::IPeakFinder<double>>> finders{
+                std::make_shared<core::SimplePeakFinder<double>>(0.1),
+                std::make_shared<core::ChunkedSimplePeakFinder<double>>(0.1, 4),
+                std::make_shared<core::WindowPeakFinder<double>>(2.0, 0, 20),
+                std::make_shared<core::LocalMaximaPeakFinder<double>>()
+            };
+            for(const auto& finder: finders){
+                const core::PeakList<double> peaks = finder->find(data);
+                finder->find(data, table);
+                REQUIRE( table.size() == static_cast<int>(peaks.size()) );
+                for(int p=0; p<table.size(); ++p){
+                    REQUIRE( table.indices()[p] == peaks[p].index );
+                    REQUIRE( table.values()[p] == peaks[p].value );
+                    REQUIRE( table.energies()[p] == 0.0 );
+                }
+            }
+
+            // reused without allocating
+            const core::SimplePeakFinder<double> finder(0.05);
+            finder.find(data, table);
+            const int capacity = table.capacity();
+            const double* values = table.values().data();
+            finder.find(data, table);
+            REQUIRE( table.capacity() == capacity );
+            REQUIRE( table.values().data() == values );
+        }
+        THEN( "check a pinned table does not move its columns" ) {
+            table.pin();
+            table.pin();
+            const double* values = table.values().data();
+            REQUIRE_THROWS_AS( table.reserve(table.capacity() + 1), PeakingDuckException );
+            table.reserve(table.capacity());
+            table.clear();
+            for(int p=0; p<table.capacity(); ++p){
+                table.append(p, 1.0);
+            }
+            REQUIRE_THROWS_AS( table.append(0, 1.0), PeakingDuckException );
+            REQUIRE( table.values().data() == values );
+
+            // copies are not pinned
+            core::PeakTable<double> copy = table;
+            REQUIRE( !copy.pinned() );
+            copy.append(0, 1.0);
+
+            // assigning keeps the columns, or throws
+            core::PeakTable<double> small;
+            small.append(3, 2.0);
+            table = small;
+            REQUIRE( table.indices() == std::vector<size_t>({3}) );
+            REQUIRE( table.values().data() == values );
+            table = core::PeakTable<double>(small);
+            REQUIRE( table.values()[0] == 2.0 );
+            REQUIRE( table.values().data() == values );
+            REQUIRE_THROWS_AS( table = copy, PeakingDuckException );
+            REQUIRE_THROWS_AS( table = core::PeakTable<double>(copy), PeakingDuckException );
+            REQUIRE( table.values().data() == values );
+            table.clear();
+            for(int p=0; p<table.capacity(); ++p){
+                table.append(p, 1.0);
+            }
+
+            table.unpin();
+            REQUIRE( table.pinned() );
+            table.unpin();
+            REQUIRE( !table.pinned() );
+            table.append(0, 1.0);
+            REQUIRE( table.size() == copy.size() );
+        }
+        THEN( "check the widths and prominences of the local maxima" ) {
+            const core::LocalMaximaPeakFinder<double> finder({}, {}, 1.0, 50.0, core::PeakCondition<double>(0.0));
+            const core::PeakProperties<double> properties = finder.findWithProperties(data);
+            finder.find(data, table);
+            REQUIRE( table.size() == 3 );
+            REQUIRE( table.widths().to_vector() == properties.widths );
+            REQUIRE( table.scores().to_vector() == properties.prominences );
+
+            // the most prominent first
+            table.sortBy(core::PeakColumn::Score, true);
+            REQUIRE( table.indices()[0] == 120 );
+        }
+    }
+
+    // the crossings of the Savitzky-Golay derivatives, from a smoother per derivative
+    core::PeakPositions<double> scanCrossings(const core::NumericalData<double>& data, int windowsize, int order, double minCurvature)
+    {
+        const core::NumericalData<double> first = core::SavitzkyGolaySmoother<double>(windowsize, order, 1).go(data);
+        const core::NumericalData<double> second = core::SavitzkyGolaySmoother<double>(windowsize, order, 2).go(data);
+        core::PeakPositions<double> peaks;
+        for(int i=windowsize/2; i<data.size()-windowsize/2-1; ++i){
+            if(first[i] > 0.0 && first[i+1] <= 0.0){
+                const double fraction = first[i]/(first[i] - first[i+1]);
+                const double curvature = -(second[i] + fraction*(second[i+1] - second[i]));
+                if(curvature > minCurvature){
+                    const int index = fraction < 0.5 ? i : i + 1;
+                    peaks.indices.push_back(index);
+                    peaks.positions.push_back(i + fraction);
+                    peaks.heights.push_back(data[index]);
+                    peaks.curvatures.push_back(curvature);
+                }
+            }
+        }
+        return peaks;
+    }
+
+    SCENARIO( "Test gradient peak finder" ) {
+        const double pi = std::acos(-1.0);
+
+        THEN( "check the same as the derivatives from the smoothers" ) {
+            for(int size: {3, 4, 500, 1500}){
+                const core::NumericalData<double> data(std::vector<double>(peakySpectrum(std::max(size, 500)).slice(0, size).to_vector()));
+                for(int windowsize: {3, 5, 11}){
+                    for(int order: {2, 4}){
+                        if(order >= windowsize){
+                            continue;
+                        }
+                        for(double minCurvature: {0.0, 2.0}){
+                            const core::GradientPeakFinder<double> finder(windowsize, order, core::PeakCondition<double>(), minCurvature);
+                            const core::PeakPositions<double> expected = scanCrossings(data, windowsize, order, minCurvature);
+                            const core::PeakPositions<double> peaks = finder.findWithPositions(data);
+                            const core::PeakList<double> list = finder.find(data);
+                            REQUIRE( peaks.indices == expected.indices );
+                            REQUIRE( list.size() == expected.indices.size() );
+                            for(int p=0; p<peaks.size(); ++p){
+                                REQUIRE( list[p].index == static_cast<size_t>(expected.indices[p]) );
+                                REQUIRE( list[p].value == data[expected.indices[p]] );
+                                REQUIRE( peaks.heights[p] == expected.heights[p] );
+                                REQUIRE( peaks.positions[p] == Approx(expected.positions[p]).epsilon(1e-9) );
+                                REQUIRE( peaks.curvatures[p] == Approx(expected.curvatures[p]).epsilon(1e-9) );
+                            }
+                        }
+                    }
+                }
+            }
+            // window 3 is the gradient
+            const core::NumericalData<double> data = peakySpectrum(500);
+            const core::NumericalData<double> gradient = data.gradient();
+            const core::NumericalData<double> first = core::SavitzkyGolaySmoother<double>(3, 2, 1).go(data);
+            for(int i=1; i<data.size()-1; ++i){
+                REQUIRE( first[i] == Approx(gradient[i]).epsilon(1e-12) );
+            }
+        }
+        THEN( "check the positions are between the points" ) {
+            const std::vector<double> centroids{100.3, 200.75, 300.4, 401.0};
+            core::NumericalData<double> data(500);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = 20.0;
+                for(double centroid: centroids){
+                    data[i] += 500.0*std::exp(-0.5*std::pow((i - centroid)/3.0, 2));
+                }
+            }
+            const core::PeakPositions<double> peaks = core::GradientPeakFinder<double>(7, 2, 100.0).findWithPositions(data);
+            REQUIRE( peaks.size() == 4 );
+            for(int p=0; p<peaks.size(); ++p){
+                REQUIRE( peaks.positions[p] == Approx(centroids[p]).margin(0.02) );
+                REQUIRE( peaks.indices[p] == static_cast<int>(std::round(peaks.positions[p])) );
+                REQUIRE( peaks.curvatures[p] > 0.0 );
+            }
+            REQUIRE( peaks.indices == std::vector<int>({100, 201, 300, 401}) );
+        }
+        THEN( "check the height and curvature conditions" ) {
+            const core::NumericalData<double> data = peakySpectrum(500);
+            const core::PeakList<double> all = core::GradientPeakFinder<double>(5).find(data);
+            const core::PeakList<double> high = core::GradientPeakFinder<double>(5, 2, 150.0).find(data);
+            const core::PeakList<double> curved = core::GradientPeakFinder<double>(5, 2, core::PeakCondition<double>(), 20.0).find(data);
+            REQUIRE( high.size() < all.size() );
+            REQUIRE( curved.size() < all.size() );
+            for(const auto& peak: high){
+                REQUIRE( peak.value >= 150.0 );
+            }
+            for(size_t expected: {120, 450}){
+                REQUIRE( std::any_of(curved.begin(), curved.end(), [&](const core::PeakInfo<double>& peak){ return peak.index == expected; }) );
+            }
+            // a limit per point
+            core::NumericalData<double> limits(std::vector<double>(500, 1e9));
+            limits[120] = 0.0;
+            const core::PeakList<double> one = core::GradientPeakFinder<double>(5, 2, limits).find(data);
+            REQUIRE( one.size() == 1 );
+            REQUIRE( one[0].index == 120 );
+            REQUIRE_THROWS_AS( core::GradientPeakFinder<double>(5, 2, limits).find(data.slice(0, 100)), PeakingDuckException );
+        }
+        THEN( "check views, tables and single precision" ) {
+            core::NumericalData<double> interleaved(2000);
+            core::NumericalData<double> sine(1000);
+            for(int i=0; i<sine.size(); ++i){
+                sine[i] = std::sin(2.0*pi*i/100.0);
+                interleaved[2*i] = sine[i];
+                interleaved[2*i + 1] = -1.0;
+            }
+            const core::GradientPeakFinder<double> finder(9, 2);
+            const core::PeakPositions<double> peaks = finder.findWithPositions(sine);
+            const core::PeakPositions<double> fromview = finder.findWithPositions(core::ConstNumericalView<double>(interleaved.data(), 1000, 2));
+            REQUIRE( peaks.size() == 10 );
+            REQUIRE( fromview.indices == peaks.indices );
+            REQUIRE( fromview.positions == peaks.positions );
+            for(int p=0; p<peaks.size(); ++p){
+                REQUIRE( peaks.positions[p] == Approx(25.0 + 100.0*p).margin(1e-3) );
+                REQUIRE( peaks.curvatures[p] == Approx(std::pow(2.0*pi/100.0, 2)).epsilon(1e-2) );
+            }
+
+            core::PeakTable<double> table;
+            finder.find(sine, table);
+            REQUIRE( table.size() == 10 );
+            for(int p=0; p<table.size(); ++p){
+                REQUIRE( table.indices()[p] == static_cast<size_t>(peaks.indices[p]) );
+                REQUIRE( table.scores()[p] == peaks.curvatures[p] );
+            }
+
+            core::NumericalData<float> single(1000);
+            for(int i=0; i<single.size(); ++i){
+                single[i] = static_cast<float>(sine[i]);
+            }
+            const core::PeakPositions<float> singlepeaks = core::GradientPeakFinder<float>(9, 2).findWithPositions(single);
+            REQUIRE( singlepeaks.indices == peaks.indices );
+            REQUIRE( singlepeaks.positions[3] == Approx(325.0).margin(1e-2) );
+
+            // no crossings
+            REQUIRE( finder.find(core::NumericalData<double>::Zero(100)).empty() );
+            REQUIRE( finder.find(core::NumericalData<double>()).empty() );
+        }
+        THEN( "check throws" ) {
+            REQUIRE_THROWS_AS( core::GradientPeakFinder<double>(4), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::GradientPeakFinder<double>(1, 0), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::GradientPeakFinder<double>(5, 1), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::GradientPeakFinder<double>(5, 5), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::GradientPeakFinder<double>(5, 2, core::PeakCondition<double>(), -1.0), PeakingDuckException );
+        }
+    }
+
+PEAKINGDUCK_NAMESPACE_END // unittests
+PEAKINGDUCK_NAMESPACE_END // peakingduck
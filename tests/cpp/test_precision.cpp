@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "common.hpp"
+
+#include "peakingduck.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(unittests)
+
+    // single precision results should match the double ones to within float rounding
+    void REQUIRE_FLOAT_APPROX_DOUBLE(const core::NumericalData<double>& expected, const core::NumericalData<float>& candidate){
+        REQUIRE( expected.size() == candidate.size() );
+        const double scale = std::max(expected.maxCoeff(), 1.0);
+        for(int i=0;i<expected.size();++i){
+            REQUIRE( static_cast<double>(candidate[i]) == Approx(expected[i]).margin(1e-5*scale) );
+        }
+    }
+
+    SCENARIO( "Test single precision path" ) {
+        core::NumericalData<double> data(200);
+        for(int i=0;i<data.size();++i){
+            data[i] = 200.0*std::exp(-i/80.0) + 10.0 
+                    + 5e3*std::exp(-std::pow(i-60, 2)/8.0)
+                    + 2e3*std::exp(-std::pow(i-140, 2)/18.0)
+                    + (i % 7);
+        }
+        const core::NumericalData<float> dataf = data.cast<float>();
+
+        THEN( "cast" ) {
+            REQUIRE( dataf.size() == data.size() );
+            REQUIRE_FLOAT_APPROX_DOUBLE(data, dataf);
+            const core::NumericalData<double> roundtrip = dataf.cast<double>();
+            REQUIRE_FLOAT_APPROX_DOUBLE(roundtrip, dataf);
+        }
+        THEN( "snip" ) {
+            REQUIRE_FLOAT_APPROX_DOUBLE(data.snip(20), dataf.snip(20));
+            core::SNIPEngine<float> engine;
+            const std::vector<int> orders = {1, 2, 4, 8, 16};
+            REQUIRE_FLOAT_APPROX_DOUBLE(data.snip(orders.begin(), orders.end()), engine.estimate(dataf, orders.begin(), orders.end()));
+        }
+        THEN( "smoothing" ) {
+            REQUIRE_FLOAT_APPROX_DOUBLE(core::MovingAverageSmoother<double>(3).go(data),
+                                        core::MovingAverageSmoother<float>(3).go(dataf));
+            REQUIRE_FLOAT_APPROX_DOUBLE(core::WeightedMovingAverageSmoother<double>(3).go(data),
+                                        core::WeightedMovingAverageSmoother<float>(3).go(dataf));
+        }
+        THEN( "process manager" ) {
+            auto pm = core::SimpleProcessManager<float>();
+            pm.append(std::make_shared<core::MovingAverageSmoother<float>>(2))
+              .append(std::make_shared<core::GlobalThresholdPeakFilter<float>>(0.1f));
+
+            auto pmd = core::SimpleProcessManager<double>();
+            pmd.append(std::make_shared<core::MovingAverageSmoother<double>>(2))
+               .append(std::make_shared<core::GlobalThresholdPeakFilter<double>>(0.1));
+            REQUIRE_FLOAT_APPROX_DOUBLE(pmd.run(data), pm.run(dataf));
+        }
+        THEN( "peaks" ) {
+            const core::NumericalData<float> signal = dataf - dataf.snip(20);
+            const core::PeakList<float> peaks = core::SimplePeakFinder<float>(0.1f).find(signal);
+            REQUIRE( peaks.size() == 2 );
+            REQUIRE( peaks[0].index == 60 );
+            REQUIRE( peaks[1].index == 140 );
+        }
+        THEN( "batch" ) {
+            const core::NumericalBatch<double> batch(std::vector<core::NumericalData<double>>{data, data*2.0});
+            const core::NumericalBatch<float> batchf = batch.cast<float>();
+            REQUIRE( batchf.nchannels() == batch.nchannels() );
+            REQUIRE( batchf.nspectra() == batch.nspectra() );
+            const core::NumericalBatch<float> snipped = batchf.snip(20);
+            REQUIRE_FLOAT_APPROX_DOUBLE(data.snip(20), core::NumericalData<float>(snipped.spectrum(0)));
+            REQUIRE_FLOAT_APPROX_DOUBLE((data*2.0).snip(20), core::NumericalData<float>(snipped.spectrum(1)));
+        }
+    }
+
+PEAKINGDUCK_NAMESPACE_END // unittests
+PEAKINGDUCK_NAMESPACE_END // peakingduck
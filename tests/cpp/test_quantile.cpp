@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "common.hpp"
+
+#include "peakingduck.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(unittests)
+
+    // the quantile of the sorted window, as numpy.quantile
+    double sortedQuantile(std::vector<double> values, double quantile)
+    {
+        std::sort(values.begin(), values.end());
+        const double position = quantile*(values.size() - 1);
+        const size_t k = static_cast<size_t>(std::floor(position));
+        if(k + 1 < values.size()){
+            return values[k] + (position - k)*(values[k+1] - values[k]);
+        }
+        return values[k];
+    }
+
+    // sorts every window
+    core::NumericalData<double> sortedQuantileFilter(const core::NumericalData<double>& data, int windowsize, double quantile, core::EdgeMode edgemode)
+    {
+        core::NumericalData<double> filtered = data;
+        const int size = data.size();
+        for(int i=0; i<size; ++i){
+            const int lower = std::max(0, i-windowsize);
+            const int upper = std::min(size, i+windowsize+1);
+            if(edgemode == core::EdgeMode::Truncate || upper - lower == 2*windowsize + 1){
+                filtered[i] = sortedQuantile(std::vector<double>(data.begin() + lower, data.begin() + upper), quantile);
+            }
+        }
+        return filtered;
+    }
+
+    SCENARIO( "Test rolling quantile filter" ) {
+        // repeated values to check the equal values across the two sets
+        core::NumericalData<double> data(200);
+        for(int i=0; i<data.size(); ++i){
+            data[i] = static_cast<double>((i*37 + 11) % 23) + (i % 5 == 0 ? 0.25 : 0.0);
+        }
+
+        THEN( "check sliding quantile" ) {
+            core::SlidingQuantile<double> window(0.25);
+            for(double value: {5.0, 1.0, 4.0, 2.0, 3.0}){
+                window.insert(value);
+            }
+            REQUIRE( window.size() == 5 );
+            REQUIRE( window.value() == Approx(2.0) );
+            window.erase(1.0);
+            REQUIRE( window.value() == Approx(2.75) );
+            window.erase(5.0);
+            window.erase(4.0);
+            REQUIRE( window.value() == Approx(2.25) );
+            window.clear();
+            REQUIRE( window.size() == 0 );
+
+            // slid along the data
+            core::SlidingQuantile<double> median;
+            for(int i=0; i<data.size(); ++i){
+                median.insert(data[i]);
+                if(i >= 9){
+                    REQUIRE( median.value() == Approx(sortedQuantile(std::vector<double>(data.begin() + i - 9, data.begin() + i + 1), 0.5)) );
+                    median.erase(data[i-9]);
+                }
+            }
+        }
+        THEN( "check sorted and ranked quantiles" ) {
+            for(int width: {1, 2, 7, 40}){
+                for(double quantile: {0.0, 0.1, 0.5, 1.0}){
+                    core::SortedQuantile<double> sorted(quantile, width);
+                    core::RankedQuantile<double> ranked(data, quantile);
+                    for(int i=0; i<data.size(); ++i){
+                        sorted.insert(data[i]);
+                        ranked.insert(i);
+                        if(i >= width - 1){
+                            const double expected = sortedQuantile(std::vector<double>(data.begin() + i - width + 1, data.begin() + i + 1), quantile);
+                            REQUIRE( sorted.size() == width );
+                            REQUIRE( ranked.size() == width );
+                            REQUIRE( sorted.value() == Approx(expected) );
+                            REQUIRE( ranked.value() == Approx(expected) );
+                            sorted.erase(data[i - width + 1]);
+                            ranked.erase(i - width + 1);
+                        }
+                    }
+                }
+            }
+        }
+        THEN( "check same as sorting each window" ) {
+            // the widest are past the sorted buffer
+            for(int windowsize: {0, 1, 2, 5, 20, 150, 1100, 3000}){
+                for(double quantile: {0.0, 0.1, 0.5, 0.9, 1.0}){
+                    for(auto edgemode: {core::EdgeMode::Keep, core::EdgeMode::Truncate}){
+                        const core::RollingQuantileFilter<double> filter(windowsize, quantile, edgemode);
+                        const core::NumericalData<double> expected = sortedQuantileFilter(data, windowsize, quantile, edgemode);
+                        const core::NumericalData<double> filtered = filter.go(data);
+                        for(int i=0; i<data.size(); ++i){
+                            REQUIRE( filtered[i] == Approx(expected[i]) );
+                        }
+                    }
+                }
+            }
+        }
+        THEN( "check spikes are removed" ) {
+            core::NumericalData<double> spiky = core::NumericalData<double>::Ones(50)*10.0;
+            spiky[20] = 1000.0;
+            spiky[21] = 900.0;
+            spiky[35] = -500.0;
+            const core::NumericalData<double> filtered = core::RollingMedianFilter<double>(2, core::EdgeMode::Truncate).go(spiky);
+            for(int i=0; i<filtered.size(); ++i){
+                REQUIRE( filtered[i] == Approx(10.0) );
+            }
+        }
+        THEN( "check views, batches and single precision" ) {
+            const core::RollingMedianFilter<double> filter(3);
+            const core::NumericalData<double> expected = filter.go(data);
+
+            core::NumericalData<double> strided(2*data.size());
+            for(int i=0; i<data.size(); ++i){
+                strided[2*i] = data[i];
+                strided[2*i+1] = -1.0;
+            }
+            const core::NumericalData<double> fromview = filter.go(core::ConstNumericalView<double>(strided.data(), data.size(), 2));
+            const core::NumericalBatch<double> batch(std::vector<core::NumericalData<double>>{data, data*2.0});
+            const core::NumericalBatch<double> filtered = filter.go(batch);
+            const core::NumericalData<float> single = core::RollingMedianFilter<float>(3).go(data.cast<float>());
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( fromview[i] == Approx(expected[i]) );
+                REQUIRE( filtered.spectrum(0)[i] == Approx(expected[i]) );
+                REQUIRE( filtered.spectrum(1)[i] == Approx(2.0*expected[i]) );
+                REQUIRE( single[i] == Approx(expected[i]) );
+            }
+        }
+        THEN( "check throws" ) {
+            REQUIRE_THROWS_AS( core::RollingQuantileFilter<double>(-1), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::RollingQuantileFilter<double>(2, 1.5), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::SlidingQuantile<double>(-0.1), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::SortedQuantile<double>(1.1), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::RankedQuantile<double>(data, -0.1), PeakingDuckException );
+        }
+    }
+
+PEAKINGDUCK_NAMESPACE_END // unittests
+PEAKINGDUCK_NAMESPACE_END // peakingduck
@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "common.hpp"
+
+#include "peakingduck.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(unittests)
+
+    // bin edges 0, width, 2*width, ...
+    core::NumericalData<double> uniformEdges(int nchannels, double width=1.0){
+        core::NumericalData<double> edges(nchannels + 1);
+        for(int i=0; i<=nchannels; ++i){
+            edges[i] = i*width;
+        }
+        return edges;
+    }
+
+    SCENARIO( "Test resolution smoothing" ) {
+        const core::FWHMCalibration calibration(4.0, 0.0, 1e-4);
+        const core::NumericalData<double> edges = uniformEdges(1000);
+
+        THEN( "check calibration" ) {
+            REQUIRE( calibration(0.0) == Approx(2.0) );
+            REQUIRE( calibration(100.0) == Approx(std::sqrt(5.0)) );
+            REQUIRE( core::FWHMCalibration(1.0, 0.5)(6.0) == Approx(2.0) );
+        }
+        THEN( "check kernels follow the calibration" ) {
+            const core::GaussianKernelBank<double> bank(edges, calibration);
+            REQUIRE( bank.nchannels() == 1000 );
+            for(int channel: {100, 500, 900}){
+                const core::ConstNumericalView<double> kernel = bank.kernel(channel);
+                REQUIRE( kernel.sum() == Approx(1.0) );
+
+                // the variance of the Gaussian, plus that of the bin (1/12)
+                double mean = 0.0;
+                double variance = 0.0;
+                for(int j=0; j<kernel.size(); ++j){
+                    mean += kernel[j]*(bank.first(channel) + j + 0.5);
+                }
+                for(int j=0; j<kernel.size(); ++j){
+                    variance += kernel[j]*std::pow(bank.first(channel) + j + 0.5 - mean, 2);
+                }
+                const double sigma = calibration(channel + 0.5)/core::GaussianKernelBank<double>::FWHMPerSigma;
+                REQUIRE( mean == Approx(channel + 0.5) );
+                REQUIRE( variance == Approx(sigma*sigma + 1.0/12.0).epsilon(5e-3) );
+            }
+            REQUIRE( bank.kernel(900).size() > 2*bank.kernel(100).size() );
+        }
+        THEN( "check edges" ) {
+            core::NumericalData<double> data(1000);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = 3.0 + 0.5*(i + 0.5);
+            }
+
+            // a line is unchanged by symmetric kernels, the edges are kept
+            const core::ResolutionSmoother<double> kept(edges, calibration);
+            const core::NumericalData<double> smoothed = kept.go(data);
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( smoothed[i] == Approx(data[i]) );
+            }
+            REQUIRE( kept.bank().kernel(0).size() == 1 );
+            REQUIRE( kept.bank().kernel(999).size() == 1 );
+
+            // a constant is unchanged with truncated edges
+            const core::NumericalData<double> flat = core::NumericalData<double>::Ones(1000)*2.0;
+            const core::ResolutionSmoother<double> truncated(edges, calibration, 4.0, core::EdgeMode::Truncate);
+            const core::NumericalData<double> smoothedflat = truncated.go(flat);
+            for(int i=0; i<flat.size(); ++i){
+                REQUIRE( smoothedflat[i] == Approx(2.0) );
+            }
+            REQUIRE( truncated.bank().kernel(0).size() > 1 );
+        }
+        THEN( "check uneven bins" ) {
+            // bins twice as wide from 500, the same FWHM in energy is half as many channels
+            core::NumericalData<double> uneven(1001);
+            for(int i=0; i<=1000; ++i){
+                uneven[i] = i < 500 ? i : 500 + 2.0*(i - 500);
+            }
+            const core::GaussianKernelBank<double> bank(uneven, core::FWHMCalibration(100.0));
+            const int before = bank.kernel(300).size();
+            const int after = bank.kernel(700).size();
+            REQUIRE( std::abs(before - 2*after) <= 2 );
+            REQUIRE( bank.kernel(700).sum() == Approx(1.0) );
+        }
+        THEN( "check views, batches and single precision" ) {
+            core::NumericalData<double> data(1000);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = 10.0 + 100.0*std::exp(-0.5*std::pow((i - 400)/3.0, 2)) + (i % 7);
+            }
+            auto bank = std::make_shared<const core::GaussianKernelBank<double>>(edges, calibration);
+            const core::ResolutionSmoother<double> smoother(bank);
+            const core::NumericalData<double> expected = smoother.go(data);
+
+            // area is kept up to the slow change of width across the spectrum
+            REQUIRE( expected.sum() == Approx(data.sum()).epsilon(1e-3) );
+
+            core::NumericalData<double> strided(2000);
+            for(int i=0; i<data.size(); ++i){
+                strided[2*i] = data[i];
+                strided[2*i+1] = -1.0;
+            }
+            const core::NumericalData<double> fromview = smoother.go(core::ConstNumericalView<double>(strided.data(), 1000, 2));
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( fromview[i] == Approx(expected[i]) );
+            }
+
+            const core::NumericalBatch<double> batch(std::vector<core::NumericalData<double>>{data, data*0.5});
+            const core::NumericalBatch<double> smoothed = smoother.go(batch);
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( smoothed.spectrum(0)[i] == Approx(expected[i]) );
+                REQUIRE( smoothed.spectrum(1)[i] == Approx(0.5*expected[i]) );
+            }
+
+            const core::ResolutionSmoother<float> single(edges, calibration);
+            const core::NumericalData<float> smoothedsingle = single.go(data.cast<float>());
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( smoothedsingle[i] == Approx(expected[i]).epsilon(1e-5) );
+            }
+        }
+        THEN( "check throws" ) {
+            const core::ResolutionSmoother<double> smoother(edges, calibration);
+            REQUIRE_THROWS_AS( smoother.go(core::NumericalData<double>::Ones(999)), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::GaussianKernelBank<double>(core::NumericalData<double>(std::vector<double>({1.0})), calibration), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::GaussianKernelBank<double>(core::NumericalData<double>(std::vector<double>({0, 2, 1})), calibration), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::GaussianKernelBank<double>(edges, core::FWHMCalibration(0.0)), PeakingDuckException );
+        }
+    }
+
+PEAKINGDUCK_NAMESPACE_END // unittests
+PEAKINGDUCK_NAMESPACE_END // peakingduck
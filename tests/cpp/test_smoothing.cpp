@@ -4,6 +4,9 @@
 //                                                                //
 ////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
 #include <vector>
 
 #include "catch2/catch.hpp"
@@ -45,5 +48,250 @@ PEAKINGDUCK_NAMESPACE_START(unittests)
     }
 
 
+    SCENARIO( "Test moving average smoother on a view" ) {
+        core::NumericalData<double> data(13);
+        data << -1, 3, 5, 4, 12, 23, 3, 7, 5, 3, 4, 8, -1;
+        const core::MovingAverageSmoother<double> smoother(2);
+
+        const core::NumericalData<double> smoothed = smoother.go(data.slice(1, -1));
+        const core::NumericalData<double> expected = smoother.go(core::NumericalData<double>(data.slice(1, -1)));
+        REQUIRE_NUMERICS_APPROX_THE_SAME(expected, smoothed);
+
+        // via the interface
+        const core::IProcess<double>& process = smoother;
+        REQUIRE_NUMERICS_APPROX_THE_SAME(expected, process.go(data.slice(1, -1)));
+    }
+
+    SCENARIO( "Test moving average smoother edges and wide windows" ) {
+        const core::NumericalData<double> data(std::vector<double>({3, 5, 4, 12, 23, 3, 7, 5, 3, 4, 8}));
+
+        THEN( "truncated edges" ) {
+            const core::MovingAverageSmoother<double> smoother(2, core::EdgeMode::Truncate);
+            const core::NumericalData<double> expected(std::vector<double>({4.0, 6.0, 9.4, 9.4, 9.8, 10.0, 8.2, 4.4, 5.4, 5.0, 5.0}));
+            REQUIRE_NUMERICS_APPROX_THE_SAME(expected, smoother.go(data));
+        }
+        THEN( "window larger than the data" ) {
+            REQUIRE_NUMERICS_APPROX_THE_SAME(data, core::MovingAverageSmoother<double>(6).go(data));
+
+            const core::NumericalData<double> truncated = core::MovingAverageSmoother<double>(20, core::EdgeMode::Truncate).go(data);
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( truncated[i] == Approx(data.mean()) );
+            }
+        }
+        THEN( "same as the mean of each window" ) {
+            core::NumericalData<double> values(5000);
+            for(int i=0; i<values.size(); ++i){
+                values[i] = 1e6 + 1e3*std::sin(0.01*i) + ((i*37) % 11);
+            }
+            for(int windowsize: {1, 7, 64, 300}){
+                const core::NumericalData<double> smoothed = core::MovingAverageSmoother<double>(windowsize).go(values);
+                const core::NumericalData<double> truncated = core::MovingAverageSmoother<double>(windowsize, core::EdgeMode::Truncate).go(values);
+                for(int i=0; i<values.size(); ++i){
+                    const int lower = std::max(0, i-windowsize);
+                    const int upper = std::min(static_cast<int>(values.size()), i+windowsize+1);
+                    const double mean = values.slice(lower, upper).mean();
+                    const bool edge = (i < windowsize) || (i >= values.size() - windowsize);
+                    REQUIRE( smoothed[i] == Approx(edge ? values[i] : mean).epsilon(1e-14) );
+                    REQUIRE( truncated[i] == Approx(mean).epsilon(1e-14) );
+                }
+            }
+        }
+        THEN( "batch" ) {
+            const core::NumericalBatch<double> batch(std::vector<core::NumericalData<double>>{data, data*0.5});
+            for(auto edgemode: {core::EdgeMode::Keep, core::EdgeMode::Truncate}){
+                const core::MovingAverageSmoother<double> smoother(3, edgemode);
+                const core::NumericalBatch<double> smoothed = smoother.go(batch);
+                REQUIRE_NUMERICS_APPROX_THE_SAME(smoother.go(data), core::NumericalData<double>(smoothed.spectrum(0)));
+                REQUIRE_NUMERICS_APPROX_THE_SAME(smoother.go(core::NumericalData<double>(data*0.5)), core::NumericalData<double>(smoothed.spectrum(1)));
+            }
+        }
+    }
+
+    SCENARIO( "Test weighted moving average smoother" ) {
+        THEN( "weights" ) {
+            const std::vector<std::vector<double>> expected({
+                {0, 1, 0},
+                {0, 0.5, 0.5, 0, 0},
+                {0, 0, 0.25, 0.5, 0.25, 0, 0},
+                {0, 0, 1/6., 2/6., 2/6., 1/6., 0, 0, 0},
+                {0, 0, 0, 1/9., 2/9., 3/9., 2/9., 1/9., 0, 0, 0}});
+            for(int windowsize=1; windowsize<=5; ++windowsize){
+                const core::NumericalData<double> weights = core::weightedMovingAverageWeights<double>(windowsize);
+                REQUIRE( weights.size() == static_cast<int>(expected[windowsize-1].size()) );
+                for(int i=0; i<weights.size(); ++i){
+                    REQUIRE( weights[i] == Approx(expected[windowsize-1][i]) );
+                }
+            }
+        }
+        THEN( "same as the weighted sum of each window" ) {
+            core::NumericalData<double> values(5000);
+            for(int i=0; i<values.size(); ++i){
+                values[i] = 1e6 + 1e3*std::sin(0.01*i) + ((i*37) % 11);
+            }
+            for(int windowsize: {1, 2, 5, 64, 301}){
+                const core::NumericalData<double> weights = core::weightedMovingAverageWeights<double>(windowsize);
+                const core::NumericalData<double> smoothed = core::WeightedMovingAverageSmoother<double>(windowsize).go(values);
+                for(int i=0; i<values.size(); ++i){
+                    const bool edge = (i < windowsize) || (i >= values.size() - windowsize);
+                    const double expected = edge ? values[i] : (values(i-windowsize, i+windowsize+1)*weights).sum();
+                    REQUIRE( smoothed[i] == Approx(expected).epsilon(1e-13) );
+                }
+            }
+        }
+        THEN( "views and batch" ) {
+            const core::NumericalData<double> data(std::vector<double>({3, 5, 4, 12, 23, 3, 7, 5, 3, 4, 8}));
+            const core::WeightedMovingAverageSmoother<double> smoother(3);
+            const core::NumericalData<double> expected(std::vector<double>({3, 5, 4, 12.75, 15.25, 9, 5.5, 5, 3, 4, 8}));
+            REQUIRE_NUMERICS_APPROX_THE_SAME(expected, smoother.go(data));
+            const core::NumericalData<double> expectedSlice(std::vector<double>({5, 4, 12, 15.25, 9, 5.5, 5, 3, 4}));
+            REQUIRE_NUMERICS_APPROX_THE_SAME(expectedSlice, smoother.go(data.slice(1, -1)));
+
+            const core::NumericalBatch<double> batch(std::vector<core::NumericalData<double>>{data, data*0.5});
+            const core::NumericalBatch<double> smoothed = smoother.go(batch);
+            REQUIRE_NUMERICS_APPROX_THE_SAME(expected, core::NumericalData<double>(smoothed.spectrum(0)));
+            REQUIRE_NUMERICS_APPROX_THE_SAME(core::NumericalData<double>(expected*0.5), core::NumericalData<double>(smoothed.spectrum(1)));
+        }
+    }
+
+    template<int WindowSize>
+    void REQUIRE_FIXED_SMOOTHERS_SAME_AS_DYNAMIC(const core::NumericalData<double>& data){
+        const core::NumericalData<double> expected = core::MovingAverageSmoother<double>(WindowSize).go(data);
+        REQUIRE_NUMERICS_APPROX_THE_SAME(expected, core::FixedMovingAverageSmoother<WindowSize, double>().go(data));
+        REQUIRE_NUMERICS_APPROX_THE_SAME(expected, core::makeMovingAverageSmoother<double>(WindowSize)->go(data));
+
+        const core::NumericalData<double> truncated = core::MovingAverageSmoother<double>(WindowSize, core::EdgeMode::Truncate).go(data);
+        REQUIRE_NUMERICS_APPROX_THE_SAME(truncated, core::FixedMovingAverageSmoother<WindowSize, double>(core::EdgeMode::Truncate).go(data));
+        REQUIRE_NUMERICS_APPROX_THE_SAME(truncated, core::makeMovingAverageSmoother<double>(WindowSize, core::EdgeMode::Truncate)->go(data));
+        const core::NumericalData<double> few = data.slice(0, WindowSize + 1);
+        REQUIRE_NUMERICS_APPROX_THE_SAME(core::MovingAverageSmoother<double>(WindowSize, core::EdgeMode::Truncate).go(few),
+                                         core::makeMovingAverageSmoother<double>(WindowSize, core::EdgeMode::Truncate)->go(few));
+        const core::NumericalBatch<double> batch(std::vector<core::NumericalData<double>>{data, data*2.0});
+        const core::NumericalBatch<double> smoothed = core::makeMovingAverageSmoother<double>(WindowSize, core::EdgeMode::Truncate)->go(batch);
+        REQUIRE_NUMERICS_APPROX_THE_SAME(core::NumericalData<double>(truncated*2.0), core::NumericalData<double>(smoothed.spectrum(1)));
+
+        const core::NumericalData<double> expectedWeighted = core::WeightedMovingAverageSmoother<double>(WindowSize).go(data);
+        REQUIRE_NUMERICS_APPROX_THE_SAME(expectedWeighted, core::FixedWeightedMovingAverageSmoother<WindowSize, double>().go(data));
+        REQUIRE_NUMERICS_APPROX_THE_SAME(expectedWeighted, core::makeWeightedMovingAverageSmoother<double>(WindowSize)->go(data));
+    }
+
+    SCENARIO( "Test fixed window size smoothers" ) {
+        core::NumericalData<double> data(40);
+        for(int i=0;i<data.size();++i){
+            data[i] = ((i*37) % 11) + 0.25*i;
+        }
+
+        THEN( "same as dynamic window size" ) {
+            REQUIRE_FIXED_SMOOTHERS_SAME_AS_DYNAMIC<1>(data);
+            REQUIRE_FIXED_SMOOTHERS_SAME_AS_DYNAMIC<2>(data);
+            REQUIRE_FIXED_SMOOTHERS_SAME_AS_DYNAMIC<3>(data);
+            REQUIRE_FIXED_SMOOTHERS_SAME_AS_DYNAMIC<5>(data);
+            REQUIRE_FIXED_SMOOTHERS_SAME_AS_DYNAMIC<8>(data);
+            REQUIRE_FIXED_SMOOTHERS_SAME_AS_DYNAMIC<12>(data);
+        }
+        THEN( "window larger than the data" ) {
+            const core::NumericalData<double> small = data.slice(0, 9);
+            REQUIRE_NUMERICS_APPROX_THE_SAME(small, core::FixedMovingAverageSmoother<5, double>().go(small));
+        }
+        THEN( "strided view" ) {
+            const core::ConstNumericalView<double> strided(data.data(), 20, 2);
+            const core::NumericalData<double> expected = core::MovingAverageSmoother<double>(3).go(core::NumericalData<double>(strided));
+            REQUIRE_NUMERICS_APPROX_THE_SAME(expected, core::FixedMovingAverageSmoother<3, double>().go(strided));
+        }
+        THEN( "dispatch" ) {
+            REQUIRE( std::dynamic_pointer_cast<core::FixedMovingAverageSmoother<4, double>>(core::makeMovingAverageSmoother<double>(4)) );
+            REQUIRE( std::dynamic_pointer_cast<core::MovingAverageSmoother<double>>(core::makeMovingAverageSmoother<double>(9)) );
+            REQUIRE( std::dynamic_pointer_cast<core::FixedWeightedMovingAverageSmoother<8, double>>(core::makeWeightedMovingAverageSmoother<double>(8)) );
+            REQUIRE( std::dynamic_pointer_cast<core::WeightedMovingAverageSmoother<double>>(core::makeWeightedMovingAverageSmoother<double>(20)) );
+        }
+        THEN( "batch" ) {
+            const core::NumericalBatch<double> batch(std::vector<core::NumericalData<double>>{data, data*0.5});
+            const core::NumericalBatch<double> smoothed = core::FixedWeightedMovingAverageSmoother<3, double>().go(batch);
+            const core::WeightedMovingAverageSmoother<double> smoother(3);
+            REQUIRE_NUMERICS_APPROX_THE_SAME(smoother.go(data), core::NumericalData<double>(smoothed.spectrum(0)));
+            REQUIRE_NUMERICS_APPROX_THE_SAME(smoother.go(core::NumericalData<double>(data*0.5)), core::NumericalData<double>(smoothed.spectrum(1)));
+        }
+    }
+
+    SCENARIO( "Test Savitzky-Golay smoother" ) {
+        THEN( "coefficients" ) {
+            const auto coefficients = core::savitzkyGolayCoefficients<double>(5, 2);
+            const std::vector<double> expected({-3./35., 12./35., 17./35., 12./35., -3./35.});
+            for(int i=0; i<5; ++i){
+                REQUIRE( coefficients->weights[i] == Approx(expected[i]) );
+            }
+
+            const auto derivative = core::savitzkyGolayCoefficients<double>(7, 2, 1);
+            for(int i=0; i<7; ++i){
+                REQUIRE( derivative->weights[i] == Approx((i-3)/28.).margin(1e-14) );
+            }
+
+            // cached
+            REQUIRE( core::savitzkyGolayCoefficients<double>(5, 2) == coefficients );
+            REQUIRE( core::savitzkyGolayCoefficients<double>(5, 3) != coefficients );
+        }
+        THEN( "same as scipy savgol_filter (mode='interp')" ) {
+            const core::NumericalData<double> data(std::vector<double>({2, 2, 5, 2, 1, 0, 1, 4, 9}));
+            const std::vector<double> expected({1.66, 3.17, 3.54, 2.86, 0.66, 0.17, 1.0, 4.0, 9.0});
+            const core::NumericalData<double> smoothed = core::SavitzkyGolaySmoother<double>(5, 2).go(data);
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( smoothed[i] == Approx(expected[i]).margin(0.005) );
+            }
+
+            // the window fits the polynomial exactly
+            const core::NumericalData<double> exact = core::SavitzkyGolaySmoother<double>(3, 2).go(data);
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( exact[i] == Approx(data[i]).margin(1e-12) );
+            }
+        }
+        THEN( "polynomials and derivatives are exact" ) {
+            const double delta = 0.5;
+            core::NumericalData<double> quadratic(60);
+            core::NumericalData<double> gradient(60);
+            for(int i=0; i<quadratic.size(); ++i){
+                const double x = i*delta;
+                quadratic[i] = 3.0 - 2.0*x + 0.25*x*x;
+                gradient[i] = -2.0 + 0.5*x;
+            }
+            for(int windowsize: {5, 11, 41}){
+                const core::NumericalData<double> smoothed = core::SavitzkyGolaySmoother<double>(windowsize, 2).go(quadratic);
+                const core::NumericalData<double> derivative = core::SavitzkyGolaySmoother<double>(windowsize, 3, 1, delta).go(quadratic);
+                for(int i=0; i<quadratic.size(); ++i){
+                    REQUIRE( smoothed[i] == Approx(quadratic[i]).margin(1e-9) );
+                    REQUIRE( derivative[i] == Approx(gradient[i]).margin(1e-9) );
+                }
+            }
+
+            // shorter than the window
+            const core::NumericalData<double> small = quadratic.slice(0, 4);
+            REQUIRE_NUMERICS_APPROX_THE_SAME(small, core::SavitzkyGolaySmoother<double>(11, 2).go(small));
+        }
+        THEN( "views, batches and single precision" ) {
+            core::NumericalData<double> data(50);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = ((i*37) % 11) + 0.25*i;
+            }
+            const core::SavitzkyGolaySmoother<double> smoother(7, 3);
+            const core::NumericalData<double> smoothed = smoother.go(data);
+
+            const core::ConstNumericalView<double> strided(data.data(), 25, 2);
+            REQUIRE_NUMERICS_APPROX_THE_SAME(smoother.go(core::NumericalData<double>(strided)), smoother.go(strided));
+
+            const core::NumericalBatch<double> batch(std::vector<core::NumericalData<double>>{data, data*2.0});
+            const core::NumericalBatch<double> smoothedbatch = smoother.go(batch);
+            REQUIRE_NUMERICS_APPROX_THE_SAME(smoothed, core::NumericalData<double>(smoothedbatch.spectrum(0)));
+            REQUIRE_NUMERICS_APPROX_THE_SAME(core::NumericalData<double>(smoothed*2.0), core::NumericalData<double>(smoothedbatch.spectrum(1)));
+
+            const core::NumericalData<float> smoothedf = core::SavitzkyGolaySmoother<float>(7, 3).go(data.cast<float>());
+            for(int i=0; i<data.size(); ++i){
+                REQUIRE( smoothedf[i] == Approx(smoothed[i]).margin(1e-4) );
+            }
+        }
+        THEN( "invalid arguments" ) {
+            REQUIRE_THROWS_AS( core::SavitzkyGolaySmoother<double>(4, 2), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::SavitzkyGolaySmoother<double>(5, 5), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::SavitzkyGolaySmoother<double>(5, 2, -1), PeakingDuckException );
+        }
+    }
+
 PEAKINGDUCK_NAMESPACE_END // unittests
 PEAKINGDUCK_NAMESPACE_END // peakingduck
@@ -0,0 +1,180 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "common.hpp"
+
+#include "peakingduck.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(unittests)
+
+    SCENARIO( "Test statistics" ) {
+        core::NumericalData<double> data(std::vector<double>({1, 4, 5, 2, 10, -2, 2, 10, -2}));
+
+        THEN( "check small array" ) {
+            const core::Statistics<double> stats = data.statistics();
+            REQUIRE( stats.count == 9 );
+            REQUIRE( stats.sum == 30.0 );
+            REQUIRE( stats.mean == Approx(30.0/9.0) );
+            REQUIRE( stats.min == -2.0 );
+            REQUIRE( stats.max == 10.0 );
+            REQUIRE( stats.argmin == 5 );
+            REQUIRE( stats.argmax == 4 );
+
+            double m2 = 0.0;
+            for(int i=0; i<data.size(); ++i){
+                m2 += std::pow(data[i] - 30.0/9.0, 2);
+            }
+            REQUIRE( stats.variance() == Approx(m2/9.0) );
+            REQUIRE( stats.variance(1) == Approx(m2/8.0) );
+            REQUIRE( stats.stddev(1) == Approx(std::sqrt(m2/8.0)) );
+            REQUIRE( data.stddev() == Approx(std::sqrt(m2/9.0)) );
+        }
+        THEN( "check empty array" ) {
+            const core::Statistics<double> stats = core::NumericalData<double>().statistics();
+            REQUIRE( stats.count == 0 );
+            REQUIRE( stats.sum == 0.0 );
+            REQUIRE( stats.argmin == -1 );
+            REQUIRE( stats.argmax == -1 );
+        }
+        THEN( "check views and expressions" ) {
+            const core::Statistics<double> stats = data.slice(1, 5).statistics();
+            REQUIRE( stats.count == 4 );
+            REQUIRE( stats.sum == 21.0 );
+            REQUIRE( stats.argmax == 3 );
+            REQUIRE( stats.argmin == 2 );
+
+            // every other value
+            const core::ConstNumericalView<double> strided(data.data(), 5, 2);
+            const core::Statistics<double> stridedstats = strided.statistics();
+            REQUIRE( stridedstats.sum == 16.0 );
+            REQUIRE( stridedstats.argmin == 4 );
+            REQUIRE( stridedstats.argmax == 2 );
+
+            const core::Statistics<double> scaled = (data*2.0 + 1.0).statistics();
+            REQUIRE( scaled.mean == Approx(2.0*30.0/9.0 + 1.0) );
+            REQUIRE( scaled.variance() == Approx(4.0*data.statistics().variance()) );
+        }
+        THEN( "check large arrays over many blocks" ) {
+            // a large offset, the naive sum of squares loses all precision
+            core::NumericalData<double> values(100003);
+            for(int i=0; i<values.size(); ++i){
+                values[i] = 1e9 + (i % 4);
+            }
+            values[70001] = 1e9 + 8;
+            values[90001] = 1e9 + 8;
+            values[3] = 1e9 - 1;
+
+            const core::Statistics<double> stats = values.statistics();
+            double mean = 0.0;
+            for(int i=0; i<values.size(); ++i){
+                mean += (values[i] - 1e9)/values.size();
+            }
+            double m2 = 0.0;
+            for(int i=0; i<values.size(); ++i){
+                m2 += std::pow(values[i] - 1e9 - mean, 2);
+            }
+            REQUIRE( stats.count == values.size() );
+            REQUIRE( stats.mean - 1e9 == Approx(mean) );
+            REQUIRE( stats.variance() == Approx(m2/values.size()).epsilon(1e-6) );
+            REQUIRE( stats.argmax == 70001 );
+            REQUIRE( stats.argmin == 3 );
+            REQUIRE( stats.min == 1e9 - 1 );
+            REQUIRE( stats.max == 1e9 + 8 );
+        }
+        THEN( "check merge" ) {
+            core::Statistics<double> first = data.slice(0, 4).statistics();
+            first.merge(data.slice(4, 9).statistics());
+            const core::Statistics<double> all = data.statistics();
+            REQUIRE( first.count == all.count );
+            REQUIRE( first.sum == all.sum );
+            REQUIRE( first.mean == Approx(all.mean) );
+            REQUIRE( first.m2 == Approx(all.m2) );
+            REQUIRE( first.argmin == all.argmin );
+            REQUIRE( first.argmax == all.argmax );
+        }
+        THEN( "check single precision" ) {
+            const core::Statistics<float> stats = data.cast<float>().statistics();
+            REQUIRE( stats.mean == Approx(30.0/9.0) );
+            REQUIRE( stats.variance() == Approx(data.statistics().variance()) );
+            REQUIRE( stats.argmax == 4 );
+        }
+        THEN( "check the extremes of the value type" ) {
+            // over several blocks, all the same value (one value for int so the sum fits)
+            const double infinity = std::numeric_limits<double>::infinity();
+            const core::Statistics<double> infinite = core::NumericalData<double>(std::vector<double>(1500, infinity)).statistics();
+            REQUIRE( infinite.min == infinity );
+            REQUIRE( infinite.max == infinity );
+            REQUIRE( infinite.argmin == 0 );
+            REQUIRE( infinite.argmax == 0 );
+
+            const core::Statistics<float> negative = core::NumericalData<float>(std::vector<float>(1500, -std::numeric_limits<float>::infinity())).statistics();
+            REQUIRE( negative.min == -std::numeric_limits<float>::infinity() );
+            REQUIRE( negative.max == -std::numeric_limits<float>::infinity() );
+            REQUIRE( negative.argmin == 0 );
+            REQUIRE( negative.argmax == 0 );
+
+            const core::Statistics<int> largest = core::NumericalData<int>(std::vector<int>(1, std::numeric_limits<int>::max())).statistics();
+            REQUIRE( largest.min == std::numeric_limits<int>::max() );
+            REQUIRE( largest.argmin == 0 );
+            REQUIRE( largest.argmax == 0 );
+
+            const core::Statistics<int> lowest = core::NumericalData<int>(std::vector<int>(1, std::numeric_limits<int>::lowest())).statistics();
+            REQUIRE( lowest.max == std::numeric_limits<int>::lowest() );
+            REQUIRE( lowest.argmin == 0 );
+            REQUIRE( lowest.argmax == 0 );
+
+            // merged into empty statistics
+            core::Statistics<double> empty;
+            empty.merge(infinite);
+            REQUIRE( empty.argmin == 0 );
+            REQUIRE( empty.min == infinity );
+        }
+        THEN( "check integer data is not truncated" ) {
+            // over several blocks so that the merge is exercised
+            core::NumericalData<int> values(2000);
+            for(int i=0; i<values.size(); ++i){
+                values[i] = i % 7;
+            }
+            double sum = 0.0;
+            for(int i=0; i<values.size(); ++i){
+                sum += values[i];
+            }
+            const double mean = sum/values.size();
+            double m2 = 0.0;
+            for(int i=0; i<values.size(); ++i){
+                m2 += std::pow(values[i] - mean, 2);
+            }
+
+            const core::Statistics<int> stats = values.statistics();
+            REQUIRE( stats.count == 2000 );
+            REQUIRE( stats.sum == static_cast<int>(sum) );
+            REQUIRE( stats.mean == Approx(mean) );
+            REQUIRE( stats.variance() == Approx(m2/2000.0) );
+            REQUIRE( stats.min == 0 );
+            REQUIRE( stats.max == 6 );
+            REQUIRE( stats.argmax == 6 );
+
+            const double stddev = values.stddev();
+            REQUIRE( stddev == Approx(std::sqrt(m2/2000.0)) );
+            REQUIRE( stddev != std::floor(stddev) );
+            REQUIRE( values.stddev(1) == Approx(std::sqrt(m2/1999.0)) );
+
+            core::Statistics<int> first = values.slice(0, 5).statistics();
+            first.merge(values.slice(5, 2000).statistics());
+            REQUIRE( first.mean == Approx(mean) );
+            REQUIRE( first.m2 == Approx(m2) );
+        }
+    }
+
+PEAKINGDUCK_NAMESPACE_END // unittests
+PEAKINGDUCK_NAMESPACE_END // peakingduck
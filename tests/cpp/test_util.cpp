@@ -4,8 +4,10 @@
 //                                                                //
 ////////////////////////////////////////////////////////////////////
 
+#include <atomic>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -248,5 +250,49 @@ PEAKINGDUCK_NAMESPACE_START(unittests)
         }                  
     }
 
+    SCENARIO( "Using the thread pool" ) {
+        THEN( "check every task is run once" ) {
+            for(int nworkers: {0, 1, 3}){
+                util::ThreadPool pool(nworkers);
+                REQUIRE( pool.nthreads() == nworkers + 1 );
+                for(int ntasks: {0, 1, 2, 100}){
+                    std::vector<int> counts(ntasks, 0);
+                    pool.parallelFor(ntasks, [&](int i){ ++counts[i]; });
+                    REQUIRE( std::vector<int>(ntasks, 1) == counts );
+                }
+            }
+        }
+        THEN( "check nested and shared" ) {
+            util::ThreadPool pool(2);
+            std::atomic<int> total(0);
+            pool.parallelFor(4, [&](int i){
+                pool.parallelFor(10, [&](int j){ total += i*10 + j; });
+            });
+            REQUIRE( total == 780 );
+
+            std::vector<int> squares(50);
+            util::ThreadPool::shared().parallelFor(50, [&](int i){ squares[i] = i*i; });
+            REQUIRE( squares[49] == 49*49 );
+        }
+        THEN( "check the first exception is rethrown" ) {
+            util::ThreadPool pool(3);
+            std::vector<int> counts(20, 0);
+            try{
+                pool.parallelFor(20, [&](int i){
+                    ++counts[i];
+                    if(i == 7 || i == 13){
+                        throw std::runtime_error(std::to_string(i));
+                    }
+                });
+                FAIL( "No exception" );
+            }
+            catch(const std::runtime_error& error){
+                REQUIRE( std::string(error.what()) == "7" );
+            }
+            // the other tasks still run
+            REQUIRE( std::vector<int>(20, 1) == counts );
+        }
+    }
+
 PEAKINGDUCK_NAMESPACE_END // unittests
 PEAKINGDUCK_NAMESPACE_END // peakingduck
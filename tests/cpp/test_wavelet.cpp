@@ -0,0 +1,263 @@
+////////////////////////////////////////////////////////////////////
+//                                                                //
+//    Copyright (c) 2019-20, UK Atomic Energy Authority (UKAEA)   //
+//                                                                //
+////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "common.hpp"
+
+#include "peakingduck.hpp"
+
+PEAKINGDUCK_NAMESPACE_START(peakingduck)
+PEAKINGDUCK_NAMESPACE_START(unittests)
+
+    // scipy.signal.find_peaks_cwt as written in Python, a direct
+    // convolution and the nearest line by searching every line
+    std::vector<int> scanPeaksCWT(const core::NumericalData<double>& data, const std::vector<double>& widths,
+                                  std::vector<double> maxDistances=std::vector<double>())
+    {
+        if(maxDistances.empty()){
+            for(double width: widths){
+                maxDistances.push_back(width/4.0);
+            }
+        }
+        const int size = data.size();
+        const int nrows = static_cast<int>(widths.size());
+        std::vector<std::vector<double>> cwt(nrows, std::vector<double>(size, 0.0));
+        for(int r=0; r<nrows; ++r){
+            const core::NumericalData<double> wavelet = core::rickerWavelet<double>(std::min(10.0*widths[r], static_cast<double>(size)), widths[r]);
+            const int k = wavelet.size();
+            // numpy.convolve(data, wavelet[::-1], 'same')
+            for(int i=0; i<size; ++i){
+                for(int j=0; j<k; ++j){
+                    const int d = i + (k - 1)/2 - j;
+                    if(d >= 0 && d < size){
+                        cwt[r][i] += wavelet[k - 1 - j]*data[d];
+                    }
+                }
+            }
+        }
+
+        struct Line { std::vector<int> rows; std::vector<int> columns; int gap; };
+        auto maxima = [&](int r){
+            std::vector<int> columns;
+            for(int i=1; i<size-1; ++i){
+                if(cwt[r][i] > cwt[r][i-1] && cwt[r][i] > cwt[r][i+1]){
+                    columns.push_back(i);
+                }
+            }
+            return columns;
+        };
+        int start = nrows - 1;
+        while(start >= 0 && maxima(start).empty()){
+            --start;
+        }
+        std::vector<Line> lines;
+        std::vector<Line> finished;
+        if(start >= 0){
+            for(int column: maxima(start)){
+                lines.push_back(Line{{start}, {column}, 0});
+            }
+        }
+        for(int r=start-1; r>=0; --r){
+            for(Line& line: lines){
+                ++line.gap;
+            }
+            std::vector<int> previous;
+            for(const Line& line: lines){
+                previous.push_back(line.columns.back());
+            }
+            for(int column: maxima(r)){
+                int closest = -1;
+                for(size_t l=0; l<previous.size(); ++l){
+                    if(closest < 0 || std::abs(column - previous[l]) < std::abs(column - previous[closest])){
+                        closest = static_cast<int>(l);
+                    }
+                }
+                if(closest >= 0 && std::abs(column - previous[closest]) <= maxDistances[r]){
+                    lines[closest].rows.push_back(r);
+                    lines[closest].columns.push_back(column);
+                    lines[closest].gap = 0;
+                }
+                else{
+                    lines.push_back(Line{{r}, {column}, 0});
+                }
+            }
+            for(int l=static_cast<int>(lines.size())-1; l>=0; --l){
+                if(lines[l].gap > std::ceil(widths[0])){
+                    finished.push_back(lines[l]);
+                    lines.erase(lines.begin() + l);
+                }
+            }
+        }
+        finished.insert(finished.end(), lines.begin(), lines.end());
+
+        // scipy.stats.scoreatpercentile of the first row
+        const int window = static_cast<int>(std::ceil(size/20.0));
+        std::vector<double> noise(size);
+        for(int i=0; i<size; ++i){
+            std::vector<double> values(cwt[0].begin() + std::max(i - window/2, 0), cwt[0].begin() + std::min(i + window/2 + window % 2, size));
+            std::sort(values.begin(), values.end());
+            const double position = 0.1*(values.size() - 1);
+            const int below = static_cast<int>(std::floor(position));
+            noise[i] = values[below] + (position - below)*(values[std::min<int>(below + 1, values.size() - 1)] - values[below]);
+        }
+
+        std::vector<int> peaks;
+        for(const Line& line: finished){
+            if(static_cast<int>(line.rows.size()) < std::ceil(nrows/4.0)){
+                continue;
+            }
+            const int row = line.rows.back();
+            const int column = line.columns.back();
+            if(std::abs(cwt[row][column]/noise[column]) < 1.0){
+                continue;
+            }
+            peaks.push_back(column);
+        }
+        std::sort(peaks.begin(), peaks.end());
+        return peaks;
+    }
+
+    // low statistics, Poisson counts on a flat background
+    core::NumericalData<double> lowCountSpectrum(int size, unsigned int seed)
+    {
+        std::mt19937 generator(seed);
+        core::NumericalData<double> data(size);
+        for(int i=0; i<size; ++i){
+            const double mean = 3.0 + 25.0*std::exp(-0.5*std::pow((i - 0.25*size)/3.0, 2))
+                + 12.0*std::exp(-0.5*std::pow((i - 0.5*size)/5.0, 2))
+                + 30.0*std::exp(-0.5*std::pow((i - 0.8*size)/2.0, 2));
+            data[i] = std::poisson_distribution<int>(mean)(generator);
+        }
+        return data;
+    }
+
+    SCENARIO( "Test wavelet transform peak finder" ) {
+        util::ThreadPool serial(0);
+        util::ThreadPool parallel(3);
+        const std::vector<double> widths{1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 8.0, 10.0};
+        auto indices = [](const core::PeakList<double>& peaks){
+            std::vector<int> result;
+            for(const auto& peak: peaks){
+                result.push_back(static_cast<int>(peak.index));
+            }
+            return result;
+        };
+
+        THEN( "check the Ricker wavelet" ) {
+            const core::NumericalData<double> wavelet = core::rickerWavelet<double>(11, 2.0);
+            REQUIRE( wavelet.size() == 11 );
+            REQUIRE( wavelet[5] == Approx(2.0/(std::sqrt(6.0)*std::pow(std::acos(-1.0), 0.25))).epsilon(1e-14) );
+            REQUIRE( wavelet[3] == Approx(0.0).margin(1e-15) );
+            REQUIRE( wavelet[1] == Approx(wavelet[9]).epsilon(1e-14) );
+            REQUIRE( wavelet[0] < 0.0 );
+            REQUIRE( core::rickerWavelet<double>(12.5, 1.25).size() == 13 );
+            REQUIRE_THROWS_AS( core::rickerWavelet<double>(10, 0.0), PeakingDuckException );
+        }
+        THEN( "check the transform is the convolution with each wavelet" ) {
+            const core::NumericalData<double> data = lowCountSpectrum(3000, 7);
+            const core::CWTPeakFinder<double> finder(std::vector<double>{1.5, 4.0, 30.0, 500.0}, {}, 0.0, 0, 1.0, 10.0, 0, parallel);
+            const std::vector<core::NumericalData<double>> rows = finder.transform(data);
+            REQUIRE( rows.size() == 4 );
+            for(int r=0; r<4; ++r){
+                const core::NumericalData<double> wavelet = core::rickerWavelet<double>(std::min(10.0*finder.widths()[r], 3000.0), finder.widths()[r]);
+                const core::NumericalData<double> expected = core::correlate<double>(data, wavelet, core::ConvolutionMethod::Direct);
+                REQUIRE( rows[r].size() == data.size() );
+                for(int i=0; i<data.size(); ++i){
+                    REQUIRE( rows[r][i] == Approx(expected[i]).margin(1e-9) );
+                }
+            }
+        }
+        THEN( "check the peaks are as scipy" ) {
+            for(unsigned int seed: {1u, 2u, 3u}){
+                const core::NumericalData<double> data = lowCountSpectrum(1000, seed);
+                const core::PeakList<double> peaks = core::CWTPeakFinder<double>(widths).find(data);
+                REQUIRE( indices(peaks) == scanPeaksCWT(data, widths) );
+                for(const auto& peak: peaks){
+                    REQUIRE( peak.value == data[peak.index] );
+                }
+            }
+            // the edges of a ramp are maxima of the transform (as scipy)
+            core::NumericalData<double> ramp(200);
+            for(int i=0; i<ramp.size(); ++i){
+                ramp[i] = i;
+            }
+            REQUIRE( indices(core::CWTPeakFinder<double>(widths).find(ramp)) == scanPeaksCWT(ramp, widths) );
+            REQUIRE( core::CWTPeakFinder<double>(widths).find(core::NumericalData<double>::Zero(200)).empty() );
+            REQUIRE( core::CWTPeakFinder<double>(widths).find(core::NumericalData<double>()).empty() );
+        }
+        THEN( "check the peak is at the last maximum to join a line (as scipy)" ) {
+            // two spikes on a broad peak are maxima of the narrowest rows
+            // near the same line end, both join it
+            core::NumericalData<double> data = core::NumericalData<double>::Zero(200);
+            for(int i=0; i<data.size(); ++i){
+                data[i] = 50.0*std::exp(-0.5*std::pow((i - 100)/6.0, 2));
+            }
+            data[97] += 20.0;
+            data[103] += 20.0;
+            const std::vector<double> maxDistances(widths.size(), 6.0);
+            const std::vector<int> found = indices(core::CWTPeakFinder<double>(widths, maxDistances).find(data));
+            REQUIRE( found == scanPeaksCWT(data, widths, maxDistances) );
+            REQUIRE( found == std::vector<int>({103}) );
+        }
+        THEN( "check the low statistics peaks are found" ) {
+            const core::NumericalData<double> data = lowCountSpectrum(1000, 11);
+            const core::CWTPeakFinder<double> finder(widths, {}, 0.0, 0, 2.0);
+            const std::vector<int> found = indices(finder.find(data));
+            for(int expected: {250, 500, 800}){
+                REQUIRE( std::any_of(found.begin(), found.end(), [&](int i){ return std::abs(i - expected) <= 3; }) );
+            }
+        }
+        THEN( "check the same with any number of threads, sizes and in a table" ) {
+            const core::CWTPeakFinder<double> finder(widths, {}, 0.0, 0, 1.0, 10.0, 0, parallel);
+            const core::CWTPeakFinder<double> serialfinder(widths, {}, 0.0, 0, 1.0, 10.0, 0, serial);
+            for(int size: {500, 1000, 500}){
+                const core::NumericalData<double> data = lowCountSpectrum(size, 5);
+                const core::PeakList<double> peaks = finder.find(data);
+                REQUIRE( indices(peaks) == indices(serialfinder.find(data)) );
+
+                core::PeakTable<double> table;
+                finder.find(data, table);
+                REQUIRE( table.toPeakList().size() == peaks.size() );
+                for(int p=0; p<table.size(); ++p){
+                    REQUIRE( table.indices()[p] == peaks[p].index );
+                    REQUIRE( table.scores()[p] >= 1.0 );
+                    REQUIRE( std::find(widths.begin(), widths.end(), table.widths()[p]) != widths.end() );
+                }
+            }
+        }
+        THEN( "check the engines are kept for a bounded number of sizes" ) {
+            const core::CWTPeakFinder<double> finder(widths, {}, 0.0, 0, 1.0, 10.0, 0, serial);
+            const core::NumericalData<double> data = lowCountSpectrum(1000, 5);
+            const core::PeakList<double> expected = finder.find(data);
+            for(int size=100; size<100 + 3*core::CWTPeakFinder<double>::MaxCachedSizes; ++size){
+                finder.find(data.slice(0, size));
+                REQUIRE( finder.cachedSizes() <= core::CWTPeakFinder<double>::MaxCachedSizes );
+            }
+            REQUIRE( finder.cachedSizes() == core::CWTPeakFinder<double>::MaxCachedSizes );
+            REQUIRE( indices(finder.find(data)) == indices(expected) );
+
+            finder.clearCache();
+            REQUIRE( finder.cachedSizes() == 0 );
+            REQUIRE( indices(finder.find(data)) == indices(expected) );
+            REQUIRE( finder.cachedSizes() == 1 );
+        }
+        THEN( "check invalid widths" ) {
+            REQUIRE_THROWS_AS( core::CWTPeakFinder<double>(std::vector<double>()), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::CWTPeakFinder<double>(std::vector<double>{1.0, 0.0}), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::CWTPeakFinder<double>(widths, std::vector<double>{1.0}), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::CWTPeakFinder<double>(widths, {}, 0.0, 0, 1.0, 120.0), PeakingDuckException );
+            REQUIRE_THROWS_AS( core::CWTPeakFinder<double>(widths, {}, 0.0, -1), PeakingDuckException );
+        }
+    }
+
+PEAKINGDUCK_NAMESPACE_END // unittests
+PEAKINGDUCK_NAMESPACE_END // peakingduck
@@ -106,4 +106,267 @@ class NumericalDataUnitTest(unittest.TestCase):
 
         for e, a in zip(expected_order20, data.snip(range(1,21)).to_list()):
             self.assertAlmostEqual(e, a, delta=1e-12, msg="Assert 20th order")
-        
\ No newline at end of file
+        
+    def test_thresholding(self):
+        data = pkd.core.NumericalData([-2.0, 0.0, 1.5, 3.0, 7.5, -0.5])
+        mask = pkd.core.NumericalData([1.0, 0.0, 0.0, 2.0, 1.0, 1.0])
+
+        self.assertEqual([0.0, 0.0, 1.5, 3.0, 7.5, 0.0], data.ramp(0.0).to_list(), "Assert ramp")
+        self.assertEqual([0.0, 0.0, 1.5, 3.0, 3.0, 0.0], data.clip(0.0, 3.0).to_list(), "Assert clip")
+        self.assertEqual([0.0, 0.0, 0.0, 3.0, 7.5, 0.0], data.zeroBelow(1.5).to_list(), "Assert zero below")
+        self.assertEqual([-2.0, 0.0, 0.0, 3.0, 7.5, -0.5], data.mask(mask).to_list(), "Assert mask")
+
+        data.clipInPlace(-1.0, 5.0)
+        self.assertEqual([-1.0, 0.0, 1.5, 3.0, 5.0, -0.5], data.to_list(), "Assert clip in place")
+
+        values = pkd.core.IntegerData([-2, 0, 1, 3, 7, -1])
+        values.zeroBelowInPlace(1)
+        self.assertEqual([0, 0, 0, 3, 7, 0], values.to_list(), "Assert integer zero below in place")
+
+    def test_statistics(self):
+        data = pkd.core.NumericalData([1.0, 4.0, 5.0, 2.0, 10.0, -2.0, 2.0, 10.0, -2.0])
+        stats = data.statistics()
+        self.assertEqual(9, stats.count, "Assert count")
+        self.assertEqual(30.0, stats.sum, "Assert sum")
+        self.assertAlmostEqual(30.0/9.0, stats.mean, msg="Assert mean")
+        self.assertAlmostEqual(data.stddev(1), stats.stddev(1), msg="Assert stddev")
+        self.assertEqual(-2.0, stats.min, "Assert min")
+        self.assertEqual(10.0, stats.max, "Assert max")
+        self.assertEqual(5, stats.argmin, "Assert argmin")
+        self.assertEqual(4, stats.argmax, "Assert argmax")
+
+    def test_moving_average_edges(self):
+        data = pkd.core.NumericalData([3.0, 5.0, 4.0, 12.0, 23.0, 3.0, 7.0, 5.0, 3.0, 4.0, 8.0])
+        kept = pkd.core.MovingAverageSmoother(2).go(data).to_list()
+        truncated = pkd.core.MovingAverageSmoother(2, pkd.core.EdgeMode.Truncate).go(data).to_list()
+        for e, v in zip([3.0, 5.0, 9.4, 9.4, 9.8, 10.0, 8.2, 4.4, 5.4, 4.0, 8.0], kept):
+            self.assertAlmostEqual(e, v, msg="Assert kept edges")
+        for e, v in zip([4.0, 6.0, 9.4, 9.4, 9.8, 10.0, 8.2, 4.4, 5.4, 5.0, 5.0], truncated):
+            self.assertAlmostEqual(e, v, msg="Assert truncated edges")
+        fixed = pkd.core.make_moving_average_smoother(2, edgemode=pkd.core.EdgeMode.Truncate).go(data).to_list()
+        for e, v in zip(truncated, fixed):
+            self.assertAlmostEqual(e, v, msg="Assert fixed window truncated edges")
+
+    def test_weighted_moving_average(self):
+        data = pkd.core.NumericalData([3.0, 5.0, 4.0, 12.0, 23.0, 3.0, 7.0, 5.0, 3.0, 4.0, 8.0])
+        smoothed = pkd.core.WeightedMovingAverageSmoother(3).go(data).to_list()
+        for e, v in zip([3.0, 5.0, 4.0, 12.75, 15.25, 9.0, 5.5, 5.0, 3.0, 4.0, 8.0], smoothed):
+            self.assertAlmostEqual(e, v, msg="Assert weights [1,2,1]/4 in the interior")
+
+    def test_savitzky_golay(self):
+        data = pkd.core.NumericalData([2.0, 2.0, 5.0, 2.0, 1.0, 0.0, 1.0, 4.0, 9.0])
+        smoothed = pkd.core.SavitzkyGolaySmoother(5, 2).go(data).to_list()
+        for e, v in zip([1.66, 3.17, 3.54, 2.86, 0.66, 0.17, 1.0, 4.0, 9.0], smoothed):
+            self.assertAlmostEqual(e, v, delta=0.005, msg="Assert same as scipy savgol_filter")
+
+        quadratic = pkd.core.NumericalData([0.5*x*x for x in range(20)])
+        derivative = pkd.core.SavitzkyGolaySmoother(7, 2, deriv=1).go(quadratic).to_list()
+        for x, v in enumerate(derivative):
+            self.assertAlmostEqual(float(x), v, msg="Assert derivative")
+
+    def test_convolution(self):
+        data = pkd.core.NumericalData([1.0, 2.0, 3.0, 4.0, 5.0])
+        kernel = pkd.core.NumericalData([1.0, 0.0, -1.0])
+        for method in [pkd.core.ConvolutionMethod.Direct, pkd.core.ConvolutionMethod.FFT]:
+            for e, v in zip([2.0, 2.0, 2.0, 2.0, -4.0], pkd.core.convolve(data, kernel, method).to_list()):
+                self.assertAlmostEqual(e, v, msg="Assert same as numpy convolve")
+            for e, v in zip([-2.0, -2.0, -2.0, -2.0, 4.0], pkd.core.correlate(data, kernel, method).to_list()):
+                self.assertAlmostEqual(e, v, msg="Assert same as numpy correlate")
+
+        flat = pkd.core.NumericalData([3.0]*50)
+        smoothed = pkd.core.make_gaussian_smoother(4.0, edgemode=pkd.core.EdgeMode.Truncate).go(flat).to_list()
+        for v in smoothed:
+            self.assertAlmostEqual(3.0, v, msg="Assert constant unchanged")
+
+        triangular = pkd.core.make_triangular_smoother(1).go(data).to_list()
+        for e, v in zip([1.0, 2.0, 3.0, 4.0, 5.0], triangular):
+            self.assertAlmostEqual(e, v, msg="Assert line unchanged")
+
+    def test_resolution_smoothing(self):
+        calibration = pkd.core.FWHMCalibration(4.0, 0.0, 1e-4)
+        self.assertAlmostEqual(2.0, calibration(0.0), msg="Assert calibration")
+
+        edges = pkd.core.NumericalData([float(i) for i in range(101)])
+        bank = pkd.core.GaussianKernelBank(edges, calibration)
+        self.assertEqual(100, bank.nchannels, "Assert number of channels")
+        self.assertAlmostEqual(1.0, sum(bank.kernel(50).to_list()), msg="Assert kernel normalised")
+
+        line = pkd.core.NumericalData([2.0 + 0.5*i for i in range(100)])
+        for smoother in [pkd.core.ResolutionSmoother(bank), pkd.core.ResolutionSmoother(edges, lambda e: 2.0 + 0.01*e)]:
+            for e, v in zip(line.to_list(), smoother.go(line).to_list()):
+                self.assertAlmostEqual(e, v, msg="Assert line unchanged")
+
+    def test_rolling_quantile(self):
+        data = pkd.core.NumericalData([10.0, 10.0, 10.0, 1000.0, 10.0, 10.0, -50.0, 10.0, 10.0])
+        for v in pkd.core.RollingMedianFilter(1, pkd.core.EdgeMode.Truncate).go(data).to_list():
+            self.assertAlmostEqual(10.0, v, msg="Assert spikes removed")
+
+        line = pkd.core.NumericalData([float(i) for i in range(10)])
+        filtered = pkd.core.RollingQuantileFilter(2, 0.25).go(line).to_list()
+        for e, v in zip([0.0, 1.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 8.0, 9.0], filtered):
+            self.assertAlmostEqual(e, v, msg="Assert same as numpy quantile")
+
+    def test_window_peak_finder(self):
+        values = [10.0]*60
+        values[30:33] = [40.0, 100.0, 40.0]
+        peaks = pkd.core.WindowPeakFinder(threshold=2.0, nouter=20, ninner=2, enforce_maximum=True).find(pkd.core.NumericalData(values))
+        self.assertEqual([31], [p.index for p in peaks], "Assert peak index")
+        self.assertEqual([100.0], [p.value for p in peaks], "Assert peak value")
+
+    def test_chunked_peaks(self):
+        data = pkd.core.NumericalData([0.0, 1.0, 5.0, 6.0, 7.0, 1.0, 0.0, 4.0, 0.0, 0.0])
+        peaks = pkd.core.ChunkedSimplePeakFinder(threshold=0.5, nchunks=3).find(data)
+        self.assertEqual([4, 7], [p.index for p in peaks], "Assert one peak across the chunk boundary")
+
+        filtered = pkd.core.ChunkedThresholdPeakFilter(0.5, 3).go(data).to_list()
+        self.assertEqual([0.0, 0.0, 5.0, 6.0, 7.0, 0.0, 0.0, 4.0, 0.0, 0.0], filtered, "Assert chunk thresholds")
+
+    def test_local_maxima_peaks(self):
+        data = pkd.core.NumericalData([0.0, 2.0, 1.0, 3.0, 1.0, 4.0, 4.0, 4.0, 0.0, 2.0, 2.0, 0.0])
+        peaks = pkd.core.LocalMaximaPeakFinder().find(data)
+        self.assertEqual([1, 3, 6, 9], [p.index for p in peaks], "Assert local maxima, middle of flat tops")
+
+        finder = pkd.core.LocalMaximaPeakFinder(height=(2.0, 3.0), distance=3)
+        self.assertEqual([3, 9], [p.index for p in finder.find(data)], "Assert height and distance")
+
+        indices, properties = pkd.core.LocalMaximaPeakFinder(prominence=2, width=0).find_with_properties(data)
+        self.assertEqual([3, 6, 9], indices, "Assert prominence")
+        self.assertEqual([2.0, 4.0, 2.0], properties["prominences"], "Assert prominences")
+        self.assertEqual([1, 3, 2], properties["plateau_sizes"], "Assert plateau sizes")
+        for e, v in zip([1.0, 7.5 - 13.0/3.0, 2.0], properties["widths"]):
+            self.assertAlmostEqual(e, v, delta=1e-12, msg="Assert widths")
+
+        lower = pkd.core.NumericalData([3.5]*len(data))
+        self.assertEqual([6], [p.index for p in pkd.core.LocalMaximaPeakFinder(height=lower).find(data)], "Assert height per point")
+
+    def test_gaussian_fit(self):
+        values = [20.0 + 0.05*i + 1000.0*math.exp(-0.5*((i - 100.3)/2.1)**2) for i in range(200)]
+        data = pkd.core.NumericalData(values)
+        peaks = [pkd.core.PeakInfo(100, values[100])]
+        fits = pkd.core.GaussianPeakFitter(tolerance=1e-10).fit(data, peaks, 15)
+        self.assertEqual(1, len(fits), "Assert one peak")
+        self.assertAlmostEqual(100.3, fits.centroids[0], delta=1e-6, msg="Assert centroid")
+        self.assertAlmostEqual(2.1*2.3548200450309493, fits.fwhms[0], delta=1e-6, msg="Assert FWHM")
+        self.assertAlmostEqual(1000.0*2.1*math.sqrt(2.0*math.pi), fits.areas[0], delta=1e-4, msg="Assert area")
+        self.assertTrue(fits.converged[0], "Assert converged")
+        self.assertFalse(fits.stalled[0], "Assert not stalled")
+
+        regions = pkd.core.fit_regions(peaks, 15, len(data))
+        self.assertEqual([85, 116], [regions[0].first, regions[0].last], "Assert region")
+        fits = pkd.core.GaussianPeakFitter(pkd.core.FitBackground.Quadratic).fit(data, regions)
+        self.assertAlmostEqual(100.3, fits.centroids[0], delta=1e-6, msg="Assert quadratic background centroid")
+
+    def test_peak_table(self):
+        data = pkd.core.NumericalData([0.0, 2.0, 1.0, 3.0, 1.0, 4.0, 4.0, 4.0, 0.0, 2.0, 2.0, 0.0])
+        finder = pkd.core.LocalMaximaPeakFinder(prominence=0)
+        table = finder.find_table(data)
+        self.assertEqual([1, 3, 6, 9], list(table.indices), "Assert indices")
+        self.assertEqual([1.0, 2.0, 4.0, 2.0], list(table.scores), "Assert prominences as scores")
+
+        # the columns share the memory of the table
+        table.energies[:] = [10.0, 30.0, 60.0, 90.0]
+        table.sort_by(pkd.core.PeakColumn.Score, descending=True)
+        self.assertEqual([6, 3, 9, 1], list(table.indices), "Assert sorted by score, stable")
+        self.assertEqual([60.0, 30.0, 90.0, 10.0], list(table.energies), "Assert energies moved with the rows")
+        table.filter(pkd.core.PeakColumn.Energy, 20.0, 80.0)
+        self.assertEqual([6, 3], list(table.indices), "Assert filtered")
+
+        pkd.core.SimplePeakFinder(0.5).find_table(data, table)
+        self.assertEqual([p.index for p in pkd.core.SimplePeakFinder(0.5).find(data)], list(table.indices), "Assert reused table")
+
+        # the table can not grow beyond its capacity while a column array is alive
+        table.clear()
+        scores = table.scores
+        self.assertTrue(table.pinned, "Assert pinned by the array")
+        with self.assertRaises(Exception):
+            table.reserve(table.capacity + 1)
+        with self.assertRaises(Exception):
+            for i in range(table.capacity + 1):
+                table.append(i, 1.0)
+        del scores
+        self.assertFalse(table.pinned, "Assert unpinned")
+        table.reserve(table.capacity + 1)
+
+    def test_cwt_peaks(self):
+        values = [3.0 + 25.0*math.exp(-0.5*((i - 100)/3.0)**2) + 30.0*math.exp(-0.5*((i - 300)/2.0)**2) for i in range(400)]
+        data = pkd.core.NumericalData(values)
+        finder = pkd.core.CWTPeakFinder([1.0, 2.0, 3.0, 4.0, 6.0, 8.0], min_snr=2.0)
+        indices = [p.index for p in finder.find(data)]
+        # within a channel, the even wavelets are centred between two
+        self.assertTrue(any(abs(i - 100) <= 1 for i in indices), "Assert wide peak")
+        self.assertTrue(any(abs(i - 300) <= 1 for i in indices), "Assert narrow peak")
+
+        rows = finder.transform(data)
+        self.assertEqual(6, len(rows), "Assert one row per width")
+        self.assertEqual(len(data), len(rows[0]), "Assert row size")
+        self.assertEqual(11, len(pkd.core.ricker_wavelet(11, 2.0)), "Assert wavelet size")
+
+    def test_gradient_peaks(self):
+        values = [20.0 + 500.0*math.exp(-0.5*((i - 100.3)/3.0)**2) + 300.0*math.exp(-0.5*((i - 200.75)/3.0)**2) for i in range(300)]
+        data = pkd.core.NumericalData(values)
+        finder = pkd.core.GradientPeakFinder(window_size=7, order=2, height=100.0)
+        self.assertEqual([100, 201], [p.index for p in finder.find(data)], "Assert nearest points")
+
+        peaks = finder.find_with_positions(data)
+        self.assertEqual([100, 201], peaks["indices"], "Assert indices")
+        for e, v in zip([100.3, 200.75], peaks["positions"]):
+            self.assertAlmostEqual(e, v, delta=0.02, msg="Assert sub-channel positions")
+        self.assertTrue(all(c > 0.0 for c in peaks["curvatures"]), "Assert negative second derivative")
+
+        values = [10.0]*60
+        values[29:35] = [30.0, 70.0, 100.0, 90.0, 70.0, 30.0]
+        data = pkd.core.NumericalData(values)
+        self.assertEqual([31, 32], [p.index for p in pkd.core.WindowPeakFinder(nouter=20).find(data)], "Assert without gradient")
+        self.assertEqual([31], [p.index for p in pkd.core.WindowPeakFinder(nouter=20, use_grad=True).find(data)], "Assert gradient turns")
+
+    def test_multiplet_fit(self):
+        values = [20.0 + 1000.0*math.exp(-0.5*((i - 100.0)/2.0)**2) + 600.0*math.exp(-0.5*((i - 103.5)/2.0)**2) for i in range(200)]
+        data = pkd.core.NumericalData(values)
+        self.assertEqual(1, len(pkd.core.SimplePeakFinder(0.05).find(data)), "Assert one group")
+
+        regions = pkd.core.multiplet_regions(data, 0.05, 8)
+        self.assertEqual(1, len(regions), "Assert one region")
+        fitter = pkd.core.MultipletFitter(max_components=3, tolerance=1e-10)
+        fits = fitter.fit(data, regions)
+        self.assertEqual(2, len(fits), "Assert two peaks")
+        for e, v in zip([100.0, 103.5], fits.centroids):
+            self.assertAlmostEqual(e, v, delta=1e-6, msg="Assert centroids")
+        self.assertAlmostEqual(fits.fwhms[0], fits.fwhms[1], delta=1e-12, msg="Assert shared width")
+
+        criteria = fitter.criteria(data, regions[0])
+        self.assertEqual(3, len(criteria), "Assert a criterion per number of peaks")
+        self.assertEqual(1, criteria.index(min(criteria)), "Assert two peaks lowest")
+
+    def test_batch(self):
+        spectra = [pkd.core.NumericalData([1.0, 42.2, 61.4, 2.1, 4.2, 23.4, 52.32, 2.3]),
+                   pkd.core.NumericalData([3.0, 2.2, 6.4, 12.1, 4.2, 3.4, 5.32, 22.3])]
+        batch = pkd.core.NumericalBatch(spectra)
+        self.assertEqual(2, len(batch), "Assert number of spectra")
+        self.assertEqual(8, batch.nchannels, "Assert number of channels")
+
+        for s, spectrum in enumerate(spectra):
+            self.assertEqual(spectrum.to_list(), batch[s].to_list(), "Assert spectrum")
+            self.assertEqual(spectrum.snip(3).to_list(), batch.snip(3)[s].to_list(), "Assert snip")
+            for e, a in zip(spectrum.midpoint(2).to_list(), batch.midpoint(2)[s].to_list()):
+                self.assertAlmostEqual(e, a, delta=1e-12, msg="Assert midpoint")
+
+    def test_float32(self):
+        values = [1.0, 42.2, 61.4, 2.1, 4.2, 23.4, 52.32, 2.3]
+        a = pkd.core.NumericalDataF32(values)
+        self.assertEqual(len(values), len(a), "Assert length of list")
+        for e, v in zip(values, a.to_list()):
+            self.assertAlmostEqual(e, v, delta=1e-5, msg="Assert values")
+
+        d = pkd.core.NumericalData(values)
+        for e, v in zip(d.snip(3).to_list(), a.snip(3).to_list()):
+            self.assertAlmostEqual(e, v, delta=1e-4, msg="Assert snip")
+        for e, v in zip(d.to_list(), d.to_float32().to_float64().to_list()):
+            self.assertAlmostEqual(e, v, delta=1e-5, msg="Assert round trip")
+
+        smoothed = pkd.core.MovingAverageSmootherF32(1).go(a)
+        for e, v in zip(pkd.core.MovingAverageSmoother(1).go(d).to_list(), smoothed.to_list()):
+            self.assertAlmostEqual(e, v, delta=1e-4, msg="Assert smoothing")
+
+        batch = pkd.core.NumericalBatchF32([a, a])
+        self.assertEqual(2, len(batch), "Assert number of spectra")
+        self.assertEqual(a.snip(3).to_list(), batch.snip(3)[1].to_list(), "Assert batch snip")
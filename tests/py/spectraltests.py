@@ -37,3 +37,12 @@ class SpectralDataUnitTest(unittest.TestCase):
             
         self.assertEqual(counts.snip(2).to_list(), hist.estimateBackground(range(1, 3)).to_list(), "Assert snip")
 
+
+    def test_snip_engine(self):
+        narray = pkd.core.NumericalData
+        
+        counts = narray([2, 4, 34, 54, 45, 23, 25, 10, 12])
+        engine = pkd.core.SNIPEngine()
+        for _ in range(2):
+            self.assertEqual(counts.snip(range(1, 4)).to_list(), engine.estimate(counts, range(1, 4)).to_list(), "Assert snip engine")
+        self.assertEqual(counts.snip(3).to_list(), engine.estimate(counts, 3).to_list(), "Assert snip engine iterations")